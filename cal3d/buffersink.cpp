@@ -0,0 +1,102 @@
+#include "stdafx.h"
+//****************************************************************************//
+// buffersink.cpp                                                            //
+// Copyright (C) 2001-2003 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "buffersink.h"
+#include "calerror.h"
+
+ /*****************************************************************************/
+/** Constructs a buffer sink instance from an existing vector.
+  *
+  * This function is the only constructor of the buffer sink. Written data is
+  * appended behind the current contents of the vector.
+  *
+  * @param vectorBuffer The vector to append the data to. It must stay alive
+  *                     as long as the buffer sink is used.
+  *****************************************************************************/
+
+CalBufferSink::CalBufferSink(std::vector<char>& vectorBuffer)
+  : mOutputBuffer(&vectorBuffer), mFailed(false)
+{
+}
+
+
+/**
+ * Destruct the CalBufferSink. Note that the buffer is not cleared here;
+ * it belongs to the caller.
+ */
+
+CalBufferSink::~CalBufferSink()
+{
+}
+
+ /*****************************************************************************/
+/** Checks whether the data sink is in a good state.
+  *
+  * This function checks if the buffer can be used.
+  *
+  * @return One of the following values:
+  *         \li \b true if data sink is in a good state
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalBufferSink::ok() const
+{
+   return (mOutputBuffer != NULL) && !mFailed;
+}
+
+ /*****************************************************************************/
+/** Sets the error code and message related to a memory buffer sink.
+  *
+  *****************************************************************************/
+
+void CalBufferSink::setError() const
+{
+   CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
+}
+
+ /*****************************************************************************/
+/** Writes a number of bytes.
+  *
+  * This function appends a given number of bytes to the buffer.
+  *
+  * @param pBuffer A pointer to the bytes that should be written.
+  * @param length The number of bytes that should be written.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalBufferSink::writeBytes(const void* pBuffer, int length)
+{
+   if (!ok() || (length < 0) || ((pBuffer == NULL) && (length > 0))) return false;
+
+   const char* pData = (const char*)pBuffer;
+   try
+   {
+      mOutputBuffer->insert(mOutputBuffer->end(), pData, pData + length);
+   }
+   catch (std::bad_alloc&)
+   {
+      mFailed = true;
+      return false;
+   }
+
+   return true;
+}
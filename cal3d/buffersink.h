@@ -0,0 +1,50 @@
+//****************************************************************************//
+// buffersink.h                                                              //
+// Copyright (C) 2001-2003 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_BUFFERSINK_H
+#define CAL_BUFFERSINK_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+#include "caldatasink.h"
+
+/**
+ * CalBufferSink class.
+ *
+ * This is an object designed to represent a sink for Cal3d data as going to
+ * a memory buffer. The data is appended to a vector owned by the caller, so a
+ * file can be saved into memory and handed to CalBufferSource or an archive
+ * without a round trip through the file system.
+ */
+
+
+class CAL3D_API CalBufferSink : public CalDataSink
+{
+public:
+   CalBufferSink(std::vector<char>& vectorBuffer);
+   virtual ~CalBufferSink();
+
+   virtual bool ok() const;
+   virtual void setError() const;
+   virtual bool writeBytes(const void* pBuffer, int length);
+
+protected:
+
+   std::vector<char>* mOutputBuffer;
+   bool mFailed;
+
+private:
+   CalBufferSink(); //Can't use this
+};
+
+#endif
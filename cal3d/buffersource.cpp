@@ -26,10 +26,12 @@
   * This function is the only constructor of the buffer source.
   *
   * @param inputBuffer The input buffer to read from
+  * @param length The size of the input buffer in bytes. Reads past it fail.
+  *               A negative length leaves the reads unchecked.
   *****************************************************************************/
 
-CalBufferSource::CalBufferSource(void* inputBuffer)
-  : mInputBuffer(inputBuffer), mOffset(0)
+CalBufferSource::CalBufferSource(void* inputBuffer, int length)
+  : mInputBuffer(inputBuffer), mOffset(0), mLength(length), mFailed(false)
 {
 }
 
@@ -56,7 +58,7 @@ CalBufferSource::~CalBufferSource()
 
 bool CalBufferSource::ok() const
 {
-   if (mInputBuffer == NULL)
+   if ((mInputBuffer == NULL) || mFailed)
       return false;
 
    return true;
@@ -69,7 +71,36 @@ bool CalBufferSource::ok() const
 
 void CalBufferSource::setError() const
 {
-   CalError::setLastError(CalError::NULL_BUFFER, __FILE__, __LINE__);
+   if (mInputBuffer == NULL)
+      CalError::setLastError(CalError::NULL_BUFFER, __FILE__, __LINE__);
+   else
+      CalError::setLastError(CalError::BAD_DATA_SOURCE, __FILE__, __LINE__);
+}
+
+ /*****************************************************************************/
+/** Checks that a number of bytes are left in the buffer.
+  *
+  * This function puts the data source into an error state if a read of the
+  * given size would go past the end of the buffer.
+  *
+  * @param length The number of bytes that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if the bytes can be read
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalBufferSource::canRead(int length)
+{
+   if (!ok()) return false;
+
+   if ((length < 0) || ((mLength >= 0) && ((unsigned int)length > (unsigned int)mLength - mOffset)))
+   {
+      mFailed = true;
+      return false;
+   }
+
+   return true;
 }
 
  /*****************************************************************************/
@@ -88,7 +119,7 @@ void CalBufferSource::setError() const
 bool CalBufferSource::readBytes(void* pBuffer, int length)
 {
    //Check that the buffer and the target are usable
-   if (!ok() || (pBuffer == NULL)) return false;
+   if ((pBuffer == NULL) || !canRead(length)) return false;
    
    bool result = CalPlatform::readBytes( ((char*)mInputBuffer+mOffset), pBuffer, length );
    mOffset += length;
@@ -111,7 +142,7 @@ bool CalBufferSource::readBytes(void* pBuffer, int length)
 bool CalBufferSource::readFloat(float& value)
 {
    //Check that the buffer is usable
-   if (!ok()) return false;
+   if (!canRead(4)) return false;
 
    bool result = CalPlatform::readFloat( ((char*)mInputBuffer+mOffset), value );
    mOffset += 4;
@@ -134,7 +165,7 @@ bool CalBufferSource::readFloat(float& value)
 bool CalBufferSource::readShort(short& value)
 {
    //Check that the buffer is usable
-   if (!ok()) return false;
+   if (!canRead(2)) return false;
 
    bool result = CalPlatform::readShort( ((char*)mInputBuffer+mOffset), value );
    mOffset += 2;
@@ -157,7 +188,7 @@ bool CalBufferSource::readShort(short& value)
 bool CalBufferSource::readInteger(int& value)
 {
    //Check that the buffer is usable
-   if (!ok()) return false;
+   if (!canRead(4)) return false;
 
    bool result = CalPlatform::readInteger( ((char*)mInputBuffer+mOffset), value );
    mOffset += 4;
@@ -179,8 +210,11 @@ bool CalBufferSource::readInteger(int& value)
 
 bool CalBufferSource::readString(std::string& strValue)
 {
-   //Check that the buffer is usable
-   if (!ok()) return false;
+   //Check that the buffer is usable, including the stored string length
+   int length;
+   if (!canRead(4)) return false;
+   CalPlatform::readInteger( ((char*)mInputBuffer+mOffset), length );
+   if (!canRead(4 + length)) return false;
 
    bool result = CalPlatform::readString( ((char*)mInputBuffer+mOffset), strValue );
 
@@ -188,3 +222,90 @@ bool CalBufferSource::readString(std::string& strValue)
    
    return result;
 }
+
+ /*****************************************************************************/
+/** Maps a number of bytes.
+  *
+  * This function returns the address of the next bytes of the buffer without
+  * copying them and moves the read position behind them.
+  *
+  * @param length The number of bytes that should be mapped.
+  *
+  * @return One of the following values:
+  *         \li the address of the bytes
+  *         \li \b NULL if an error happend
+  *****************************************************************************/
+
+const char* CalBufferSource::mapBytes(int length)
+{
+   if (!canRead(length)) return NULL;
+
+   const char* pData = (const char*)mInputBuffer + mOffset;
+   mOffset += length;
+
+   return pData;
+}
+
+ /*****************************************************************************/
+/** Returns the number of bytes left to read.
+  *
+  * @return The number of bytes behind the read position, or -1 if the buffer
+  *         was given without a length.
+  *****************************************************************************/
+
+int CalBufferSource::getRemainingSize() const
+{
+   if ((mLength < 0) || !ok()) return -1;
+
+   return mLength - (int)mOffset;
+}
+
+ /*****************************************************************************/
+/** Reads a number of floats.
+  *
+  * This function reads a given number of floats from this data source in one
+  * block.
+  *
+  * @param pValue A pointer to the array into which the data is read.
+  * @param count The number of floats that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalBufferSource::readFloats(float* pValue, int count)
+{
+   //Check that the buffer is usable
+   if ((count < 0) || (count > 0x1fffffff) || !canRead(4 * count)) return false;
+
+   bool result = CalPlatform::readFloats( ((char*)mInputBuffer+mOffset), pValue, count );
+   mOffset += 4 * count;
+
+   return result;
+}
+
+ /*****************************************************************************/
+/** Reads a number of integers.
+  *
+  * This function reads a given number of integers from this data source in one
+  * block.
+  *
+  * @param pValue A pointer to the array into which the data is read.
+  * @param count The number of integers that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalBufferSource::readIntegers(int* pValue, int count)
+{
+   //Check that the buffer is usable
+   if ((count < 0) || (count > 0x1fffffff) || !canRead(4 * count)) return false;
+
+   bool result = CalPlatform::readIntegers( ((char*)mInputBuffer+mOffset), pValue, count );
+   mOffset += 4 * count;
+
+   return result;
+}
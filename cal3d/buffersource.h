@@ -34,7 +34,7 @@
 class CAL3D_API CalBufferSource : public CalDataSource
 {
 public:
-   CalBufferSource(void* inputBuffer);
+   CalBufferSource(void* inputBuffer, int length = -1);
    virtual ~CalBufferSource();
 
    virtual bool ok() const;
@@ -44,11 +44,19 @@ public:
    virtual bool readShort(short& value);
    virtual bool readInteger(int& value);
    virtual bool readString(std::string& strValue);
+   virtual bool readFloats(float* pValue, int count);
+   virtual bool readIntegers(int* pValue, int count);
+   virtual const char* mapBytes(int length);
+   virtual int getRemainingSize() const;
 
 protected:
 
+   bool canRead(int length);
+
    void* mInputBuffer;
    unsigned int mOffset;   
+   int mLength;
+   bool mFailed;
 
 private:
    CalBufferSource(); //Can't use this
@@ -15,6 +15,10 @@
 // Includes                                                                   //
 //****************************************************************************//
 
+#include "calarchive.h"
+#include "calarena.h"
+#include "calassetcache.h"
+#include "calasyncloader.h"
 #include "calbone.h"
 #include "calcoreanim.h"
 #include "calcorebone.h"
@@ -22,10 +26,15 @@
 #include "calcoremodel.h"
 #include "calcoresub.h"
 #include "calcoretrack.h"
+#include "calencoder.h"
 #include "calerror.h"
 #include "calloader.h"
+#include "callodbuilder.h"
+#include "callodmanager.h"
 #include "calmatrix.h"
+#include "calmeshoptimizer.h"
 #include "calmodel.h"
+#include "calnametable.h"
 #include "calquat.h"
 #include "calsaver.h"
 #include "calsub.h"
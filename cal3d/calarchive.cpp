@@ -0,0 +1,587 @@
+#include "stdafx.h"
+//****************************************************************************//
+// archive.cpp                                                                //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calarchive.h"
+#include "calerror.h"
+#include "calloader.h"
+#include "mappedfilesource.h"
+
+#include <fstream>
+#include <algorithm>
+
+ /*****************************************************************************/
+/** Constructs the archive instance.
+  *
+  * This function is the default constructor of the archive instance.
+  *****************************************************************************/
+
+CalArchive::CalArchive()
+  : m_pFileSource(0), m_pData(0), m_pHeader(0), m_pFirstEntry(0), m_pEntry(0), m_pName(0)
+{
+}
+
+ /*****************************************************************************/
+/** Destructs the archive instance.
+  *
+  * This function is the destructor of the archive instance.
+  *****************************************************************************/
+
+CalArchive::~CalArchive()
+{
+  destroy();
+}
+
+ /*****************************************************************************/
+/** Opens the archive instance.
+  *
+  * This function maps an archive file and checks its table of contents, so
+  * that the lookups afterwards do not have to.
+  *
+  * @param strFilename The name of the archive file.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalArchive::create(const std::string& strFilename)
+{
+  destroy();
+
+  m_pFileSource = new CalMappedFileSource(strFilename);
+  if(m_pFileSource == 0)
+  {
+    CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
+    return false;
+  }
+
+  if(!m_pFileSource->isMapped())
+  {
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
+    destroy();
+    return false;
+  }
+
+  m_pData = m_pFileSource->mapBytes(m_pFileSource->getSize());
+  if((m_pData == 0) || (m_pFileSource->getSize() < sizeof(CalArchiveFile::Header)))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strFilename);
+    destroy();
+    return false;
+  }
+
+  m_pHeader = (const CalArchiveFile::Header *)m_pData;
+  if(memcmp(m_pHeader->magic, Cal::ARCHIVE_FILE_MAGIC, sizeof(m_pHeader->magic)) != 0)
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strFilename);
+    destroy();
+    return false;
+  }
+
+  // archives only open on machines with the byte order they were written with
+  if((m_pHeader->version != Cal::ARCHIVE_FILE_VERSION) || (m_pHeader->byteOrder != CalArchiveFile::BYTE_ORDER_TAG))
+  {
+    CalError::setLastError(CalError::INCOMPATIBLE_FILE_VERSION, __FILE__, __LINE__, strFilename);
+    destroy();
+    return false;
+  }
+
+  if(!validate())
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strFilename);
+    destroy();
+    return false;
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Closes the archive instance.
+  *
+  * This function unmaps the archive file. Pointers returned by getEntryData()
+  * become invalid.
+  *****************************************************************************/
+
+void CalArchive::destroy()
+{
+  delete m_pFileSource;
+
+  m_pFileSource = 0;
+  m_pData = 0;
+  m_pHeader = 0;
+  m_pFirstEntry = 0;
+  m_pEntry = 0;
+  m_pName = 0;
+}
+
+ /*****************************************************************************/
+/** Looks up an entry.
+  *
+  * This function returns the ID of the entry with a given name. Names are
+  * compared exactly, as they were passed to the archive builder.
+  *
+  * @param strName The name of the entry.
+  *
+  * @return One of the following values:
+  *         \li the ID of the entry
+  *         \li \b -1 if the archive has no entry with this name
+  *****************************************************************************/
+
+int CalArchive::findEntry(const std::string& strName) const
+{
+  if((m_pHeader == 0) || (m_pHeader->entryCount == 0)) return -1;
+
+  unsigned int hash = CalArchiveFile::hashName(strName.data(), (unsigned int)strName.size());
+  unsigned int bucketId = hash % m_pHeader->bucketCount;
+
+  unsigned int entryId;
+  for(entryId = m_pFirstEntry[bucketId]; entryId < m_pFirstEntry[bucketId + 1]; entryId++)
+  {
+    const CalArchiveFile::Entry& entry = m_pEntry[entryId];
+    if((entry.hash == hash) && (entry.nameLength == strName.size()) && (memcmp(m_pName + entry.nameOffset, strName.data(), entry.nameLength) == 0))
+    {
+      return (int)entryId;
+    }
+  }
+
+  return -1;
+}
+
+ /*****************************************************************************/
+/** Returns the number of entries.
+  *
+  * This function returns the number of entries in the archive.
+  *
+  * @return The number of entries.
+  *****************************************************************************/
+
+int CalArchive::getEntryCount() const
+{
+  if(m_pHeader == 0) return 0;
+
+  return (int)m_pHeader->entryCount;
+}
+
+ /*****************************************************************************/
+/** Provides access to the data of an entry.
+  *
+  * This function returns the address of the data of an entry in the mapping.
+  * It stays valid until the archive is destroyed.
+  *
+  * @param entryId The ID of the entry.
+  *
+  * @return One of the following values:
+  *         \li the address of the data
+  *         \li \b 0 if the entry does not exist
+  *****************************************************************************/
+
+const void *CalArchive::getEntryData(int entryId) const
+{
+  if((entryId < 0) || (entryId >= getEntryCount())) return 0;
+
+  return m_pData + m_pEntry[entryId].offset;
+}
+
+ /*****************************************************************************/
+/** Returns the name of an entry.
+  *
+  * @param entryId The ID of the entry.
+  *
+  * @return One of the following values:
+  *         \li the name of the entry
+  *         \li an empty string if the entry does not exist
+  *****************************************************************************/
+
+std::string CalArchive::getEntryName(int entryId) const
+{
+  if((entryId < 0) || (entryId >= getEntryCount())) return "";
+
+  return std::string(m_pName + m_pEntry[entryId].nameOffset, m_pEntry[entryId].nameLength);
+}
+
+ /*****************************************************************************/
+/** Returns the size of an entry.
+  *
+  * @param entryId The ID of the entry.
+  *
+  * @return One of the following values:
+  *         \li the size of the entry in bytes
+  *         \li \b -1 if the entry does not exist
+  *****************************************************************************/
+
+int CalArchive::getEntrySize(int entryId) const
+{
+  if((entryId < 0) || (entryId >= getEntryCount())) return -1;
+
+  return (int)m_pEntry[entryId].size;
+}
+
+ /*****************************************************************************/
+/** Loads a core animation from an entry.
+  *
+  * This function loads a core animation from the data of an entry through
+  * the buffer entry point of the loader, without copying the entry.
+  *
+  * @param pCoreAnimation The core animation to load into.
+  * @param strName The name of the entry.
+  * @param pLoader The loader to use, or 0 for one with the default flags.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalArchive::loadCoreAnimation(CalCoreAnimation *pCoreAnimation, const std::string& strName, CalLoader *pLoader) const
+{
+  int entryId = findEntry(strName);
+  if(entryId == -1)
+  {
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strName);
+    return false;
+  }
+
+  CalLoader loader;
+  if(pLoader == 0) pLoader = &loader;
+
+  return pLoader->loadCoreAnimation(pCoreAnimation, (void *)getEntryData(entryId), getEntrySize(entryId), strName);
+}
+
+ /*****************************************************************************/
+/** Loads a core model from an entry.
+  *
+  * This function loads a core model from the data of an entry through the
+  * buffer entry point of the loader, without copying the entry.
+  *
+  * @param pCoreModel The core model to load into.
+  * @param strName The name of the entry.
+  * @param pLoader The loader to use, or 0 for one with the default flags.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalArchive::loadCoreModel(CalCoreModel *pCoreModel, const std::string& strName, CalLoader *pLoader) const
+{
+  int entryId = findEntry(strName);
+  if(entryId == -1)
+  {
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strName);
+    return false;
+  }
+
+  CalLoader loader;
+  if(pLoader == 0) pLoader = &loader;
+
+  return pLoader->loadCoreModel(pCoreModel, (void *)getEntryData(entryId), getEntrySize(entryId), strName);
+}
+
+ /*****************************************************************************/
+/** Checks the table of contents.
+  *
+  * This function checks that the tables, the names and the payloads lie
+  * within the file and that every entry sits in the bucket of its hash.
+  *
+  * @return One of the following values:
+  *         \li \b true if the table of contents is valid
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalArchive::validate()
+{
+  const unsigned long long fileSize = m_pFileSource->getSize();
+  const CalArchiveFile::Header& header = *m_pHeader;
+
+  if((header.entryCount > 0) && (header.bucketCount == 0)) return false;
+
+  unsigned long long offset = sizeof(CalArchiveFile::Header);
+  m_pFirstEntry = (const unsigned int *)(m_pData + offset);
+  offset += ((unsigned long long)header.bucketCount + 1) * sizeof(unsigned int);
+  if(offset > fileSize) return false;
+
+  m_pEntry = (const CalArchiveFile::Entry *)(m_pData + offset);
+  offset += (unsigned long long)header.entryCount * sizeof(CalArchiveFile::Entry);
+  if(offset > fileSize) return false;
+
+  m_pName = m_pData + offset;
+  offset += header.nameSize;
+  if(offset > fileSize) return false;
+
+  // the buckets must partition the entry table in order
+  if(m_pFirstEntry[0] != 0) return false;
+
+  unsigned int bucketId;
+  for(bucketId = 0; bucketId < header.bucketCount; bucketId++)
+  {
+    if(m_pFirstEntry[bucketId + 1] < m_pFirstEntry[bucketId]) return false;
+    if(m_pFirstEntry[bucketId + 1] > header.entryCount) return false;
+
+    unsigned int entryId;
+    for(entryId = m_pFirstEntry[bucketId]; entryId < m_pFirstEntry[bucketId + 1]; entryId++)
+    {
+      const CalArchiveFile::Entry& entry = m_pEntry[entryId];
+      if(entry.hash % header.bucketCount != bucketId) return false;
+      if((unsigned long long)entry.nameOffset + entry.nameLength > header.nameSize) return false;
+      if((unsigned long long)entry.offset + entry.size > fileSize) return false;
+      if(entry.size > 0x7fffffff) return false;
+    }
+  }
+
+  if(m_pFirstEntry[header.bucketCount] != header.entryCount) return false;
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Constructs the archive builder instance.
+  *
+  * This function is the default constructor of the archive builder instance.
+  *****************************************************************************/
+
+CalArchiveBuilder::CalArchiveBuilder()
+{
+}
+
+ /*****************************************************************************/
+/** Destructs the archive builder instance.
+  *
+  * This function is the destructor of the archive builder instance.
+  *****************************************************************************/
+
+CalArchiveBuilder::~CalArchiveBuilder()
+{
+}
+
+ /*****************************************************************************/
+/** Adds an entry.
+  *
+  * This function copies a block of data into the archive under a given name.
+  *
+  * @param strName The name of the entry, unique within the archive.
+  * @param pData The address of the data.
+  * @param size The size of the data in bytes.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalArchiveBuilder::addEntry(const std::string& strName, const void *pData, int size)
+{
+  if((size < 0) || ((pData == 0) && (size > 0)))
+  {
+    CalError::setLastError(CalError::NULL_BUFFER, __FILE__, __LINE__, strName);
+    return false;
+  }
+
+  if(std::find(m_vectorName.begin(), m_vectorName.end(), strName) != m_vectorName.end())
+  {
+    CalError::setLastError(CalError::INVALID_ATTRIBUTE_VALUE, __FILE__, __LINE__, strName);
+    return false;
+  }
+
+  m_vectorName.push_back(strName);
+  m_vectorPayload.push_back(std::vector<char>((const char *)pData, (const char *)pData + size));
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Adds a file.
+  *
+  * This function reads a whole file into the archive under a given name.
+  *
+  * @param strName The name of the entry, unique within the archive.
+  * @param strFilename The name of the file to add.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalArchiveBuilder::addFile(const std::string& strName, const std::string& strFilename)
+{
+  std::ifstream file;
+  file.open(strFilename.c_str(), std::ios::in | std::ios::binary);
+  if(!file)
+  {
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  std::vector<char> vectorData((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if(file.bad() || (vectorData.size() > 0x7fffffff))
+  {
+    CalError::setLastError(CalError::FILE_PARSER_FAILED, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  return addEntry(strName, vectorData.empty() ? "" : &vectorData[0], (int)vectorData.size());
+}
+
+ /*****************************************************************************/
+/** Removes all entries.
+  *
+  * This function removes all entries added so far.
+  *****************************************************************************/
+
+void CalArchiveBuilder::clear()
+{
+  m_vectorName.clear();
+  m_vectorPayload.clear();
+}
+
+ /*****************************************************************************/
+/** Returns the number of entries.
+  *
+  * This function returns the number of entries added so far.
+  *
+  * @return The number of entries.
+  *****************************************************************************/
+
+int CalArchiveBuilder::getEntryCount() const
+{
+  return (int)m_vectorName.size();
+}
+
+ /*****************************************************************************/
+/** Saves the archive.
+  *
+  * This function writes all entries added so far into an archive file.
+  *
+  * @param strFilename The name of the file to write.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalArchiveBuilder::save(const std::string& strFilename) const
+{
+  const unsigned int entryCount = (unsigned int)m_vectorName.size();
+  const unsigned int bucketCount = std::max(entryCount, 1u);
+
+  // sort the entries by bucket, keeping the order they were added in
+  std::vector<std::pair<unsigned int, unsigned int> > vectorOrder;
+  std::vector<CalArchiveFile::Entry> vectorEntry(entryCount);
+  std::vector<char> vectorName;
+
+  unsigned int entryId;
+  for(entryId = 0; entryId < entryCount; entryId++)
+  {
+    const std::string& strName = m_vectorName[entryId];
+
+    CalArchiveFile::Entry& entry = vectorEntry[entryId];
+    entry.hash = CalArchiveFile::hashName(strName.data(), (unsigned int)strName.size());
+    entry.nameOffset = (unsigned int)vectorName.size();
+    entry.nameLength = (unsigned int)strName.size();
+    entry.offset = 0;
+    entry.size = (unsigned int)m_vectorPayload[entryId].size();
+    entry.reserved[0] = 0;
+    entry.reserved[1] = 0;
+    entry.reserved[2] = 0;
+
+    vectorName.insert(vectorName.end(), strName.begin(), strName.end());
+    vectorOrder.push_back(std::make_pair(entry.hash % bucketCount, entryId));
+  }
+  std::stable_sort(vectorOrder.begin(), vectorOrder.end());
+
+  std::vector<unsigned int> vectorFirstEntry(bucketCount + 1, 0);
+  for(entryId = 0; entryId < entryCount; entryId++)
+  {
+    vectorFirstEntry[vectorOrder[entryId].first + 1]++;
+  }
+  unsigned int bucketId;
+  for(bucketId = 0; bucketId < bucketCount; bucketId++)
+  {
+    vectorFirstEntry[bucketId + 1] += vectorFirstEntry[bucketId];
+  }
+
+  // lay out the payloads behind the tables
+  unsigned long long offset = sizeof(CalArchiveFile::Header) + (bucketCount + 1) * sizeof(unsigned int) + entryCount * sizeof(CalArchiveFile::Entry) + vectorName.size();
+
+  std::vector<CalArchiveFile::Entry> vectorSortedEntry;
+  for(entryId = 0; entryId < entryCount; entryId++)
+  {
+    CalArchiveFile::Entry entry = vectorEntry[vectorOrder[entryId].second];
+    offset = (offset + CalArchiveFile::ALIGNMENT - 1) & ~(unsigned long long)(CalArchiveFile::ALIGNMENT - 1);
+    entry.offset = (unsigned int)offset;
+    offset += entry.size;
+    vectorSortedEntry.push_back(entry);
+  }
+
+  // the archive is mapped as a whole, so it has to fit the data sources
+  if(offset > 0x7fffffff)
+  {
+    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  CalArchiveFile::Header header;
+  memcpy(header.magic, Cal::ARCHIVE_FILE_MAGIC, sizeof(header.magic));
+  header.version = Cal::ARCHIVE_FILE_VERSION;
+  header.byteOrder = CalArchiveFile::BYTE_ORDER_TAG;
+  header.entryCount = entryCount;
+  header.bucketCount = bucketCount;
+  header.nameSize = (unsigned int)vectorName.size();
+  header.reserved[0] = 0;
+  header.reserved[1] = 0;
+
+  // open the file
+  std::ofstream file;
+  file.open(strFilename.c_str(), std::ios::out | std::ios::binary);
+  if(!file)
+  {
+    CalError::setLastError(CalError::FILE_CREATION_FAILED, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  // write the table of contents
+  file.write((const char *)&header, sizeof(header));
+  file.write((const char *)&vectorFirstEntry[0], vectorFirstEntry.size() * sizeof(unsigned int));
+  if(!vectorSortedEntry.empty()) file.write((const char *)&vectorSortedEntry[0], vectorSortedEntry.size() * sizeof(CalArchiveFile::Entry));
+  if(!vectorName.empty()) file.write(&vectorName[0], vectorName.size());
+
+  // write all payloads
+  static const char zero[CalArchiveFile::ALIGNMENT] = { 0 };
+  unsigned long long position = sizeof(CalArchiveFile::Header) + vectorFirstEntry.size() * sizeof(unsigned int) + vectorSortedEntry.size() * sizeof(CalArchiveFile::Entry) + vectorName.size();
+  for(entryId = 0; entryId < entryCount; entryId++)
+  {
+    const CalArchiveFile::Entry& entry = vectorSortedEntry[entryId];
+    const std::vector<char>& vectorPayload = m_vectorPayload[vectorOrder[entryId].second];
+
+    file.write(zero, (std::streamsize)(entry.offset - position));
+    if(!vectorPayload.empty()) file.write(&vectorPayload[0], vectorPayload.size());
+    position = entry.offset + entry.size;
+  }
+
+  if(!file)
+  {
+    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  // explicitly close the file
+  file.close();
+
+  return true;
+}
+
+//****************************************************************************//
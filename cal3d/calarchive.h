@@ -0,0 +1,162 @@
+//****************************************************************************//
+// archive.h                                                                  //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_ARCHIVE_H
+#define CAL_ARCHIVE_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+
+//****************************************************************************//
+// Forward declarations                                                       //
+//****************************************************************************//
+
+class CalCoreAnimation;
+class CalCoreModel;
+class CalLoader;
+class CalMappedFileSource;
+
+//****************************************************************************//
+// Archive file layout                                                        //
+//****************************************************************************//
+
+// An archive packs many files (cdf, caf, baked files, ...) into one file that
+// is mapped once, so opening an asset costs a table lookup instead of a file
+// system call.
+//
+// The file starts with a Header, followed by the bucket table, the entry table
+// and the name block. The bucket table holds bucketCount + 1 entry indices;
+// the entries of bucket b are firstEntry[b] .. firstEntry[b + 1] - 1, where b
+// is the hash of the entry name modulo bucketCount. The payloads follow, each
+// aligned to ALIGNMENT bytes from the start of the file.
+
+namespace CalArchiveFile
+{
+  const int ALIGNMENT = 16;
+  const int BYTE_ORDER_TAG = 0x01020304;
+
+  /// The file header, behind which the bucket table starts.
+  struct Header
+  {
+    char magic[4];
+    int version;
+    int byteOrder;
+    unsigned int entryCount;
+    unsigned int bucketCount;
+    unsigned int nameSize;
+    int reserved[2];
+  };
+
+  /// An entry of the entry table.
+  struct Entry
+  {
+    unsigned int hash;
+    unsigned int nameOffset;
+    unsigned int nameLength;
+    unsigned int offset;
+    unsigned int size;
+    int reserved[3];
+  };
+
+  /// Returns the hash of an entry name (32 bit FNV-1a).
+  inline unsigned int hashName(const char *pName, unsigned int length)
+  {
+    unsigned int hash = 2166136261u;
+    for(unsigned int i = 0; i < length; i++)
+    {
+      hash ^= (unsigned char)pName[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+}
+
+//****************************************************************************//
+// Class declaration                                                          //
+//****************************************************************************//
+
+ /*****************************************************************************/
+/** The archive class.
+  *
+  * This class maps an archive file and looks up its entries by name. The
+  * entries stay mapped until the archive is destroyed; core models and core
+  * animations are loaded straight from the mapping.
+  *****************************************************************************/
+
+class CAL3D_API CalArchive
+{
+// member variables
+protected:
+  CalMappedFileSource *m_pFileSource;
+  const char *m_pData;
+  const CalArchiveFile::Header *m_pHeader;
+  const unsigned int *m_pFirstEntry;
+  const CalArchiveFile::Entry *m_pEntry;
+  const char *m_pName;
+
+// constructors/destructor
+public:
+  CalArchive();
+  virtual ~CalArchive();
+
+// member functions
+public:
+  bool create(const std::string& strFilename);
+  void destroy();
+  int findEntry(const std::string& strName) const;
+  int getEntryCount() const;
+  const void *getEntryData(int entryId) const;
+  std::string getEntryName(int entryId) const;
+  int getEntrySize(int entryId) const;
+  bool loadCoreAnimation(CalCoreAnimation *pCoreAnimation, const std::string& strName, CalLoader *pLoader = 0) const;
+  bool loadCoreModel(CalCoreModel *pCoreModel, const std::string& strName, CalLoader *pLoader = 0) const;
+
+protected:
+  bool validate();
+
+private:
+  CalArchive(const CalArchive&);
+  CalArchive& operator=(const CalArchive&);
+};
+
+ /*****************************************************************************/
+/** The archive builder class.
+  *
+  * This class collects named files and writes them into an archive that can
+  * be opened with CalArchive.
+  *****************************************************************************/
+
+class CAL3D_API CalArchiveBuilder
+{
+// member variables
+protected:
+  std::vector<std::string> m_vectorName;
+  std::vector<std::vector<char> > m_vectorPayload;
+
+// constructors/destructor
+public:
+  CalArchiveBuilder();
+  virtual ~CalArchiveBuilder();
+
+// member functions
+public:
+  bool addEntry(const std::string& strName, const void *pData, int size);
+  bool addFile(const std::string& strName, const std::string& strFilename);
+  void clear();
+  int getEntryCount() const;
+  bool save(const std::string& strFilename) const;
+};
+
+#endif
+
+//****************************************************************************//
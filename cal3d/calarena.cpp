@@ -0,0 +1,211 @@
+#include "stdafx.h"
+//****************************************************************************//
+// arena.cpp                                                                  //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calarena.h"
+
+#include <utility>
+
+ /*****************************************************************************/
+/** Constructs the arena instance.
+  *
+  * This function is the default constructor of the arena instance. No memory
+  * is taken until the first allocation or reservation.
+  *****************************************************************************/
+
+CalArena::CalArena()
+  : m_capacity(0), m_size(0)
+{
+}
+
+ /*****************************************************************************/
+/** Destructs the arena instance.
+  *
+  * This function is the destructor of the arena instance. It frees all blocks
+  * without running the destructors of the objects in them.
+  *****************************************************************************/
+
+CalArena::~CalArena()
+{
+  clear();
+}
+
+ /*****************************************************************************/
+/** Allocates memory.
+  *
+  * This function hands out memory from the current block. If it doesn't fit,
+  * a new block is started, which grows with the arena up to MAX_BLOCK_SIZE.
+  *
+  * @param size The number of bytes to allocate.
+  * @param alignment The alignment of the memory, a power of two.
+  *
+  * @return One of the following values:
+  *         \li the address of the memory
+  *         \li \b 0 if an error happend
+  *****************************************************************************/
+
+void *CalArena::allocate(size_t size, size_t alignment)
+{
+  if(!m_vectorBlock.empty())
+  {
+    Block& block = m_vectorBlock.back();
+
+    // align the address, the blocks themselves are only aligned for malloc
+    size_t address = (size_t)(block.pData + block.size);
+    size_t offset = block.size + (((address + alignment - 1) & ~(alignment - 1)) - address);
+    if((offset <= block.capacity) && (size <= block.capacity - offset))
+    {
+      block.size = offset + size;
+      m_size += size;
+      return block.pData + offset;
+    }
+  }
+
+  // start a new block, double the capacity while the arena is small
+  size_t capacity = m_capacity;
+  if(capacity < MIN_BLOCK_SIZE) capacity = MIN_BLOCK_SIZE;
+  if(capacity > MAX_BLOCK_SIZE) capacity = MAX_BLOCK_SIZE;
+  if(capacity < size + alignment) capacity = size + alignment;
+
+  if(!reserve(capacity)) return 0;
+
+  return allocate(size, alignment);
+}
+
+ /*****************************************************************************/
+/** Frees all memory.
+  *
+  * This function frees all blocks of the arena at once. The objects in them
+  * must have been released before.
+  *****************************************************************************/
+
+void CalArena::clear()
+{
+  std::vector<Block>::iterator iteratorBlock;
+  for(iteratorBlock = m_vectorBlock.begin(); iteratorBlock != m_vectorBlock.end(); ++iteratorBlock)
+  {
+    free(iteratorBlock->pData);
+  }
+
+  m_vectorBlock.clear();
+  m_capacity = 0;
+  m_size = 0;
+}
+
+ /*****************************************************************************/
+/** Returns the capacity.
+  *
+  * This function returns the number of bytes held in all blocks.
+  *
+  * @return The capacity in bytes.
+  *****************************************************************************/
+
+size_t CalArena::getCapacity() const
+{
+  return m_capacity;
+}
+
+ /*****************************************************************************/
+/** Returns the size.
+  *
+  * This function returns the number of bytes handed out by the arena.
+  *
+  * @return The size in bytes.
+  *****************************************************************************/
+
+size_t CalArena::getSize() const
+{
+  return m_size;
+}
+
+ /*****************************************************************************/
+/** Checks if memory comes from the arena.
+  *
+  * @param pData The address to check.
+  *
+  * @return One of the following values:
+  *         \li \b true if the address lies in a block of the arena
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalArena::owns(const void *pData) const
+{
+  const char *pByte = (const char *)pData;
+
+  // the latest block is the most likely one
+  std::vector<Block>::const_reverse_iterator iteratorBlock;
+  for(iteratorBlock = m_vectorBlock.rbegin(); iteratorBlock != m_vectorBlock.rend(); ++iteratorBlock)
+  {
+    if((pByte >= iteratorBlock->pData) && (pByte < iteratorBlock->pData + iteratorBlock->capacity)) return true;
+  }
+
+  return false;
+}
+
+ /*****************************************************************************/
+/** Reserves memory.
+  *
+  * This function makes sure that the given number of bytes can be allocated
+  * from one block. Loaders call it with the size of all objects they are about
+  * to place, so they end up next to each other.
+  *
+  * @param size The number of bytes to reserve.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalArena::reserve(size_t size)
+{
+  if(!m_vectorBlock.empty())
+  {
+    const Block& block = m_vectorBlock.back();
+    if(size <= block.capacity - block.size) return true;
+  }
+
+  Block block;
+  block.pData = (char *)malloc(size);
+  if(block.pData == 0) return false;
+  block.capacity = size;
+  block.size = 0;
+
+  m_vectorBlock.push_back(block);
+  m_capacity += size;
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Swaps the blocks of two arenas.
+  *
+  * This function exchanges the memory of the arena with that of another one,
+  * so objects built in a spare arena can take the place of the current ones
+  * without being copied.
+  *
+  * @param arena The arena to swap with.
+  *****************************************************************************/
+
+void CalArena::swap(CalArena& arena)
+{
+  m_vectorBlock.swap(arena.m_vectorBlock);
+  std::swap(m_capacity, arena.m_capacity);
+  std::swap(m_size, arena.m_size);
+}
+
+//****************************************************************************//
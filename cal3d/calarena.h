@@ -0,0 +1,99 @@
+//****************************************************************************//
+// arena.h                                                                    //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_ARENA_H
+#define CAL_ARENA_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include <new>
+
+#include "calglobal.h"
+
+//****************************************************************************//
+// Class declaration                                                          //
+//****************************************************************************//
+
+ /*****************************************************************************/
+/** The arena class.
+  *
+  * This class hands out memory from a few large blocks and frees all of it at
+  * once in clear(). Core models and core animations own one each: the loader
+  * sizes it ahead of loading and places the core bones, core submeshes, core
+  * tracks and core keyframes in it one after the other. Objects in an arena
+  * are destroyed with release(), which runs their destructor but leaves the
+  * memory to the arena.
+  *****************************************************************************/
+
+class CAL3D_API CalArena
+{
+// misc
+public:
+  static const size_t MIN_BLOCK_SIZE = 4096;
+  static const size_t MAX_BLOCK_SIZE = 1024 * 1024;
+
+protected:
+  struct Block
+  {
+    char *pData;
+    size_t capacity;
+    size_t size;
+  };
+
+// member variables
+protected:
+  std::vector<Block> m_vectorBlock;
+  size_t m_capacity;
+  size_t m_size;
+
+// constructors/destructor
+public:
+  CalArena();
+  ~CalArena();
+
+// member functions
+public:
+  void *allocate(size_t size, size_t alignment);
+  void clear();
+  size_t getCapacity() const;
+  size_t getSize() const;
+  bool owns(const void *pData) const;
+  bool reserve(size_t size);
+  void swap(CalArena& arena);
+
+  /// Creates an object in an arena, or on the heap if there is no arena.
+  template<class T>
+  static T *construct(CalArena *pArena)
+  {
+    if(pArena == 0) return new T();
+
+    void *pData = pArena->allocate(sizeof(T), alignof(T));
+    return (pData != 0) ? new(pData) T() : 0;
+  }
+
+  /// Destroys an object created by construct(). Objects on the heap are
+  /// deleted, so arena and heap objects can be mixed in one container.
+  template<class T>
+  static void release(CalArena *pArena, T *pObject)
+  {
+    if((pArena != 0) && pArena->owns(pObject)) pObject->~T();
+    else delete pObject;
+  }
+
+private:
+  CalArena(const CalArena&);
+  CalArena& operator=(const CalArena&);
+};
+
+#endif
+
+//****************************************************************************//
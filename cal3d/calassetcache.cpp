@@ -0,0 +1,549 @@
+#include "stdafx.h"
+//****************************************************************************//
+// assetcache.cpp                                                             //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calassetcache.h"
+#include "calerror.h"
+#include "calloader.h"
+#include "calcoremodel.h"
+#include "calcoreanim.h"
+#include "mappedfilesource.h"
+
+// threading includes
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+namespace
+{
+  enum AssetType
+  {
+    ASSET_CORE_MODEL = 1,
+    ASSET_CORE_ANIMATION
+  };
+
+  enum EntryState
+  {
+    ENTRY_LOADING = 0,
+    ENTRY_LOADED,
+    ENTRY_FAILED,
+    ENTRY_MERGED
+  };
+
+  /// Returns the hash of a file content (64 bit FNV-1a).
+  unsigned long long hashContent(const char *pData, unsigned int size)
+  {
+    unsigned long long hash = 14695981039346656037ull;
+    for(unsigned int i = 0; i < size; i++)
+    {
+      hash ^= (unsigned char)pData[i];
+      hash *= 1099511628211ull;
+    }
+    return hash;
+  }
+
+  void destroyAsset(int type, void *pAsset)
+  {
+    if(type == ASSET_CORE_MODEL)
+    {
+      ((CalCoreModel *)pAsset)->destroy();
+      delete (CalCoreModel *)pAsset;
+    }
+    else
+    {
+      ((CalCoreAnimation *)pAsset)->destroy();
+      delete (CalCoreAnimation *)pAsset;
+    }
+  }
+}
+
+ /*****************************************************************************/
+/** A cached asset.
+  *
+  * An entry is reachable under every path that resolved to it, under its
+  * content and under its asset. An entry whose file turned out to hold the
+  * content of another entry is merged into that one.
+  *****************************************************************************/
+
+struct CalAssetCache::Entry
+{
+  typedef std::pair<int, std::string> PathKey;
+  typedef std::pair<int, std::pair<unsigned long long, unsigned int> > ContentKey;
+
+  int type;
+  EntryState state;
+  void *pAsset;
+  int referenceCount;
+  size_t memorySize;
+  CalError::Code errorCode;
+  std::vector<PathKey> vectorPathKey;
+  ContentKey contentKey;
+  bool bContentKey;
+  std::shared_ptr<Entry> pMergedEntry;
+};
+
+ /*****************************************************************************/
+/** The lookup tables of the cache, guarded by one mutex.
+  *****************************************************************************/
+
+struct CalAssetCache::Table
+{
+  std::mutex mutex;
+  std::condition_variable loaded;
+  std::map<Entry::PathKey, std::shared_ptr<Entry> > mapPath;
+  std::map<Entry::ContentKey, std::shared_ptr<Entry> > mapContent;
+  std::map<const void *, std::shared_ptr<Entry> > mapAsset;
+  int loadingFlags;
+  Statistics statistics;
+
+  void erase(const std::shared_ptr<Entry>& pEntry)
+  {
+    size_t pathKeyId;
+    for(pathKeyId = 0; pathKeyId < pEntry->vectorPathKey.size(); pathKeyId++)
+    {
+      mapPath.erase(pEntry->vectorPathKey[pathKeyId]);
+    }
+    if(pEntry->bContentKey) mapContent.erase(pEntry->contentKey);
+    if(pEntry->pAsset != 0) mapAsset.erase(pEntry->pAsset);
+  }
+};
+
+ /*****************************************************************************/
+/** Constructs the asset cache instance.
+  *
+  * This function is the default constructor of the asset cache instance.
+  *****************************************************************************/
+
+CalAssetCache::CalAssetCache()
+  : m_pTable(0)
+{
+}
+
+ /*****************************************************************************/
+/** Destructs the asset cache instance.
+  *
+  * This function is the destructor of the asset cache instance.
+  *****************************************************************************/
+
+CalAssetCache::~CalAssetCache()
+{
+  destroy();
+}
+
+ /*****************************************************************************/
+/** Adds a reference to an asset.
+  *
+  * This function is called by the asset handles when they are copied.
+  *
+  * @param pAsset The cached core model or core animation.
+  *****************************************************************************/
+
+void CalAssetCache::addReference(const void *pAsset)
+{
+  std::lock_guard<std::mutex> lock(m_pTable->mutex);
+
+  std::map<const void *, std::shared_ptr<Entry> >::iterator iteratorAsset = m_pTable->mapAsset.find(pAsset);
+  if(iteratorAsset != m_pTable->mapAsset.end()) iteratorAsset->second->referenceCount++;
+}
+
+ /*****************************************************************************/
+/** Creates the asset cache instance.
+  *
+  * This function creates the asset cache instance.
+  *
+  * @param loadingFlags The CalLoader flags for all loads of the cache, or -1
+  *                     to follow CalLoader::setLoadingMode().
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalAssetCache::create(int loadingFlags)
+{
+  destroy();
+
+  m_pTable = new Table();
+  if(m_pTable == 0)
+  {
+    CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
+    return false;
+  }
+
+  m_pTable->loadingFlags = loadingFlags;
+  resetStatistics();
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Destroys the asset cache instance.
+  *
+  * This function frees all cached assets. No handle to them may be left and
+  * no request may be running.
+  *****************************************************************************/
+
+void CalAssetCache::destroy()
+{
+  if(m_pTable == 0) return;
+
+  std::map<const void *, std::shared_ptr<Entry> >::iterator iteratorAsset;
+  for(iteratorAsset = m_pTable->mapAsset.begin(); iteratorAsset != m_pTable->mapAsset.end(); ++iteratorAsset)
+  {
+    destroyAsset(iteratorAsset->second->type, iteratorAsset->second->pAsset);
+  }
+
+  delete m_pTable;
+  m_pTable = 0;
+}
+
+ /*****************************************************************************/
+/** Provides access to a core animation.
+  *
+  * This function returns a handle to the core animation of a given file,
+  * loading it if no path or file with the same content is cached yet.
+  *
+  * @param strFilename The name of the file to load the core animation from.
+  *
+  * @return One of the following values:
+  *         \li a handle to the core animation
+  *         \li an empty handle if an error happend
+  *****************************************************************************/
+
+CalAssetCache::CoreAnimationHandle CalAssetCache::getCoreAnimation(const std::string& strFilename)
+{
+  return CoreAnimationHandle(this, (CalCoreAnimation *)getAsset(strFilename, ASSET_CORE_ANIMATION));
+}
+
+ /*****************************************************************************/
+/** Provides access to a core model.
+  *
+  * This function returns a handle to the core model of a given file, loading
+  * it if no path or file with the same content is cached yet.
+  *
+  * @param strFilename The name of the file to load the core model from.
+  *
+  * @return One of the following values:
+  *         \li a handle to the core model
+  *         \li an empty handle if an error happend
+  *****************************************************************************/
+
+CalAssetCache::CoreModelHandle CalAssetCache::getCoreModel(const std::string& strFilename)
+{
+  return CoreModelHandle(this, (CalCoreModel *)getAsset(strFilename, ASSET_CORE_MODEL));
+}
+
+ /*****************************************************************************/
+/** Returns the hit rate.
+  *
+  * This function returns the share of the requests that did not start a load
+  * of their own.
+  *
+  * @return The hit rate between 0 and 1.
+  *****************************************************************************/
+
+float CalAssetCache::getHitRate()
+{
+  Statistics statistics = getStatistics();
+  if(statistics.requestCount == 0) return 0.0f;
+
+  return (float)(statistics.pathHitCount + statistics.contentHitCount + statistics.coalescedCount) / (float)statistics.requestCount;
+}
+
+ /*****************************************************************************/
+/** Returns the statistics.
+  *
+  * This function returns the request counters since the last reset and the
+  * assets and memory the cache holds now.
+  *
+  * @return The statistics.
+  *****************************************************************************/
+
+CalAssetCache::Statistics CalAssetCache::getStatistics()
+{
+  Statistics statistics = Statistics();
+  if(m_pTable == 0) return statistics;
+
+  std::lock_guard<std::mutex> lock(m_pTable->mutex);
+
+  statistics = m_pTable->statistics;
+  statistics.assetCount = (int)m_pTable->mapAsset.size();
+
+  std::map<const void *, std::shared_ptr<Entry> >::iterator iteratorAsset;
+  for(iteratorAsset = m_pTable->mapAsset.begin(); iteratorAsset != m_pTable->mapAsset.end(); ++iteratorAsset)
+  {
+    if(iteratorAsset->second->referenceCount > 0) statistics.referencedAssetCount++;
+    statistics.memorySize += iteratorAsset->second->memorySize;
+  }
+
+  return statistics;
+}
+
+ /*****************************************************************************/
+/** Frees unreferenced assets.
+  *
+  * This function frees all cached assets that no handle refers to anymore.
+  * They are loaded again on the next request.
+  *
+  * @return The number of freed assets.
+  *****************************************************************************/
+
+int CalAssetCache::purge()
+{
+  if(m_pTable == 0) return 0;
+
+  std::vector<std::shared_ptr<Entry> > vectorEntry;
+  {
+    std::lock_guard<std::mutex> lock(m_pTable->mutex);
+
+    std::map<const void *, std::shared_ptr<Entry> >::iterator iteratorAsset;
+    for(iteratorAsset = m_pTable->mapAsset.begin(); iteratorAsset != m_pTable->mapAsset.end(); ++iteratorAsset)
+    {
+      if(iteratorAsset->second->referenceCount == 0) vectorEntry.push_back(iteratorAsset->second);
+    }
+
+    size_t entryId;
+    for(entryId = 0; entryId < vectorEntry.size(); entryId++)
+    {
+      m_pTable->erase(vectorEntry[entryId]);
+    }
+  }
+
+  // free the assets outside the lock, nothing can reach them anymore
+  size_t entryId;
+  for(entryId = 0; entryId < vectorEntry.size(); entryId++)
+  {
+    destroyAsset(vectorEntry[entryId]->type, vectorEntry[entryId]->pAsset);
+    vectorEntry[entryId]->pAsset = 0;
+  }
+
+  return (int)vectorEntry.size();
+}
+
+ /*****************************************************************************/
+/** Drops a reference to an asset.
+  *
+  * This function is called by the asset handles when they are reset. The
+  * asset stays cached until purge() is called.
+  *
+  * @param pAsset The cached core model or core animation.
+  *****************************************************************************/
+
+void CalAssetCache::release(const void *pAsset)
+{
+  std::lock_guard<std::mutex> lock(m_pTable->mutex);
+
+  std::map<const void *, std::shared_ptr<Entry> >::iterator iteratorAsset = m_pTable->mapAsset.find(pAsset);
+  if((iteratorAsset != m_pTable->mapAsset.end()) && (iteratorAsset->second->referenceCount > 0)) iteratorAsset->second->referenceCount--;
+}
+
+ /*****************************************************************************/
+/** Resets the statistics.
+  *
+  * This function sets all request counters to zero.
+  *****************************************************************************/
+
+void CalAssetCache::resetStatistics()
+{
+  if(m_pTable == 0) return;
+
+  std::lock_guard<std::mutex> lock(m_pTable->mutex);
+  m_pTable->statistics = Statistics();
+}
+
+ /*****************************************************************************/
+/** Provides access to an asset.
+  *
+  * This function looks an asset up by path and by content and loads it if
+  * neither is cached. The returned asset carries one reference for the
+  * caller.
+  *
+  * @param strFilename The name of the file to load the asset from.
+  * @param type The type of the asset.
+  *
+  * @return One of the following values:
+  *         \li a pointer to the asset
+  *         \li \b 0 if an error happend
+  *****************************************************************************/
+
+void *CalAssetCache::getAsset(const std::string& strFilename, int type)
+{
+  if(m_pTable == 0)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return 0;
+  }
+
+  const Entry::PathKey pathKey(type, strFilename);
+  std::shared_ptr<Entry> pEntry;
+
+  std::unique_lock<std::mutex> lock(m_pTable->mutex);
+  m_pTable->statistics.requestCount++;
+
+  std::map<Entry::PathKey, std::shared_ptr<Entry> >::iterator iteratorPath = m_pTable->mapPath.find(pathKey);
+  if(iteratorPath != m_pTable->mapPath.end())
+  {
+    pEntry = iteratorPath->second;
+    if(pEntry->state == ENTRY_LOADING) m_pTable->statistics.coalescedCount++;
+    else m_pTable->statistics.pathHitCount++;
+  }
+  else
+  {
+    // register the path before loading, so requests for it wait for this load
+    pEntry = std::make_shared<Entry>();
+    pEntry->type = type;
+    pEntry->state = ENTRY_LOADING;
+    pEntry->pAsset = 0;
+    pEntry->referenceCount = 0;
+    pEntry->memorySize = 0;
+    pEntry->errorCode = CalError::OK;
+    pEntry->vectorPathKey.push_back(pathKey);
+    pEntry->bContentKey = false;
+    m_pTable->mapPath[pathKey] = pEntry;
+
+    lock.unlock();
+
+    CalMappedFileSource fileSource(strFilename);
+    const char *pData = fileSource.mapBytes(fileSource.getSize());
+    bool bMapped = fileSource.isMapped() && ((pData != 0) || (fileSource.getSize() == 0));
+
+    std::shared_ptr<Entry> pContentEntry;
+    if(bMapped)
+    {
+      const Entry::ContentKey contentKey(type, std::make_pair(hashContent(pData, fileSource.getSize()), fileSource.getSize()));
+
+      lock.lock();
+      std::map<Entry::ContentKey, std::shared_ptr<Entry> >::iterator iteratorContent = m_pTable->mapContent.find(contentKey);
+      if(iteratorContent != m_pTable->mapContent.end())
+      {
+        // the same file under another path, merge this path into its entry
+        pContentEntry = iteratorContent->second;
+        pContentEntry->vectorPathKey.push_back(pathKey);
+        m_pTable->mapPath[pathKey] = pContentEntry;
+        m_pTable->statistics.contentHitCount++;
+
+        pEntry->state = ENTRY_MERGED;
+        pEntry->pMergedEntry = pContentEntry;
+        m_pTable->loaded.notify_all();
+      }
+      else
+      {
+        pEntry->contentKey = contentKey;
+        pEntry->bContentKey = true;
+        m_pTable->mapContent[contentKey] = pEntry;
+      }
+      lock.unlock();
+    }
+
+    if(pContentEntry)
+    {
+      pEntry = pContentEntry;
+      lock.lock();
+    }
+    else
+    {
+      CalLoader loader;
+      loader.setLoadingFlags(m_pTable->loadingFlags);
+
+      void *pAsset = 0;
+      size_t memorySize = 0;
+      bool bLoaded = false;
+
+      if(!bMapped)
+      {
+        CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
+      }
+      else if(type == ASSET_CORE_MODEL)
+      {
+        CalCoreModel *pCoreModel = new CalCoreModel();
+        pCoreModel->create(strFilename.c_str());
+        bLoaded = loader.loadCoreModel(pCoreModel, (void *)pData, (int)fileSource.getSize(), strFilename);
+        if(bLoaded) memorySize = pCoreModel->getMemorySize();
+        pAsset = pCoreModel;
+      }
+      else
+      {
+        // lazy and streamed animations read their keyframes from the file
+        // later, so they have to be loaded from the file and not from the
+        // mapping
+        CalCoreAnimation *pCoreAnimation = new CalCoreAnimation();
+        pCoreAnimation->create(strFilename.c_str());
+        if((loader.getLoadingFlags() & (LOADER_LAZY_TRACKS | LOADER_STREAM_TRACKS)) != 0)
+          bLoaded = loader.loadCoreAnimation(pCoreAnimation, strFilename);
+        else
+          bLoaded = loader.loadCoreAnimation(pCoreAnimation, (void *)pData, (int)fileSource.getSize(), strFilename);
+        if(bLoaded) memorySize = pCoreAnimation->getMemorySize();
+        pAsset = pCoreAnimation;
+      }
+
+      if(!bLoaded && (pAsset != 0))
+      {
+        destroyAsset(type, pAsset);
+        pAsset = 0;
+      }
+
+      lock.lock();
+      if(bLoaded)
+      {
+        pEntry->state = ENTRY_LOADED;
+        pEntry->pAsset = pAsset;
+        pEntry->memorySize = memorySize;
+        m_pTable->mapAsset[pAsset] = pEntry;
+        m_pTable->statistics.loadCount++;
+      }
+      else
+      {
+        // forget the failed entry, so the next request tries again
+        pEntry->state = ENTRY_FAILED;
+        pEntry->errorCode = CalError::getLastErrorCode();
+        m_pTable->erase(pEntry);
+        m_pTable->statistics.failedCount++;
+      }
+      m_pTable->loaded.notify_all();
+    }
+  }
+
+  // wait for a load that another request started
+  for(;;)
+  {
+    if(pEntry->state == ENTRY_MERGED)
+    {
+      pEntry = pEntry->pMergedEntry;
+    }
+    else if(pEntry->state == ENTRY_LOADING)
+    {
+      m_pTable->loaded.wait(lock);
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  if(pEntry->state == ENTRY_FAILED)
+  {
+    CalError::setLastError(pEntry->errorCode, __FILE__, __LINE__, strFilename);
+    return 0;
+  }
+
+  pEntry->referenceCount++;
+
+  return pEntry->pAsset;
+}
+
+//****************************************************************************//
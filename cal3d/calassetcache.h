@@ -0,0 +1,206 @@
+//****************************************************************************//
+// assetcache.h                                                               //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_ASSETCACHE_H
+#define CAL_ASSETCACHE_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+
+//****************************************************************************//
+// Forward declarations                                                       //
+//****************************************************************************//
+
+class CalAssetCache;
+class CalCoreAnimation;
+class CalCoreModel;
+
+//****************************************************************************//
+// Class declaration                                                          //
+//****************************************************************************//
+
+ /*****************************************************************************/
+/** The asset handle class.
+  *
+  * This class holds one reference to an asset of an asset cache. Copies add a
+  * reference, destruction or reset() drops it. An empty handle holds nothing.
+  *****************************************************************************/
+
+template<class Asset>
+class CalAssetHandle
+{
+// member variables
+protected:
+  CalAssetCache *m_pCache;
+  Asset *m_pAsset;
+
+// constructors/destructor
+public:
+  CalAssetHandle();
+  CalAssetHandle(CalAssetCache *pCache, Asset *pAsset);
+  CalAssetHandle(const CalAssetHandle& handle);
+  ~CalAssetHandle();
+
+// member functions
+public:
+  CalAssetHandle& operator=(const CalAssetHandle& handle);
+  Asset *operator->() const;
+  Asset *get() const;
+  bool isValid() const;
+  void reset();
+};
+
+ /*****************************************************************************/
+/** The asset cache class.
+  *
+  * This class loads core models and core animations once and shares them.
+  * Requests are deduplicated by path first and by the content of the file
+  * second, so the same file under two paths is held once. Concurrent requests
+  * for an asset that is still loading wait for that load instead of starting
+  * their own.
+  *
+  * Assets are held by reference counted handles. An asset whose last handle
+  * is gone stays cached until purge() is called. All handles must be gone
+  * before the cache is destroyed.
+  *****************************************************************************/
+
+class CAL3D_API CalAssetCache
+{
+// misc
+public:
+  typedef CalAssetHandle<CalCoreAnimation> CoreAnimationHandle;
+  typedef CalAssetHandle<CalCoreModel> CoreModelHandle;
+
+  /// The request and memory counters of the cache.
+  struct Statistics
+  {
+    int requestCount;
+    int pathHitCount;
+    int contentHitCount;
+    int coalescedCount;
+    int loadCount;
+    int failedCount;
+    int assetCount;
+    int referencedAssetCount;
+    size_t memorySize;
+  };
+
+protected:
+  struct Entry;
+  struct Table;
+
+// member variables
+protected:
+  Table *m_pTable;
+
+// constructors/destructor
+public:
+  CalAssetCache();
+  virtual ~CalAssetCache();
+
+// member functions
+public:
+  void addReference(const void *pAsset);
+  bool create(int loadingFlags = -1);
+  void destroy();
+  CoreAnimationHandle getCoreAnimation(const std::string& strFilename);
+  CoreModelHandle getCoreModel(const std::string& strFilename);
+  float getHitRate();
+  Statistics getStatistics();
+  int purge();
+  void release(const void *pAsset);
+  void resetStatistics();
+
+protected:
+  void *getAsset(const std::string& strFilename, int type);
+
+private:
+  CalAssetCache(const CalAssetCache&);
+  CalAssetCache& operator=(const CalAssetCache&);
+};
+
+//****************************************************************************//
+// Asset handle implementation                                                //
+//****************************************************************************//
+
+template<class Asset>
+inline CalAssetHandle<Asset>::CalAssetHandle()
+  : m_pCache(0), m_pAsset(0)
+{
+}
+
+/// Takes over a reference that the cache has already added.
+template<class Asset>
+inline CalAssetHandle<Asset>::CalAssetHandle(CalAssetCache *pCache, Asset *pAsset)
+  : m_pCache(pCache), m_pAsset(pAsset)
+{
+}
+
+template<class Asset>
+inline CalAssetHandle<Asset>::CalAssetHandle(const CalAssetHandle& handle)
+  : m_pCache(handle.m_pCache), m_pAsset(handle.m_pAsset)
+{
+  if(m_pAsset != 0) m_pCache->addReference(m_pAsset);
+}
+
+template<class Asset>
+inline CalAssetHandle<Asset>::~CalAssetHandle()
+{
+  reset();
+}
+
+template<class Asset>
+inline CalAssetHandle<Asset>& CalAssetHandle<Asset>::operator=(const CalAssetHandle& handle)
+{
+  // take the new reference first, the handle may be assigned to itself
+  CalAssetCache *pCache = handle.m_pCache;
+  Asset *pAsset = handle.m_pAsset;
+  if(pAsset != 0) pCache->addReference(pAsset);
+  reset();
+
+  m_pCache = pCache;
+  m_pAsset = pAsset;
+
+  return *this;
+}
+
+template<class Asset>
+inline Asset *CalAssetHandle<Asset>::operator->() const
+{
+  return m_pAsset;
+}
+
+template<class Asset>
+inline Asset *CalAssetHandle<Asset>::get() const
+{
+  return m_pAsset;
+}
+
+template<class Asset>
+inline bool CalAssetHandle<Asset>::isValid() const
+{
+  return m_pAsset != 0;
+}
+
+template<class Asset>
+inline void CalAssetHandle<Asset>::reset()
+{
+  if(m_pAsset != 0) m_pCache->release(m_pAsset);
+
+  m_pCache = 0;
+  m_pAsset = 0;
+}
+
+#endif
+
+//****************************************************************************//
@@ -0,0 +1,610 @@
+#include "stdafx.h"
+//****************************************************************************//
+// asyncloader.cpp                                                            //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calasyncloader.h"
+#include "calloader.h"
+#include "calcoremodel.h"
+#include "calcoreanim.h"
+
+// threading includes
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <algorithm>
+
+ /*****************************************************************************/
+/** A load request.
+  *****************************************************************************/
+
+struct CalAsyncLoader::Request
+{
+  CalCoreModel *pCoreModel;
+  CalCoreAnimation *pCoreAnimation;
+  std::string strFilename;
+  std::string strFilename2;
+  int priority;
+  unsigned int sequence;
+  Callback callback;
+  void *pUserData;
+  State state;
+  bool bCancelled;
+  CalError::Code errorCode;
+  std::string strErrorText;
+};
+
+ /*****************************************************************************/
+/** The loader thread pool.
+  *
+  * All members are guarded by the mutex. The loader threads wait on
+  * 'condition' for pending requests, wait() waits on 'conditionFinished' for
+  * requests to leave the loading state.
+  *****************************************************************************/
+
+struct CalAsyncLoader::Pool
+{
+  std::vector<std::thread> vectorThread;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::condition_variable conditionFinished;
+  std::map<int, Request> mapRequest;
+  std::vector<int> vectorPending;
+  std::vector<int> vectorFinished;
+  int nextRequestId;
+  unsigned int nextSequence;
+  bool bQuit;
+};
+
+ /*****************************************************************************/
+/** Constructs the asynchronous loader instance.
+  *
+  * This function is the default constructor of the asynchronous loader
+  * instance.
+  *****************************************************************************/
+
+CalAsyncLoader::CalAsyncLoader()
+{
+  m_pPool = 0;
+}
+
+ /*****************************************************************************/
+/** Destructs the asynchronous loader instance.
+  *
+  * This function is the destructor of the asynchronous loader instance.
+  *****************************************************************************/
+
+CalAsyncLoader::~CalAsyncLoader()
+{
+  assert(m_pPool == 0);
+}
+
+ /*****************************************************************************/
+/** Queues a load request.
+  *
+  * This function hands a request to the loader threads.
+  *
+  * @param request The request to queue.
+  *
+  * @return One of the following values:
+  *         \li the ID of the request
+  *         \li \b -1 if an error happend
+  *****************************************************************************/
+
+int CalAsyncLoader::addRequest(const Request& request)
+{
+  if(m_pPool == 0)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return -1;
+  }
+
+  int requestId;
+  {
+    std::lock_guard<std::mutex> lock(m_pPool->mutex);
+
+    requestId = m_pPool->nextRequestId++;
+
+    // only the fields set by the caller are copied, the others are set here
+    Request& queued = m_pPool->mapRequest[requestId];
+    queued.pCoreModel = request.pCoreModel;
+    queued.pCoreAnimation = request.pCoreAnimation;
+    queued.strFilename = request.strFilename;
+    queued.strFilename2 = request.strFilename2;
+    queued.priority = request.priority;
+    queued.callback = request.callback;
+    queued.pUserData = request.pUserData;
+    queued.sequence = m_pPool->nextSequence++;
+    queued.state = STATE_PENDING;
+    queued.bCancelled = false;
+    queued.errorCode = CalError::OK;
+
+    m_pPool->vectorPending.push_back(requestId);
+  }
+  m_pPool->condition.notify_one();
+
+  return requestId;
+}
+
+ /*****************************************************************************/
+/** Cancels a load request.
+  *
+  * This function cancels a request. A pending request is dropped right away;
+  * a request that is already loading finishes its load, which is then thrown
+  * away. Either way the request ends in the cancelled state and its callback
+  * is still run by update().
+  *
+  * @param requestId The ID of the request.
+  *
+  * @return One of the following values:
+  *         \li \b true if the request was cancelled
+  *         \li \b false if it is unknown or has already finished
+  *****************************************************************************/
+
+bool CalAsyncLoader::cancel(int requestId)
+{
+  if(m_pPool == 0) return false;
+
+  std::lock_guard<std::mutex> lock(m_pPool->mutex);
+
+  std::map<int, Request>::iterator iteratorRequest = m_pPool->mapRequest.find(requestId);
+  if(iteratorRequest == m_pPool->mapRequest.end()) return false;
+
+  Request& request = iteratorRequest->second;
+  if(request.state == STATE_LOADING)
+  {
+    request.bCancelled = true;
+    return true;
+  }
+
+  if(request.state != STATE_PENDING) return false;
+
+  // the request never reached a loader thread, so nothing was touched
+  m_pPool->vectorPending.erase(std::find(m_pPool->vectorPending.begin(), m_pPool->vectorPending.end(), requestId));
+  request.state = STATE_CANCELLED;
+  m_pPool->vectorFinished.push_back(requestId);
+  m_pPool->conditionFinished.notify_all();
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Creates the asynchronous loader instance.
+  *
+  * This function starts the loader threads.
+  *
+  * @param threadCount The number of loader threads.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalAsyncLoader::create(int threadCount)
+{
+  if((m_pPool != 0) || (threadCount < 1))
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return false;
+  }
+
+  m_pPool = new Pool();
+  m_pPool->nextRequestId = 0;
+  m_pPool->nextSequence = 0;
+  m_pPool->bQuit = false;
+
+  int threadId;
+  for(threadId = 0; threadId < threadCount; threadId++)
+  {
+    m_pPool->vectorThread.push_back(std::thread(&CalAsyncLoader::runWorker, this));
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Destroys the asynchronous loader instance.
+  *
+  * This function cancels all pending requests, waits for the loading ones to
+  * finish and stops the loader threads. The callbacks of all requests that
+  * have not been reported yet are run before it returns.
+  *****************************************************************************/
+
+void CalAsyncLoader::destroy()
+{
+  if(m_pPool == 0) return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_pPool->mutex);
+
+    std::vector<int>::iterator iteratorRequestId;
+    for(iteratorRequestId = m_pPool->vectorPending.begin(); iteratorRequestId != m_pPool->vectorPending.end(); ++iteratorRequestId)
+    {
+      m_pPool->mapRequest[*iteratorRequestId].state = STATE_CANCELLED;
+      m_pPool->vectorFinished.push_back(*iteratorRequestId);
+    }
+    m_pPool->vectorPending.clear();
+
+    m_pPool->bQuit = true;
+  }
+  m_pPool->condition.notify_all();
+
+  std::vector<std::thread>::iterator iteratorThread;
+  for(iteratorThread = m_pPool->vectorThread.begin(); iteratorThread != m_pPool->vectorThread.end(); ++iteratorThread)
+  {
+    iteratorThread->join();
+  }
+
+  update();
+
+  delete m_pPool;
+  m_pPool = 0;
+}
+
+ /*****************************************************************************/
+/** Returns the error code of a failed request.
+  *
+  * @param requestId The ID of the request.
+  *
+  * @return The error code the loader reported, or CalError::OK.
+  *****************************************************************************/
+
+CalError::Code CalAsyncLoader::getErrorCode(int requestId)
+{
+  if(m_pPool == 0) return CalError::OK;
+
+  std::lock_guard<std::mutex> lock(m_pPool->mutex);
+
+  std::map<int, Request>::iterator iteratorRequest = m_pPool->mapRequest.find(requestId);
+  if(iteratorRequest == m_pPool->mapRequest.end()) return CalError::OK;
+
+  return iteratorRequest->second.errorCode;
+}
+
+ /*****************************************************************************/
+/** Returns the error text of a failed request.
+  *
+  * @param requestId The ID of the request.
+  *
+  * @return The error text the loader reported, usually the file name.
+  *****************************************************************************/
+
+std::string CalAsyncLoader::getErrorText(int requestId)
+{
+  if(m_pPool == 0) return "";
+
+  std::lock_guard<std::mutex> lock(m_pPool->mutex);
+
+  std::map<int, Request>::iterator iteratorRequest = m_pPool->mapRequest.find(requestId);
+  if(iteratorRequest == m_pPool->mapRequest.end()) return "";
+
+  return iteratorRequest->second.strErrorText;
+}
+
+ /*****************************************************************************/
+/** Returns the number of requests still waiting for a loader thread.
+  *
+  * @return The number of pending requests.
+  *****************************************************************************/
+
+int CalAsyncLoader::getPendingCount()
+{
+  if(m_pPool == 0) return 0;
+
+  std::lock_guard<std::mutex> lock(m_pPool->mutex);
+
+  return (int)m_pPool->vectorPending.size();
+}
+
+ /*****************************************************************************/
+/** Returns the state of a request.
+  *
+  * @param requestId The ID of the request.
+  *
+  * @return The state of the request, or STATE_NONE if the request is unknown
+  *         or has already been reported by update().
+  *****************************************************************************/
+
+CalAsyncLoader::State CalAsyncLoader::getState(int requestId)
+{
+  if(m_pPool == 0) return STATE_NONE;
+
+  std::lock_guard<std::mutex> lock(m_pPool->mutex);
+
+  std::map<int, Request>::iterator iteratorRequest = m_pPool->mapRequest.find(requestId);
+  if(iteratorRequest == m_pPool->mapRequest.end()) return STATE_NONE;
+
+  return iteratorRequest->second.state;
+}
+
+ /*****************************************************************************/
+/** Loads a core animation in the background.
+  *
+  * This function queues the loading of a core animation from a file.
+  *
+  * @param pCoreAnimation The created core animation to load into.
+  * @param strFilename The name of the file to load the core animation from.
+  * @param priority The priority of the request; higher ones are loaded first.
+  * @param callback The function update() calls when the request finished.
+  * @param pUserData The user data passed to the callback.
+  *
+  * @return One of the following values:
+  *         \li the ID of the request
+  *         \li \b -1 if an error happend
+  *****************************************************************************/
+
+int CalAsyncLoader::loadCoreAnimation(CalCoreAnimation *pCoreAnimation, const std::string& strFilename, int priority, Callback callback, void *pUserData)
+{
+  if(pCoreAnimation == 0)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return -1;
+  }
+
+  Request request;
+  request.pCoreModel = 0;
+  request.pCoreAnimation = pCoreAnimation;
+  request.strFilename = strFilename;
+  request.priority = priority;
+  request.callback = callback;
+  request.pUserData = pUserData;
+
+  return addRequest(request);
+}
+
+ /*****************************************************************************/
+/** Loads a core model in the background.
+  *
+  * This function queues the loading of a core model from a file.
+  *
+  * @param pCoreModel The created core model to load into.
+  * @param strFilename The name of the file to load the core model from.
+  * @param priority The priority of the request; higher ones are loaded first.
+  * @param callback The function update() calls when the request finished.
+  * @param pUserData The user data passed to the callback.
+  *
+  * @return One of the following values:
+  *         \li the ID of the request
+  *         \li \b -1 if an error happend
+  *****************************************************************************/
+
+int CalAsyncLoader::loadCoreModel(CalCoreModel *pCoreModel, const std::string& strFilename, int priority, Callback callback, void *pUserData)
+{
+  return loadCoreModel(pCoreModel, strFilename, "", priority, callback, pUserData);
+}
+
+ /*****************************************************************************/
+/** Loads a core model from a skeleton and a mesh file in the background.
+  *
+  * This function queues the loading of a core model from two files.
+  *
+  * @param pCoreModel The created core model to load into.
+  * @param strFilename1 The name of the file to load the core skeleton from.
+  * @param strFilename2 The name of the file to load the core mesh from.
+  * @param priority The priority of the request; higher ones are loaded first.
+  * @param callback The function update() calls when the request finished.
+  * @param pUserData The user data passed to the callback.
+  *
+  * @return One of the following values:
+  *         \li the ID of the request
+  *         \li \b -1 if an error happend
+  *****************************************************************************/
+
+int CalAsyncLoader::loadCoreModel(CalCoreModel *pCoreModel, const std::string& strFilename1, const std::string& strFilename2, int priority, Callback callback, void *pUserData)
+{
+  if(pCoreModel == 0)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return -1;
+  }
+
+  Request request;
+  request.pCoreModel = pCoreModel;
+  request.pCoreAnimation = 0;
+  request.strFilename = strFilename1;
+  request.strFilename2 = strFilename2;
+  request.priority = priority;
+  request.callback = callback;
+  request.pUserData = pUserData;
+
+  return addRequest(request);
+}
+
+ /*****************************************************************************/
+/** Runs a loader thread.
+  *
+  * This function is the body of the loader threads. It takes the pending
+  * request of the highest priority, oldest first, and loads it outside the
+  * lock.
+  *****************************************************************************/
+
+void CalAsyncLoader::runWorker()
+{
+  Pool *pPool = m_pPool;
+
+  std::unique_lock<std::mutex> lock(pPool->mutex);
+  for(;;)
+  {
+    while(pPool->vectorPending.empty() && !pPool->bQuit) pPool->condition.wait(lock);
+    if(pPool->bQuit) break;
+
+    // pick the most urgent request
+    std::vector<int>::iterator iteratorBest = pPool->vectorPending.begin();
+    std::vector<int>::iterator iteratorRequestId;
+    for(iteratorRequestId = pPool->vectorPending.begin() + 1; iteratorRequestId != pPool->vectorPending.end(); ++iteratorRequestId)
+    {
+      const Request& request = pPool->mapRequest[*iteratorRequestId];
+      const Request& best = pPool->mapRequest[*iteratorBest];
+      if((request.priority > best.priority) || ((request.priority == best.priority) && (request.sequence < best.sequence)))
+      {
+        iteratorBest = iteratorRequestId;
+      }
+    }
+
+    int requestId = *iteratorBest;
+    pPool->vectorPending.erase(iteratorBest);
+
+    // the map doesn't move its elements, and nobody else writes the
+    // arguments of a loading request
+    Request& request = pPool->mapRequest[requestId];
+    request.state = STATE_LOADING;
+
+    lock.unlock();
+    CalLoader loader;
+    bool bSuccess;
+    if(request.pCoreAnimation != 0)
+    {
+      bSuccess = loader.loadCoreAnimation(request.pCoreAnimation, request.strFilename);
+    }
+    else if(request.strFilename2.empty())
+    {
+      bSuccess = loader.loadCoreModel(request.pCoreModel, request.strFilename);
+    }
+    else
+    {
+      bSuccess = loader.loadCoreModel(request.pCoreModel, request.strFilename, request.strFilename2);
+    }
+
+    CalError::Code errorCode = bSuccess ? CalError::OK : CalError::getLastErrorCode();
+    std::string strErrorText = bSuccess ? std::string() : CalError::getLastErrorText();
+    lock.lock();
+
+    if(request.bCancelled)
+    {
+      if(bSuccess)
+      {
+        if(request.pCoreAnimation != 0) request.pCoreAnimation->destroy();
+        else request.pCoreModel->destroy();
+      }
+      request.state = STATE_CANCELLED;
+    }
+    else
+    {
+      request.state = bSuccess ? STATE_DONE : STATE_FAILED;
+      request.errorCode = errorCode;
+      request.strErrorText = strErrorText;
+    }
+
+    pPool->vectorFinished.push_back(requestId);
+    pPool->conditionFinished.notify_all();
+  }
+}
+
+ /*****************************************************************************/
+/** Changes the priority of a pending request.
+  *
+  * @param requestId The ID of the request.
+  * @param priority The new priority; higher ones are loaded first.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if the request is not pending anymore
+  *****************************************************************************/
+
+bool CalAsyncLoader::setPriority(int requestId, int priority)
+{
+  if(m_pPool == 0) return false;
+
+  std::lock_guard<std::mutex> lock(m_pPool->mutex);
+
+  std::map<int, Request>::iterator iteratorRequest = m_pPool->mapRequest.find(requestId);
+  if((iteratorRequest == m_pPool->mapRequest.end()) || (iteratorRequest->second.state != STATE_PENDING)) return false;
+
+  iteratorRequest->second.priority = priority;
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Reports the finished requests.
+  *
+  * This function runs the callbacks of all requests that finished since the
+  * last call, on the calling thread, and then forgets about them. Call it
+  * regularly, for example once per frame.
+  *
+  * @return The number of requests reported.
+  *****************************************************************************/
+
+int CalAsyncLoader::update()
+{
+  if(m_pPool == 0) return 0;
+
+  std::vector<int> vectorFinished;
+  std::vector<Request> vectorRequest;
+  {
+    std::lock_guard<std::mutex> lock(m_pPool->mutex);
+    vectorFinished.swap(m_pPool->vectorFinished);
+
+    std::vector<int>::iterator iteratorRequestId;
+    for(iteratorRequestId = vectorFinished.begin(); iteratorRequestId != vectorFinished.end(); ++iteratorRequestId)
+    {
+      vectorRequest.push_back(m_pPool->mapRequest[*iteratorRequestId]);
+    }
+  }
+
+  // the requests stay queryable while their callbacks run
+  int finishedId;
+  for(finishedId = 0; finishedId < (int)vectorFinished.size(); finishedId++)
+  {
+    const Request& request = vectorRequest[finishedId];
+    if(request.callback != 0) request.callback(vectorFinished[finishedId], request.state, request.pUserData);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_pPool->mutex);
+
+    std::vector<int>::iterator iteratorRequestId;
+    for(iteratorRequestId = vectorFinished.begin(); iteratorRequestId != vectorFinished.end(); ++iteratorRequestId)
+    {
+      m_pPool->mapRequest.erase(*iteratorRequestId);
+    }
+  }
+
+  return (int)vectorFinished.size();
+}
+
+ /*****************************************************************************/
+/** Waits for a request to finish.
+  *
+  * This function blocks until the request is no longer pending or loading.
+  * It does not run the callback of the request, update() still does.
+  *
+  * @param requestId The ID of the request.
+  *
+  * @return The final state of the request, or STATE_NONE if it is unknown or
+  *         has already been reported by update().
+  *****************************************************************************/
+
+CalAsyncLoader::State CalAsyncLoader::wait(int requestId)
+{
+  if(m_pPool == 0) return STATE_NONE;
+
+  std::unique_lock<std::mutex> lock(m_pPool->mutex);
+  for(;;)
+  {
+    std::map<int, Request>::iterator iteratorRequest = m_pPool->mapRequest.find(requestId);
+    if(iteratorRequest == m_pPool->mapRequest.end()) return STATE_NONE;
+
+    State state = iteratorRequest->second.state;
+    if((state != STATE_PENDING) && (state != STATE_LOADING)) return state;
+
+    m_pPool->conditionFinished.wait(lock);
+  }
+}
+
+//****************************************************************************//
@@ -0,0 +1,101 @@
+//****************************************************************************//
+// asyncloader.h                                                              //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_ASYNCLOADER_H
+#define CAL_ASYNCLOADER_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+#include "calerror.h"
+
+//****************************************************************************//
+// Forward declarations                                                       //
+//****************************************************************************//
+
+class CalCoreAnimation;
+class CalCoreModel;
+
+//****************************************************************************//
+// Class declaration                                                          //
+//****************************************************************************//
+
+ /*****************************************************************************/
+/** The asynchronous loader class.
+  *
+  * This class runs CalLoader on a pool of loader threads, so that files are
+  * read and parsed without stalling the calling thread. Each load returns a
+  * request id that can be waited on, queried, reprioritized or cancelled.
+  * Completion callbacks are not run on the loader threads but on the thread
+  * that calls update(), typically once per frame, so they can hand the loaded
+  * core objects to the rest of the application without locking.
+  *
+  * The core model or core animation of a request must be created by the
+  * caller and must not be touched until the request has finished. A failed or
+  * cancelled request leaves it destroyed, like a failed CalLoader call does.
+  *****************************************************************************/
+
+class CAL3D_API CalAsyncLoader
+{
+// misc
+public:
+  /// The states of a load request.
+  enum State
+  {
+    STATE_NONE = 0,
+    STATE_PENDING,
+    STATE_LOADING,
+    STATE_DONE,
+    STATE_FAILED,
+    STATE_CANCELLED
+  };
+
+  /// The completion callback, run by update() once per finished request.
+  typedef void (*Callback)(int requestId, State state, void *pUserData);
+
+protected:
+  struct Request;
+  struct Pool;
+
+// member variables
+protected:
+  Pool *m_pPool;
+
+// constructors/destructor
+public:
+  CalAsyncLoader();
+  virtual ~CalAsyncLoader();
+
+// member functions
+public:
+  bool cancel(int requestId);
+  bool create(int threadCount = 1);
+  void destroy();
+  CalError::Code getErrorCode(int requestId);
+  std::string getErrorText(int requestId);
+  int getPendingCount();
+  State getState(int requestId);
+  int loadCoreAnimation(CalCoreAnimation *pCoreAnimation, const std::string& strFilename, int priority = 0, Callback callback = 0, void *pUserData = 0);
+  int loadCoreModel(CalCoreModel *pCoreModel, const std::string& strFilename, int priority = 0, Callback callback = 0, void *pUserData = 0);
+  int loadCoreModel(CalCoreModel *pCoreModel, const std::string& strFilename1, const std::string& strFilename2, int priority = 0, Callback callback = 0, void *pUserData = 0);
+  bool setPriority(int requestId, int priority);
+  int update();
+  State wait(int requestId);
+
+protected:
+  int addRequest(const Request& request);
+  void runWorker();
+};
+
+#endif
+
+//****************************************************************************//
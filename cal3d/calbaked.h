@@ -0,0 +1,199 @@
+//****************************************************************************//
+// baked.h                                                                    //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_BAKED_H
+#define CAL_BAKED_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+
+//****************************************************************************//
+// Baked file layout                                                          //
+//****************************************************************************//
+
+// A baked file holds a core model or a core animation as the arrays the
+// runtime classes keep, in the byte order of the machine that wrote it.
+//
+// The file starts with a Header, followed by the body. The body starts with
+// the section table, one Section per array. Each section stores its array at
+// an offset relative to the start of the body, aligned to ALIGNMENT bytes, so
+// the body can be copied or mapped anywhere. Per-submesh sections name their
+// submesh in 'owner' and their texture coordinate map in 'index'. Sections of
+// an unknown type are skipped, which lets later versions add tables.
+//
+// The tables that the runtime otherwise computes after loading (LOD steps,
+// influence sets, spring batches) are optional; the loader rebuilds the ones
+// that are missing.
+
+namespace CalBaked
+{
+  const int ALIGNMENT = 16;
+  const int BYTE_ORDER_TAG = 0x01020304;
+
+  enum ContentType
+  {
+    CONTENT_MODEL = 1,
+    CONTENT_ANIMATION = 2
+  };
+
+  enum SectionType
+  {
+    SECTION_STRING = 1,
+    SECTION_BONE,
+    SECTION_BONE_CHILD,
+    SECTION_SUBMESH,
+    SECTION_VERTEX,
+    SECTION_LOD_CONTROL,
+    SECTION_INFLUENCE,
+    SECTION_PHYSICAL_PROPERTY,
+    SECTION_SPRING,
+    SECTION_FACE,
+    SECTION_TEXTURE_COORDINATE,
+    SECTION_TANGENT_SPACE,
+    SECTION_LOD_STEP,
+    SECTION_LOD_FACE,
+    SECTION_INFLUENCE_SET,
+    SECTION_VERTEX_INFLUENCE_SET,
+    SECTION_SEAM_VERTEX,
+    SECTION_SPRING_BATCH,
+    SECTION_SPRING_FACTOR,
+    SECTION_ANIMATION,
+    SECTION_TRACK,
+    SECTION_KEYFRAME
+  };
+
+  /// The file header, behind which the body starts.
+  struct Header
+  {
+    char magic[4];
+    int version;
+    int byteOrder;
+    int contentType;
+    unsigned int bodySize;
+    int sectionCount;
+    int reserved[2];
+  };
+
+  /// An entry of the section table.
+  struct Section
+  {
+    int type;
+    int owner;
+    int index;
+    unsigned int offset;
+    unsigned int count;
+    int reserved;
+  };
+
+  struct Bone
+  {
+    int nameOffset;
+    int parentId;
+    int firstChild;
+    int childCount;
+    float length;
+    float translation[3];
+    float rotation[4];
+    float translationBoneSpace[3];
+    float rotationBoneSpace[4];
+    int reserved;
+  };
+
+  struct Submesh
+  {
+    int coreMaterialThreadId;
+    int vertexCount;
+    int faceCount;
+    int lodCount;
+    int springCount;
+    int textureCoordinateCount;
+    int maxInfluenceCount;
+    int reserved;
+  };
+
+  struct Vertex
+  {
+    float position[3];
+    char nx, ny, nz;
+    char influenceCount;
+  };
+
+  struct LodControl
+  {
+    int faceCollapseCount;
+    int collapseId;
+  };
+
+  struct LodStep
+  {
+    int vertexCount;
+    int faceCount;
+    int firstFace;
+  };
+
+  struct Animation
+  {
+    float duration;
+    int reserved[3];
+  };
+
+  struct Track
+  {
+    int nameOffset;
+    int firstKeyframe;
+    int keyframeCount;
+    int reserved;
+  };
+
+  struct Keyframe
+  {
+    float time;
+    float translation[3];
+    float rotation[4];
+  };
+
+  /// Returns the size of one element of a section, or 0 for an unknown type.
+  inline unsigned int getElementSize(int type)
+  {
+    switch(type)
+    {
+      case SECTION_STRING:               return 1;
+      case SECTION_BONE:                 return sizeof(Bone);
+      case SECTION_BONE_CHILD:           return sizeof(int);
+      case SECTION_SUBMESH:              return sizeof(Submesh);
+      case SECTION_VERTEX:               return sizeof(Vertex);
+      case SECTION_LOD_CONTROL:          return sizeof(LodControl);
+      case SECTION_INFLUENCE:            return 2 * sizeof(int);
+      case SECTION_PHYSICAL_PROPERTY:    return sizeof(float);
+      case SECTION_SPRING:               return 4 * sizeof(int);
+      case SECTION_FACE:                 return 3 * sizeof(int);
+      case SECTION_TEXTURE_COORDINATE:   return 2 * sizeof(float);
+      case SECTION_TANGENT_SPACE:        return 4;
+      case SECTION_LOD_STEP:             return sizeof(LodStep);
+      case SECTION_LOD_FACE:             return 3 * sizeof(int);
+      case SECTION_INFLUENCE_SET:        return 2 * sizeof(int);
+      case SECTION_VERTEX_INFLUENCE_SET: return sizeof(int);
+      case SECTION_SEAM_VERTEX:          return sizeof(int);
+      case SECTION_SPRING_BATCH:         return 2 * sizeof(int);
+      case SECTION_SPRING_FACTOR:        return sizeof(float);
+      case SECTION_ANIMATION:            return sizeof(Animation);
+      case SECTION_TRACK:                return sizeof(Track);
+      case SECTION_KEYFRAME:             return sizeof(Keyframe);
+      default:                           return 0;
+    }
+  }
+}
+
+#endif
+
+//****************************************************************************//
@@ -19,6 +19,221 @@
 
 #include "calcoreanim.h"
 #include "calcoretrack.h"
+#include "calcorekey.h"
+#include "calloader.h"
+#include "calerror.h"
+#include "mappedfilesource.h"
+
+#include <cfloat>
+
+// threading includes
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+
+ /*****************************************************************************/
+/** A chunk of a streamed core animation.
+  *
+  * A chunk holds the keyframes each core track needs to be sampled in one span
+  * of time. Chunks are shared by all models playing the core animation in the
+  * same span; a chunk is only freed when no one holds it and it has not been
+  * used for a while. The fields other than the keyframes are guarded by the
+  * chunk mutex; the keyframes are written by the thread that reads the chunk
+  * and don't change once it is ready.
+  *****************************************************************************/
+
+struct CalCoreAnimation::Chunk
+{
+  enum State
+  {
+    STATE_QUEUED,
+    STATE_LOADING,
+    STATE_READY,
+    STATE_FAILED
+  };
+
+  int chunkId;
+  State state;
+  CalError::Code errorCode;
+  int useCount;
+  double lastUseTime;
+  std::vector<std::map<float, CalCoreKeyframe *> > vectorMapCoreKeyframe;
+  CalArena arena;
+
+  Chunk(int id, State initialState, double time)
+    : chunkId(id), state(initialState), errorCode(CalError::OK), useCount(0), lastUseTime(time)
+  {
+  }
+};
+
+ /*****************************************************************************/
+/** The deferred keyframes of a lazily loaded core animation.
+  *
+  * The flag is set under the mutex once the keyframes are loaded, so the
+  * common case of an already loaded animation doesn't take the lock.
+  *
+  * A streamed core animation keeps its chunks apart from the core tracks, see
+  * acquireChunk(). The chunk mutex guards the chunk list, and the file mutex
+  * the mapped file, which is read by one thread at a time.
+  *****************************************************************************/
+
+struct CalCoreAnimation::DeferredTracks
+{
+  std::string strFilename;
+  std::mutex mutex;
+  std::atomic<bool> bLoaded;
+  CalArena arena;
+
+  float chunkDuration;
+  std::mutex chunkMutex;
+  std::condition_variable chunkCondition;
+  std::list<Chunk *> listChunk;
+  std::mutex fileMutex;
+  CalMappedFileSource *pFileSource;
+
+  DeferredTracks()
+    : bLoaded(false), chunkDuration(0.0f), pFileSource(0)
+  {
+  }
+};
+
+ /*****************************************************************************/
+/** The chunk prefetcher.
+  *
+  * A single thread reads the chunks that playback will reach next, for all
+  * streamed core animations in turn. It is started on first use and lives
+  * until the process ends.
+  *****************************************************************************/
+
+struct CalCoreAnimation::Prefetcher
+{
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::deque<std::pair<CalCoreAnimation *, Chunk *> > dequeJob;
+  CalCoreAnimation *pActiveCoreAnimation;
+
+  static Prefetcher& getInstance()
+  {
+    // never destroyed, the thread may still sleep on it at exit
+    static Prefetcher *pPrefetcher = new Prefetcher();
+    return *pPrefetcher;
+  }
+
+  /// Queues a chunk, which must hold a use for the job.
+  void queue(CalCoreAnimation *pCoreAnimation, Chunk *pChunk)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      dequeJob.push_back(std::make_pair(pCoreAnimation, pChunk));
+    }
+    condition.notify_all();
+  }
+
+  /// Drops the queued chunks of a core animation and waits for the one
+  /// being read.
+  void cancel(CalCoreAnimation *pCoreAnimation)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    std::deque<std::pair<CalCoreAnimation *, Chunk *> >::iterator iteratorJob = dequeJob.begin();
+    while(iteratorJob != dequeJob.end())
+    {
+      if(iteratorJob->first == pCoreAnimation) iteratorJob = dequeJob.erase(iteratorJob);
+      else ++iteratorJob;
+    }
+
+    while(pActiveCoreAnimation == pCoreAnimation) condition.wait(lock);
+  }
+
+protected:
+  Prefetcher()
+    : pActiveCoreAnimation(0)
+  {
+    std::thread(&Prefetcher::run, this).detach();
+  }
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(true)
+    {
+      while(dequeJob.empty()) condition.wait(lock);
+
+      std::pair<CalCoreAnimation *, Chunk *> job = dequeJob.front();
+      dequeJob.pop_front();
+      pActiveCoreAnimation = job.first;
+      lock.unlock();
+
+      job.first->prefetchChunk(job.second);
+
+      lock.lock();
+      pActiveCoreAnimation = 0;
+      condition.notify_all();
+    }
+  }
+};
+
+namespace
+{
+  /// Returns the number of chunks a streamed core animation is split into.
+  int getChunkCount(float duration, float chunkDuration)
+  {
+    float chunkCount = ceilf(duration / chunkDuration);
+    if(!(chunkCount > 1.0f)) return 1;
+
+    return (chunkCount < 65536.0f) ? (int)chunkCount : 65536;
+  }
+
+  /// Returns the start of a chunk. The first chunk reaches back and the last
+  /// one forward without end, so every time falls into one of them.
+  float getChunkStartTime(int chunkId, int chunkCount, float chunkDuration)
+  {
+    if(chunkId <= 0) return -FLT_MAX;
+    if(chunkId >= chunkCount) return FLT_MAX;
+
+    return chunkId * chunkDuration;
+  }
+
+  /// Returns the chunk a time falls into.
+  int getChunkId(float time, int chunkCount, float chunkDuration)
+  {
+    float chunk = time / chunkDuration;
+    int chunkId = (chunk > 0.0f) ? ((chunk < chunkCount) ? (int)chunk : chunkCount - 1) : 0;
+
+    // the division may round across the border of a chunk
+    while((chunkId > 0) && (time < getChunkStartTime(chunkId, chunkCount, chunkDuration))) chunkId--;
+    while((chunkId < chunkCount - 1) && (time >= getChunkStartTime(chunkId + 1, chunkCount, chunkDuration))) chunkId++;
+
+    return chunkId;
+  }
+
+  /// Returns the wall clock time in seconds, which ages unused chunks.
+  double getClockTime()
+  {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /// Destroys the keyframes in a set of maps and frees their arena.
+  void releaseKeyframes(std::vector<std::map<float, CalCoreKeyframe *> >& vectorMapCoreKeyframe, CalArena *pArena)
+  {
+    std::vector<std::map<float, CalCoreKeyframe *> >::iterator iteratorMap;
+    for(iteratorMap = vectorMapCoreKeyframe.begin(); iteratorMap != vectorMapCoreKeyframe.end(); ++iteratorMap)
+    {
+      std::map<float, CalCoreKeyframe *>::iterator iteratorCoreKeyframe;
+      for(iteratorCoreKeyframe = iteratorMap->begin(); iteratorCoreKeyframe != iteratorMap->end(); ++iteratorCoreKeyframe)
+      {
+        iteratorCoreKeyframe->second->destroy();
+        CalArena::release(pArena, iteratorCoreKeyframe->second);
+      }
+      iteratorMap->clear();
+    }
+
+    pArena->clear();
+  }
+}
 
  /*****************************************************************************/
 /** Constructs the core animation instance.
@@ -28,22 +243,130 @@
 
 CalCoreAnimation::CalCoreAnimation()
 {
+  m_pDeferredTracks = 0;
 }
 
 CalCoreAnimation::~CalCoreAnimation()
 {
+  // the prefetch thread reads the core tracks
+  if(m_pDeferredTracks != 0) releaseChunks();
+
   std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
   for(iteratorCoreTrack = m_listCoreTrack.begin(); iteratorCoreTrack != m_listCoreTrack.end(); ++iteratorCoreTrack)
   {
   (*iteratorCoreTrack)->destroy();
-  delete *iteratorCoreTrack; 
+  CalArena::release(&m_arena, *iteratorCoreTrack);
   }
+  delete m_pDeferredTracks;
   // assert(m_listCoreTrack.empty());
 }
 
 CalCoreAnimation *CalCoreAnimation::Alloc(void) { return new CalCoreAnimation; }
 void CalCoreAnimation::Free(CalCoreAnimation *x) { delete x; }
 
+ /*****************************************************************************/
+/** Acquires the chunk of a streamed core animation needed at a given time.
+  *
+  * This function returns the chunk the time falls into, reading it from the
+  * file if no model plays the core animation in the same span. The next chunk
+  * is read ahead on the prefetch thread, so playing through the animation
+  * only waits when it jumps. The chunk stays in memory until it is handed back
+  * with releaseChunk(); its keyframes are sampled with getChunkMapCoreKeyframe()
+  * and CalCoreTrack::getState(). CalModel::blendState() does all of this, and
+  * it can be called from several threads at once for any times.
+  *
+  * @param time The time in seconds the core animation is sampled at.
+  *
+  * @return One of the following values:
+  *         \li a pointer to the chunk
+  *         \li \b 0 if the core animation isn't streamed or an error happend
+  *****************************************************************************/
+
+const CalCoreAnimation::Chunk *CalCoreAnimation::acquireChunk(float time)
+{
+  if(!isStreamed())
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalCoreAnimation::acquireChunk");
+    return 0;
+  }
+
+  DeferredTracks& deferredTracks = *m_pDeferredTracks;
+  int chunkCount = getChunkCount(m_duration, deferredTracks.chunkDuration);
+  int chunkId = getChunkId(time, chunkCount, deferredTracks.chunkDuration);
+  double clockTime = getClockTime();
+
+  std::unique_lock<std::mutex> lock(deferredTracks.chunkMutex);
+  evictChunks(false);
+
+  // share the chunk if it is in memory, or take it over from the prefetcher
+  // if it has not started on it yet
+  Chunk *pChunk = 0;
+  std::list<Chunk *>::iterator iteratorChunk;
+  for(iteratorChunk = deferredTracks.listChunk.begin(); iteratorChunk != deferredTracks.listChunk.end(); ++iteratorChunk)
+  {
+    if((*iteratorChunk)->chunkId == chunkId) pChunk = *iteratorChunk;
+  }
+
+  bool bRead = false;
+  if(pChunk == 0)
+  {
+    pChunk = new Chunk(chunkId, Chunk::STATE_LOADING, clockTime);
+    deferredTracks.listChunk.push_back(pChunk);
+    bRead = true;
+  }
+  else if(pChunk->state == Chunk::STATE_QUEUED)
+  {
+    pChunk->state = Chunk::STATE_LOADING;
+    bRead = true;
+  }
+  pChunk->useCount++;
+  pChunk->lastUseTime = clockTime;
+
+  if(bRead)
+  {
+    lock.unlock();
+    bool bSuccess = readChunk(pChunk);
+    lock.lock();
+
+    pChunk->state = bSuccess ? Chunk::STATE_READY : Chunk::STATE_FAILED;
+    deferredTracks.chunkCondition.notify_all();
+  }
+  else
+  {
+    while(pChunk->state == Chunk::STATE_LOADING) deferredTracks.chunkCondition.wait(lock);
+  }
+
+  if(pChunk->state == Chunk::STATE_FAILED)
+  {
+    // errors are kept per thread, so the code is handed over
+    pChunk->useCount--;
+    CalError::setLastError(pChunk->errorCode, __FILE__, __LINE__, deferredTracks.strFilename);
+    return 0;
+  }
+
+  // read the next chunk ahead, wrapping around for looping animations
+  if(chunkCount > 1)
+  {
+    int nextChunkId = (chunkId + 1) % chunkCount;
+
+    bool bResident = false;
+    for(iteratorChunk = deferredTracks.listChunk.begin(); iteratorChunk != deferredTracks.listChunk.end(); ++iteratorChunk)
+    {
+      if((*iteratorChunk)->chunkId == nextChunkId) bResident = true;
+    }
+
+    if(!bResident)
+    {
+      Chunk *pNextChunk = new Chunk(nextChunkId, Chunk::STATE_QUEUED, clockTime);
+      pNextChunk->useCount = 1;
+      deferredTracks.listChunk.push_back(pNextChunk);
+      Prefetcher::getInstance().queue(this, pNextChunk);
+    }
+  }
+
+  return pChunk;
+}
+
  /*****************************************************************************/
 /** Adds a core track.
   *
@@ -89,6 +412,9 @@ bool CalCoreAnimation::create(const char *strName)
 
 void CalCoreAnimation::destroy()
 {
+  // the prefetch thread reads the core tracks
+  if(m_pDeferredTracks != 0) releaseChunks();
+
   // destroy all core tracks
   while(!m_listCoreTrack.empty())
   {
@@ -97,8 +423,80 @@ void CalCoreAnimation::destroy()
     m_listCoreTrack.pop_front();
 
     pCoreTrack->destroy();
-    delete pCoreTrack;
+    CalArena::release(&m_arena, pCoreTrack);
   }
+
+  delete m_pDeferredTracks;
+  m_pDeferredTracks = 0;
+
+  // free the core tracks and core keyframes at once
+  m_arena.clear();
+}
+
+ /*****************************************************************************/
+/** Frees the unused chunks of a streamed core animation.
+  *
+  * This function frees the chunks no one holds that failed to load or, unless
+  * all of them are freed, were not used for twice the chunk duration. Chunks
+  * that playback is about to reach are held by the prefetcher. The chunk
+  * mutex must be held.
+  *
+  * @param bAll \b true to free the unused chunks however recently they were
+  *             used.
+  *****************************************************************************/
+
+void CalCoreAnimation::evictChunks(bool bAll)
+{
+  DeferredTracks& deferredTracks = *m_pDeferredTracks;
+  double evictTime = getClockTime() - 2.0 * deferredTracks.chunkDuration;
+
+  std::list<Chunk *>::iterator iteratorChunk = deferredTracks.listChunk.begin();
+  while(iteratorChunk != deferredTracks.listChunk.end())
+  {
+    Chunk *pChunk = *iteratorChunk;
+    bool bEvict = (pChunk->useCount == 0) && ((pChunk->state == Chunk::STATE_FAILED) || ((pChunk->state == Chunk::STATE_READY) && (bAll || (pChunk->lastUseTime < evictTime))));
+    if(!bEvict)
+    {
+      ++iteratorChunk;
+      continue;
+    }
+
+    releaseKeyframes(pChunk->vectorMapCoreKeyframe, &pChunk->arena);
+    delete pChunk;
+    iteratorChunk = deferredTracks.listChunk.erase(iteratorChunk);
+  }
+}
+
+ /*****************************************************************************/
+/** Returns the chunk duration.
+  *
+  * This function returns the length of the chunks a streamed core animation
+  * is played in, see setChunkDuration().
+  *
+  * @return The chunk duration in seconds, 0 if the core animation isn't
+  *         streamed.
+  *****************************************************************************/
+
+float CalCoreAnimation::getChunkDuration()
+{
+  return (m_pDeferredTracks != 0) ? m_pDeferredTracks->chunkDuration : 0.0f;
+}
+
+ /*****************************************************************************/
+/** Returns the keyframes of a core track in a chunk.
+  *
+  * This function returns the keyframes a core track of a streamed core
+  * animation needs to be sampled in the span of a chunk, see acquireChunk().
+  *
+  * @param pChunk A pointer to the chunk, as returned by acquireChunk().
+  * @param trackId The position of the core track in the core track list.
+  *
+  * @return A reference to the keyframes.
+  *****************************************************************************/
+
+const std::map<float, CalCoreKeyframe *>& CalCoreAnimation::getChunkMapCoreKeyframe(const Chunk *pChunk, int trackId)
+{
+  return pChunk->vectorMapCoreKeyframe[trackId];
 }
 
  /*****************************************************************************/
@@ -128,6 +526,354 @@ std::list<CalCoreTrack *>& CalCoreAnimation::getListCoreTrack()
   return m_listCoreTrack;
 }
 
+ /*****************************************************************************/
+/** Returns the memory size.
+  *
+  * This function returns the number of bytes the core animation instance
+  * holds in its core tracks and core keyframes. The keyframes of a lazily
+  * loaded core animation only count while they are loaded, and those of a
+  * streamed one while their chunks are in memory.
+  *
+  * @return The memory size in bytes.
+  *****************************************************************************/
+
+size_t CalCoreAnimation::getMemorySize()
+{
+  size_t size = sizeof(CalCoreAnimation) + m_strName.capacity();
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = m_listCoreTrack.begin(); iteratorCoreTrack != m_listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    // tracks are list nodes, keyframes are map nodes of a key, a value and
+    // three links each; the bone names are shared in the name table
+    CalCoreTrack *pCoreTrack = *iteratorCoreTrack;
+    size += sizeof(CalCoreTrack) + 2 * sizeof(void *);
+    size += pCoreTrack->getMapCoreKeyframe().size() * (sizeof(CalCoreKeyframe) + sizeof(float) + 4 * sizeof(void *));
+  }
+
+  if(m_pDeferredTracks != 0)
+  {
+    std::lock_guard<std::mutex> lock(m_pDeferredTracks->chunkMutex);
+
+    std::list<Chunk *>::iterator iteratorChunk;
+    for(iteratorChunk = m_pDeferredTracks->listChunk.begin(); iteratorChunk != m_pDeferredTracks->listChunk.end(); ++iteratorChunk)
+    {
+      // the keyframes of a chunk being read are not there yet
+      Chunk *pChunk = *iteratorChunk;
+      if(pChunk->state != Chunk::STATE_READY) continue;
+
+      size += sizeof(Chunk);
+      std::vector<std::map<float, CalCoreKeyframe *> >::iterator iteratorMap;
+      for(iteratorMap = pChunk->vectorMapCoreKeyframe.begin(); iteratorMap != pChunk->vectorMapCoreKeyframe.end(); ++iteratorMap)
+      {
+        size += iteratorMap->size() * (sizeof(CalCoreKeyframe) + sizeof(float) + 4 * sizeof(void *));
+      }
+    }
+  }
+
+  return size;
+}
+
+ /*****************************************************************************/
+/** Returns the arena for the core keyframes.
+  *
+  * This function returns the arena the loader places the core keyframes in.
+  * The keyframes of a lazily loaded core animation get an arena of their own,
+  * so unloadTracks() can free them without the core tracks.
+  *
+  * @return A pointer to the arena.
+  *****************************************************************************/
+
+CalArena *CalCoreAnimation::getKeyframeArena()
+{
+  return (m_pDeferredTracks != 0) ? &m_pDeferredTracks->arena : &m_arena;
+}
+
+ /*****************************************************************************/
+/** Returns if the core animation was loaded lazily.
+  *
+  * @return One of the following values:
+  *         \li \b true if the keyframes are read on demand
+  *         \li \b false if they were loaded with the animation
+  *****************************************************************************/
+
+bool CalCoreAnimation::isLazy()
+{
+  return m_pDeferredTracks != 0;
+}
+
+ /*****************************************************************************/
+/** Returns if the core animation streams its keyframes.
+  *
+  * @return One of the following values:
+  *         \li \b true if the keyframes are sampled from chunks, see
+  *             acquireChunk()
+  *         \li \b false if they are sampled from the core tracks
+  *****************************************************************************/
+
+bool CalCoreAnimation::isStreamed()
+{
+  return (m_pDeferredTracks != 0) && (m_pDeferredTracks->chunkDuration > 0.0f);
+}
+
+ /*****************************************************************************/
+/** Returns if the keyframes of the core animation are in memory.
+  *
+  * @return One of the following values:
+  *         \li \b true if the core tracks hold all keyframes
+  *         \li \b false if they still need to be loaded with loadTracks()
+  *****************************************************************************/
+
+bool CalCoreAnimation::isTrackDataLoaded()
+{
+  return (m_pDeferredTracks == 0) || m_pDeferredTracks->bLoaded;
+}
+
+ /*****************************************************************************/
+/** Loads the keyframes of a lazily loaded core animation.
+  *
+  * This function reads the keyframes of all core tracks from the animation
+  * file if they are not in memory yet. CalModel::blendState() calls it before
+  * sampling, so it only needs to be called directly to sample the core tracks
+  * by hand or to load the keyframes ahead of time. It can be called from
+  * several threads at once. A streamed core animation keeps streaming, as it
+  * is sampled from its chunks; the keyframes stay in the core tracks until
+  * unloadTracks() is called.
+  *
+  * @return One of the following values:
+  *         \li \b true if the keyframes are in memory
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalCoreAnimation::loadTracks()
+{
+  if((m_pDeferredTracks == 0) || m_pDeferredTracks->bLoaded) return true;
+
+  std::lock_guard<std::mutex> lock(m_pDeferredTracks->mutex);
+  if(m_pDeferredTracks->bLoaded) return true;
+
+  if(!CalLoader::loadDeferredTracks(this, m_pDeferredTracks->strFilename)) return false;
+
+  m_pDeferredTracks->bLoaded = true;
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Loads the keyframes of a core animation needed at a given time.
+  *
+  * This function reads the chunk of a streamed core animation the time falls
+  * into, and the one after it, ahead of sampling, see acquireChunk(). The
+  * chunk is kept for a while, like after playback. Other core animations are
+  * loaded like by loadTracks().
+  *
+  * @param time The time in seconds the core animation will be sampled at.
+  *
+  * @return One of the following values:
+  *         \li \b true if the keyframes are in memory
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalCoreAnimation::loadTracks(float time)
+{
+  if(!isStreamed()) return loadTracks();
+
+  const Chunk *pChunk = acquireChunk(time);
+  if(pChunk == 0) return false;
+
+  releaseChunk(pChunk);
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Reads a chunk for the prefetcher.
+  *
+  * This function runs on the prefetch thread. It reads a queued chunk unless
+  * a model has taken it over in the meantime, and drops the use the queue
+  * held on it.
+  *
+  * @param pChunk A pointer to the chunk.
+  *****************************************************************************/
+
+void CalCoreAnimation::prefetchChunk(Chunk *pChunk)
+{
+  DeferredTracks& deferredTracks = *m_pDeferredTracks;
+
+  {
+    std::lock_guard<std::mutex> lock(deferredTracks.chunkMutex);
+    if(pChunk->state != Chunk::STATE_QUEUED)
+    {
+      pChunk->useCount--;
+      return;
+    }
+    pChunk->state = Chunk::STATE_LOADING;
+  }
+
+  bool bSuccess = readChunk(pChunk);
+
+  std::lock_guard<std::mutex> lock(deferredTracks.chunkMutex);
+  pChunk->state = bSuccess ? Chunk::STATE_READY : Chunk::STATE_FAILED;
+  pChunk->useCount--;
+  deferredTracks.chunkCondition.notify_all();
+}
+
+ /*****************************************************************************/
+/** Reads the keyframes of a chunk.
+  *
+  * This function reads the keyframes of a chunk from the animation file. Only
+  * the thread that set the chunk to loading may call it.
+  *
+  * @param pChunk A pointer to the chunk.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend, its code is kept in the chunk
+  *****************************************************************************/
+
+bool CalCoreAnimation::readChunk(Chunk *pChunk)
+{
+  DeferredTracks& deferredTracks = *m_pDeferredTracks;
+  std::lock_guard<std::mutex> lock(deferredTracks.fileMutex);
+
+  if(deferredTracks.pFileSource == 0)
+  {
+    deferredTracks.pFileSource = new CalMappedFileSource(deferredTracks.strFilename);
+    if(!deferredTracks.pFileSource->isMapped())
+    {
+      delete deferredTracks.pFileSource;
+      deferredTracks.pFileSource = 0;
+
+      pChunk->errorCode = CalError::FILE_NOT_FOUND;
+      return false;
+    }
+  }
+
+  int chunkCount = getChunkCount(m_duration, deferredTracks.chunkDuration);
+  float startTime = getChunkStartTime(pChunk->chunkId, chunkCount, deferredTracks.chunkDuration);
+  float endTime = getChunkStartTime(pChunk->chunkId + 1, chunkCount, deferredTracks.chunkDuration);
+
+  if(!CalLoader::loadStreamedKeyframes(this, *deferredTracks.pFileSource, startTime, endTime, &pChunk->arena, pChunk->vectorMapCoreKeyframe))
+  {
+    pChunk->errorCode = CalError::getLastErrorCode();
+    return false;
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Releases a chunk of a streamed core animation.
+  *
+  * This function hands back a chunk returned by acquireChunk(). It stays in
+  * memory for a while, in case a model plays the same span again.
+  *
+  * @param pChunk A pointer to the chunk.
+  *****************************************************************************/
+
+void CalCoreAnimation::releaseChunk(const Chunk *pChunk)
+{
+  std::lock_guard<std::mutex> lock(m_pDeferredTracks->chunkMutex);
+
+  Chunk *pUsedChunk = const_cast<Chunk *>(pChunk);
+  pUsedChunk->useCount--;
+  pUsedChunk->lastUseTime = getClockTime();
+}
+
+ /*****************************************************************************/
+/** Frees the chunks of a streamed core animation.
+  *
+  * This function cancels the chunks queued for the prefetcher, waits for the
+  * one it reads and frees all chunks and the mapped file. No chunk may be held
+  * and the core animation must not be sampled meanwhile.
+  *****************************************************************************/
+
+void CalCoreAnimation::releaseChunks()
+{
+  DeferredTracks& deferredTracks = *m_pDeferredTracks;
+
+  // the queued chunks are in the list until the prefetcher is done with them
+  bool bChunks;
+  {
+    std::lock_guard<std::mutex> lock(deferredTracks.chunkMutex);
+    bChunks = !deferredTracks.listChunk.empty();
+  }
+  if(bChunks) Prefetcher::getInstance().cancel(this);
+
+  {
+    std::lock_guard<std::mutex> lock(deferredTracks.chunkMutex);
+
+    std::list<Chunk *>::iterator iteratorChunk;
+    for(iteratorChunk = deferredTracks.listChunk.begin(); iteratorChunk != deferredTracks.listChunk.end(); ++iteratorChunk)
+    {
+      releaseKeyframes((*iteratorChunk)->vectorMapCoreKeyframe, &(*iteratorChunk)->arena);
+      delete *iteratorChunk;
+    }
+    deferredTracks.listChunk.clear();
+  }
+
+  std::lock_guard<std::mutex> lock(deferredTracks.fileMutex);
+  delete deferredTracks.pFileSource;
+  deferredTracks.pFileSource = 0;
+}
+
+ /*****************************************************************************/
+/** Sets the chunk duration.
+  *
+  * This function makes a lazily loaded core animation stream its keyframes:
+  * only the chunks being played, the ones after them and those played within
+  * twice the chunk duration are in memory, so long animations such as
+  * cutscenes take the same memory whatever their length. The loader sets two
+  * seconds for the LOADER_STREAM_TRACKS flag. Any keyframes in memory are
+  * freed, so no chunk may be held and the core animation must not be sampled
+  * meanwhile.
+  *
+  * @param chunkDuration The length of a chunk in seconds, or 0 to stop
+  *                      streaming.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if the core animation wasn't loaded lazily
+  *****************************************************************************/
+
+bool CalCoreAnimation::setChunkDuration(float chunkDuration)
+{
+  if(m_pDeferredTracks == 0) return false;
+
+  std::lock_guard<std::mutex> lock(m_pDeferredTracks->mutex);
+
+  releaseChunks();
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = m_listCoreTrack.begin(); iteratorCoreTrack != m_listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    (*iteratorCoreTrack)->destroy();
+  }
+  m_pDeferredTracks->arena.clear();
+  m_pDeferredTracks->bLoaded = false;
+
+  m_pDeferredTracks->chunkDuration = (chunkDuration > 0.0f) ? chunkDuration : 0.0f;
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Sets the file of a lazily loaded core animation.
+  *
+  * This function is called by the loader to mark the core animation as lazily
+  * loaded. Its core tracks carry the file offsets of their keyframes.
+  *
+  * @param strFilename The name of the file the keyframes are read from.
+  *****************************************************************************/
+
+void CalCoreAnimation::setDeferredFile(const std::string& strFilename)
+{
+  if(m_pDeferredTracks == 0) m_pDeferredTracks = new DeferredTracks();
+
+  m_pDeferredTracks->strFilename = strFilename;
+  m_pDeferredTracks->bLoaded = false;
+}
+
  /*****************************************************************************/
 /** Sets the duration.
   *
@@ -141,4 +887,49 @@ void CalCoreAnimation::setDuration(float duration)
   m_duration = duration;
 }
 
+ /*****************************************************************************/
+/** Frees the keyframes of a lazily loaded core animation.
+  *
+  * This function drops the keyframes of all core tracks; the next call to
+  * loadTracks() reads them again. Use it to evict animations that are not
+  * played anymore. The core animation must not be sampled while it runs,
+  * unless it is streamed: then only the chunks no one holds are freed.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if the core animation wasn't loaded lazily
+  *****************************************************************************/
+
+bool CalCoreAnimation::unloadTracks()
+{
+  if(m_pDeferredTracks == 0) return false;
+
+  std::lock_guard<std::mutex> lock(m_pDeferredTracks->mutex);
+
+  {
+    std::lock_guard<std::mutex> chunkLock(m_pDeferredTracks->chunkMutex);
+    evictChunks(true);
+
+    // the file is mapped again with the next chunk
+    if(m_pDeferredTracks->listChunk.empty())
+    {
+      std::lock_guard<std::mutex> fileLock(m_pDeferredTracks->fileMutex);
+      delete m_pDeferredTracks->pFileSource;
+      m_pDeferredTracks->pFileSource = 0;
+    }
+  }
+
+  // the file offsets of the core tracks survive, only the keyframes go
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = m_listCoreTrack.begin(); iteratorCoreTrack != m_listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    (*iteratorCoreTrack)->destroy();
+  }
+  m_pDeferredTracks->arena.clear();
+
+  m_pDeferredTracks->bLoaded = false;
+
+  return true;
+}
+
 //****************************************************************************//
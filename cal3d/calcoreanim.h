@@ -16,12 +16,14 @@
 //****************************************************************************//
 
 #include "calglobal.h"
+#include "calarena.h"
 
 //****************************************************************************//
 // Forward declarations                                                       //
 //****************************************************************************//
 
 class CalCoreTrack;
+class CalCoreKeyframe;
 
 //****************************************************************************//
 // Class declaration                                                          //
@@ -33,11 +35,23 @@ class CalCoreTrack;
 
 class CAL3D_API CalCoreAnimation: public CalCoreAnimationUserData
 {
+  friend class CalLoader;
+
+// misc
+public:
+  struct Chunk;
+
+protected:
+  struct DeferredTracks;
+  struct Prefetcher;
+
 // member variables
 protected:
   std::string m_strName;
   float m_duration;
   std::list<CalCoreTrack *> m_listCoreTrack;
+  DeferredTracks *m_pDeferredTracks;
+  CalArena m_arena;
 
 // constructors/destructor
 public:
@@ -48,12 +62,32 @@ public:
 
 // member functions	
 public:
+  const Chunk *acquireChunk(float time);
   bool addCoreTrack(CalCoreTrack *pCoreTrack);
   bool create(const char *strName);
   void destroy();
   float getDuration();
+  float getChunkDuration();
+  const std::map<float, CalCoreKeyframe *>& getChunkMapCoreKeyframe(const Chunk *pChunk, int trackId);
   std::list<CalCoreTrack *>& getListCoreTrack();
+  size_t getMemorySize();
+  bool isLazy();
+  bool isStreamed();
+  bool isTrackDataLoaded();
+  bool loadTracks();
+  bool loadTracks(float time);
+  void releaseChunk(const Chunk *pChunk);
+  bool setChunkDuration(float chunkDuration);
+  void setDeferredFile(const std::string& strFilename);
   void setDuration(float duration);
+  bool unloadTracks();
+
+protected:
+  void evictChunks(bool bAll);
+  CalArena *getKeyframeArena();
+  void prefetchChunk(Chunk *pChunk);
+  bool readChunk(Chunk *pChunk);
+  void releaseChunks();
 };
 
 #endif
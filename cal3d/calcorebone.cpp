@@ -20,6 +20,7 @@
 #include "calerror.h"
 #include "calcorebone.h"
 #include "calcoremodel.h"
+#include "calnametable.h"
 
  /*****************************************************************************/
 /** Constructs the core bone instance.
@@ -29,6 +30,7 @@
 
 CalCoreBone::CalCoreBone()
 {
+  m_nameId = -1;
   m_pCoreModel = 0;
   m_parentId = -1;
 }
@@ -118,7 +120,26 @@ void CalCoreBone::calculateState()
 
 bool CalCoreBone::create(const std::string& strName)
 {
-  m_strName = strName;
+  return create(CalNameTable::intern(strName));
+}
+
+ /*****************************************************************************/
+/** Creates the core bone instance.
+  *
+  * This function creates the core bone instance from a name that is already
+  * in the name table, as the loader does.
+  *
+  * @param nameId The ID of the name of the core bone instance, see
+  *               CalNameTable.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalCoreBone::create(int nameId)
+{
+  m_nameId = nameId;
 
   return true;
 }
@@ -136,7 +157,7 @@ void CalCoreBone::destroy()
   m_listChildId.clear();
 
   m_parentId = -1;
-  m_strName.erase();
+  m_nameId = -1;
 }
 
  /*****************************************************************************/
@@ -163,7 +184,21 @@ std::list<int>& CalCoreBone::getListChildId()
 
 const std::string& CalCoreBone::getName()
 {
-  return m_strName;
+  return CalNameTable::getName(m_nameId);
+}
+
+ /*****************************************************************************/
+/** Returns the name ID.
+  *
+  * This function returns the ID of the name of the core bone instance in the
+  * name table. Bones and tracks with the same name have the same ID.
+  *
+  * @return The ID of the name.
+  *****************************************************************************/
+
+int CalCoreBone::getNameId()
+{
+  return m_nameId;
 }
 
  /*****************************************************************************/
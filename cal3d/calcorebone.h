@@ -33,7 +33,7 @@ class CAL3D_API CalCoreBone: public CalCoreBoneUserData
 {
 // member variables
 protected:
-  std::string m_strName;
+  int m_nameId;
   CalCoreModel *m_pCoreModel;
   int m_parentId;
   std::list<int> m_listChildId;
@@ -55,9 +55,11 @@ public:
   bool addChildId(int childId);
   void calculateState();
   bool create(const std::string& strName);
+  bool create(int nameId);
   void destroy();
   std::list<int>& getListChildId();
   const std::string& getName();
+  int getNameId();
   int getParentId();
   float getLength();
   const CalQuaternion& getRotation();
@@ -21,6 +21,7 @@
 #include "calcorebone.h"
 #include "calcoresub.h"
 #include "calerror.h"
+#include "calnametable.h"
 #include "calloader.h"
 #include "calsaver.h"
 
@@ -79,7 +80,7 @@ void CalCoreModel::destroy(void)
   for(iteratorCoreBone = m_vectorCoreBone.begin(); iteratorCoreBone != m_vectorCoreBone.end(); ++iteratorCoreBone)
   {
     (*iteratorCoreBone)->destroy();
-    delete (*iteratorCoreBone);
+    CalArena::release(&m_arena, *iteratorCoreBone);
   }
   m_vectorCoreBone.clear();
   
@@ -88,9 +89,12 @@ void CalCoreModel::destroy(void)
   for(iteratorCoreSubmesh = m_vectorCoreSubmesh.begin(); iteratorCoreSubmesh != m_vectorCoreSubmesh.end(); ++iteratorCoreSubmesh)
   {
     (*iteratorCoreSubmesh)->destroy();
-    delete (*iteratorCoreSubmesh);
+    CalArena::release(&m_arena, *iteratorCoreSubmesh);
   }
   m_vectorCoreSubmesh.clear();
+
+  // free the core bones and core submeshes at once
+  m_arena.clear();
 }
 
  /*****************************************************************************/
@@ -143,10 +147,14 @@ CalCoreBone *CalCoreModel::getCoreBone(int coreBoneId)
 
 int CalCoreModel::getCoreBoneId(const std::string& strName)
 {
+  // a name that was never interned can't belong to a core bone
+  int nameId = CalNameTable::find(strName);
+  if(nameId == -1) return -1;
+
   int boneId;
   for(boneId = 0; boneId < (int)m_vectorCoreBone.size(); boneId++)
   {
-    if(m_vectorCoreBone[boneId]->getName() == strName) return boneId;
+    if(m_vectorCoreBone[boneId]->getNameId() == nameId) return boneId;
   }
 
   return -1;
@@ -168,7 +176,12 @@ int CalCoreModel::addCoreBone(const std::string& strName)
   int boneId = m_vectorCoreBone.size();
   
   // Create the core bone
-  CalCoreBone *pCoreBone = new CalCoreBone();
+  CalCoreBone *pCoreBone = CalArena::construct<CalCoreBone>(&m_arena);
+  if(pCoreBone == 0)
+  {
+    CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
+    return -1;
+  }
   pCoreBone->create(strName);
   pCoreBone->setCoreModel(this);
 
@@ -197,6 +210,39 @@ void CalCoreModel::calculateState()
   }
 }
 
+ /*****************************************************************************/
+/** Returns the memory size.
+  *
+  * This function returns the number of bytes the core model instance holds in
+  * its core bones and core submeshes.
+  *
+  * @return The memory size in bytes.
+  *****************************************************************************/
+
+size_t CalCoreModel::getMemorySize()
+{
+  size_t size = sizeof(CalCoreModel) + m_strName.capacity();
+  size += m_vectorCoreBone.capacity() * sizeof(CalCoreBone *);
+  size += m_vectorCoreSubmesh.capacity() * sizeof(CalCoreSubmesh *);
+
+  size_t boneId;
+  for(boneId = 0; boneId < m_vectorCoreBone.size(); boneId++)
+  {
+    // the child ids are list nodes of an int and two links
+    CalCoreBone *pCoreBone = m_vectorCoreBone[boneId];
+    size += sizeof(CalCoreBone);
+    size += pCoreBone->getListChildId().size() * (sizeof(int) + 2 * sizeof(void *));
+  }
+
+  size_t submeshId;
+  for(submeshId = 0; submeshId < m_vectorCoreSubmesh.size(); submeshId++)
+  {
+    size += m_vectorCoreSubmesh[submeshId]->getMemorySize();
+  }
+
+  return size;
+}
+
  /*****************************************************************************/
 /** Returns the number of core submeshes.
   *
@@ -251,7 +297,12 @@ int CalCoreModel::addCoreSubmesh(void)
   int submeshId = m_vectorCoreSubmesh.size();
 
   // create the core submesh
-  CalCoreSubmesh *pCoreSubmesh = new CalCoreSubmesh;
+  CalCoreSubmesh *pCoreSubmesh = CalArena::construct<CalCoreSubmesh>(&m_arena);
+  if(pCoreSubmesh == 0)
+  {
+    CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
+    return -1;
+  }
   pCoreSubmesh->create();
   
   // push the core submesh onto the core submesh list.
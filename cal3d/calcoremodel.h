@@ -16,6 +16,7 @@
 //****************************************************************************//
 
 #include "calglobal.h"
+#include "calarena.h"
 
 class CalCoreSubmesh;
 class CalCoreBone;
@@ -34,6 +35,7 @@ protected:
   std::string                   m_strName;
   std::vector<CalCoreBone *>    m_vectorCoreBone;
   std::vector<CalCoreSubmesh *> m_vectorCoreSubmesh;
+  CalArena                      m_arena;
   
 // constructors/destructor
 public:
@@ -59,6 +61,8 @@ public:
   int getCoreSubmeshCount();
   CalCoreSubmesh *getCoreSubmesh(int id);
   int addCoreSubmesh(void);
+
+  size_t getMemorySize();
 };
 
 #endif
@@ -20,6 +20,57 @@
 //****************************************************************************//
 
 #include "calcoresub.h"
+#include "calerror.h"
+
+#include <algorithm>
+
+ /*****************************************************************************/
+/** Orders influence sets by their bones and weights.
+  *
+  * Two influence sets compare equal if they have the same influences in the
+  * same order, no matter which vertex they were taken from.
+  *****************************************************************************/
+
+struct CalCoreSubmesh::InfluenceSetLess
+{
+  const Influence *arrayInfluence;
+
+  bool operator()(const InfluenceSet& a, const InfluenceSet& b) const
+  {
+    if(a.influenceCount != b.influenceCount) return a.influenceCount < b.influenceCount;
+
+    for(int influenceId = 0; influenceId < a.influenceCount; influenceId++)
+    {
+      const Influence &influenceA = arrayInfluence[a.firstInfluence + influenceId];
+      const Influence &influenceB = arrayInfluence[b.firstInfluence + influenceId];
+      if(influenceA.boneId != influenceB.boneId) return influenceA.boneId < influenceB.boneId;
+      if(influenceA.weight != influenceB.weight) return influenceA.weight < influenceB.weight;
+    }
+
+    return false;
+  }
+};
+
+ /*****************************************************************************/
+/** Identifies the vertices of a seam.
+  *
+  * Vertices that the exporter split at a UV or normal seam keep the same
+  * position and influences, so they skin to the same position.
+  *****************************************************************************/
+
+struct CalCoreSubmesh::SeamKey
+{
+  float x, y, z;
+  int influenceSetId;
+
+  bool operator<(const SeamKey& key) const
+  {
+    if(influenceSetId != key.influenceSetId) return influenceSetId < key.influenceSetId;
+    if(x != key.x) return x < key.x;
+    if(y != key.y) return y < key.y;
+    return z < key.z;
+  }
+};
 
  /*****************************************************************************/
 /** Constructs the core submesh instance.
@@ -31,6 +82,7 @@ CalCoreSubmesh::CalCoreSubmesh()
 {
   m_coreMaterialThreadId = 0;
   m_lodCount = 0;
+  m_maxInfluenceCount = 0;
 }
 
  /*****************************************************************************/
@@ -46,6 +98,8 @@ CalCoreSubmesh::~CalCoreSubmesh()
   assert(m_vectorPhysicalProperty.empty());
   assert(m_vectorvectorTextureCoordinate.empty());
   assert(m_vectorSpring.empty());
+  assert(m_vectorInfluenceSet.empty());
+  assert(m_vectorSeamVertex.empty());
 }
 
  /*****************************************************************************/
@@ -74,10 +128,23 @@ void CalCoreSubmesh::destroy()
 {
   // destroy all data
   m_vectorFace.clear();
+  m_vectorLodControl.clear();
+  m_vectorLodStep.clear();
+  m_vectorLodFace.clear();
   m_vectorVertex.clear();
+  m_vectorInfluence.clear();
+  m_vectorInfluenceSet.clear();
+  m_vectorVertexInfluenceSet.clear();
+  m_vectorSeamVertex.clear();
   m_vectorPhysicalProperty.clear();
   m_vectorvectorTextureCoordinate.clear();
+  m_vectorvectorTangentSpace.clear();
+  m_vectorTangentsEnabled.clear();
   m_vectorSpring.clear();
+  m_vectorSpringBatch.clear();
+  m_vectorSpringFactor.clear();
+  m_lodCount = 0;
+  m_maxInfluenceCount = 0;
 }
 
  /*****************************************************************************/
@@ -107,6 +174,48 @@ size_t CalCoreSubmesh::getFaceCount()
   return m_vectorFace.size();
 }
 
+ /*****************************************************************************/
+/** Returns the memory size.
+  *
+  * This function returns the number of bytes the core submesh instance holds,
+  * including the reserved capacity of its arrays.
+  *
+  * @return The memory size in bytes.
+  *****************************************************************************/
+
+size_t CalCoreSubmesh::getMemorySize()
+{
+  size_t size = sizeof(CalCoreSubmesh);
+  size += m_vectorVertex.capacity() * sizeof(Vertex);
+  size += m_vectorTangentsEnabled.capacity() / 8;
+  size += m_vectorvectorTangentSpace.capacity() * sizeof(std::vector<TangentSpace>);
+  size += m_vectorvectorTextureCoordinate.capacity() * sizeof(std::vector<TextureCoordinate>);
+  size += m_vectorPhysicalProperty.capacity() * sizeof(PhysicalProperty);
+  size += m_vectorFace.capacity() * sizeof(Face);
+  size += m_vectorSpring.capacity() * sizeof(Spring);
+  size += m_vectorInfluence.capacity() * sizeof(Influence);
+  size += m_vectorLodControl.capacity() * sizeof(LodControl);
+  size += m_vectorLodStep.capacity() * sizeof(LodStep);
+  size += m_vectorLodFace.capacity() * sizeof(Face);
+  size += m_vectorInfluenceSet.capacity() * sizeof(InfluenceSet);
+  size += m_vectorVertexInfluenceSet.capacity() * sizeof(int);
+  size += m_vectorSeamVertex.capacity() * sizeof(int);
+  size += m_vectorSpringBatch.capacity() * sizeof(SpringBatch);
+  size += m_vectorSpringFactor.capacity() * sizeof(float);
+
+  size_t mapId;
+  for(mapId = 0; mapId < m_vectorvectorTangentSpace.size(); mapId++)
+  {
+    size += m_vectorvectorTangentSpace[mapId].capacity() * sizeof(TangentSpace);
+  }
+  for(mapId = 0; mapId < m_vectorvectorTextureCoordinate.size(); mapId++)
+  {
+    size += m_vectorvectorTextureCoordinate[mapId].capacity() * sizeof(TextureCoordinate);
+  }
+
+  return size;
+}
+
  /*****************************************************************************/
 /** Returns the number of LOD steps.
   *
@@ -120,6 +229,21 @@ size_t CalCoreSubmesh::getLodCount()
   return m_lodCount;
 }
 
+ /*****************************************************************************/
+/** Returns the maximum influence count.
+  *
+  * This function returns the largest number of influences of any vertex in
+  * the core submesh instance. It is kept up to date by setInfluenceCount and
+  * analyzeInfluences.
+  *
+  * @return The maximum influence count.
+  *****************************************************************************/
+
+int CalCoreSubmesh::getMaxInfluenceCount()
+{
+  return m_maxInfluenceCount;
+}
+
  /*****************************************************************************/
 /** Returns the number of springs.
   *
@@ -214,6 +338,35 @@ std::vector<CalCoreSubmesh::Spring>& CalCoreSubmesh::getVectorSpring()
   return m_vectorSpring;
 }
 
+ /*****************************************************************************/
+/** Returns the spring batch vector.
+  *
+  * This function returns the vector that contains the spring batches built by
+  * buildSpringBatches(). It is empty if the batches are out of date.
+  *
+  * @return A reference to the spring batch vector.
+  *****************************************************************************/
+
+std::vector<CalCoreSubmesh::SpringBatch>& CalCoreSubmesh::getVectorSpringBatch()
+{
+  return m_vectorSpringBatch;
+}
+
+ /*****************************************************************************/
+/** Returns the spring factor vector.
+  *
+  * This function returns the share of the length correction each end of a
+  * spring takes, two values per spring. It depends on which ends are pinned
+  * (have no weight) and is built together with the spring batches.
+  *
+  * @return A reference to the spring factor vector.
+  *****************************************************************************/
+
+std::vector<float>& CalCoreSubmesh::getVectorSpringFactor()
+{
+  return m_vectorSpringFactor;
+}
+
  /*****************************************************************************/
 /** Returns the texture coordinate vector for a specific channel.
   *
@@ -290,6 +443,105 @@ std::vector<CalCoreSubmesh::Influence>& CalCoreSubmesh::getVectorInfluence()
   return m_vectorInfluence;
 }
 
+ /*****************************************************************************/
+/** Returns the influence set vector.
+  *
+  * This function returns the vector that contains the unique influence sets
+  * of the core submesh instance. Each set refers to the influences of the
+  * first vertex that uses it. The vector is built by analyzeInfluences.
+  *
+  * @return A reference to the influence set vector.
+  *****************************************************************************/
+
+std::vector<CalCoreSubmesh::InfluenceSet>& CalCoreSubmesh::getVectorInfluenceSet()
+{
+  return m_vectorInfluenceSet;
+}
+
+ /*****************************************************************************/
+/** Returns the vertex influence set vector.
+  *
+  * This function returns the vector that contains the influence set ID of
+  * every vertex. The vector is built by analyzeInfluences and is empty if
+  * there is no influence set table.
+  *
+  * @return A reference to the vertex influence set vector.
+  *****************************************************************************/
+
+std::vector<int>& CalCoreSubmesh::getVectorVertexInfluenceSet()
+{
+  return m_vectorVertexInfluenceSet;
+}
+
+ /*****************************************************************************/
+/** Returns the number of influence sets.
+  *
+  * This function returns the number of unique influence sets, which is the
+  * number of transforms that are blended per frame when skinning the core
+  * submesh.
+  *
+  * @return The number of influence sets.
+  *****************************************************************************/
+
+size_t CalCoreSubmesh::getInfluenceSetCount()
+{
+  return m_vectorInfluenceSet.size();
+}
+
+ /*****************************************************************************/
+/** Returns the influence set deduplication ratio.
+  *
+  * This function returns the average number of vertices that share one
+  * influence set, that is, how many per-vertex blends a single per-set blend
+  * replaces.
+  *
+  * @return The deduplication ratio, or 1.0 if there is no influence set table.
+  *****************************************************************************/
+
+float CalCoreSubmesh::getInfluenceSetRatio()
+{
+  if(m_vectorInfluenceSet.empty()) return 1.0f;
+
+  return (float)m_vectorVertexInfluenceSet.size() / (float)m_vectorInfluenceSet.size();
+}
+
+ /*****************************************************************************/
+/** Returns the seam vertex vector.
+  *
+  * This function returns the vector that holds, for every vertex, the ID of
+  * the first vertex with the same position and influence set. A vertex that
+  * refers to an earlier vertex can take its skinned position from there. The
+  * vector is built by analyzeInfluences and is empty if there is no influence
+  * set table.
+  *
+  * @return A reference to the seam vertex vector.
+  *****************************************************************************/
+
+std::vector<int>& CalCoreSubmesh::getVectorSeamVertex()
+{
+  return m_vectorSeamVertex;
+}
+
+ /*****************************************************************************/
+/** Returns the number of seam vertices.
+  *
+  * This function returns the number of vertices whose skinned position is
+  * copied from an earlier vertex instead of being calculated.
+  *
+  * @return The number of seam vertices.
+  *****************************************************************************/
+
+size_t CalCoreSubmesh::getSeamVertexCount()
+{
+  size_t seamVertexCount = 0;
+  for(int vertexId = 0; vertexId < (int)m_vectorSeamVertex.size(); vertexId++)
+  {
+    if(m_vectorSeamVertex[vertexId] != vertexId) seamVertexCount++;
+  }
+
+  return seamVertexCount;
+}
+
  /*****************************************************************************/
 /** Returns the vertex vector.
   *
@@ -410,9 +662,12 @@ bool CalCoreSubmesh::reserve(int vertexCount, int textureCoordinateCount, int fa
   
   m_vectorFace.reserve(faceCount);
   m_vectorFace.resize(faceCount);
+  m_vectorLodStep.clear();
 
   m_vectorSpring.reserve(springCount);
   m_vectorSpring.resize(springCount);
+  m_vectorSpringBatch.clear();
+  m_vectorSpringFactor.clear();
 
   // reserve the space for the physical properties if we have springs in the core submesh instance
   if(springCount > 0)
@@ -528,9 +783,12 @@ bool CalCoreSubmesh::resize(int vertexCount, int textureCoordinateCount, int fac
   
   m_vectorFace.reserve(faceReserve);
   m_vectorFace.resize(faceCount);
+  m_vectorLodStep.clear();
 
   m_vectorSpring.reserve(springReserve);
   m_vectorSpring.resize(springCount);
+  m_vectorSpringBatch.clear();
+  m_vectorSpringFactor.clear();
 
   // reserve the space for the physical properties if we have springs in the core submesh instance
   if(springCount > 0)
@@ -579,6 +837,7 @@ bool CalCoreSubmesh::setFace(int faceId, const Face& face)
   if((faceId < 0) || (faceId >= (int)m_vectorFace.size())) return false;
 
   m_vectorFace[faceId] = face;
+  m_vectorLodStep.clear();
 
   return true;
 }
@@ -594,6 +853,7 @@ bool CalCoreSubmesh::setFace(int faceId, const Face& face)
 void CalCoreSubmesh::setLodCount(size_t lodCount)
 {
   m_lodCount = lodCount;
+  m_vectorLodStep.clear();
 }
 
  /*****************************************************************************/
@@ -615,6 +875,8 @@ bool CalCoreSubmesh::setPhysicalProperty(int vertexId, const PhysicalProperty& p
   if((vertexId < 0) || (vertexId >= (int)m_vectorPhysicalProperty.size())) return false;
 
   m_vectorPhysicalProperty[vertexId] = physicalProperty;
+  m_vectorSpringBatch.clear();
+  m_vectorSpringFactor.clear();
 
   return true;
 }
@@ -637,6 +899,8 @@ bool CalCoreSubmesh::setSpring(int springId, const Spring& spring)
   if((springId < 0) || (springId >= (int)m_vectorSpring.size())) return false;
 
   m_vectorSpring[springId] = spring;
+  m_vectorSpringBatch.clear();
+  m_vectorSpringFactor.clear();
 
   return true;
 }
@@ -716,6 +980,12 @@ bool CalCoreSubmesh::setInfluenceCount(int vertexId, int influenceCount)
   if((influenceCount < 0) || (influenceCount > 127)) return false;
 
   m_vectorVertex[vertexId].influenceCount = influenceCount;
+  if(influenceCount > m_maxInfluenceCount) m_maxInfluenceCount = influenceCount;
+
+  // the influence set table is out of date until analyzeInfluences runs again
+  m_vectorInfluenceSet.clear();
+  m_vectorVertexInfluenceSet.clear();
+  m_vectorSeamVertex.clear();
   
   return true;
 }
@@ -740,6 +1010,7 @@ bool CalCoreSubmesh::setLodControl(int vertexId, int faceCollapseCount, int coll
 
   m_vectorLodControl[vertexId].faceCollapseCount = faceCollapseCount;
   m_vectorLodControl[vertexId].collapseId = collapseId;
+  m_vectorLodStep.clear();
   
   return true;
 }
@@ -810,3 +1081,539 @@ float *CalCoreSubmesh::getTextureCoordinates(int mapId)
   }
   return &(m_vectorvectorTextureCoordinate[mapId][0].u);
 }
+
+ /*****************************************************************************/
+/** Analyzes the vertex influences.
+  *
+  * This function gathers the influence statistics the skinning kernels are
+  * selected by and builds the influence set table: vertices with exactly the
+  * same bones and weights (in the same order) share one influence set, so
+  * their transform only needs to be blended once per frame. Vertices that also
+  * share their position with an earlier vertex (seams) are marked, so their
+  * position is only skinned once. It must be called
+  * once all vertices and influences are set, before any submesh instance is
+  * created from the core submesh. The loader does this automatically.
+  *****************************************************************************/
+
+void CalCoreSubmesh::analyzeInfluences(void)
+{
+  m_maxInfluenceCount = 0;
+  m_vectorInfluenceSet.clear();
+  m_vectorVertexInfluenceSet.clear();
+  m_vectorSeamVertex.clear();
+
+  // make sure the influence vector covers all vertices
+  size_t totalInfluenceCount = 0;
+  std::vector<Vertex>::iterator iteratorVertex;
+  for(iteratorVertex = m_vectorVertex.begin(); iteratorVertex != m_vectorVertex.end(); ++iteratorVertex)
+  {
+    totalInfluenceCount += iteratorVertex->influenceCount;
+    if(iteratorVertex->influenceCount > m_maxInfluenceCount) m_maxInfluenceCount = iteratorVertex->influenceCount;
+  }
+  if(totalInfluenceCount > m_vectorInfluence.size()) return;
+
+  // assign every vertex to the first set with the same influences
+  InfluenceSetLess influenceSetLess;
+  influenceSetLess.arrayInfluence = m_vectorInfluence.empty() ? 0 : &m_vectorInfluence[0];
+  std::map<InfluenceSet, int, InfluenceSetLess> mapInfluenceSet(influenceSetLess);
+
+  m_vectorVertexInfluenceSet.reserve(m_vectorVertex.size());
+  int nextInfluence = 0;
+  for(iteratorVertex = m_vectorVertex.begin(); iteratorVertex != m_vectorVertex.end(); ++iteratorVertex)
+  {
+    InfluenceSet influenceSet;
+    influenceSet.firstInfluence = nextInfluence;
+    influenceSet.influenceCount = iteratorVertex->influenceCount;
+    nextInfluence += iteratorVertex->influenceCount;
+
+    std::map<InfluenceSet, int, InfluenceSetLess>::iterator iteratorInfluenceSet = mapInfluenceSet.find(influenceSet);
+    if(iteratorInfluenceSet == mapInfluenceSet.end())
+    {
+      iteratorInfluenceSet = mapInfluenceSet.insert(std::make_pair(influenceSet, (int)m_vectorInfluenceSet.size())).first;
+      m_vectorInfluenceSet.push_back(influenceSet);
+    }
+
+    m_vectorVertexInfluenceSet.push_back(iteratorInfluenceSet->second);
+  }
+
+  // group the vertices that skin to the same position; vertices driven by
+  // the spring system are left alone, since they are not skinned at all
+  std::map<SeamKey, int> mapSeam;
+  bool bSprings = !m_vectorSpring.empty() && (m_vectorPhysicalProperty.size() == m_vectorVertex.size());
+
+  m_vectorSeamVertex.reserve(m_vectorVertex.size());
+  for(int vertexId = 0; vertexId < (int)m_vectorVertex.size(); vertexId++)
+  {
+    if(bSprings && (m_vectorPhysicalProperty[vertexId].weight > 0.0f))
+    {
+      m_vectorSeamVertex.push_back(vertexId);
+      continue;
+    }
+
+    SeamKey seamKey;
+    seamKey.x = m_vectorVertex[vertexId].position.x;
+    seamKey.y = m_vectorVertex[vertexId].position.y;
+    seamKey.z = m_vectorVertex[vertexId].position.z;
+    seamKey.influenceSetId = m_vectorVertexInfluenceSet[vertexId];
+
+    m_vectorSeamVertex.push_back(mapSeam.insert(std::make_pair(seamKey, vertexId)).first->second);
+  }
+}
+
+ /*****************************************************************************/
+/** Returns the LOD step vector.
+  *
+  * This function returns the vector that contains the precomputed LOD steps
+  * of the core submesh instance. Step 0 is the full detail mesh, the last
+  * step is the coarsest one.
+  *
+  * @return A reference to the LOD step vector.
+  *****************************************************************************/
+
+std::vector<CalCoreSubmesh::LodStep>& CalCoreSubmesh::getVectorLodStep()
+{
+  return m_vectorLodStep;
+}
+
+ /*****************************************************************************/
+/** Precomputes the LOD steps.
+  *
+  * This function collapses the faces of the core submesh for a number of
+  * evenly spaced LOD levels, following the LOD control information. All
+  * submesh instances share the result, so changing the LOD level of an
+  * instance is just a table lookup. The full detail step uses the face vector
+  * directly and costs no extra memory. Changing the faces or the LOD control
+  * information drops the steps; until they are rebuilt, submesh instances
+  * show all faces at every LOD level. The loader builds them automatically.
+  * Submesh instances only read the steps, so they must not be rebuilt while
+  * instances are created or updated on other threads.
+  *
+  * @param lodStepCount The number of LOD steps, including full detail. It is
+  *                     clamped to the number of LOD levels the core submesh
+  *                     actually has.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalCoreSubmesh::buildLodSteps(int lodStepCount)
+{
+  m_vectorLodStep.clear();
+  m_vectorLodFace.clear();
+
+  // there can't be more steps than LOD levels
+  if(m_lodCount > m_vectorVertex.size()) m_lodCount = m_vectorVertex.size();
+  if(lodStepCount > (int)m_lodCount + 1) lodStepCount = m_lodCount + 1;
+  if(lodStepCount < 1) lodStepCount = 1;
+
+  m_vectorLodStep.reserve(lodStepCount);
+
+  // count the faces of all reduced steps first, so the face vector is only allocated once
+  int lodStepId;
+  size_t lodFaceCount = 0;
+  for(lodStepId = 1; lodStepId < lodStepCount; lodStepId++)
+  {
+    size_t vertexCount = m_vectorVertex.size() - (lodStepId * m_lodCount) / (lodStepCount - 1);
+    size_t faceCount = m_vectorFace.size();
+    for(int vertexId = m_vectorLodControl.size() - 1; vertexId >= (int)vertexCount; vertexId--)
+    {
+      faceCount -= m_vectorLodControl[vertexId].faceCollapseCount;
+    }
+    if(faceCount > m_vectorFace.size())
+    {
+      CalError::setLastError(CalError::INVALID_ATTRIBUTE_VALUE, __FILE__, __LINE__, "CalCoreSubmesh::buildLodSteps");
+      return false;
+    }
+    lodFaceCount += faceCount;
+  }
+  m_vectorLodFace.reserve(lodFaceCount);
+
+  for(lodStepId = 0; lodStepId < lodStepCount; lodStepId++)
+  {
+    LodStep lodStep;
+
+    // calculate the number of vertices and faces of the step
+    size_t collapseCount = (lodStepId == 0) ? 0 : (lodStepId * m_lodCount) / (lodStepCount - 1);
+    lodStep.vertexCount = m_vectorVertex.size() - collapseCount;
+    lodStep.faceCount = m_vectorFace.size();
+    for(int vertexId = m_vectorLodControl.size() - 1; vertexId >= (int)lodStep.vertexCount; vertexId--)
+    {
+      lodStep.faceCount -= m_vectorLodControl[vertexId].faceCollapseCount;
+    }
+    lodStep.firstFace = m_vectorLodFace.size();
+
+    // the full detail step uses the face vector as is
+    if(lodStepId > 0)
+    {
+      for(size_t faceId = 0; faceId < lodStep.faceCount; faceId++)
+      {
+        Face face;
+        for(int vertexId = 0; vertexId < 3; vertexId++)
+        {
+          // collapse the vertex id until it fits into the lod step
+          int collapsedVertexId = m_vectorFace[faceId].vertexId[vertexId];
+          while(collapsedVertexId >= (int)lodStep.vertexCount)
+          {
+            collapsedVertexId = m_vectorLodControl[collapsedVertexId].collapseId;
+            if(collapsedVertexId < 0)
+            {
+              CalError::setLastError(CalError::INVALID_ATTRIBUTE_VALUE, __FILE__, __LINE__, "CalCoreSubmesh::buildLodSteps");
+              m_vectorLodStep.clear();
+              m_vectorLodFace.clear();
+              return false;
+            }
+          }
+          face.vertexId[vertexId] = collapsedVertexId;
+        }
+        m_vectorLodFace.push_back(face);
+      }
+    }
+
+    m_vectorLodStep.push_back(lodStep);
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Finds the LOD step of a LOD level.
+  *
+  * This function returns the precomputed LOD step that is used for a given
+  * LOD level. Levels between two steps use the more detailed one (with a
+  * little tolerance, so the level of a step maps back onto it).
+  *
+  * @param lodLevel The LOD level in the range [0.0, 1.0].
+  *
+  * @return One of the following values:
+  *         \li the ID of the LOD step
+  *         \li \b -1 if the LOD steps have not been built
+  *****************************************************************************/
+
+int CalCoreSubmesh::findLodStep(float lodLevel)
+{
+  if(m_vectorLodStep.empty()) return -1;
+
+  // clamp the lod level to [0.0, 1.0]
+  if(lodLevel < 0.0f) lodLevel = 0.0f;
+  if(lodLevel > 1.0f) lodLevel = 1.0f;
+
+  int lodStepCount = m_vectorLodStep.size();
+  int lodStepId = (int)((1.0f - lodLevel) * (lodStepCount - 1) + 0.0001f);
+  if(lodStepId >= lodStepCount) lodStepId = lodStepCount - 1;
+
+  return lodStepId;
+}
+
+ /*****************************************************************************/
+/** Provides access to the faces of a LOD step.
+  *
+  * @param lodStepId The ID of the LOD step, or -1 for all faces when the LOD
+  *                  steps have not been built.
+  *
+  * @return One of the following values:
+  *         \li a pointer to the collapsed faces of the step
+  *         \li \b 0 if the step has no faces or does not exist
+  *****************************************************************************/
+
+CalCoreSubmesh::Face *CalCoreSubmesh::getLodStepFaces(int lodStepId)
+{
+  if(lodStepId == -1) return m_vectorFace.empty() ? 0 : &m_vectorFace[0];
+  if((lodStepId < 0) || (lodStepId >= (int)m_vectorLodStep.size())) return 0;
+  if(m_vectorLodStep[lodStepId].faceCount == 0) return 0;
+
+  if(lodStepId == 0) return &m_vectorFace[0];
+
+  return &m_vectorLodFace[m_vectorLodStep[lodStepId].firstFace];
+}
+
+ /*****************************************************************************/
+/** Reorders the vertices.
+  *
+  * This function moves all per-vertex data (vertex, texture coordinates,
+  * tangent spaces, influences, physical properties and LOD control) into a
+  * new order and remaps the faces, springs and collapse IDs accordingly. The
+  * influence analysis is redone; the LOD steps must be rebuilt.
+  *
+  * @param vectorVertexOrder The old ID of every vertex, in the new order. It
+  *                          must be a permutation of all vertex IDs.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalCoreSubmesh::reorderVertices(const std::vector<int>& vectorVertexOrder)
+{
+  int vertexCount = m_vectorVertex.size();
+  if((int)vectorVertexOrder.size() != vertexCount)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalCoreSubmesh::reorderVertices");
+    return false;
+  }
+
+  // invert the order, making sure it is a permutation
+  std::vector<int> vectorNewVertexId(vertexCount, -1);
+  int vertexId;
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    int oldVertexId = vectorVertexOrder[vertexId];
+    if((oldVertexId < 0) || (oldVertexId >= vertexCount) || (vectorNewVertexId[oldVertexId] != -1))
+    {
+      CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalCoreSubmesh::reorderVertices");
+      return false;
+    }
+    vectorNewVertexId[oldVertexId] = vertexId;
+  }
+
+  // find the influences of every old vertex
+  std::vector<int> vectorFirstInfluence(vertexCount);
+  int nextInfluence = 0;
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    vectorFirstInfluence[vertexId] = nextInfluence;
+    nextInfluence += m_vectorVertex[vertexId].influenceCount;
+  }
+  if(nextInfluence > (int)m_vectorInfluence.size())
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalCoreSubmesh::reorderVertices");
+    return false;
+  }
+
+  // move the per-vertex data
+  std::vector<Vertex> vectorVertex(vertexCount);
+  std::vector<LodControl> vectorLodControl(m_vectorLodControl.size());
+  std::vector<PhysicalProperty> vectorPhysicalProperty(m_vectorPhysicalProperty.size());
+  std::vector<Influence> vectorInfluence;
+  vectorInfluence.reserve(m_vectorInfluence.size());
+
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    int oldVertexId = vectorVertexOrder[vertexId];
+    vectorVertex[vertexId] = m_vectorVertex[oldVertexId];
+
+    if(!vectorLodControl.empty())
+    {
+      vectorLodControl[vertexId] = m_vectorLodControl[oldVertexId];
+      int collapseId = vectorLodControl[vertexId].collapseId;
+      if((collapseId >= 0) && (collapseId < vertexCount)) vectorLodControl[vertexId].collapseId = vectorNewVertexId[collapseId];
+    }
+
+    if(!vectorPhysicalProperty.empty()) vectorPhysicalProperty[vertexId] = m_vectorPhysicalProperty[oldVertexId];
+
+    for(int influenceId = 0; influenceId < m_vectorVertex[oldVertexId].influenceCount; influenceId++)
+    {
+      vectorInfluence.push_back(m_vectorInfluence[vectorFirstInfluence[oldVertexId] + influenceId]);
+    }
+  }
+
+  m_vectorVertex.swap(vectorVertex);
+  m_vectorLodControl.swap(vectorLodControl);
+  m_vectorPhysicalProperty.swap(vectorPhysicalProperty);
+  m_vectorInfluence.swap(vectorInfluence);
+
+  // move the texture coordinates and tangent spaces
+  int textureCoordinateId;
+  for(textureCoordinateId = 0; textureCoordinateId < (int)m_vectorvectorTextureCoordinate.size(); textureCoordinateId++)
+  {
+    std::vector<TextureCoordinate>& vectorTextureCoordinate = m_vectorvectorTextureCoordinate[textureCoordinateId];
+    if((int)vectorTextureCoordinate.size() == vertexCount)
+    {
+      std::vector<TextureCoordinate> vectorReordered(vertexCount);
+      for(vertexId = 0; vertexId < vertexCount; vertexId++) vectorReordered[vertexId] = vectorTextureCoordinate[vectorVertexOrder[vertexId]];
+      vectorTextureCoordinate.swap(vectorReordered);
+    }
+
+    std::vector<TangentSpace>& vectorTangentSpace = m_vectorvectorTangentSpace[textureCoordinateId];
+    if((int)vectorTangentSpace.size() == vertexCount)
+    {
+      std::vector<TangentSpace> vectorReordered(vertexCount);
+      for(vertexId = 0; vertexId < vertexCount; vertexId++) vectorReordered[vertexId] = vectorTangentSpace[vectorVertexOrder[vertexId]];
+      vectorTangentSpace.swap(vectorReordered);
+    }
+  }
+
+  // remap the faces and springs
+  std::vector<Face>::iterator iteratorFace;
+  for(iteratorFace = m_vectorFace.begin(); iteratorFace != m_vectorFace.end(); ++iteratorFace)
+  {
+    for(int faceVertexId = 0; faceVertexId < 3; faceVertexId++)
+    {
+      iteratorFace->vertexId[faceVertexId] = vectorNewVertexId[iteratorFace->vertexId[faceVertexId]];
+    }
+  }
+
+  std::vector<Spring>::iterator iteratorSpring;
+  for(iteratorSpring = m_vectorSpring.begin(); iteratorSpring != m_vectorSpring.end(); ++iteratorSpring)
+  {
+    iteratorSpring->vertexId[0] = vectorNewVertexId[iteratorSpring->vertexId[0]];
+    iteratorSpring->vertexId[1] = vectorNewVertexId[iteratorSpring->vertexId[1]];
+  }
+
+  // the derived tables refer to the old order
+  m_vectorLodStep.clear();
+  m_vectorLodFace.clear();
+  m_vectorSpringBatch.clear();
+  m_vectorSpringFactor.clear();
+  analyzeInfluences();
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Reorders the faces.
+  *
+  * This function moves the faces into a new order. The LOD steps must be
+  * rebuilt afterwards. Note that progressive LOD expects the faces removed
+  * by the vertex collapses at the end, in reverse collapse order.
+  *
+  * @param vectorFaceOrder The old ID of every face, in the new order. It must
+  *                        be a permutation of all face IDs.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalCoreSubmesh::reorderFaces(const std::vector<int>& vectorFaceOrder)
+{
+  int faceCount = m_vectorFace.size();
+  if((int)vectorFaceOrder.size() != faceCount)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalCoreSubmesh::reorderFaces");
+    return false;
+  }
+
+  std::vector<bool> vectorUsed(faceCount, false);
+  std::vector<Face> vectorFace(faceCount);
+  for(int faceId = 0; faceId < faceCount; faceId++)
+  {
+    int oldFaceId = vectorFaceOrder[faceId];
+    if((oldFaceId < 0) || (oldFaceId >= faceCount) || vectorUsed[oldFaceId])
+    {
+      CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalCoreSubmesh::reorderFaces");
+      return false;
+    }
+    vectorUsed[oldFaceId] = true;
+    vectorFace[faceId] = m_vectorFace[oldFaceId];
+  }
+
+  m_vectorFace.swap(vectorFace);
+  m_vectorLodStep.clear();
+  m_vectorLodFace.clear();
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Builds the spring batches.
+  *
+  * This function colors the spring graph so that no two springs of the same
+  * color share a vertex, and reorders the springs by color and then by vertex
+  * for locality. Each color becomes a batch whose springs can be relaxed in
+  * any order, with SIMD or on several threads. The per-end correction
+  * factors are precomputed from the physical properties as well. Changing
+  * the springs or the physical properties drops the batches; until they are
+  * rebuilt, submesh instances relax the springs one by one. The loader
+  * builds them automatically. Submesh instances only read the batches, so
+  * they must not be rebuilt while instances are created or updated on other
+  * threads.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalCoreSubmesh::buildSpringBatches(void)
+{
+  m_vectorSpringBatch.clear();
+  m_vectorSpringFactor.clear();
+
+  int vertexCount = m_vectorVertex.size();
+  int springCount = m_vectorSpring.size();
+  if(springCount == 0) return true;
+
+  if((int)m_vectorPhysicalProperty.size() != vertexCount)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalCoreSubmesh::buildSpringBatches");
+    return false;
+  }
+
+  // visit the springs by their first vertex, so neighbouring springs get neighbouring slots
+  std::vector<std::pair<int, int> > vectorOrder(springCount);
+  int springId;
+  for(springId = 0; springId < springCount; springId++)
+  {
+    const Spring& spring = m_vectorSpring[springId];
+    if((spring.vertexId[0] < 0) || (spring.vertexId[0] >= vertexCount) || (spring.vertexId[1] < 0) || (spring.vertexId[1] >= vertexCount))
+    {
+      CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalCoreSubmesh::buildSpringBatches");
+      return false;
+    }
+    int firstVertexId = (spring.vertexId[0] < spring.vertexId[1]) ? spring.vertexId[0] : spring.vertexId[1];
+    vectorOrder[springId] = std::make_pair(firstVertexId, springId);
+  }
+  std::sort(vectorOrder.begin(), vectorOrder.end());
+
+  // greedy coloring: the lowest color that neither vertex uses yet
+  std::vector<std::vector<int> > vectorvectorVertexColor(vertexCount);
+  std::vector<int> vectorSpringColor(springCount);
+  int colorCount = 0;
+  int orderId;
+  for(orderId = 0; orderId < springCount; orderId++)
+  {
+    springId = vectorOrder[orderId].second;
+    std::vector<int>& vectorColor0 = vectorvectorVertexColor[m_vectorSpring[springId].vertexId[0]];
+    std::vector<int>& vectorColor1 = vectorvectorVertexColor[m_vectorSpring[springId].vertexId[1]];
+
+    int color = 0;
+    while((std::find(vectorColor0.begin(), vectorColor0.end(), color) != vectorColor0.end())
+       || (std::find(vectorColor1.begin(), vectorColor1.end(), color) != vectorColor1.end()))
+    {
+      color++;
+    }
+
+    vectorColor0.push_back(color);
+    vectorColor1.push_back(color);
+    vectorSpringColor[springId] = color;
+    if(color >= colorCount) colorCount = color + 1;
+  }
+
+  // reorder the springs by color, keeping the vertex order inside a color
+  std::vector<Spring> vectorSpring;
+  vectorSpring.reserve(springCount);
+  m_vectorSpringBatch.resize(colorCount);
+
+  for(int color = 0; color < colorCount; color++)
+  {
+    m_vectorSpringBatch[color].firstSpring = vectorSpring.size();
+    for(orderId = 0; orderId < springCount; orderId++)
+    {
+      if(vectorSpringColor[vectorOrder[orderId].second] == color) vectorSpring.push_back(m_vectorSpring[vectorOrder[orderId].second]);
+    }
+    m_vectorSpringBatch[color].springCount = vectorSpring.size() - m_vectorSpringBatch[color].firstSpring;
+  }
+
+  m_vectorSpring.swap(vectorSpring);
+
+  // split the correction between the two ends, a pinned end doesn't move
+  m_vectorSpringFactor.resize(2 * springCount);
+  for(springId = 0; springId < springCount; springId++)
+  {
+    bool bFree0 = m_vectorPhysicalProperty[m_vectorSpring[springId].vertexId[0]].weight > 0.0f;
+    bool bFree1 = m_vectorPhysicalProperty[m_vectorSpring[springId].vertexId[1]].weight > 0.0f;
+
+    float factor0 = bFree0 ? 0.5f : 0.0f;
+    float factor1 = bFree0 ? 0.5f : 1.0f;
+    if(!bFree1)
+    {
+      factor0 *= 2.0f;
+      factor1 = 0.0f;
+    }
+
+    m_vectorSpringFactor[2 * springId] = factor0;
+    m_vectorSpringFactor[2 * springId + 1] = factor1;
+  }
+
+  return true;
+}
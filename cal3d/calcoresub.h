@@ -28,6 +28,8 @@
 
 class CAL3D_API CalCoreSubmesh: public CalCoreSubmeshUserData
 {
+  friend class CalLoader;
+  friend class CalSaver;
   friend class CalSubmesh;
 
 // misc
@@ -78,6 +80,24 @@ public:
     int vertexId[3];
   };
 
+  /// A precomputed LOD step, shared by all submesh instances.
+  struct LodStep
+  {
+    size_t vertexCount;
+    size_t faceCount;
+    size_t firstFace;
+  };
+
+  /// The number of LOD steps the loader precomputes.
+  enum { DEFAULT_LOD_STEP_COUNT = 16 };
+
+  /// A unique combination of influences, shared by all vertices that have it.
+  struct InfluenceSet
+  {
+    int firstInfluence;
+    int influenceCount;
+  };
+
   /// The core submesh Spring.
   struct Spring
   {
@@ -86,6 +106,17 @@ public:
     float idleLength;
   };
 
+  /// A batch of springs that share no vertex and can be relaxed in parallel.
+  struct SpringBatch
+  {
+    int firstSpring;
+    int springCount;
+  };
+
+protected:
+  struct InfluenceSetLess;
+  struct SeamKey;
+
 // member variables
 protected:
   std::vector<Vertex> m_vectorVertex;
@@ -97,8 +128,16 @@ protected:
   std::vector<Spring> m_vectorSpring;
   std::vector<Influence> m_vectorInfluence;
   std::vector<LodControl> m_vectorLodControl;
+  std::vector<LodStep> m_vectorLodStep;
+  std::vector<Face> m_vectorLodFace;
+  std::vector<InfluenceSet> m_vectorInfluenceSet;
+  std::vector<int> m_vectorVertexInfluenceSet;
+  std::vector<int> m_vectorSeamVertex;
+  std::vector<SpringBatch> m_vectorSpringBatch;
+  std::vector<float> m_vectorSpringFactor;
   int m_coreMaterialThreadId;
   size_t m_lodCount;
+  int m_maxInfluenceCount;
 
 // constructors/destructor
 public:
@@ -112,6 +151,8 @@ public:
   int getCoreMaterialThreadId();
   size_t getFaceCount();
   size_t getLodCount();
+  size_t getMemorySize();
+  int getMaxInfluenceCount();
   size_t getSpringCount();
   size_t getVertexCount();
   size_t getTextureCoordinateCount();
@@ -119,13 +160,26 @@ public:
   std::vector<Face>& getVectorFace();
   std::vector<PhysicalProperty>& getVectorPhysicalProperty();
   std::vector<Spring>& getVectorSpring();
+  std::vector<SpringBatch>& getVectorSpringBatch();
+  std::vector<float>& getVectorSpringFactor();
+  bool buildSpringBatches(void);
   std::vector<std::vector<TangentSpace> >& getVectorVectorTangentSpace();
   std::vector<std::vector<TextureCoordinate> >& getVectorVectorTextureCoordinate();
   std::vector<Influence>& getVectorInfluence();
+  std::vector<InfluenceSet>& getVectorInfluenceSet();
+  std::vector<int>& getVectorVertexInfluenceSet();
+  size_t getInfluenceSetCount();
+  float getInfluenceSetRatio();
+  std::vector<int>& getVectorSeamVertex();
+  size_t getSeamVertexCount();
   std::vector<Vertex>& getVectorVertex();
   std::vector<TangentSpace>& getVectorTangentSpace(int textureCoordinateId);
   std::vector<TextureCoordinate>& getVectorTextureCoordinate(int textureCoordinateId);
   std::vector<LodControl>& getVectorLodControl();
+  std::vector<LodStep>& getVectorLodStep();
+  bool buildLodSteps(int lodStepCount);
+  int findLodStep(float lodLevel);
+  Face *getLodStepFaces(int lodStepId);
   bool tangentsEnabled(int mapId);
   bool enableTangents(int mapId, bool enabled);
   bool reserve(int vertexCount, int textureCoordinateCount, int faceCount, int springCount);
@@ -141,6 +195,9 @@ public:
   bool setVertex(int vertexId, const CalVector &position, const CalVector &normal);
   bool setInfluenceCount(int vertexId, int influenceCount);
   CalCoreVertexUserData *getVertexUserData(int vertexId);
+  void analyzeInfluences(void);
+  bool reorderVertices(const std::vector<int>& vectorVertexOrder);
+  bool reorderFaces(const std::vector<int>& vectorFaceOrder);
 };
 
 #endif
@@ -20,6 +20,8 @@
 #include "calcoretrack.h"
 #include "calerror.h"
 #include "calcorekey.h"
+#include "calarena.h"
+#include "calnametable.h"
 
  /*****************************************************************************/
 /** Constructs the core track instance.
@@ -30,6 +32,10 @@
 CalCoreTrack::CalCoreTrack()
 {
   m_coreBoneHint = -1;
+  m_coreBoneNameId = -1;
+  m_deferredOffset = 0;
+  m_deferredKeyframeCount = 0;
+  m_pKeyframeArena = 0;
 }
 
  /*****************************************************************************/
@@ -95,7 +101,7 @@ void CalCoreTrack::destroy()
     pCoreKeyframe = iteratorCoreKeyframe->second;
 
     pCoreKeyframe->destroy();
-    delete pCoreKeyframe;
+    CalArena::release(m_pKeyframeArena, pCoreKeyframe);
   }
 
   m_mapCoreKeyframe.clear();
@@ -103,6 +109,43 @@ void CalCoreTrack::destroy()
   m_coreBoneHint = -1;
 }
 
+ /*****************************************************************************/
+/** Returns the number of deferred keyframes.
+  *
+  * This function returns the number of keyframes of a lazily loaded track
+  * that are stored in the animation file, see setDeferredKeyframes().
+  *
+  * @return The number of deferred keyframes, 0 if the track isn't deferred.
+  *****************************************************************************/
+
+int CalCoreTrack::getDeferredKeyframeCount()
+{
+  return m_deferredKeyframeCount;
+}
+
+ /*****************************************************************************/
+/** Returns the arena of the core keyframes.
+  *
+  * @return The arena the core keyframes were placed in, 0 if they are on the
+  *         heap.
+  *****************************************************************************/
+
+CalArena *CalCoreTrack::getKeyframeArena()
+{
+  return m_pKeyframeArena;
+}
+
+ /*****************************************************************************/
+/** Returns the file offset of the deferred keyframes.
+  *
+  * @return The offset of the first keyframe in the animation file.
+  *****************************************************************************/
+
+unsigned int CalCoreTrack::getDeferredOffset()
+{
+  return m_deferredOffset;
+}
+
  /*****************************************************************************/
 /** Returns the core keyframe map.
   *
@@ -138,28 +181,53 @@ std::map<float, CalCoreKeyframe *>& CalCoreTrack::getMapCoreKeyframe()
 
 bool CalCoreTrack::getState(float time, float duration, CalVector& orientation, CalQuaternion& rotation)
 {
-  std::map<float, CalCoreKeyframe *>::iterator iteratorCoreKeyframeBefore;
-  std::map<float, CalCoreKeyframe *>::iterator iteratorCoreKeyframeAfter;
+  return getState(m_mapCoreKeyframe, time, duration, orientation, rotation);
+}
+
+ /*****************************************************************************/
+/** Returns a specified state from a set of keyframes.
+  *
+  * This function returns the state for the specified time and duration like
+  * getState(), but samples the given keyframes instead of those of the core
+  * track, such as a chunk of a streamed core animation.
+  *
+  * @param mapCoreKeyframe The keyframes to sample.
+  * @param time The time in seconds at which the state should be returned.
+  * @param duration The duration of the animation in seconds.
+  * @param translation A reference to the translation reference that will be
+  *                    filled with the specified state.
+  * @param rotation A reference to the rotation reference that will be filled
+  *                 with the specified state.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalCoreTrack::getState(const std::map<float, CalCoreKeyframe *>& mapCoreKeyframe, float time, float duration, CalVector& orientation, CalQuaternion& rotation)
+{
+  std::map<float, CalCoreKeyframe *>::const_iterator iteratorCoreKeyframeBefore;
+  std::map<float, CalCoreKeyframe *>::const_iterator iteratorCoreKeyframeAfter;
 
   // get the one core keyframe before and the one after the requested time
   bool bWrap;
-  iteratorCoreKeyframeAfter = m_mapCoreKeyframe.upper_bound(time);
+  iteratorCoreKeyframeAfter = mapCoreKeyframe.upper_bound(time);
 
   // check if we have a wrap-around
-  if(iteratorCoreKeyframeAfter == m_mapCoreKeyframe.end())
+  if(iteratorCoreKeyframeAfter == mapCoreKeyframe.end())
   {
     iteratorCoreKeyframeBefore = iteratorCoreKeyframeAfter;
     --iteratorCoreKeyframeBefore;
 
-    iteratorCoreKeyframeAfter = m_mapCoreKeyframe.begin();
+    iteratorCoreKeyframeAfter = mapCoreKeyframe.begin();
     
     bWrap = true;
   }
   else
   {
-    if(iteratorCoreKeyframeAfter == m_mapCoreKeyframe.begin())
+    if(iteratorCoreKeyframeAfter == mapCoreKeyframe.begin())
     {
-      iteratorCoreKeyframeBefore = m_mapCoreKeyframe.end();
+      iteratorCoreKeyframeBefore = mapCoreKeyframe.end();
     }
     else
     {
@@ -202,13 +270,16 @@ bool CalCoreTrack::getState(float time, float duration, CalVector& orientation,
 /** Returns the bone ID which was stored in the bone hint field.
   *
   * This function returns the bone ID which was stored in the bone hint field.
+  * The hint is shared by all models playing the core track and may be read
+  * and stored on several threads at once; it is only a guess, so a hint
+  * stored by another thread is as good as any.
   *
   * @return The bone hint value.
   *****************************************************************************/
 
 int CalCoreTrack::getCoreBoneHint()
 {
-  return m_coreBoneHint;
+  return m_coreBoneHint.load(std::memory_order_relaxed);
 }
 
  /*****************************************************************************/
@@ -222,7 +293,7 @@ int CalCoreTrack::getCoreBoneHint()
 
 void CalCoreTrack::setCoreBoneHint(int coreBoneId)
 {
-  m_coreBoneHint = coreBoneId;
+  m_coreBoneHint.store(coreBoneId, std::memory_order_relaxed);
 }
 
  /*****************************************************************************/
@@ -232,9 +303,9 @@ void CalCoreTrack::setCoreBoneHint(int coreBoneId)
   *
   *****************************************************************************/
 
-std::string& CalCoreTrack::getCoreBoneName(void)
+const std::string& CalCoreTrack::getCoreBoneName(void)
 {
-  return m_coreBoneName;
+  return CalNameTable::getName(m_coreBoneNameId);
 }
 
  /*****************************************************************************/
@@ -248,7 +319,66 @@ std::string& CalCoreTrack::getCoreBoneName(void)
 
 void CalCoreTrack::setCoreBoneName(const std::string& name)
 {
-  m_coreBoneName = name;
+  m_coreBoneNameId = CalNameTable::intern(name);
+}
+
+ /*****************************************************************************/
+/** Gets the bone name ID of the core track.
+  *
+  * This function gets the ID of the bone name in the name table. The track
+  * animates the bone with the same name ID.
+  *
+  * @return The ID of the bone name.
+  *****************************************************************************/
+
+int CalCoreTrack::getCoreBoneNameId()
+{
+  return m_coreBoneNameId;
+}
+
+ /*****************************************************************************/
+/** Sets the bone name ID of the core track.
+  *
+  * This function sets the bone name of the core track from a name that is
+  * already in the name table, as the loader does.
+  *
+  * @param nameId The ID of the bone name, see CalNameTable.
+  *****************************************************************************/
+
+void CalCoreTrack::setCoreBoneNameId(int nameId)
+{
+  m_coreBoneNameId = nameId;
+}
+
+ /*****************************************************************************/
+/** Sets the arena of the core keyframes.
+  *
+  * This function is called by the loader when it places the core keyframes of
+  * the core track in the arena of the core animation. destroy() then leaves
+  * their memory to the arena. Keyframes added from the heap are still deleted.
+  *
+  * @param pArena The arena the core keyframes are placed in.
+  *****************************************************************************/
+
+void CalCoreTrack::setKeyframeArena(CalArena *pArena)
+{
+  m_pKeyframeArena = pArena;
+}
+
+ /*****************************************************************************/
+/** Sets the deferred keyframes.
+  *
+  * This function records where the keyframes of a lazily loaded track are
+  * stored in the animation file. They are read by CalCoreAnimation::loadTracks().
+  *
+  * @param offset The offset of the first keyframe in the animation file.
+  * @param keyframeCount The number of keyframes.
+  *****************************************************************************/
+
+void CalCoreTrack::setDeferredKeyframes(unsigned int offset, int keyframeCount)
+{
+  m_deferredOffset = offset;
+  m_deferredKeyframeCount = keyframeCount;
 }
 
 //****************************************************************************//
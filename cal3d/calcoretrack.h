@@ -19,10 +19,13 @@
 #include "calvector.h"
 #include "calquat.h"
 
+#include <atomic>
+
 //****************************************************************************//
 // Forward declarations                                                       //
 //****************************************************************************//
 
+class CalArena;
 class CalCoreBone;
 class CalCoreKeyframe;
 
@@ -38,9 +41,12 @@ class CAL3D_API CalCoreTrack: public CalCoreTrackUserData
 {
 // member variables
 protected:
-  int m_coreBoneHint;
-  std::string m_coreBoneName;
+  std::atomic<int> m_coreBoneHint;
+  int m_coreBoneNameId;
   std::map<float, CalCoreKeyframe *> m_mapCoreKeyframe;
+  unsigned int m_deferredOffset;
+  int m_deferredKeyframeCount;
+  CalArena *m_pKeyframeArena;
 
 // constructors/destructor
 public:
@@ -54,10 +60,18 @@ public:
   void destroy();
   int getCoreBoneHint();
   void setCoreBoneHint(int coreBoneId);
-  std::string& getCoreBoneName(void);
+  const std::string& getCoreBoneName(void);
   void setCoreBoneName(const std::string& name);
+  int getCoreBoneNameId();
+  void setCoreBoneNameId(int nameId);
+  int getDeferredKeyframeCount();
+  CalArena *getKeyframeArena();
+  void setKeyframeArena(CalArena *pArena);
+  unsigned int getDeferredOffset();
   std::map<float, CalCoreKeyframe *>& getMapCoreKeyframe();
+  void setDeferredKeyframes(unsigned int offset, int keyframeCount);
   bool getState(float time, float duration, CalVector& orientation, CalQuaternion& rotation);
+  static bool getState(const std::map<float, CalCoreKeyframe *>& mapCoreKeyframe, float time, float duration, CalVector& orientation, CalQuaternion& rotation);
 };
 
 #endif
@@ -0,0 +1,44 @@
+//****************************************************************************//
+// datasink.h                                                                //
+// Copyright (C) 2001-2003 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_DATASINK_H
+#define CAL_DATASINK_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "calglobal.h"
+
+/**
+ * CalDataSink abstract interface class.
+ *
+ * This is an abstract class designed to represent a sink for Cal3d data,
+ * whether it is an ofstream, ostream, or a memory buffer. The saver builds
+ * whole sections of a file in memory and hands them to the sink in large
+ * blocks, so inheriting classes only implement the 'write' function below.
+ */
+
+class CAL3D_API CalDataSink
+{
+public:
+
+   virtual bool ok() const = 0;
+   virtual void setError() const = 0;
+   virtual bool writeBytes(const void* pBuffer, int length) = 0;
+   virtual ~CalDataSink() {};
+
+};
+
+#endif
@@ -42,6 +42,28 @@ public:
    virtual bool readShort(short& value) = 0;
    virtual bool readInteger(int& value) = 0;
    virtual bool readString(std::string& strValue) = 0;
+
+   /// Reads a number of floats or integers in one go. Data sources that can
+   /// copy a whole block override these, the defaults read one at a time.
+   virtual bool readFloats(float* pValue, int count)
+   {
+      for (int i = 0; i < count; i++) if (!readFloat(pValue[i])) return false;
+      return true;
+   }
+   virtual bool readIntegers(int* pValue, int count)
+   {
+      for (int i = 0; i < count; i++) if (!readInteger(pValue[i])) return false;
+      return true;
+   }
+
+   /// Returns the address of the next bytes in place of copying them, or 0
+   /// if the source can't hand out its memory. Consumes nothing when it
+   /// returns 0 for that reason.
+   virtual const char* mapBytes(int /*length*/) { return 0; }
+
+   /// Returns the number of bytes left to read, or -1 if the source can't
+   /// tell. The loader sizes the arena of the core objects with it.
+   virtual int getRemainingSize() const { return -1; }
    virtual ~CalDataSource() {};
    
 };
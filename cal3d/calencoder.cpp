@@ -0,0 +1,629 @@
+#include "stdafx.h"
+//****************************************************************************//
+// encoder.cpp                                                                //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calencoder.h"
+#include "calerror.h"
+#include "calloader.h"
+#include "calplatform.h"
+#include "calcoremodel.h"
+#include "calcoreanim.h"
+#include "caldatasource.h"
+
+#include <fstream>
+
+namespace
+{
+  const int HASH_BITS = 14;
+  const int MIN_MATCH = 4;
+  const int MAX_OFFSET = 0xffff;
+
+  inline unsigned int readWord(const char *pData)
+  {
+    const unsigned char *p = (const unsigned char *)pData;
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+  }
+
+  inline void writeWord(char *pData, unsigned int word)
+  {
+    pData[0] = (char)word;
+    pData[1] = (char)(word >> 8);
+    pData[2] = (char)(word >> 16);
+    pData[3] = (char)(word >> 24);
+  }
+
+  void appendWord(std::vector<char>& vectorData, unsigned int word)
+  {
+    char data[4];
+    writeWord(data, word);
+    vectorData.insert(vectorData.end(), data, data + 4);
+  }
+
+  void appendLength(std::vector<char>& vectorData, unsigned int length)
+  {
+    while(length >= 255)
+    {
+      vectorData.push_back((char)255);
+      length -= 255;
+    }
+    vectorData.push_back((char)length);
+  }
+
+  void appendSequence(std::vector<char>& vectorData, const char *pLiteral, unsigned int literalLength, unsigned int offset, unsigned int matchLength)
+  {
+    const unsigned int matchCode = (matchLength > 0) ? matchLength - MIN_MATCH : 0;
+
+    vectorData.push_back((char)(((literalLength < 15) ? literalLength : 15) << 4 | ((matchCode < 15) ? matchCode : 15)));
+    if(literalLength >= 15) appendLength(vectorData, literalLength - 15);
+    vectorData.insert(vectorData.end(), pLiteral, pLiteral + literalLength);
+
+    // the last sequence has no match
+    if(matchLength == 0) return;
+
+    vectorData.push_back((char)offset);
+    vectorData.push_back((char)(offset >> 8));
+    if(matchCode >= 15) appendLength(vectorData, matchCode - 15);
+  }
+
+  /// Reads the length extension of a sequence, false if the input ends.
+  inline bool readLength(const unsigned char *&pInput, const unsigned char *pInputEnd, size_t& length)
+  {
+    unsigned char value;
+    do
+    {
+      if(pInput == pInputEnd) return false;
+      value = *pInput++;
+      length += value;
+    } while(value == 255);
+
+    return true;
+  }
+
+   /*****************************************************************************/
+  /** A data source that splits what the loader reads into streams.
+    *
+    * This data source reads a cdf or caf file from a buffer and appends the
+    * bytes of every read to the stream of its type.
+    *****************************************************************************/
+
+  class StreamSplitter : public CalDataSource
+  {
+  public:
+    StreamSplitter(const char *pData, int length)
+      : m_pData(pData), m_length(length), m_offset(0), m_bFailed(false)
+    {
+    }
+
+    virtual bool ok() const
+    {
+      return !m_bFailed;
+    }
+
+    virtual void setError() const
+    {
+      CalError::setLastError(CalError::BAD_DATA_SOURCE, __FILE__, __LINE__);
+    }
+
+    virtual bool readBytes(void *pBuffer, int length)
+    {
+      const char *pData = take(CalEncoded::STREAM_BYTE, length);
+      if(pData == 0) return false;
+      if(length > 0) memcpy(pBuffer, pData, length);
+      return true;
+    }
+
+    virtual bool readFloat(float& value)
+    {
+      const char *pData = take(CalEncoded::STREAM_FLOAT, 4);
+      return (pData != 0) && CalPlatform::readFloat((char *)pData, value);
+    }
+
+    virtual bool readShort(short& value)
+    {
+      const char *pData = take(CalEncoded::STREAM_BYTE, 2);
+      return (pData != 0) && CalPlatform::readShort((char *)pData, value);
+    }
+
+    virtual bool readInteger(int& value)
+    {
+      const char *pData = take(CalEncoded::STREAM_INTEGER, 4);
+      return (pData != 0) && CalPlatform::readInteger((char *)pData, value);
+    }
+
+    virtual bool readString(std::string& strValue)
+    {
+      const char *pLength = take(CalEncoded::STREAM_STRING, 4);
+      if(pLength == 0) return false;
+
+      int length;
+      CalPlatform::readInteger((char *)pLength, length);
+
+      const char *pData = take(CalEncoded::STREAM_STRING, length);
+      if(pData == 0) return false;
+
+      strValue.assign(pData, strnlen(pData, length));
+      return true;
+    }
+
+    virtual bool readFloats(float *pValue, int count)
+    {
+      if((count < 0) || (count > 0x1fffffff)) return false;
+      const char *pData = take(CalEncoded::STREAM_FLOAT, 4 * count);
+      return (pData != 0) && CalPlatform::readFloats((char *)pData, pValue, count);
+    }
+
+    virtual bool readIntegers(int *pValue, int count)
+    {
+      if((count < 0) || (count > 0x1fffffff)) return false;
+      const char *pData = take(CalEncoded::STREAM_INTEGER, 4 * count);
+      return (pData != 0) && CalPlatform::readIntegers((char *)pData, pValue, count);
+    }
+
+    const std::vector<char>& getStream(int type) const
+    {
+      return m_vectorStream[type];
+    }
+
+    bool isConsumed() const
+    {
+      return !m_bFailed && (m_offset == m_length);
+    }
+
+  private:
+    const char *take(int type, int length)
+    {
+      if(m_bFailed || (length < 0) || (length > m_length - m_offset))
+      {
+        m_bFailed = true;
+        return 0;
+      }
+
+      const char *pData = m_pData + m_offset;
+      m_offset += length;
+      m_vectorStream[type].insert(m_vectorStream[type].end(), pData, pData + length);
+
+      return pData;
+    }
+
+    const char *m_pData;
+    int m_length;
+    int m_offset;
+    bool m_bFailed;
+    std::vector<char> m_vectorStream[CalEncoded::STREAM_COUNT];
+  };
+}
+
+ /*****************************************************************************/
+/** Encodes a cdf or caf file in memory.
+  *
+  * This function parses a core model or core animation file with the loader
+  * and writes it in the encoded file format. The loader always runs without
+  * loading flags, and the file must be read to its end, so that the encoded
+  * file holds all of it whatever the loading mode of the application.
+  *
+  * @param pData The address of the file.
+  * @param length The size of the file in bytes.
+  * @param vectorEncoded The vector the encoded file is written to.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalEncoder::encodeBuffer(const void *pData, int length, std::vector<char>& vectorEncoded)
+{
+  if((pData == 0) || (length < 4))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return false;
+  }
+
+  // run the loader over the file, so the streams follow its reads exactly
+  StreamSplitter splitter((const char *)pData, length);
+  if(memcmp(pData, Cal::ANIMATION_FILE_MAGIC, 4) == 0)
+  {
+    CalCoreAnimation coreAnimation;
+    coreAnimation.create("");
+    bool bLoaded = CalLoader::loadCoreAnimation(&coreAnimation, splitter);
+    coreAnimation.destroy();
+    if(!bLoaded) return false;
+  }
+  else if(memcmp(pData, Cal::MODEL_FILE_MAGIC, 4) == 0)
+  {
+    CalCoreModel coreModel;
+    coreModel.create("");
+    bool bLoaded = CalLoader::loadCoreModel(&coreModel, splitter, 0);
+    coreModel.destroy();
+    if(!bLoaded) return false;
+  }
+  else
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return false;
+  }
+
+  // the streams must hold the whole file
+  if(!splitter.isConsumed())
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return false;
+  }
+
+  // encode all streams
+  std::vector<char> vectorBody;
+  appendWord(vectorBody, CalEncoded::STREAM_COUNT);
+  vectorBody.resize(4 + CalEncoded::STREAM_COUNT * sizeof(CalEncoded::Stream));
+
+  int type;
+  for(type = 0; type < CalEncoded::STREAM_COUNT; type++)
+  {
+    bool bWords = (type == CalEncoded::STREAM_INTEGER) || (type == CalEncoded::STREAM_FLOAT);
+
+    CalEncoded::Stream stream;
+    std::vector<char> vectorStream;
+    encodeStream(splitter.getStream(type), bWords, stream, vectorStream);
+
+    char *pStream = &vectorBody[4 + type * sizeof(CalEncoded::Stream)];
+    writeWord(pStream, stream.size);
+    writeWord(pStream + 4, stream.encodedSize);
+    writeWord(pStream + 8, stream.stride);
+    writeWord(pStream + 12, stream.flags);
+    vectorBody.insert(vectorBody.end(), vectorStream.begin(), vectorStream.end());
+  }
+
+  vectorEncoded.clear();
+  vectorEncoded.insert(vectorEncoded.end(), Cal::ENCODED_FILE_MAGIC, Cal::ENCODED_FILE_MAGIC + 4);
+  appendWord(vectorEncoded, Cal::ENCODED_FILE_VERSION);
+  appendWord(vectorEncoded, Cal::LIBRARY_VERSION);
+  appendWord(vectorEncoded, (unsigned int)vectorBody.size());
+  vectorEncoded.insert(vectorEncoded.end(), vectorBody.begin(), vectorBody.end());
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Encodes a cdf or caf file.
+  *
+  * This function reads a core model or core animation file and writes it in
+  * the encoded file format, see encodeBuffer().
+  *
+  * @param strSourceFilename The name of the file to encode.
+  * @param strFilename The name of the encoded file to write.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalEncoder::encodeFile(const std::string& strSourceFilename, const std::string& strFilename)
+{
+  std::ifstream sourceFile;
+  sourceFile.open(strSourceFilename.c_str(), std::ios::in | std::ios::binary);
+  if(!sourceFile)
+  {
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strSourceFilename);
+    return false;
+  }
+
+  std::vector<char> vectorData((std::istreambuf_iterator<char>(sourceFile)), std::istreambuf_iterator<char>());
+  if(sourceFile.bad() || (vectorData.size() > 0x7fffffff))
+  {
+    CalError::setLastError(CalError::FILE_PARSER_FAILED, __FILE__, __LINE__, strSourceFilename);
+    return false;
+  }
+
+  std::vector<char> vectorEncoded;
+  if(!encodeBuffer(vectorData.empty() ? 0 : &vectorData[0], (int)vectorData.size(), vectorEncoded))
+  {
+    CalError::setLastError(CalError::getLastErrorCode(), __FILE__, __LINE__, strSourceFilename);
+    return false;
+  }
+
+  // open the file
+  std::ofstream file;
+  file.open(strFilename.c_str(), std::ios::out | std::ios::binary);
+  if(!file)
+  {
+    CalError::setLastError(CalError::FILE_CREATION_FAILED, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  file.write(&vectorEncoded[0], vectorEncoded.size());
+  if(!file)
+  {
+    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  // explicitly close the file
+  file.close();
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Compresses a block of data.
+  *
+  * This function compresses a block with a greedy LZ coder. The block is a
+  * list of sequences; each holds a token with the literal length in the high
+  * and the match length minus 4 in the low nibble, the literals, the 16 bit
+  * match offset and, for nibbles of 15, more length bytes of up to 255 each.
+  * The last sequence has no match.
+  *
+  * @param pData The address of the block.
+  * @param length The size of the block in bytes.
+  * @param vectorCompressed The vector the compressed block is written to.
+  *****************************************************************************/
+
+void CalEncoder::compress(const char *pData, int length, std::vector<char>& vectorCompressed)
+{
+  vectorCompressed.clear();
+  vectorCompressed.reserve(length + length / 255 + 16);
+
+  std::vector<int> vectorHash(1 << HASH_BITS, -1);
+
+  int anchor = 0;
+  int position = 0;
+  while(position + MIN_MATCH <= length)
+  {
+    unsigned int word = readWord(pData + position);
+    unsigned int hash = (word * 2654435761u) >> (32 - HASH_BITS);
+    int candidate = vectorHash[hash];
+    vectorHash[hash] = position;
+
+    if((candidate < 0) || (position - candidate > MAX_OFFSET) || (readWord(pData + candidate) != word))
+    {
+      // skip faster through data that does not match
+      position += 1 + ((position - anchor) >> 6);
+      continue;
+    }
+
+    int matchLength = MIN_MATCH;
+    while((position + matchLength < length) && (pData[candidate + matchLength] == pData[position + matchLength]))
+    {
+      matchLength++;
+    }
+
+    appendSequence(vectorCompressed, pData + anchor, position - anchor, position - candidate, matchLength);
+
+    position += matchLength;
+    anchor = position;
+  }
+
+  appendSequence(vectorCompressed, pData + anchor, length - anchor, 0, 0);
+}
+
+ /*****************************************************************************/
+/** Decompresses a block of data.
+  *
+  * This function decompresses a block written by compress(). Every length
+  * and offset is checked, so damaged blocks fail instead of writing out of
+  * bounds.
+  *
+  * @param pData The address of the compressed block.
+  * @param length The size of the compressed block in bytes.
+  * @param pDecompressed The buffer the block is decompressed into.
+  * @param decompressedLength The size of the decompressed block in bytes.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if the block is damaged
+  *****************************************************************************/
+
+bool CalEncoder::decompress(const char *pData, int length, char *pDecompressed, int decompressedLength)
+{
+  const unsigned char *pInput = (const unsigned char *)pData;
+  const unsigned char *pInputEnd = pInput + length;
+  char *pOutput = pDecompressed;
+  char *pOutputEnd = pDecompressed + decompressedLength;
+
+  while(pInput < pInputEnd)
+  {
+    const unsigned int token = *pInput++;
+
+    // copy the literals, short runs as one chunk while both buffers have
+    // room for it; the bytes behind the run are overwritten later
+    size_t literalLength = token >> 4;
+    if((literalLength == 15) && !readLength(pInput, pInputEnd, literalLength)) return false;
+    if((literalLength > (size_t)(pInputEnd - pInput)) || (literalLength > (size_t)(pOutputEnd - pOutput))) return false;
+
+    if((literalLength <= 16) && (pInputEnd - pInput >= 16) && (pOutputEnd - pOutput >= 16))
+      memcpy(pOutput, pInput, 16);
+    else
+      memcpy(pOutput, pInput, literalLength);
+    pInput += literalLength;
+    pOutput += literalLength;
+
+    if(pInput == pInputEnd) break;
+
+    // copy the match
+    if(pInputEnd - pInput < 2) return false;
+    const size_t offset = pInput[0] | (pInput[1] << 8);
+    pInput += 2;
+
+    size_t matchLength = token & 15;
+    if((matchLength == 15) && !readLength(pInput, pInputEnd, matchLength)) return false;
+    matchLength += MIN_MATCH;
+
+    if((offset == 0) || (offset > (size_t)(pOutput - pDecompressed)) || (matchLength > (size_t)(pOutputEnd - pOutput))) return false;
+
+    // copy the match in chunks that never overlap, since the match starts at
+    // least one chunk back, overshooting its end while there is room for it
+    const char *pMatch = pOutput - offset;
+    char *pMatchEnd = pOutput + matchLength;
+    if((offset >= 16) && ((size_t)(pOutputEnd - pOutput) >= matchLength + 16))
+    {
+      do
+      {
+        memcpy(pOutput, pMatch, 16);
+        pOutput += 16;
+        pMatch += 16;
+      } while(pOutput < pMatchEnd);
+    }
+    else if((offset >= 8) && ((size_t)(pOutputEnd - pOutput) >= matchLength + 8))
+    {
+      do
+      {
+        memcpy(pOutput, pMatch, 8);
+        pOutput += 8;
+        pMatch += 8;
+      } while(pOutput < pMatchEnd);
+    }
+    else
+    {
+      while(pOutput < pMatchEnd) *pOutput++ = *pMatch++;
+    }
+    pOutput = pMatchEnd;
+  }
+
+  return pOutput == pOutputEnd;
+}
+
+ /*****************************************************************************/
+/** Delta codes and shuffles a block of 32 bit words.
+  *
+  * This function replaces each word by its difference to the word 'stride'
+  * words before it and writes the bytes of the result as four planes, the
+  * lowest bytes of all words first. Similar values then turn into long runs
+  * of equal bytes that compress well.
+  *
+  * @param pData The address of the words.
+  * @param length The size of the block in bytes, a multiple of 4.
+  * @param stride The distance of the words to subtract, or 0 for none.
+  * @param vectorEncoded The vector the encoded block is written to.
+  *****************************************************************************/
+
+void CalEncoder::encodeWords(const char *pData, int length, int stride, std::vector<char>& vectorEncoded)
+{
+  const int count = length / 4;
+  vectorEncoded.resize(length);
+
+  int wordId;
+  for(wordId = 0; wordId < count; wordId++)
+  {
+    unsigned int word = readWord(pData + 4 * wordId);
+    if((stride > 0) && (wordId >= stride)) word -= readWord(pData + 4 * (wordId - stride));
+
+    vectorEncoded[wordId] = (char)word;
+    vectorEncoded[count + wordId] = (char)(word >> 8);
+    vectorEncoded[2 * count + wordId] = (char)(word >> 16);
+    vectorEncoded[3 * count + wordId] = (char)(word >> 24);
+  }
+}
+
+ /*****************************************************************************/
+/** Restores a block of 32 bit words.
+  *
+  * This function undoes encodeWords() in a single pass.
+  *
+  * @param pData The address of the encoded block.
+  * @param length The size of the block in bytes.
+  * @param stride The stride the block was encoded with.
+  * @param pDecoded The buffer the words are written to.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if the length is not a multiple of 4
+  *****************************************************************************/
+
+bool CalEncoder::decodeWords(const char *pData, int length, int stride, char *pDecoded)
+{
+  if((length % 4) != 0) return false;
+
+  const int count = length / 4;
+  const unsigned char *pPlane0 = (const unsigned char *)pData;
+  const unsigned char *pPlane1 = pPlane0 + count;
+  const unsigned char *pPlane2 = pPlane1 + count;
+  const unsigned char *pPlane3 = pPlane2 + count;
+
+  int wordId;
+  if(stride == 0)
+  {
+    for(wordId = 0; wordId < count; wordId++)
+    {
+      writeWord(pDecoded + 4 * wordId, pPlane0[wordId] | (pPlane1[wordId] << 8) | (pPlane2[wordId] << 16) | ((unsigned int)pPlane3[wordId] << 24));
+    }
+    return true;
+  }
+
+  // keep the last 'stride' words in registers instead of reading them back
+  unsigned int previous[CalEncoded::MAX_STRIDE] = { 0 };
+  int previousId = 0;
+  for(wordId = 0; wordId < count; wordId++)
+  {
+    unsigned int word = previous[previousId] + (pPlane0[wordId] | (pPlane1[wordId] << 8) | (pPlane2[wordId] << 16) | ((unsigned int)pPlane3[wordId] << 24));
+    writeWord(pDecoded + 4 * wordId, word);
+    previous[previousId] = word;
+    if(++previousId == stride) previousId = 0;
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Encodes a stream.
+  *
+  * This function encodes a stream in the smallest way it finds. Word streams
+  * are tried with every stride up to CalEncoded::MAX_STRIDE. Streams that
+  * don't get smaller by compressing them are stored as they are.
+  *
+  * @param vectorData The stream to encode.
+  * @param bWords True if the stream consists of 32 bit words.
+  * @param stream The stream table entry that is filled in.
+  * @param vectorEncoded The vector the encoded stream is written to.
+  *****************************************************************************/
+
+void CalEncoder::encodeStream(const std::vector<char>& vectorData, bool bWords, CalEncoded::Stream& stream, std::vector<char>& vectorEncoded)
+{
+  stream.size = (unsigned int)vectorData.size();
+  stream.encodedSize = stream.size;
+  stream.stride = 0;
+  stream.flags = 0;
+  vectorEncoded = vectorData;
+
+  if(vectorData.empty()) return;
+
+  std::vector<char> vectorCompressed;
+  compress(&vectorData[0], (int)vectorData.size(), vectorCompressed);
+  if(vectorCompressed.size() < vectorEncoded.size())
+  {
+    stream.flags = CalEncoded::FLAG_COMPRESSED;
+    vectorEncoded.swap(vectorCompressed);
+  }
+  stream.encodedSize = (unsigned int)vectorEncoded.size();
+
+  if(!bWords || ((vectorData.size() % 4) != 0)) return;
+
+  std::vector<char> vectorWords;
+  int stride;
+  for(stride = 0; stride <= CalEncoded::MAX_STRIDE; stride++)
+  {
+    encodeWords(&vectorData[0], (int)vectorData.size(), stride, vectorWords);
+    compress(&vectorWords[0], (int)vectorWords.size(), vectorCompressed);
+    if(vectorCompressed.size() < vectorEncoded.size())
+    {
+      stream.stride = stride;
+      stream.flags = CalEncoded::FLAG_SHUFFLED | CalEncoded::FLAG_COMPRESSED;
+      vectorEncoded.swap(vectorCompressed);
+    }
+  }
+
+  stream.encodedSize = (unsigned int)vectorEncoded.size();
+}
+
+//****************************************************************************//
@@ -0,0 +1,97 @@
+//****************************************************************************//
+// encoder.h                                                                  //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_ENCODER_H
+#define CAL_ENCODER_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+
+//****************************************************************************//
+// Encoded file layout                                                        //
+//****************************************************************************//
+
+// An encoded file holds a cdf or caf file, split by the type of each read of
+// the loader into STREAM_COUNT streams: bytes, integers, floats and strings.
+// Reading the streams back in the same order gives the loader the values of
+// the original file, so the loader parses encoded files with its usual code.
+//
+// The file starts with the magic tag, the version, the library version of
+// the loader that split the file and the size of the body. The streams follow
+// the reads of that loader, so only the same library version reads them back.
+// The body starts with the stream count and one Stream per stream, followed
+// by the encoded streams. The integer and float streams are delta coded per
+// 32 bit word against the word 'stride' words before it, which lines up the
+// fields of keyframes and vertices, and split into four byte planes. Every
+// stream that gets smaller is then compressed with a small LZ coder. All
+// values are little endian, like in the original files.
+
+namespace CalEncoded
+{
+  const int STREAM_COUNT = 4;
+  const int MAX_STRIDE = 16;
+
+  enum StreamType
+  {
+    STREAM_BYTE = 0,
+    STREAM_INTEGER,
+    STREAM_FLOAT,
+    STREAM_STRING
+  };
+
+  enum StreamFlag
+  {
+    FLAG_SHUFFLED = 1,
+    FLAG_COMPRESSED = 2
+  };
+
+  /// An entry of the stream table.
+  struct Stream
+  {
+    unsigned int size;
+    unsigned int encodedSize;
+    int stride;
+    int flags;
+  };
+}
+
+//****************************************************************************//
+// Class declaration                                                          //
+//****************************************************************************//
+
+ /*****************************************************************************/
+/** The encoder class.
+  *
+  * This class converts cdf and caf files into the encoded file format and
+  * holds the coders that CalEncodedSource uses to read them back.
+  *****************************************************************************/
+
+class CAL3D_API CalEncoder
+{
+// member functions
+public:
+  static bool encodeBuffer(const void *pData, int length, std::vector<char>& vectorEncoded);
+  static bool encodeFile(const std::string& strSourceFilename, const std::string& strFilename);
+
+  static void compress(const char *pData, int length, std::vector<char>& vectorCompressed);
+  static bool decompress(const char *pData, int length, char *pDecompressed, int decompressedLength);
+  static void encodeWords(const char *pData, int length, int stride, std::vector<char>& vectorEncoded);
+  static bool decodeWords(const char *pData, int length, int stride, char *pDecoded);
+
+protected:
+  static void encodeStream(const std::vector<char>& vectorData, bool bWords, CalEncoded::Stream& stream, std::vector<char>& vectorEncoded);
+};
+
+#endif
+
+//****************************************************************************//
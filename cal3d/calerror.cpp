@@ -15,19 +15,21 @@
 
 #include "calerror.h"
 
+// the last error is kept per thread, so loads on several threads don't
+// overwrite each other's errors
 namespace
 {
-    CalError::Code m_lastErrorCode = CalError::OK;
-    std::string m_strLastErrorFile;
-    int m_lastErrorLine = -1;
-    std::string m_strLastErrorText;
+    thread_local CalError::Code m_lastErrorCode = CalError::OK;
+    thread_local std::string m_strLastErrorFile;
+    thread_local int m_lastErrorLine = -1;
+    thread_local std::string m_strLastErrorText;
 }
 
  /*****************************************************************************/
 /** Returns the code of the last error.
   *
   * This function returns the code of the last error that occured inside the
-  * library.
+  * library on the calling thread.
   *
   * @return The code of the last error.
   *****************************************************************************/
@@ -140,7 +142,7 @@ void CalError::printLastError()
 /** Sets all the information about the last error.
   *
   * This function sets all the information about the last error that occured
-  * inside the library.
+  * inside the library on the calling thread.
   *
   * @param code The code of the last error.
   * @param strFile The file where the last error occured.
@@ -45,6 +45,9 @@ namespace Cal
   const char ANIMATION_FILE_MAGIC[4] = { 'C', 'A', 'F', '\0' };
   const char MESH_FILE_MAGIC[4]      = { 'C', 'M', 'F', '\0' };
   const char MATERIAL_FILE_MAGIC[4]  = { 'C', 'R', 'F', '\0' };
+  const char BAKED_FILE_MAGIC[4]     = { 'C', 'B', 'F', '\0' };
+  const char ARCHIVE_FILE_MAGIC[4]   = { 'C', 'A', 'R', '\0' };
+  const char ENCODED_FILE_MAGIC[4]   = { 'C', 'E', 'F', '\0' };
   
   // library version
   const int LIBRARY_VERSION = 710;
@@ -53,6 +56,15 @@ namespace Cal
   const int CURRENT_FILE_VERSION = LIBRARY_VERSION;
   const int EARLIEST_COMPATIBLE_FILE_VERSION = 700;
 
+  // baked file version, see calbaked.h
+  const int BAKED_FILE_VERSION = 1;
+
+  // archive file version, see calarchive.h
+  const int ARCHIVE_FILE_VERSION = 1;
+
+  // encoded file version, see calencoder.h
+  const int ENCODED_FILE_VERSION = 2;
+
   // empty string
   const std::string strNull;
 }
@@ -30,74 +30,1902 @@
 #include "calcoretrack.h"
 #include "calcorekey.h"
 #include "calcoresub.h"
+#include "calarena.h"
+#include "calbaked.h"
+#include "calnametable.h"
 #include "buffersource.h"
+#include "encodedsource.h"
+#include "mappedfilesource.h"
 #include "streamsource.h"
 
+// threading includes
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
 int CalLoader::loadingMode;
+
+namespace
+{
+  /// Returns the section of a given type and index, or 0 if there is none.
+  const CalBaked::Section *findBakedSection(const std::vector<const CalBaked::Section *>& vectorSection, int type, int index = 0)
+  {
+    std::vector<const CalBaked::Section *>::const_iterator iteratorSection;
+    for(iteratorSection = vectorSection.begin(); iteratorSection != vectorSection.end(); ++iteratorSection)
+    {
+      if(((*iteratorSection)->type == type) && ((*iteratorSection)->index == index)) return *iteratorSection;
+    }
+
+    return 0;
+  }
+
+  /// Copies a section whose elements are stored as they are kept in memory.
+  template<typename T>
+  bool copyBakedSection(const char *pBody, const CalBaked::Section *pSection, size_t count, std::vector<T>& vectorElement)
+  {
+    if(count == 0) return (pSection == 0) || (pSection->count == 0);
+    if((pSection == 0) || (pSection->count != count) || (sizeof(T) != CalBaked::getElementSize(pSection->type))) return false;
+
+    vectorElement.resize(count);
+    memcpy(&vectorElement[0], pBody + pSection->offset, count * sizeof(T));
+
+    return true;
+  }
+
+  /// Interns a string of the string section.
+  bool getBakedNameId(const char *pBody, const CalBaked::Section *pSection, int offset, int& nameId)
+  {
+    if((pSection == 0) || (offset < 0) || ((unsigned int)offset >= pSection->count)) return false;
+
+    // the string must end inside the section
+    const char *pString = pBody + pSection->offset + offset;
+    size_t length = strnlen(pString, pSection->count - offset);
+    if(length == pSection->count - offset) return false;
+
+    nameId = CalNameTable::intern(pString, (int)length);
+
+    return true;
+  }
+
+  /// Reads a name stored as its length and its characters, and interns it.
+  /// The name is read in place if the data source can map its memory, else
+  /// through a buffer on the stack. Returns -1 if the name can't be read.
+  template<class DataSource>
+  int readNameId(DataSource& dataSrc)
+  {
+    int length;
+    if(!dataSrc.readInteger(length) || (length < 1)) return -1;
+
+    char buffer[256];
+    std::vector<char> vectorBuffer;
+    const char *pName = dataSrc.mapBytes(length);
+    if(pName == 0)
+    {
+      char *pBuffer = buffer;
+      if(length > (int)sizeof(buffer))
+      {
+        vectorBuffer.resize(length);
+        pBuffer = &vectorBuffer[0];
+      }
+      if(!dataSrc.readBytes(pBuffer, length)) return -1;
+      pName = pBuffer;
+    }
+
+    // the name ends with a zero, which is not part of it
+    const char *pEnd = (const char *)memchr(pName, 0, length);
+    return CalNameTable::intern(pName, (pEnd != 0) ? (int)(pEnd - pName) : length);
+  }
+
+  /// Returns the index of the first keyframe of a lazily loaded track that is
+  /// later than the given time, or at it if bAtTime is set; keyframeCount if
+  /// there is none. The keyframes are sorted by time, so only their times are
+  /// read, in a binary search. Returns -1 if the file can't be read.
+  int findStreamedKeyframe(CalMappedFileSource& fileSrc, unsigned int offset, int keyframeCount, float time, bool bAtTime)
+  {
+    int lowId = 0;
+    int highId = keyframeCount;
+    while(lowId < highId)
+    {
+      int keyframeId = lowId + (highId - lowId) / 2;
+
+      float keyframeTime;
+      if(!fileSrc.seek(offset + keyframeId * 32) || !fileSrc.readFloat(keyframeTime)) return -1;
+
+      if((keyframeTime > time) || (bAtTime && (keyframeTime == time))) highId = keyframeId;
+      else lowId = keyframeId + 1;
+    }
+
+    return lowId;
+  }
+
+  /// Runs load(itemId) for all items on up to threadCount threads, including
+  /// the calling one, and collects the error code of each failed item.
+  /// Returns the number of items loaded.
+  template<typename LoadFunction>
+  int loadInParallel(int itemCount, int threadCount, LoadFunction load, std::vector<CalError::Code>& vectorErrorCode)
+  {
+    vectorErrorCode.assign(itemCount, CalError::OK);
+
+    if(threadCount <= 0) threadCount = (int)std::thread::hardware_concurrency();
+    if(threadCount > itemCount) threadCount = itemCount;
+    if(threadCount < 1) threadCount = 1;
+
+    // every thread keeps taking the next item, the error state is per thread
+    std::atomic<int> nextItemId(0);
+    std::atomic<int> loadedCount(0);
+    auto worker = [&]()
+    {
+      int itemId;
+      while((itemId = nextItemId++) < itemCount)
+      {
+        if(load(itemId)) loadedCount++;
+        else vectorErrorCode[itemId] = CalError::getLastErrorCode();
+      }
+    };
+
+    std::vector<std::thread> vectorThread;
+    int threadId;
+    for(threadId = 1; threadId < threadCount; threadId++)
+    {
+      vectorThread.push_back(std::thread(worker));
+    }
+    worker();
+
+    std::vector<std::thread>::iterator iteratorThread;
+    for(iteratorThread = vectorThread.begin(); iteratorThread != vectorThread.end(); ++iteratorThread)
+    {
+      iteratorThread->join();
+    }
+
+    return loadedCount;
+  }
+
+  /// Reports the first failed item of a batch as the error of the calling thread.
+  void setBatchError(const std::vector<CalError::Code>& vectorErrorCode, const std::vector<std::string>& vectorFilename)
+  {
+    size_t itemId;
+    for(itemId = 0; itemId < vectorErrorCode.size(); itemId++)
+    {
+      if(vectorErrorCode[itemId] != CalError::OK)
+      {
+        CalError::setLastError(vectorErrorCode[itemId], __FILE__, __LINE__, vectorFilename[itemId]);
+        return;
+      }
+    }
+  }
+}
+
+ /*****************************************************************************/
+/** The state of an incremental load.
+  *
+  * An incremental load works through the file one piece at a time: a header,
+  * a core bone, a vertex, a block of faces or a keyframe. This is all it needs
+  * to go on with the next piece in a later call to step().
+  *****************************************************************************/
+
+struct CalLoader::IncrementalLoad
+{
+  enum Phase
+  {
+    PHASE_START,
+    PHASE_BONES,
+    PHASE_MESH,
+    PHASE_SUBMESH,
+    PHASE_VERTICES,
+    PHASE_SPRINGS,
+    PHASE_FACES,
+    PHASE_SUBMESH_END,
+    PHASE_TRACK,
+    PHASE_KEYFRAMES,
+    PHASE_DONE
+  };
+
+  /// The number of faces read as one piece.
+  static const int FACE_BLOCK_SIZE = 1024;
+
+  State state;
+  Phase phase;
+  int flags;
+  CalCoreAnimation *pCoreAnimation;
+  CalCoreModel *pCoreModel;
+  std::string strFilename;
+  std::string strMeshFilename;
+  CalMappedFileSource *pFileSource;
+  CalMappedFileSource *pMeshFileSource;
+  CalMappedFileSource *pDataSource;
+  bool bSeparateMesh;
+  int count;
+  int id;
+  int itemCount;
+  int itemId;
+  CalCoreSubmesh *pCoreSubmesh;
+  CalCoreTrack *pCoreTrack;
+
+  IncrementalLoad()
+    : state(STATE_LOADING), phase(PHASE_START), flags(0), pCoreAnimation(0), pCoreModel(0), pFileSource(0), pMeshFileSource(0), pDataSource(0),
+      bSeparateMesh(false), count(0), id(0), itemCount(0), itemId(0), pCoreSubmesh(0), pCoreTrack(0)
+  {
+  }
+
+  ~IncrementalLoad()
+  {
+    delete pFileSource;
+    delete pMeshFileSource;
+  }
+};
                                                                                                             
  /*****************************************************************************/
-/** Sets optional flags which affect how the model is loaded into memory.
-  *
-  * This function sets the loading mode for all future loader calls.
-  *
-  * @param flags A boolean OR of any of the following flags
-  *         \li LOADER_ROTATE_X_AXIS will rotate the mesh 90 degrees about the X axis,
-  *             which has the effect of swapping Y/Z coordinates.
-  *         \li LOADER_INVERT_V_COORD will substitute (1-v) for any v texture coordinate
-  *             to eliminate the need for texture inversion after export.
-  *
+/** Sets optional flags which affect how the model is loaded into memory.
+  *
+  * This function sets the loading mode for all future loader calls, except
+  * those of loaders that have their own flags set with setLoadingFlags().
+  *
+  * @param flags A boolean OR of any of the following flags
+  *         \li LOADER_ROTATE_X_AXIS will rotate the mesh 90 degrees about the X axis,
+  *             which has the effect of swapping Y/Z coordinates.
+  *         \li LOADER_INVERT_V_COORD will substitute (1-v) for any v texture coordinate
+  *             to eliminate the need for texture inversion after export.
+  *         \li LOADER_LAZY_TRACKS will make loadCoreAnimation() with a file name read
+  *             only the track headers; the keyframes are read on first use, see
+  *             CalCoreAnimation::loadTracks().
+  *         \li LOADER_STREAM_TRACKS will make loadCoreAnimation() with a file name
+  *             read only the track headers like LOADER_LAZY_TRACKS, but keep
+  *             only the keyframes of a two second chunk of the animation in
+  *             memory while it plays, see CalCoreAnimation::setChunkDuration().
+  *         \li LOADER_SKELETON_ONLY will make loadCoreModel() read the core bones
+  *             only and skip all core submeshes, for servers that never draw
+  *             the model. With separate skeleton and mesh files, the mesh file
+  *             isn't opened at all.
+  *
+  *****************************************************************************/
+void CalLoader::setLoadingMode(int flags)
+{
+  loadingMode = flags;
+}
+
+ /*****************************************************************************/
+/** Returns the loading mode flags of this loader.
+  *
+  * This function returns the flags set with setLoadingFlags(), or the global
+  * loading mode if there are none.
+  *
+  * @return The loading mode flags.
+  *****************************************************************************/
+
+int CalLoader::getLoadingFlags() const
+{
+  return (m_loadingFlags >= 0) ? m_loadingFlags : loadingMode;
+}
+
+ /*****************************************************************************/
+/** Sets the loading mode flags of this loader.
+  *
+  * This function sets the flags for the calls of this loader only, so loads
+  * with different flags can run on several threads at once.
+  *
+  * @param flags A boolean OR of the flags of setLoadingMode(), or -1 to
+  *              follow the global loading mode again.
+  *****************************************************************************/
+
+void CalLoader::setLoadingFlags(int flags)
+{
+  m_loadingFlags = flags;
+}
+
+ /*****************************************************************************/
+/** Constructs the loader instance.
+  *
+  * This function is the default constructor of the loader instance.
+  *****************************************************************************/
+
+CalLoader::CalLoader()
+{
+  m_loadingFlags = -1;
+  m_pIncrementalLoad = 0;
+}
+
+ /*****************************************************************************/
+/** Destructs the loader instance.
+  *
+  * This function is the destructor of the loader instance. An incremental
+  * load that isn't done yet is cancelled.
+  *****************************************************************************/
+
+CalLoader::~CalLoader()
+{
+  cancel();
+}
+
+ /*****************************************************************************/
+/** Starts an incremental load of a core animation.
+  *
+  * This function opens an animation file for loading with step(), which reads
+  * a bit of it at a time, so a large file can be loaded across frames without
+  * a loader thread. The core animation must not be used before the load is
+  * done. A load of this loader that is still going on is cancelled.
+  *
+  * @param anim The core animation to load into.
+  * @param strFilename The name of the file to load the core animation from.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLoader::beginCoreAnimation(CalCoreAnimation *anim, const std::string& strFilename)
+{
+  cancel();
+
+  CalMappedFileSource *pFileSource = new CalMappedFileSource(strFilename);
+  if(!pFileSource->isMapped())
+  {
+    delete pFileSource;
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
+    anim->destroy(); return false;
+  }
+
+  m_pIncrementalLoad = new IncrementalLoad();
+  m_pIncrementalLoad->flags = getLoadingFlags();
+  m_pIncrementalLoad->pCoreAnimation = anim;
+  m_pIncrementalLoad->strFilename = strFilename;
+  m_pIncrementalLoad->pFileSource = pFileSource;
+  m_pIncrementalLoad->pDataSource = pFileSource;
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Starts an incremental load of a core model.
+  *
+  * This function opens a model file for loading with step(), see
+  * beginCoreAnimation().
+  *
+  * @param model The core model to load into.
+  * @param strFilename The name of the file to load the core model from.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLoader::beginCoreModel(CalCoreModel *model, const std::string& strFilename)
+{
+  cancel();
+
+  CalMappedFileSource *pFileSource = new CalMappedFileSource(strFilename);
+  if(!pFileSource->isMapped())
+  {
+    delete pFileSource;
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
+    model->destroy(); return false;
+  }
+
+  m_pIncrementalLoad = new IncrementalLoad();
+  m_pIncrementalLoad->flags = getLoadingFlags();
+  m_pIncrementalLoad->pCoreModel = model;
+  m_pIncrementalLoad->strFilename = strFilename;
+  m_pIncrementalLoad->pFileSource = pFileSource;
+  m_pIncrementalLoad->pDataSource = pFileSource;
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Starts an incremental load of a core model from two files.
+  *
+  * This function opens a skeleton file and a mesh file for loading with
+  * step(), see beginCoreAnimation(). With the LOADER_SKELETON_ONLY flag the
+  * mesh file isn't opened.
+  *
+  * @param model The core model to load into.
+  * @param strFilename The name of the skeleton file.
+  * @param strFilenameM The name of the mesh file.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLoader::beginCoreModel(CalCoreModel *model, const std::string& strFilename, const std::string& strFilenameM)
+{
+  if(!beginCoreModel(model, strFilename)) return false;
+
+  m_pIncrementalLoad->bSeparateMesh = true;
+  m_pIncrementalLoad->strMeshFilename = strFilenameM;
+  if(m_pIncrementalLoad->flags & LOADER_SKELETON_ONLY) return true;
+
+  CalMappedFileSource *pMeshFileSource = new CalMappedFileSource(strFilenameM);
+  if(!pMeshFileSource->isMapped())
+  {
+    delete pMeshFileSource;
+    delete m_pIncrementalLoad;
+    m_pIncrementalLoad = 0;
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilenameM);
+    model->destroy(); return false;
+  }
+
+  m_pIncrementalLoad->pMeshFileSource = pMeshFileSource;
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Cancels an incremental load.
+  *
+  * This function stops the incremental load of this loader. A core animation
+  * or core model that isn't completely loaded yet is destroyed, as by a
+  * failed load; one that is done is left alone.
+  *****************************************************************************/
+
+void CalLoader::cancel()
+{
+  if(m_pIncrementalLoad == 0) return;
+
+  IncrementalLoad& load = *m_pIncrementalLoad;
+  if(load.state == STATE_LOADING)
+  {
+    // the piece being loaded isn't part of the core object yet
+    if(load.pCoreSubmesh != 0)
+    {
+      load.pCoreSubmesh->destroy();
+      CalArena::release(&load.pCoreModel->m_arena, load.pCoreSubmesh);
+    }
+
+    if(load.pCoreTrack != 0)
+    {
+      load.pCoreTrack->destroy();
+      CalArena::release(&load.pCoreAnimation->m_arena, load.pCoreTrack);
+    }
+
+    if(load.pCoreAnimation != 0) load.pCoreAnimation->destroy();
+    if(load.pCoreModel != 0) load.pCoreModel->destroy();
+  }
+
+  delete m_pIncrementalLoad;
+  m_pIncrementalLoad = 0;
+}
+
+ /*****************************************************************************/
+/** Returns the state of the incremental load.
+  *
+  * @return One of the following values:
+  *         \li \b STATE_NONE if no load was started or it was cancelled
+  *         \li \b STATE_LOADING if step() needs to be called again
+  *         \li \b STATE_DONE if the core object is loaded
+  *         \li \b STATE_FAILED if an error happend; the core object is
+  *             destroyed
+  *****************************************************************************/
+
+CalLoader::State CalLoader::getState() const
+{
+  return (m_pIncrementalLoad != 0) ? m_pIncrementalLoad->state : STATE_NONE;
+}
+
+ /*****************************************************************************/
+/** Continues an incremental load.
+  *
+  * This function loads pieces of the file started with beginCoreAnimation()
+  * or beginCoreModel() until one of the budgets is used up. A piece is a
+  * header, a core bone, a vertex, a block of faces or a keyframe, so a step
+  * stops at most one piece after its budget. Completing a core submesh, which
+  * analyzes its influences and builds its level of detail steps, is one piece
+  * too. At least one piece is loaded in every step. A byte budget makes the
+  * steps the same on every run, which a replay needs; a time budget follows
+  * the frame time. Baked and encoded files as well as lazily loaded and
+  * streamed core animations only read headers or single blocks, so they are
+  * loaded in one piece.
+  *
+  * @param byteBudget The number of bytes of the file to read, or 0 for no
+  *                   limit.
+  * @param microsecondBudget The time to spend in microseconds, or 0 for no
+  *                          limit.
+  *
+  * @return The state of the load, see getState().
+  *****************************************************************************/
+
+CalLoader::State CalLoader::step(int byteBudget, int microsecondBudget)
+{
+  if(m_pIncrementalLoad == 0) return STATE_NONE;
+
+  IncrementalLoad& load = *m_pIncrementalLoad;
+  if(load.state != STATE_LOADING) return load.state;
+
+  std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+  int byteCount = 0;
+  int pieceCount = 0;
+
+  for(;;)
+  {
+    IncrementalLoad::Phase phase = load.phase;
+    CalMappedFileSource *pDataSource = load.pDataSource;
+    unsigned int offset = pDataSource->getOffset();
+
+    if(!loadNextPiece())
+    {
+      cancel();
+
+      // the last error stays as the piece set it
+      m_pIncrementalLoad = new IncrementalLoad();
+      m_pIncrementalLoad->state = STATE_FAILED;
+      return STATE_FAILED;
+    }
+
+    if(load.phase == IncrementalLoad::PHASE_DONE)
+    {
+      // the files aren't needed anymore
+      delete load.pFileSource;
+      delete load.pMeshFileSource;
+      load.pFileSource = 0;
+      load.pMeshFileSource = 0;
+      load.pDataSource = 0;
+
+      load.state = STATE_DONE;
+      return STATE_DONE;
+    }
+
+    byteCount += (int)(pDataSource->getOffset() - offset);
+    if((byteBudget > 0) && (byteCount >= byteBudget)) break;
+
+    // reading the clock costs about as much as a vertex, so it is read every
+    // few pieces and after each header or completed core submesh
+    ++pieceCount;
+    if((microsecondBudget > 0) && (((pieceCount & 15) == 0) || (load.phase != phase)))
+    {
+      std::chrono::steady_clock::duration time = std::chrono::steady_clock::now() - startTime;
+      if(std::chrono::duration_cast<std::chrono::microseconds>(time).count() >= microsecondBudget) break;
+    }
+  }
+
+  return STATE_LOADING;
+}
+
+ /*****************************************************************************/
+/** Loads the next piece of an incremental load.
+  *
+  * This function loads one piece of the file and moves on to the next one.
+  * It reads the file like loadCoreAnimationFrom() and loadCoreModelFrom().
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLoader::loadNextPiece()
+{
+  IncrementalLoad& load = *m_pIncrementalLoad;
+  CalMappedFileSource& dataSrc = *load.pDataSource;
+  CalCoreAnimation *anim = load.pCoreAnimation;
+  CalCoreModel *model = load.pCoreModel;
+
+  switch(load.phase)
+  {
+  case IncrementalLoad::PHASE_START:
+    {
+      // lazily loaded and streamed core animations only read the track headers
+      if((anim != 0) && (load.flags & (LOADER_LAZY_TRACKS | LOADER_STREAM_TRACKS)))
+      {
+        if(!loadLazyCoreAnimation(anim, dataSrc, load.strFilename)) return false;
+
+        // baked and encoded animations are loaded completely and can't stream
+        if((load.flags & LOADER_STREAM_TRACKS) && anim->isLazy()) anim->setChunkDuration(2.0f);
+        load.phase = IncrementalLoad::PHASE_DONE;
+        return true;
+      }
+
+      // check if this is a valid file
+      char magic[4];
+      if(!dataSrc.readBytes(&magic[0], 4))
+      {
+        CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, load.strFilename);
+        return false;
+      }
+
+      // baked and encoded files are told apart by their magic tag
+      bool bBaked = (memcmp(&magic[0], Cal::BAKED_FILE_MAGIC, 4) == 0);
+      bool bEncoded = (memcmp(&magic[0], Cal::ENCODED_FILE_MAGIC, 4) == 0);
+      if((bBaked || bEncoded) && !load.bSeparateMesh)
+      {
+        bool bSuccess;
+        if(anim != 0) bSuccess = bBaked ? loadBakedCoreAnimation(anim, dataSrc) : loadEncodedCoreAnimation(anim, dataSrc);
+        else bSuccess = bBaked ? loadBakedCoreModel(model, dataSrc, load.flags) : loadEncodedCoreModel(model, dataSrc, load.flags);
+        if(!bSuccess) return false;
+
+        load.phase = IncrementalLoad::PHASE_DONE;
+        return true;
+      }
+
+      const char *pMagic = (anim != 0) ? Cal::ANIMATION_FILE_MAGIC : (load.bSeparateMesh ? Cal::SKELETON_FILE_MAGIC : Cal::MODEL_FILE_MAGIC);
+      if(memcmp(&magic[0], pMagic, 4) != 0)
+      {
+        CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, load.strFilename);
+        return false;
+      }
+
+      // check if the version is compatible with the library
+      int version;
+      if(!dataSrc.readInteger(version) || (version < Cal::EARLIEST_COMPATIBLE_FILE_VERSION) || (version > Cal::CURRENT_FILE_VERSION))
+      {
+        CalError::setLastError(CalError::INCOMPATIBLE_FILE_VERSION, __FILE__, __LINE__, load.strFilename);
+        return false;
+      }
+
+      if(anim != 0)
+      {
+        // get the duration and the number of tracks of the core animation
+        float duration;
+        if(!dataSrc.readFloat(duration) || !dataSrc.readInteger(load.count) || (load.count <= 0))
+        {
+          CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, load.strFilename);
+          return false;
+        }
+
+        if(duration <= 0.0f)
+        {
+          CalError::setLastError(CalError::INVALID_ANIMATION_DURATION, __FILE__, __LINE__, load.strFilename);
+          return false;
+        }
+
+        anim->setDuration(duration);
+
+        // place all core tracks and core keyframes next to each other
+        int remainingSize = dataSrc.getRemainingSize();
+        if(remainingSize > 0)
+        {
+          size_t coreTrackCount = std::min(load.count, remainingSize / 40);
+          anim->m_arena.reserve(coreTrackCount * sizeof(CalCoreTrack) + (remainingSize / 32) * sizeof(CalCoreKeyframe));
+        }
+
+        load.phase = IncrementalLoad::PHASE_TRACK;
+        return true;
+      }
+
+      // read the number of bones
+      if(!dataSrc.readInteger(load.count) || (load.count <= 0))
+      {
+        CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, load.strFilename);
+        return false;
+      }
+
+      // place all core bones next to each other
+      int remainingSize = dataSrc.getRemainingSize();
+      if(remainingSize > 0) model->m_arena.reserve(std::min(load.count, remainingSize / 64) * sizeof(CalCoreBone));
+
+      load.phase = IncrementalLoad::PHASE_BONES;
+      return true;
+    }
+
+  case IncrementalLoad::PHASE_BONES:
+    {
+      if(load.id < load.count)
+      {
+        CalCoreBone *pCoreBone = loadCoreBones(dataSrc, load.flags, &model->m_arena);
+        if(pCoreBone == 0) return false;
+
+        pCoreBone->setCoreModel(model);
+        model->m_vectorCoreBone.push_back(pCoreBone);
+        ++load.id;
+        return true;
+      }
+
+      // a separate skeleton file is complete in itself
+      if(load.bSeparateMesh) model->calculateState();
+
+      // the core submeshes take the rest of the file, so they are skipped by
+      // not reading any further
+      if(load.flags & LOADER_SKELETON_ONLY)
+      {
+        load.phase = IncrementalLoad::PHASE_DONE;
+        return true;
+      }
+
+      if(load.bSeparateMesh) load.pDataSource = load.pMeshFileSource;
+      load.phase = IncrementalLoad::PHASE_MESH;
+      return true;
+    }
+
+  case IncrementalLoad::PHASE_MESH:
+    {
+      const std::string& strMeshFilename = load.bSeparateMesh ? load.strMeshFilename : load.strFilename;
+
+      if(load.bSeparateMesh)
+      {
+        // check if this is a valid file
+        char magic[4];
+        if(!dataSrc.readBytes(&magic[0], 4) || (memcmp(&magic[0], Cal::MESH_FILE_MAGIC, 4) != 0))
+        {
+          CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strMeshFilename);
+          return false;
+        }
+
+        // check if the version is compatible with the library
+        int version;
+        if(!dataSrc.readInteger(version) || (version < Cal::EARLIEST_COMPATIBLE_FILE_VERSION) || (version > Cal::CURRENT_FILE_VERSION))
+        {
+          CalError::setLastError(CalError::INCOMPATIBLE_FILE_VERSION, __FILE__, __LINE__, strMeshFilename);
+          return false;
+        }
+      }
+
+      // get the number of submeshes
+      if(!dataSrc.readInteger(load.count))
+      {
+        CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strMeshFilename);
+        return false;
+      }
+
+      // place all core submeshes next to each other
+      int remainingSize = dataSrc.getRemainingSize();
+      if(remainingSize > 0) model->m_arena.reserve(std::min(load.count, remainingSize / 24) * sizeof(CalCoreSubmesh));
+
+      load.id = 0;
+      load.phase = IncrementalLoad::PHASE_SUBMESH;
+      return true;
+    }
+
+  case IncrementalLoad::PHASE_SUBMESH:
+    {
+      if(load.id >= load.count)
+      {
+        load.phase = IncrementalLoad::PHASE_DONE;
+        return true;
+      }
+
+      load.pCoreSubmesh = loadCoreSubmeshHeader(dataSrc, &model->m_arena);
+      if(load.pCoreSubmesh == 0) return false;
+
+      load.itemCount = (int)load.pCoreSubmesh->getVectorVertex().size();
+      load.itemId = 0;
+      load.phase = (load.itemCount > 0) ? IncrementalLoad::PHASE_VERTICES : IncrementalLoad::PHASE_SPRINGS;
+      return true;
+    }
+
+  case IncrementalLoad::PHASE_VERTICES:
+    {
+      if(!loadCoreSubmeshVertex(dataSrc, load.pCoreSubmesh, load.itemId)) return false;
+
+      ++load.itemId;
+      if(load.itemId == load.itemCount) load.phase = IncrementalLoad::PHASE_SPRINGS;
+      return true;
+    }
+
+  case IncrementalLoad::PHASE_SPRINGS:
+    {
+      if(!loadCoreSubmeshSprings(dataSrc, load.pCoreSubmesh)) return false;
+
+      load.itemCount = (int)load.pCoreSubmesh->getVectorFace().size();
+      load.itemId = 0;
+      load.phase = IncrementalLoad::PHASE_FACES;
+      return true;
+    }
+
+  case IncrementalLoad::PHASE_FACES:
+    {
+      int faceCount = std::min(load.itemCount - load.itemId, (int)IncrementalLoad::FACE_BLOCK_SIZE);
+      if(!loadCoreSubmeshFaces(dataSrc, load.pCoreSubmesh, load.itemId, faceCount)) return false;
+
+      load.itemId += faceCount;
+      if(load.itemId == load.itemCount) load.phase = IncrementalLoad::PHASE_SUBMESH_END;
+      return true;
+    }
+
+  case IncrementalLoad::PHASE_SUBMESH_END:
+    {
+      if(!finishCoreSubmesh(load.pCoreSubmesh)) return false;
+
+      model->m_vectorCoreSubmesh.push_back(load.pCoreSubmesh);
+      load.pCoreSubmesh = 0;
+      ++load.id;
+      load.phase = IncrementalLoad::PHASE_SUBMESH;
+      return true;
+    }
+
+  case IncrementalLoad::PHASE_TRACK:
+    {
+      if(load.id >= load.count)
+      {
+        load.phase = IncrementalLoad::PHASE_DONE;
+        return true;
+      }
+
+      load.pCoreTrack = loadCoreTrackHeader(dataSrc, &anim->m_arena, load.itemCount);
+      if(load.pCoreTrack == 0) return false;
+
+      load.itemId = 0;
+      load.phase = IncrementalLoad::PHASE_KEYFRAMES;
+      return true;
+    }
+
+  case IncrementalLoad::PHASE_KEYFRAMES:
+    {
+      CalCoreKeyframe *pCoreKeyframe = loadCoreKeyframe(dataSrc, &anim->m_arena);
+      if(pCoreKeyframe == 0) return false;
+
+      load.pCoreTrack->addCoreKeyframe(pCoreKeyframe);
+
+      ++load.itemId;
+      if(load.itemId == load.itemCount)
+      {
+        anim->addCoreTrack(load.pCoreTrack);
+        load.pCoreTrack = 0;
+        ++load.id;
+        load.phase = IncrementalLoad::PHASE_TRACK;
+      }
+      return true;
+    }
+
+  default:
+    return true;
+  }
+}
+
+ /*****************************************************************************/
+/** Loads a baked core animation.
+  *
+  * This function loads a core animation instance from the body of a baked
+  * file, whose magic tag has already been read. See calbaked.h for the layout.
+  *
+  * @param anim The core animation instance to load into.
+  * @param dataSrc The data source to load the core animation from.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLoader::loadBakedCoreAnimation(CalCoreAnimation *anim, CalDataSource& dataSrc)
+{
+  std::vector<char> vectorBody;
+  std::vector<CalBaked::Section> vectorSection;
+  const char *pBody = readBakedBody(dataSrc, CalBaked::CONTENT_ANIMATION, vectorBody, vectorSection);
+  if(pBody == 0) { anim->destroy(); return false; }
+
+  // find the sections of the animation
+  const CalBaked::Section *pAnimationSection = 0;
+  const CalBaked::Section *pTrackSection = 0;
+  const CalBaked::Section *pKeyframeSection = 0;
+  const CalBaked::Section *pStringSection = 0;
+  std::vector<CalBaked::Section>::iterator iteratorSection;
+  for(iteratorSection = vectorSection.begin(); iteratorSection != vectorSection.end(); ++iteratorSection)
+  {
+    if(iteratorSection->type == CalBaked::SECTION_ANIMATION) pAnimationSection = &(*iteratorSection);
+    else if(iteratorSection->type == CalBaked::SECTION_TRACK) pTrackSection = &(*iteratorSection);
+    else if(iteratorSection->type == CalBaked::SECTION_KEYFRAME) pKeyframeSection = &(*iteratorSection);
+    else if(iteratorSection->type == CalBaked::SECTION_STRING) pStringSection = &(*iteratorSection);
+  }
+
+  if((pAnimationSection == 0) || (pAnimationSection->count < 1) || (pTrackSection == 0) || (pTrackSection->count < 1) || (pKeyframeSection == 0))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    anim->destroy(); return false;
+  }
+
+  // check for a valid duration
+  CalBaked::Animation animation;
+  memcpy(&animation, pBody + pAnimationSection->offset, sizeof(animation));
+  if(animation.duration <= 0.0f)
+  {
+    CalError::setLastError(CalError::INVALID_ANIMATION_DURATION, __FILE__, __LINE__);
+    anim->destroy(); return false;
+  }
+
+  // set the duration in the core animation instance
+  anim->setDuration(animation.duration);
+
+  // place all core tracks and core keyframes next to each other
+  CalArena *pArena = &anim->m_arena;
+  pArena->reserve(pTrackSection->count * sizeof(CalCoreTrack) + pKeyframeSection->count * sizeof(CalCoreKeyframe));
+
+  // load all core tracks
+  unsigned int trackId;
+  for(trackId = 0; trackId < pTrackSection->count; trackId++)
+  {
+    CalBaked::Track track;
+    memcpy(&track, pBody + pTrackSection->offset + trackId * sizeof(track), sizeof(track));
+
+    int nameId;
+    if(!getBakedNameId(pBody, pStringSection, track.nameOffset, nameId) || (track.firstKeyframe < 0) || (track.keyframeCount <= 0)
+      || ((unsigned int)track.firstKeyframe > pKeyframeSection->count) || ((unsigned int)track.keyframeCount > pKeyframeSection->count - track.firstKeyframe))
+    {
+      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+      anim->destroy(); return false;
+    }
+
+    // allocate a new core track instance
+    CalCoreTrack *pCoreTrack;
+    pCoreTrack = CalArena::construct<CalCoreTrack>(pArena);
+    if(pCoreTrack == 0)
+    {
+      CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
+      anim->destroy(); return false;
+    }
+
+    // create the core track instance
+    if(!pCoreTrack->create())
+    {
+      CalArena::release(pArena, pCoreTrack);
+      anim->destroy(); return false;
+    }
+
+    // link the core track to the appropriate core bone
+    pCoreTrack->setCoreBoneNameId(nameId);
+    pCoreTrack->setKeyframeArena(pArena);
+
+    // load all core keyframes of the track
+    const char *pKeyframe = pBody + pKeyframeSection->offset + track.firstKeyframe * sizeof(CalBaked::Keyframe);
+    int keyframeId;
+    for(keyframeId = 0; keyframeId < track.keyframeCount; keyframeId++, pKeyframe += sizeof(CalBaked::Keyframe))
+    {
+      CalBaked::Keyframe keyframe;
+      memcpy(&keyframe, pKeyframe, sizeof(keyframe));
+
+      // allocate a new core keyframe instance
+      CalCoreKeyframe *pCoreKeyframe;
+      pCoreKeyframe = CalArena::construct<CalCoreKeyframe>(pArena);
+      if((pCoreKeyframe == 0) || !pCoreKeyframe->create())
+      {
+        CalArena::release(pArena, pCoreKeyframe);
+        pCoreTrack->destroy();
+        CalArena::release(pArena, pCoreTrack);
+        CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__, "CalLoader::loadBakedCoreAnimation");
+        anim->destroy(); return false;
+      }
+
+      // set all attributes of the keyframe
+      pCoreKeyframe->setTime(keyframe.time);
+      pCoreKeyframe->setOrientation(CalVector(keyframe.translation[0], keyframe.translation[1], keyframe.translation[2]));
+      pCoreKeyframe->setRotation(CalQuaternion(keyframe.rotation[0], keyframe.rotation[1], keyframe.rotation[2], keyframe.rotation[3]));
+
+      // add the core keyframe to the core track instance
+      pCoreTrack->addCoreKeyframe(pCoreKeyframe);
+    }
+
+    anim->addCoreTrack(pCoreTrack);
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Loads a baked core model.
+  *
+  * This function loads a core model instance from the body of a baked file,
+  * whose magic tag has already been read. See calbaked.h for the layout.
+  *
+  * @param model The core model instance to load into.
+  * @param dataSrc The data source to load the core model from.
+  * @param flags The loading mode flags, see setLoadingMode().
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLoader::loadBakedCoreModel(CalCoreModel *model, CalDataSource& dataSrc, int flags)
+{
+  std::vector<char> vectorBody;
+  std::vector<CalBaked::Section> vectorSection;
+  const char *pBody = readBakedBody(dataSrc, CalBaked::CONTENT_MODEL, vectorBody, vectorSection);
+  if(pBody == 0) { model->destroy(); return false; }
+
+  // sort the sections by the submesh they belong to
+  const CalBaked::Section *pStringSection = 0;
+  const CalBaked::Section *pBoneSection = 0;
+  const CalBaked::Section *pChildSection = 0;
+  const CalBaked::Section *pSubmeshSection = 0;
+  std::vector<std::vector<const CalBaked::Section *> > vectorvectorSubmeshSection;
+  std::vector<CalBaked::Section>::iterator iteratorSection;
+  for(iteratorSection = vectorSection.begin(); iteratorSection != vectorSection.end(); ++iteratorSection)
+  {
+    if(iteratorSection->owner >= 0)
+    {
+      if(iteratorSection->owner >= (int)vectorvectorSubmeshSection.size()) vectorvectorSubmeshSection.resize(iteratorSection->owner + 1);
+      vectorvectorSubmeshSection[iteratorSection->owner].push_back(&(*iteratorSection));
+    }
+    else if(iteratorSection->type == CalBaked::SECTION_STRING) pStringSection = &(*iteratorSection);
+    else if(iteratorSection->type == CalBaked::SECTION_BONE) pBoneSection = &(*iteratorSection);
+    else if(iteratorSection->type == CalBaked::SECTION_BONE_CHILD) pChildSection = &(*iteratorSection);
+    else if(iteratorSection->type == CalBaked::SECTION_SUBMESH) pSubmeshSection = &(*iteratorSection);
+  }
+
+  if((pBoneSection == 0) || (pBoneSection->count == 0))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    model->destroy(); return false;
+  }
+
+  // place all core bones and core submeshes next to each other
+  unsigned int submeshCount = (pSubmeshSection != 0) ? pSubmeshSection->count : 0;
+  if(flags & LOADER_SKELETON_ONLY) submeshCount = 0;
+  CalArena *pArena = &model->m_arena;
+  pArena->reserve(pBoneSection->count * sizeof(CalCoreBone) + submeshCount * sizeof(CalCoreSubmesh));
+
+  // load all core bones
+  unsigned int boneId;
+  for(boneId = 0; boneId < pBoneSection->count; boneId++)
+  {
+    CalBaked::Bone bone;
+    memcpy(&bone, pBody + pBoneSection->offset + boneId * sizeof(bone), sizeof(bone));
+
+    unsigned int childCount = (pChildSection != 0) ? pChildSection->count : 0;
+    int nameId;
+    if(!getBakedNameId(pBody, pStringSection, bone.nameOffset, nameId) || (bone.firstChild < 0) || (bone.childCount < 0)
+      || ((unsigned int)bone.firstChild > childCount) || ((unsigned int)bone.childCount > childCount - bone.firstChild))
+    {
+      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+      model->destroy(); return false;
+    }
+
+    CalQuaternion rot(bone.rotation[0], bone.rotation[1], bone.rotation[2], bone.rotation[3]);
+    CalVector trans(bone.translation[0], bone.translation[1], bone.translation[2]);
+
+    if (flags & LOADER_ROTATE_X_AXIS)
+    {
+      if (bone.parentId == -1) // only root bone necessary
+      {
+        // Root bone must have quaternion rotated
+        float temp = (float)sqrt(2.0f)/2.0f;
+        CalQuaternion x_axis_90(temp,0.0f,0.0f,temp);
+        rot *= x_axis_90;
+        // Root bone must have translation rotated also
+        trans.set(bone.translation[0], bone.translation[2], bone.translation[1]);
+      }
+    }
+
+    // allocate a new core bone instance
+    CalCoreBone *pCoreBone;
+    pCoreBone = CalArena::construct<CalCoreBone>(pArena);
+    if(pCoreBone == 0)
+    {
+      CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__, "CalLoader::loadBakedCoreModel");
+      model->destroy(); return false;
+    }
+
+    // create the core bone instance
+    if(!pCoreBone->create(nameId))
+    {
+      CalArena::release(pArena, pCoreBone);
+      model->destroy(); return false;
+    }
+
+    // set all attributes of the bone
+    pCoreBone->setParentId(bone.parentId);
+    pCoreBone->setLength(bone.length);
+    pCoreBone->setTranslation(trans);
+    pCoreBone->setRotation(rot);
+    pCoreBone->setTranslationBoneSpace(CalVector(bone.translationBoneSpace[0], bone.translationBoneSpace[1], bone.translationBoneSpace[2]));
+    pCoreBone->setRotationBoneSpace(CalQuaternion(bone.rotationBoneSpace[0], bone.rotationBoneSpace[1], bone.rotationBoneSpace[2], bone.rotationBoneSpace[3]));
+
+    // add all children ids
+    int childId;
+    for(childId = 0; childId < bone.childCount; childId++)
+    {
+      int id;
+      memcpy(&id, pBody + pChildSection->offset + (bone.firstChild + childId) * sizeof(int), sizeof(int));
+      pCoreBone->addChildId(id);
+    }
+
+    // set the core skeleton of the core bone instance
+    pCoreBone->setCoreModel(model);
+
+    // add the core bone to the core skeleton instance
+    model->m_vectorCoreBone.push_back(pCoreBone);
+  }
+
+  // load all core submeshes
+  unsigned int submeshId;
+  for(submeshId = 0; submeshId < submeshCount; submeshId++)
+  {
+    CalBaked::Submesh submesh;
+    memcpy(&submesh, pBody + pSubmeshSection->offset + submeshId * sizeof(submesh), sizeof(submesh));
+
+    static const std::vector<const CalBaked::Section *> vectorNoSection;
+    const std::vector<const CalBaked::Section *>& vectorSubmeshSection = (submeshId < vectorvectorSubmeshSection.size()) ? vectorvectorSubmeshSection[submeshId] : vectorNoSection;
+
+    // load the core submesh
+    CalCoreSubmesh *pCoreSubmesh;
+    pCoreSubmesh = loadBakedCoreSubmesh(pBody, vectorSubmeshSection, submesh, pArena);
+    if(pCoreSubmesh == 0) { model->destroy(); return false; }
+
+    // add the core submesh to the core mesh instance
+    model->m_vectorCoreSubmesh.push_back(pCoreSubmesh);
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Loads a baked core submesh.
+  *
+  * This function creates a core submesh instance from the sections of a baked
+  * file. The arrays are copied in one block each. Precomputed tables that are
+  * missing or don't fit the submesh are built again.
+  *
+  * @param pBody The body of the baked file.
+  * @param vectorSection The sections that belong to the submesh.
+  * @param submesh The submesh record of the baked file.
+  * @param pArena The arena to place the core submesh in, or 0 for the heap.
+  *
+  * @return One of the following values:
+  *         \li a pointer to the core submesh
+  *         \li \b 0 if an error happend
+  *****************************************************************************/
+
+CalCoreSubmesh *CalLoader::loadBakedCoreSubmesh(const char *pBody, const std::vector<const CalBaked::Section *>& vectorSection, const CalBaked::Submesh& submesh, CalArena *pArena)
+{
+  if((submesh.vertexCount < 0) || (submesh.faceCount < 0) || (submesh.lodCount < 0) || (submesh.springCount < 0) || (submesh.textureCoordinateCount < 0))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return 0;
+  }
+
+  size_t vertexCount = submesh.vertexCount;
+  size_t springCount = submesh.springCount;
+
+  // allocate a new core submesh instance
+  CalCoreSubmesh *pCoreSubmesh;
+  pCoreSubmesh = CalArena::construct<CalCoreSubmesh>(pArena);
+  if(pCoreSubmesh == 0)
+  {
+    CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__, "CalLoader::loadBakedCoreSubmesh");
+    return 0;
+  }
+
+  // create the core submesh instance
+  if(!pCoreSubmesh->create())
+  {
+    CalArena::release(pArena, pCoreSubmesh);
+    return 0;
+  }
+
+  pCoreSubmesh->setLodCount(submesh.lodCount);
+  pCoreSubmesh->setCoreMaterialThreadId(submesh.coreMaterialThreadId);
+
+  // reserve memory for all the submesh data
+  if(!pCoreSubmesh->reserve(submesh.vertexCount, submesh.textureCoordinateCount, submesh.faceCount, submesh.springCount))
+  {
+    CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
+    pCoreSubmesh->destroy();
+    CalArena::release(pArena, pCoreSubmesh);
+    return 0;
+  }
+
+  bool bValid = true;
+
+  // load all vertices; the core vertex derives from the user data and is not
+  // copied as a block, even where its size matches the file
+  const CalBaked::Section *pSection = findBakedSection(vectorSection, CalBaked::SECTION_VERTEX);
+  if(vertexCount > 0)
+  {
+    if((pSection == 0) || (pSection->count != vertexCount))
+    {
+      bValid = false;
+    }
+    else
+    {
+      const char *pData = pBody + pSection->offset;
+      size_t vertexId;
+      for(vertexId = 0; vertexId < vertexCount; vertexId++, pData += sizeof(CalBaked::Vertex))
+      {
+        CalBaked::Vertex vertex;
+        memcpy(&vertex, pData, sizeof(vertex));
+        pCoreSubmesh->m_vectorVertex[vertexId].position.set(vertex.position[0], vertex.position[1], vertex.position[2]);
+        pCoreSubmesh->m_vectorVertex[vertexId].nx = vertex.nx;
+        pCoreSubmesh->m_vectorVertex[vertexId].ny = vertex.ny;
+        pCoreSubmesh->m_vectorVertex[vertexId].nz = vertex.nz;
+        pCoreSubmesh->m_vectorVertex[vertexId].influenceCount = vertex.influenceCount;
+      }
+    }
+  }
+
+  // load the LOD control information
+  pSection = findBakedSection(vectorSection, CalBaked::SECTION_LOD_CONTROL);
+  if(bValid && (vertexCount > 0))
+  {
+    if((pSection == 0) || (pSection->count != vertexCount))
+    {
+      bValid = false;
+    }
+    else
+    {
+      const char *pData = pBody + pSection->offset;
+      size_t vertexId;
+      for(vertexId = 0; vertexId < vertexCount; vertexId++, pData += sizeof(CalBaked::LodControl))
+      {
+        CalBaked::LodControl lodControl;
+        memcpy(&lodControl, pData, sizeof(lodControl));
+        pCoreSubmesh->m_vectorLodControl[vertexId].faceCollapseCount = lodControl.faceCollapseCount;
+        pCoreSubmesh->m_vectorLodControl[vertexId].collapseId = lodControl.collapseId;
+      }
+    }
+  }
+
+  // the influences must match the influence counts of the vertices
+  size_t influenceCount = 0;
+  size_t vertexId;
+  for(vertexId = 0; bValid && (vertexId < vertexCount); vertexId++)
+  {
+    if(pCoreSubmesh->m_vectorVertex[vertexId].influenceCount < 0) bValid = false;
+    influenceCount += pCoreSubmesh->m_vectorVertex[vertexId].influenceCount;
+  }
+
+  bValid = bValid && copyBakedSection(pBody, findBakedSection(vectorSection, CalBaked::SECTION_INFLUENCE), influenceCount, pCoreSubmesh->m_vectorInfluence);
+  if(springCount > 0)
+  {
+    bValid = bValid && copyBakedSection(pBody, findBakedSection(vectorSection, CalBaked::SECTION_PHYSICAL_PROPERTY), vertexCount, pCoreSubmesh->m_vectorPhysicalProperty);
+  }
+  bValid = bValid && copyBakedSection(pBody, findBakedSection(vectorSection, CalBaked::SECTION_SPRING), springCount, pCoreSubmesh->m_vectorSpring);
+  bValid = bValid && copyBakedSection(pBody, findBakedSection(vectorSection, CalBaked::SECTION_FACE), submesh.faceCount, pCoreSubmesh->m_vectorFace);
+
+  // load the texture coordinates and tangent spaces of all maps
+  int textureCoordinateId;
+  for(textureCoordinateId = 0; bValid && (textureCoordinateId < submesh.textureCoordinateCount); textureCoordinateId++)
+  {
+    bValid = copyBakedSection(pBody, findBakedSection(vectorSection, CalBaked::SECTION_TEXTURE_COORDINATE, textureCoordinateId), vertexCount, pCoreSubmesh->m_vectorvectorTextureCoordinate[textureCoordinateId]);
+
+    pSection = findBakedSection(vectorSection, CalBaked::SECTION_TANGENT_SPACE, textureCoordinateId);
+    if(bValid && (pSection != 0))
+    {
+      pCoreSubmesh->enableTangents(textureCoordinateId, true);
+      bValid = copyBakedSection(pBody, pSection, vertexCount, pCoreSubmesh->m_vectorvectorTangentSpace[textureCoordinateId]);
+    }
+  }
+
+  if(!bValid)
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    pCoreSubmesh->destroy();
+    CalArena::release(pArena, pCoreSubmesh);
+    return 0;
+  }
+
+  // take over the LOD steps if they fit the faces, otherwise build them
+  pSection = findBakedSection(vectorSection, CalBaked::SECTION_LOD_FACE);
+  bool bLodSteps = (pSection != 0) && copyBakedSection(pBody, pSection, pSection->count, pCoreSubmesh->m_vectorLodFace);
+  pSection = findBakedSection(vectorSection, CalBaked::SECTION_LOD_STEP);
+  if(bLodSteps && (pSection != 0) && (pSection->count > 0))
+  {
+    const char *pData = pBody + pSection->offset;
+    unsigned int lodStepId;
+    for(lodStepId = 0; bLodSteps && (lodStepId < pSection->count); lodStepId++, pData += sizeof(CalBaked::LodStep))
+    {
+      CalBaked::LodStep lodStep;
+      memcpy(&lodStep, pData, sizeof(lodStep));
+
+      bLodSteps = (lodStep.vertexCount >= 0) && ((size_t)lodStep.vertexCount <= vertexCount)
+               && (lodStep.faceCount >= 0) && (lodStep.firstFace >= 0)
+               && ((size_t)lodStep.firstFace + lodStep.faceCount <= pCoreSubmesh->m_vectorLodFace.size());
+
+      CalCoreSubmesh::LodStep step;
+      step.vertexCount = lodStep.vertexCount;
+      step.faceCount = lodStep.faceCount;
+      step.firstFace = lodStep.firstFace;
+      pCoreSubmesh->m_vectorLodStep.push_back(step);
+    }
+  }
+  else
+  {
+    bLodSteps = false;
+  }
+
+  if(!bLodSteps)
+  {
+    pCoreSubmesh->m_vectorLodStep.clear();
+    pCoreSubmesh->m_vectorLodFace.clear();
+    if(!pCoreSubmesh->buildLodSteps(CalCoreSubmesh::DEFAULT_LOD_STEP_COUNT))
+    {
+      pCoreSubmesh->destroy();
+      CalArena::release(pArena, pCoreSubmesh);
+      return 0;
+    }
+  }
+
+  // take over the influence sets if they fit the vertices, otherwise analyze them
+  bool bInfluenceSets = (vertexCount > 0)
+    && copyBakedSection(pBody, findBakedSection(vectorSection, CalBaked::SECTION_VERTEX_INFLUENCE_SET), vertexCount, pCoreSubmesh->m_vectorVertexInfluenceSet)
+    && copyBakedSection(pBody, findBakedSection(vectorSection, CalBaked::SECTION_SEAM_VERTEX), vertexCount, pCoreSubmesh->m_vectorSeamVertex);
+  pSection = findBakedSection(vectorSection, CalBaked::SECTION_INFLUENCE_SET);
+  bInfluenceSets = bInfluenceSets && (pSection != 0)
+    && copyBakedSection(pBody, pSection, pSection->count, pCoreSubmesh->m_vectorInfluenceSet);
+
+  int maxInfluenceCount = 0;
+  for(vertexId = 0; bInfluenceSets && (vertexId < vertexCount); vertexId++)
+  {
+    const CalCoreSubmesh::Vertex& vertex = pCoreSubmesh->m_vectorVertex[vertexId];
+    if(vertex.influenceCount > maxInfluenceCount) maxInfluenceCount = vertex.influenceCount;
+
+    int influenceSetId = pCoreSubmesh->m_vectorVertexInfluenceSet[vertexId];
+    int seamVertexId = pCoreSubmesh->m_vectorSeamVertex[vertexId];
+    bInfluenceSets = (influenceSetId >= 0) && ((size_t)influenceSetId < pCoreSubmesh->m_vectorInfluenceSet.size())
+                  && (seamVertexId >= 0) && ((size_t)seamVertexId < vertexCount);
+  }
+
+  std::vector<CalCoreSubmesh::InfluenceSet>::iterator iteratorInfluenceSet;
+  for(iteratorInfluenceSet = pCoreSubmesh->m_vectorInfluenceSet.begin(); bInfluenceSets && (iteratorInfluenceSet != pCoreSubmesh->m_vectorInfluenceSet.end()); ++iteratorInfluenceSet)
+  {
+    bInfluenceSets = (iteratorInfluenceSet->firstInfluence >= 0) && (iteratorInfluenceSet->influenceCount >= 0)
+                  && ((size_t)iteratorInfluenceSet->firstInfluence + iteratorInfluenceSet->influenceCount <= influenceCount);
+  }
+
+  if(bInfluenceSets)
+  {
+    pCoreSubmesh->m_maxInfluenceCount = maxInfluenceCount;
+  }
+  else
+  {
+    pCoreSubmesh->analyzeInfluences();
+  }
+
+  // take over the spring batches if they fit the springs, otherwise build them
+  if(springCount > 0)
+  {
+    bool bSpringBatches = copyBakedSection(pBody, findBakedSection(vectorSection, CalBaked::SECTION_SPRING_FACTOR), 2 * springCount, pCoreSubmesh->m_vectorSpringFactor);
+    pSection = findBakedSection(vectorSection, CalBaked::SECTION_SPRING_BATCH);
+    bSpringBatches = bSpringBatches && (pSection != 0) && (pSection->count > 0)
+      && copyBakedSection(pBody, pSection, pSection->count, pCoreSubmesh->m_vectorSpringBatch);
+
+    // the batches must cover all springs in order
+    int nextSpring = 0;
+    std::vector<CalCoreSubmesh::SpringBatch>::iterator iteratorSpringBatch;
+    for(iteratorSpringBatch = pCoreSubmesh->m_vectorSpringBatch.begin(); bSpringBatches && (iteratorSpringBatch != pCoreSubmesh->m_vectorSpringBatch.end()); ++iteratorSpringBatch)
+    {
+      bSpringBatches = (iteratorSpringBatch->firstSpring == nextSpring) && (iteratorSpringBatch->springCount >= 0);
+      nextSpring += iteratorSpringBatch->springCount;
+    }
+
+    if(!bSpringBatches || ((size_t)nextSpring != springCount))
+    {
+      pCoreSubmesh->m_vectorSpringBatch.clear();
+      pCoreSubmesh->m_vectorSpringFactor.clear();
+      if(!pCoreSubmesh->buildSpringBatches())
+      {
+        pCoreSubmesh->destroy();
+        CalArena::release(pArena, pCoreSubmesh);
+        return 0;
+      }
+    }
+  }
+
+  return pCoreSubmesh;
+}
+
+ /*****************************************************************************/
+/** Reads the body of a baked file.
+  *
+  * This function reads the header of a baked file behind its magic tag and
+  * checks it. The body is taken in place from data sources that support it
+  * and read into a buffer from all others.
+  *
+  * @param dataSrc The data source to read from.
+  * @param contentType The content type the file must have.
+  * @param vectorBody The buffer the body is read into if needed.
+  * @param vectorSection The vector the checked section table is written to.
+  *
+  * @return One of the following values:
+  *         \li the address of the body
+  *         \li \b 0 if an error happend
+  *****************************************************************************/
+
+const char *CalLoader::readBakedBody(CalDataSource& dataSrc, int contentType, std::vector<char>& vectorBody, std::vector<CalBaked::Section>& vectorSection)
+{
+  // the magic tag has been read already
+  CalBaked::Header header;
+  if(!dataSrc.readBytes(&header.version, sizeof(header) - sizeof(header.magic)))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return 0;
+  }
+
+  // baked files only load on machines with the byte order they were written with
+  if((header.version != Cal::BAKED_FILE_VERSION) || (header.byteOrder != CalBaked::BYTE_ORDER_TAG))
+  {
+    CalError::setLastError(CalError::INCOMPATIBLE_FILE_VERSION, __FILE__, __LINE__);
+    return 0;
+  }
+
+  if((header.contentType != contentType) || (header.sectionCount < 0) || (header.bodySize > 0x7fffffff)
+    || ((size_t)header.sectionCount * sizeof(CalBaked::Section) > header.bodySize))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return 0;
+  }
+
+  // take the body in place if the data source can hand it out
+  const char *pBody = dataSrc.mapBytes(header.bodySize);
+  if(pBody == 0)
+  {
+    vectorBody.resize(header.bodySize + 1);
+    if(!dataSrc.ok() || !dataSrc.readBytes(&vectorBody[0], header.bodySize))
+    {
+      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+      return 0;
+    }
+    pBody = &vectorBody[0];
+  }
+
+  // check that all known sections lie inside the body
+  vectorSection.resize(header.sectionCount);
+  int sectionId;
+  for(sectionId = 0; sectionId < header.sectionCount; sectionId++)
+  {
+    CalBaked::Section& section = vectorSection[sectionId];
+    memcpy(&section, pBody + sectionId * sizeof(CalBaked::Section), sizeof(section));
+
+    unsigned int elementSize = CalBaked::getElementSize(section.type);
+    if((elementSize > 0) && ((section.offset > header.bodySize) || (section.count > (header.bodySize - section.offset) / elementSize)))
+    {
+      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+      return 0;
+    }
+  }
+
+  return pBody;
+}
+
+ /*****************************************************************************/
+/** Loads an encoded core animation.
+  *
+  * This function loads a core animation instance from the body of an encoded
+  * file, whose magic tag has already been read. See calencoder.h for the
+  * layout.
+  *
+  * @param anim The core animation instance to load into.
+  * @param dataSrc The data source to load the core animation from.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLoader::loadEncodedCoreAnimation(CalCoreAnimation *anim, CalDataSource& dataSrc)
+{
+  std::vector<char> vectorBody;
+  int length;
+  const char *pBody = readEncodedBody(dataSrc, vectorBody, length);
+  if(pBody == 0) { anim->destroy(); return false; }
+
+  // the decoded streams hold a regular caf file
+  CalEncodedSource encodedSrc(pBody, length);
+  if(!encodedSrc.isDecoded())
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    anim->destroy(); return false;
+  }
+
+  return loadCoreAnimationFrom(anim, encodedSrc);
+}
+
+ /*****************************************************************************/
+/** Loads an encoded core model.
+  *
+  * This function loads a core model instance from the body of an encoded
+  * file, whose magic tag has already been read.
+  *
+  * @param model The core model instance to load into.
+  * @param dataSrc The data source to load the core model from.
+  * @param flags The loading mode flags, see setLoadingMode().
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLoader::loadEncodedCoreModel(CalCoreModel *model, CalDataSource& dataSrc, int flags)
+{
+  std::vector<char> vectorBody;
+  int length;
+  const char *pBody = readEncodedBody(dataSrc, vectorBody, length);
+  if(pBody == 0) { model->destroy(); return false; }
+
+  // the decoded streams hold a regular cdf file
+  CalEncodedSource encodedSrc(pBody, length);
+  if(!encodedSrc.isDecoded())
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    model->destroy(); return false;
+  }
+
+  return loadCoreModelFrom(model, encodedSrc, flags);
+}
+
+ /*****************************************************************************/
+/** Reads the body of an encoded file.
+  *
+  * This function reads the version, the reader version and the body size of
+  * an encoded file behind its magic tag. Files split by the loader of another
+  * library version are rejected, as their streams may not follow our reads.
+  * The body is taken in place from data sources that support it and read
+  * into a buffer from all others.
+  *
+  * @param dataSrc The data source to read from.
+  * @param vectorBody The buffer the body is read into if needed.
+  * @param length Receives the size of the body.
+  *
+  * @return One of the following values:
+  *         \li the address of the body
+  *         \li \b 0 if an error happend
+  *****************************************************************************/
+
+const char *CalLoader::readEncodedBody(CalDataSource& dataSrc, std::vector<char>& vectorBody, int& length)
+{
+  // the magic tag has been read already
+  int version;
+  if(!dataSrc.readInteger(version) || (version != Cal::ENCODED_FILE_VERSION))
+  {
+    CalError::setLastError(CalError::INCOMPATIBLE_FILE_VERSION, __FILE__, __LINE__);
+    return 0;
+  }
+
+  int readerVersion;
+  if(!dataSrc.readInteger(readerVersion) || (readerVersion != Cal::LIBRARY_VERSION))
+  {
+    CalError::setLastError(CalError::INCOMPATIBLE_FILE_VERSION, __FILE__, __LINE__);
+    return 0;
+  }
+
+  if(!dataSrc.readInteger(length) || (length < 0))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return 0;
+  }
+
+  // take the body in place if the data source can hand it out
+  const char *pBody = dataSrc.mapBytes(length);
+  if(pBody == 0)
+  {
+    vectorBody.resize(length + 1);
+    if(!dataSrc.ok() || !dataSrc.readBytes(&vectorBody[0], length))
+    {
+      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+      return 0;
+    }
+    pBody = &vectorBody[0];
+  }
+
+  return pBody;
+}
+
+ /*****************************************************************************/
+/** Loads a core animation.
   *****************************************************************************/
-void CalLoader::setLoadingMode(int flags)
+
+bool CalLoader::loadCoreAnimation(CalCoreAnimation *anim, const std::string& strFilename)
 {
-  loadingMode = flags;
+  // map the file
+  CalMappedFileSource fileSrc(strFilename);
+
+  //make sure it was opened properly
+  if(!fileSrc.isMapped())
+  {
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
+    anim->destroy(); return false;
+  }
+
+  if(getLoadingFlags() & LOADER_STREAM_TRACKS)
+  {
+    if(!loadLazyCoreAnimation(anim, fileSrc, strFilename)) return false;
+
+    // baked and encoded animations are loaded completely and can't stream
+    if(anim->isLazy()) anim->setChunkDuration(2.0f);
+    return true;
+  }
+
+  if(getLoadingFlags() & LOADER_LAZY_TRACKS) return loadLazyCoreAnimation(anim, fileSrc, strFilename);
+
+  return loadCoreAnimationFrom(anim, fileSrc);
 }
 
  /*****************************************************************************/
-/** Constructs the loader instance.
+/** Loads the headers of a core animation.
   *
-  * This function is the default constructor of the loader instance.
+  * This function loads the duration and the core tracks of a core animation,
+  * but only records where the keyframes of each core track are stored in the
+  * file. They are read by loadDeferredTracks() when the animation is first
+  * used. Baked animations are loaded completely.
+  *
+  * @param anim The core animation to load into.
+  * @param dataSrc The mapped file to load the core animation from.
+  * @param strFilename The name of the file.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
   *****************************************************************************/
 
-CalLoader::CalLoader()
+bool CalLoader::loadLazyCoreAnimation(CalCoreAnimation *anim, CalMappedFileSource& dataSrc, const std::string& strFilename)
 {
+  // check if this is a valid file
+  char magic[4];
+  if(!dataSrc.readBytes(&magic[0], 4))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strFilename);
+    anim->destroy(); return false;
+  }
+
+  // baked and encoded files load fast enough as a whole
+  if(memcmp(&magic[0], Cal::BAKED_FILE_MAGIC, 4) == 0) return loadBakedCoreAnimation(anim, dataSrc);
+  if(memcmp(&magic[0], Cal::ENCODED_FILE_MAGIC, 4) == 0) return loadEncodedCoreAnimation(anim, dataSrc);
+
+  if(memcmp(&magic[0], Cal::ANIMATION_FILE_MAGIC, 4) != 0)
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strFilename);
+    anim->destroy(); return false;
+  }
+
+  // check if the version is compatible with the library
+  int version;
+  if(!dataSrc.readInteger(version) || (version < Cal::EARLIEST_COMPATIBLE_FILE_VERSION) || (version > Cal::CURRENT_FILE_VERSION))
+  {
+    CalError::setLastError(CalError::INCOMPATIBLE_FILE_VERSION, __FILE__, __LINE__, strFilename);
+    anim->destroy(); return false;
+  }
+
+  // get the duration and the number of tracks of the core animation
+  float duration;
+  int trackCount;
+  if(!dataSrc.readFloat(duration) || !dataSrc.readInteger(trackCount) || (trackCount <= 0))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strFilename);
+    anim->destroy(); return false;
+  }
+
+  if(duration <= 0.0f)
+  {
+    CalError::setLastError(CalError::INVALID_ANIMATION_DURATION, __FILE__, __LINE__, strFilename);
+    anim->destroy(); return false;
+  }
+
+  anim->setDuration(duration);
+
+  // place all core tracks next to each other, their keyframes go to the
+  // arena of the deferred tracks once they are loaded
+  CalArena *pArena = &anim->m_arena;
+  pArena->reserve(trackCount * sizeof(CalCoreTrack));
+
+  // load the header of all core tracks and skip their keyframes
+  int trackId;
+  for(trackId = 0; trackId < trackCount; ++trackId)
+  {
+    int nameId = readNameId(dataSrc);
+    int keyframeCount;
+    if((nameId == -1) || !dataSrc.readInteger(keyframeCount) || (keyframeCount <= 0) || (keyframeCount > 0x3ffffff))
+    {
+      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strFilename);
+      anim->destroy(); return false;
+    }
+
+    // a keyframe is its time, translation and rotation
+    unsigned int offset = dataSrc.getOffset();
+    if(dataSrc.mapBytes(keyframeCount * 32) == 0)
+    {
+      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strFilename);
+      anim->destroy(); return false;
+    }
+
+    CalCoreTrack *pCoreTrack = CalArena::construct<CalCoreTrack>(pArena);
+    if(pCoreTrack == 0)
+    {
+      CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__, strFilename);
+      anim->destroy(); return false;
+    }
+
+    pCoreTrack->create();
+    pCoreTrack->setCoreBoneNameId(nameId);
+    pCoreTrack->setDeferredKeyframes(offset, keyframeCount);
+    anim->addCoreTrack(pCoreTrack);
+  }
+
+  anim->setDeferredFile(strFilename);
+
+  return true;
 }
 
  /*****************************************************************************/
-/** Destructs the loader instance.
+/** Loads the keyframes of a lazily loaded core animation.
+  *
+  * This function reads the keyframes of all core tracks of a core animation
+  * that was loaded with the LOADER_LAZY_TRACKS flag. If any of them can't be
+  * read, none are kept. Use CalCoreAnimation::loadTracks() rather than this.
   *
-  * This function is the destructor of the loader instance.
+  * @param anim The core animation to load the keyframes of.
+  * @param strFilename The name of the file the core animation was loaded from.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
   *****************************************************************************/
 
-CalLoader::~CalLoader()
+bool CalLoader::loadDeferredTracks(CalCoreAnimation *anim, const std::string& strFilename)
 {
+  CalMappedFileSource fileSrc(strFilename);
+  if(!fileSrc.isMapped())
+  {
+    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
+    return false;
+  }
+
+  std::list<CalCoreTrack *>& listCoreTrack = anim->getListCoreTrack();
+
+  // place all core keyframes next to each other
+  CalArena *pArena = anim->getKeyframeArena();
+  size_t keyframeCount = 0;
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    if((*iteratorCoreTrack)->getMapCoreKeyframe().empty()) keyframeCount += (*iteratorCoreTrack)->getDeferredKeyframeCount();
+  }
+  pArena->reserve(keyframeCount * sizeof(CalCoreKeyframe));
+
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  {
+    CalCoreTrack *pCoreTrack = *iteratorCoreTrack;
+    if(!pCoreTrack->getMapCoreKeyframe().empty()) continue;
+
+    pCoreTrack->setKeyframeArena(pArena);
+    bool bSuccess = fileSrc.seek(pCoreTrack->getDeferredOffset());
+
+    int keyframeId;
+    for(keyframeId = 0; bSuccess && (keyframeId < pCoreTrack->getDeferredKeyframeCount()); ++keyframeId)
+    {
+      CalCoreKeyframe *pCoreKeyframe = loadCoreKeyframe(fileSrc, pArena);
+      if(pCoreKeyframe == 0) bSuccess = false;
+      else pCoreTrack->addCoreKeyframe(pCoreKeyframe);
+    }
+
+    if(!bSuccess)
+    {
+      // the file changed since the headers were loaded
+      for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+      {
+        (*iteratorCoreTrack)->destroy();
+      }
+      pArena->clear();
+
+      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__, strFilename);
+      return false;
+    }
+  }
+
+  return true;
 }
 
  /*****************************************************************************/
-/** Loads a core animation.
+/** Loads the keyframes of a streamed core animation for a span of time.
+  *
+  * This function reads the keyframes each core track of a core animation that
+  * was loaded with the LOADER_STREAM_TRACKS flag needs to be sampled in a span
+  * of time: those in the span and one on each side of it. Where a core track
+  * wraps around, its first or last keyframe is added as well, so sampling gives
+  * the same result as with all keyframes in memory. The keyframes go to maps
+  * of their own instead of the core tracks, so this can run on another thread
+  * while the core animation is sampled. If any of them can't be read, none
+  * are kept. Use CalCoreAnimation::acquireChunk() rather than this.
+  *
+  * @param anim The core animation to load the keyframes of.
+  * @param fileSrc The file the core animation was loaded from.
+  * @param startTime The start of the span in seconds.
+  * @param endTime The end of the span in seconds.
+  * @param pArena The arena to place the core keyframes in.
+  * @param vectorMapCoreKeyframe The maps to fill, one for each core track.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
   *****************************************************************************/
 
-bool CalLoader::loadCoreAnimation(CalCoreAnimation *anim, const std::string& strFilename)
+bool CalLoader::loadStreamedKeyframes(CalCoreAnimation *anim, CalMappedFileSource& fileSrc, float startTime, float endTime, CalArena *pArena, std::vector<std::map<float, CalCoreKeyframe *> >& vectorMapCoreKeyframe)
 {
-  // open the file
-  std::ifstream file;
-  file.open(strFilename.c_str(), std::ios::in | std::ios::binary);
-
-  //make sure it was opened properly
-  if(!file)
+  std::list<CalCoreTrack *>& listCoreTrack = anim->getListCoreTrack();
+  vectorMapCoreKeyframe.resize(listCoreTrack.size());
+
+  // find the runs of keyframes of all core tracks first, so the keyframes can
+  // be placed next to each other; a core track needs up to three runs
+  std::vector<int> vectorRun(listCoreTrack.size() * 6, 0);
+  size_t keyframeCount = 0;
+  bool bSuccess = true;
+
+  size_t trackId = 0;
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); bSuccess && (iteratorCoreTrack != listCoreTrack.end()); ++iteratorCoreTrack, ++trackId)
   {
-    CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
-    anim->destroy(); return false;
+    CalCoreTrack *pCoreTrack = *iteratorCoreTrack;
+    unsigned int offset = pCoreTrack->getDeferredOffset();
+    int trackKeyframeCount = pCoreTrack->getDeferredKeyframeCount();
+
+    // the last keyframe at or before the start and the first one after the
+    // end; of keyframes with the same time only the first one is kept, like
+    // when the track is loaded in full, so a run starts at the first of them
+    int firstId = findStreamedKeyframe(fileSrc, offset, trackKeyframeCount, startTime, false) - 1;
+    int lastId = findStreamedKeyframe(fileSrc, offset, trackKeyframeCount, endTime, false);
+    if((firstId < -1) || (lastId < 0))
+    {
+      bSuccess = false;
+      break;
+    }
+
+    // the span starts at the keyframe before it; before its first keyframe
+    // the track blends from its last one, which then makes a run of its own
+    int wrapId = (firstId >= 0) ? firstId : trackKeyframeCount - 1;
+    float time;
+    if(!fileSrc.seek(offset + wrapId * 32) || !fileSrc.readFloat(time) || ((wrapId = findStreamedKeyframe(fileSrc, offset, wrapId, time, true)) < 0))
+    {
+      bSuccess = false;
+      break;
+    }
+
+    int *pRun = &vectorRun[trackId * 6];
+    if(firstId >= 0)
+    {
+      pRun[0] = wrapId;
+    }
+    else
+    {
+      pRun[2] = wrapId;
+      pRun[3] = trackKeyframeCount;
+    }
+    pRun[1] = (lastId < trackKeyframeCount) ? lastId + 1 : trackKeyframeCount;
+
+    // after the last keyframe it blends to its first one
+    if(lastId == trackKeyframeCount)
+    {
+      pRun[4] = 0;
+      pRun[5] = 1;
+    }
+
+    keyframeCount += (pRun[1] - pRun[0]) + (pRun[3] - pRun[2]) + (pRun[5] - pRun[4]);
   }
 
-  //make a new stream data source and use it to load the animation
-  CalStreamSource streamSrc( file );
+  if(bSuccess) pArena->reserve(keyframeCount * sizeof(CalCoreKeyframe));
+
+  trackId = 0;
+  for(iteratorCoreTrack = listCoreTrack.begin(); bSuccess && (iteratorCoreTrack != listCoreTrack.end()); ++iteratorCoreTrack, ++trackId)
+  {
+    CalCoreTrack *pCoreTrack = *iteratorCoreTrack;
+    std::map<float, CalCoreKeyframe *>& mapCoreKeyframe = vectorMapCoreKeyframe[trackId];
+
+    const int *pRun = &vectorRun[trackId * 6];
+    int runId;
+    for(runId = 0; bSuccess && (runId < 3); ++runId)
+    {
+      if(pRun[runId * 2] == pRun[runId * 2 + 1]) continue;
+
+      bSuccess = fileSrc.seek(pCoreTrack->getDeferredOffset() + pRun[runId * 2] * 32);
+
+      int keyframeId;
+      for(keyframeId = pRun[runId * 2]; bSuccess && (keyframeId < pRun[runId * 2 + 1]); ++keyframeId)
+      {
+        CalCoreKeyframe *pCoreKeyframe = loadCoreKeyframe(fileSrc, pArena);
+        if(pCoreKeyframe == 0) bSuccess = false;
+        else if(!mapCoreKeyframe.insert(std::make_pair(pCoreKeyframe->getTime(), pCoreKeyframe)).second)
+        {
+          pCoreKeyframe->destroy();
+          CalArena::release(pArena, pCoreKeyframe);
+        }
+      }
+    }
+  }
 
-  bool coreanim = loadCoreAnimation(anim, streamSrc);
+  if(!bSuccess)
+  {
+    // the file changed since the headers were loaded
+    std::vector<std::map<float, CalCoreKeyframe *> >::iterator iteratorMap;
+    for(iteratorMap = vectorMapCoreKeyframe.begin(); iteratorMap != vectorMapCoreKeyframe.end(); ++iteratorMap)
+    {
+      std::map<float, CalCoreKeyframe *>::iterator iteratorCoreKeyframe;
+      for(iteratorCoreKeyframe = iteratorMap->begin(); iteratorCoreKeyframe != iteratorMap->end(); ++iteratorCoreKeyframe)
+      {
+        iteratorCoreKeyframe->second->destroy();
+        CalArena::release(pArena, iteratorCoreKeyframe->second);
+      }
+      iteratorMap->clear();
+    }
+    pArena->clear();
 
-  //close the file
-  file.close();
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return false;
+  }
 
-  return coreanim;
+  return true;
 }
 
  /*****************************************************************************/
@@ -123,17 +1951,47 @@ bool CalLoader::loadCoreAnimation(CalCoreAnimation *anim, std::istream& inputStr
 bool CalLoader::loadCoreAnimation(CalCoreAnimation *anim, void* inputBuffer, int len, const std::string& strFilename)
 {
   //Create a new buffer data source and pass it on
-  CalBufferSource bufferSrc(inputBuffer);
+  CalBufferSource bufferSrc(inputBuffer, len);
 
-  // std::istrstream file(data, len);
-  return loadCoreAnimation(anim, bufferSrc);
+  return loadCoreAnimationFrom(anim, bufferSrc);
 }
 
 bool CalLoader::loadCoreAnimation(CalCoreAnimation *anim, CalDataSource& dataSrc)
+{
+  return loadCoreAnimationFrom(anim, dataSrc);
+}
+
+ /*****************************************************************************/
+/** Loads a core animation from a data source.
+  *
+  * This function loads a core animation from a data source of a given type.
+  * The loader is instantiated for the concrete data sources it creates itself,
+  * so their readers are called without going through the vtable.
+  *
+  * @param anim The core animation to load into.
+  * @param dataSrc The data source to load the core animation from.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+template<class DataSource>
+bool CalLoader::loadCoreAnimationFrom(CalCoreAnimation *anim, DataSource& dataSrc)
 {
   // check if this is a valid file
   char magic[4];
-  if(!dataSrc.readBytes(&magic[0], 4) || (memcmp(&magic[0], Cal::ANIMATION_FILE_MAGIC, 4) != 0))
+  if(!dataSrc.readBytes(&magic[0], 4))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    anim->destroy(); return false;
+  }
+
+  // baked and encoded files are told apart by their magic tag
+  if(memcmp(&magic[0], Cal::BAKED_FILE_MAGIC, 4) == 0) return loadBakedCoreAnimation(anim, dataSrc);
+  if(memcmp(&magic[0], Cal::ENCODED_FILE_MAGIC, 4) == 0) return loadEncodedCoreAnimation(anim, dataSrc);
+
+  if(memcmp(&magic[0], Cal::ANIMATION_FILE_MAGIC, 4) != 0)
   {
     CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
     anim->destroy(); return false;
@@ -173,13 +2031,23 @@ bool CalLoader::loadCoreAnimation(CalCoreAnimation *anim, CalDataSource& dataSrc
     anim->destroy(); return false;
   }
   
-  // load all core bones
+  // place all core tracks and core keyframes next to each other, a keyframe
+  // takes 32 bytes in the file
+  CalArena *pArena = &anim->m_arena;
+  int remainingSize = dataSrc.getRemainingSize();
+  if(remainingSize > 0)
+  {
+    size_t coreTrackCount = std::min(trackCount, remainingSize / 40);
+    pArena->reserve(coreTrackCount * sizeof(CalCoreTrack) + (remainingSize / 32) * sizeof(CalCoreKeyframe));
+  }
+
+  // load all core tracks
   int trackId;
   for(trackId = 0; trackId < trackCount; ++trackId)
   {
     // load the core track
     CalCoreTrack *pCoreTrack;
-    pCoreTrack = loadCoreTrack(dataSrc);
+    pCoreTrack = loadCoreTrack(dataSrc, pArena);
     if(pCoreTrack == 0) { anim->destroy(); return false; }
     anim->addCoreTrack(pCoreTrack);
   }
@@ -187,6 +2055,76 @@ bool CalLoader::loadCoreAnimation(CalCoreAnimation *anim, CalDataSource& dataSrc
   return true;
 }
 
+ /*****************************************************************************/
+/** Loads a list of core animations in parallel.
+  *
+  * This function loads each core animation from its file, spreading the files
+  * over several threads. The core animations must have been created; the ones
+  * that fail to load are destroyed, as by loadCoreAnimation(). The first
+  * failure is also reported as the last error of the calling thread.
+  *
+  * @param vectorCoreAnimation The core animations to load into.
+  * @param vectorFilename The file of each core animation.
+  * @param vectorErrorCode Receives the error code of each core animation,
+  *                        CalError::OK for the ones that loaded.
+  * @param threadCount The number of threads to use, 0 for one per core.
+  *
+  * @return The number of core animations loaded.
+  *****************************************************************************/
+
+int CalLoader::loadCoreAnimations(const std::vector<CalCoreAnimation *>& vectorCoreAnimation, const std::vector<std::string>& vectorFilename, std::vector<CalError::Code>& vectorErrorCode, int threadCount)
+{
+  if(vectorCoreAnimation.size() != vectorFilename.size())
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return 0;
+  }
+
+  int loadedCount = loadInParallel((int)vectorFilename.size(), threadCount, [&](int itemId)
+  {
+    return loadCoreAnimation(vectorCoreAnimation[itemId], vectorFilename[itemId]);
+  }, vectorErrorCode);
+
+  setBatchError(vectorErrorCode, vectorFilename);
+
+  return loadedCount;
+}
+
+ /*****************************************************************************/
+/** Loads a list of core models in parallel.
+  *
+  * This function loads each core model from its file, spreading the files
+  * over several threads. The core models must have been created; the ones
+  * that fail to load are destroyed, as by loadCoreModel(). The first failure
+  * is also reported as the last error of the calling thread.
+  *
+  * @param vectorCoreModel The core models to load into.
+  * @param vectorFilename The file of each core model.
+  * @param vectorErrorCode Receives the error code of each core model,
+  *                        CalError::OK for the ones that loaded.
+  * @param threadCount The number of threads to use, 0 for one per core.
+  *
+  * @return The number of core models loaded.
+  *****************************************************************************/
+
+int CalLoader::loadCoreModels(const std::vector<CalCoreModel *>& vectorCoreModel, const std::vector<std::string>& vectorFilename, std::vector<CalError::Code>& vectorErrorCode, int threadCount)
+{
+  if(vectorCoreModel.size() != vectorFilename.size())
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return 0;
+  }
+
+  int loadedCount = loadInParallel((int)vectorFilename.size(), threadCount, [&](int itemId)
+  {
+    return loadCoreModel(vectorCoreModel[itemId], vectorFilename[itemId]);
+  }, vectorErrorCode);
+
+  setBatchError(vectorErrorCode, vectorFilename);
+
+  return loadedCount;
+}
+
  /*****************************************************************************/
 /** Loads a core bone instance.
   *
@@ -195,13 +2133,15 @@ bool CalLoader::loadCoreAnimation(CalCoreAnimation *anim, CalDataSource& dataSrc
   * @param pCoreBone the bone to initialize.
   * @param file The file stream to load the core bone instance from.
   * @param strFilename The name of the file stream.
+  * @param pArena The arena to place the core bone in, or 0 for the heap.
   *
   * @return One of the following values:
   *         \li a pointer to the core bone
   *         \li \b 0 if an error happend
   *****************************************************************************/
 
-CalCoreBone *CalLoader::loadCoreBones(CalDataSource& dataSrc)
+template<class DataSource>
+CalCoreBone *CalLoader::loadCoreBones(DataSource& dataSrc, int flags, CalArena *pArena)
 {
   if(!dataSrc.ok())
   {
@@ -209,51 +2149,24 @@ CalCoreBone *CalLoader::loadCoreBones(CalDataSource& dataSrc)
     return 0;
   }
 
-  // get the name length of the bone
-  int len;
-  if(!dataSrc.readInteger(len) || (len < 1))
+  // read the name of the bone
+  int nameId = readNameId(dataSrc);
+  if(nameId == -1)
   {
     CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
     return 0;
   }
-
-  // read the name of the bone
-  char *strBuffer;
-  strBuffer = new char[len];
-  dataSrc.readBytes(strBuffer, len);
-  std::string strName;
-  strName = strBuffer;
-  delete [] strBuffer;
   
-  // read the length of the bone.
-  float length;
-  dataSrc.readFloat(length);
-  
-  // get the translation of the bone
-  float tx, ty, tz;
-  dataSrc.readFloat(tx);
-  dataSrc.readFloat(ty);
-  dataSrc.readFloat(tz);
-
-  // get the rotation of the bone
-  float rx, ry, rz, rw;
-  dataSrc.readFloat(rx);
-  dataSrc.readFloat(ry);
-  dataSrc.readFloat(rz);
-  dataSrc.readFloat(rw);
-
-  // get the bone space translation of the bone
-  float txBoneSpace, tyBoneSpace, tzBoneSpace;
-  dataSrc.readFloat(txBoneSpace);
-  dataSrc.readFloat(tyBoneSpace);
-  dataSrc.readFloat(tzBoneSpace);
-
-  // get the bone space rotation of the bone
-  float rxBoneSpace, ryBoneSpace, rzBoneSpace, rwBoneSpace;
-  dataSrc.readFloat(rxBoneSpace);
-  dataSrc.readFloat(ryBoneSpace);
-  dataSrc.readFloat(rzBoneSpace);
-  dataSrc.readFloat(rwBoneSpace);
+  // read the length, the translation and rotation and the bone space
+  // translation and rotation of the bone in one block
+  float boneData[15];
+  dataSrc.readFloats(boneData, 15);
+
+  float length = boneData[0];
+  float tx = boneData[1], ty = boneData[2], tz = boneData[3];
+  float rx = boneData[4], ry = boneData[5], rz = boneData[6], rw = boneData[7];
+  float txBoneSpace = boneData[8], tyBoneSpace = boneData[9], tzBoneSpace = boneData[10];
+  float rxBoneSpace = boneData[11], ryBoneSpace = boneData[12], rzBoneSpace = boneData[13], rwBoneSpace = boneData[14];
 
   // get the parent bone id
   int parentId;
@@ -263,7 +2176,7 @@ CalCoreBone *CalLoader::loadCoreBones(CalDataSource& dataSrc)
   CalQuaternion rotbs(rxBoneSpace, ryBoneSpace, rzBoneSpace, rwBoneSpace);
   CalVector trans(tx,ty,tz);
 
-  if (loadingMode & LOADER_ROTATE_X_AXIS)
+  if (flags & LOADER_ROTATE_X_AXIS)
   {
     if (parentId == -1) // only root bone necessary
     {
@@ -285,7 +2198,7 @@ CalCoreBone *CalLoader::loadCoreBones(CalDataSource& dataSrc)
   
   // allocate a new core bone instance
   CalCoreBone *pCoreBone;
-  pCoreBone = new CalCoreBone();
+  pCoreBone = CalArena::construct<CalCoreBone>(pArena);
   if(pCoreBone == 0)
   {
     CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__, "CalLoader::loadCoreBones");
@@ -293,9 +2206,9 @@ CalCoreBone *CalLoader::loadCoreBones(CalDataSource& dataSrc)
   }
 
   // create the core bone instance
-  if(!pCoreBone->create(strName))
+  if(!pCoreBone->create(nameId))
   {
-    delete pCoreBone;
+    CalArena::release(pArena, pCoreBone);
     return 0;
   }
 
@@ -314,7 +2227,7 @@ CalCoreBone *CalLoader::loadCoreBones(CalDataSource& dataSrc)
   if(!dataSrc.readInteger(childCount) || (childCount < 0))
   {
     pCoreBone->destroy();
-    delete pCoreBone;
+    CalArena::release(pArena, pCoreBone);
     CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
     return 0;
   }
@@ -326,7 +2239,7 @@ CalCoreBone *CalLoader::loadCoreBones(CalDataSource& dataSrc)
     if(!dataSrc.readInteger(childId) || (childId < 0))
     {
       pCoreBone->destroy();
-      delete pCoreBone;
+      CalArena::release(pArena, pCoreBone);
       CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
       return 0;
     }
@@ -344,13 +2257,15 @@ CalCoreBone *CalLoader::loadCoreBones(CalDataSource& dataSrc)
   *
   * @param file The file stream to load the core keyframe instance from.
   * @param strFilename The name of the file stream.
+  * @param pArena The arena to place the core keyframe in, or 0 for the heap.
   *
   * @return One of the following values:
   *         \li a pointer to the core keyframe
   *         \li \b 0 if an error happend
   *****************************************************************************/
 
-CalCoreKeyframe *CalLoader::loadCoreKeyframe(CalDataSource& dataSrc)
+template<class DataSource>
+CalCoreKeyframe *CalLoader::loadCoreKeyframe(DataSource& dataSrc, CalArena *pArena)
 {
   if(!dataSrc.ok())
   {
@@ -358,22 +2273,13 @@ CalCoreKeyframe *CalLoader::loadCoreKeyframe(CalDataSource& dataSrc)
     return 0;
   }
 
-  // get the time of the keyframe
-  float time;
-  dataSrc.readFloat(time);
+  // get the time, the translation and the rotation of the keyframe
+  float keyframeData[8];
+  dataSrc.readFloats(keyframeData, 8);
 
-  // get the orientation of the bone
-  float tx, ty, tz;
-  dataSrc.readFloat(tx);
-  dataSrc.readFloat(ty);
-  dataSrc.readFloat(tz);
-
-  // get the rotation of the bone
-  float rx, ry, rz, rw;
-  dataSrc.readFloat(rx);
-  dataSrc.readFloat(ry);
-  dataSrc.readFloat(rz);
-  dataSrc.readFloat(rw);
+  float time = keyframeData[0];
+  float tx = keyframeData[1], ty = keyframeData[2], tz = keyframeData[3];
+  float rx = keyframeData[4], ry = keyframeData[5], rz = keyframeData[6], rw = keyframeData[7];
 
   // check if an error happend
   if(!dataSrc.ok())
@@ -384,7 +2290,7 @@ CalCoreKeyframe *CalLoader::loadCoreKeyframe(CalDataSource& dataSrc)
 
   // allocate a new core keyframe instance
   CalCoreKeyframe *pCoreKeyframe;
-  pCoreKeyframe = new CalCoreKeyframe();
+  pCoreKeyframe = CalArena::construct<CalCoreKeyframe>(pArena);
   if(pCoreKeyframe == 0)
   {
     CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__, "CalLoader::loadCoreKeyframe");
@@ -394,7 +2300,7 @@ CalCoreKeyframe *CalLoader::loadCoreKeyframe(CalDataSource& dataSrc)
   // create the core keyframe instance
   if(!pCoreKeyframe->create())
   {
-    delete pCoreKeyframe;
+    CalArena::release(pArena, pCoreKeyframe);
     return 0;
   }
 
@@ -412,38 +2318,60 @@ CalCoreKeyframe *CalLoader::loadCoreKeyframe(CalDataSource& dataSrc)
 
 bool CalLoader::loadCoreModel(CalCoreModel *model, const std::string& strFilename)
 {
-  // open the file
-  std::ifstream file;
-  file.open(strFilename.c_str(), std::ios::in | std::ios::binary);
-  if(!file)
+  // map the file
+  CalMappedFileSource fileSrc(strFilename);
+  if(!fileSrc.isMapped())
   {
     CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename);
     model->destroy(); return false;
   }
-  
-  //make a new stream data source and use it to load the animation
-  CalStreamSource streamSrc( file );
 
-  bool coremodel = loadCoreModel(model, streamSrc);
-
-  //close the file
-  file.close();
-
-  return coremodel;
+  return loadCoreModelFrom(model, fileSrc, getLoadingFlags());
 }
 
 bool CalLoader::loadCoreModel(CalCoreModel *model, void* inputBuffer, int len, const std::string& strFilename)
 {
   //Create a new buffer data source and pass it on
-  CalBufferSource bufferSrc(inputBuffer);
-  return loadCoreModel(model, bufferSrc);
+  CalBufferSource bufferSrc(inputBuffer, len);
+  return loadCoreModelFrom(model, bufferSrc, getLoadingFlags());
+}
+
+bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc, int flags)
+{
+  return loadCoreModelFrom(model, dataSrc, flags);
 }
 
-bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc)
+ /*****************************************************************************/
+/** Loads a core model from a data source.
+  *
+  * This function loads a core model from a data source of a given type, see
+  * loadCoreAnimationFrom().
+  *
+  * @param model The core model to load into.
+  * @param dataSrc The data source to load the core model from.
+  * @param flags The loading mode flags, see setLoadingMode().
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+template<class DataSource>
+bool CalLoader::loadCoreModelFrom(CalCoreModel *model, DataSource& dataSrc, int flags)
 {
   // check if this is a valid file
   char magic[4];
-  if(!dataSrc.readBytes(&magic[0], 4) || (memcmp(&magic[0], Cal::MODEL_FILE_MAGIC, 4) != 0))
+  if(!dataSrc.readBytes(&magic[0], 4))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    model->destroy(); return false;
+  }
+
+  // baked and encoded files are told apart by their magic tag
+  if(memcmp(&magic[0], Cal::BAKED_FILE_MAGIC, 4) == 0) return loadBakedCoreModel(model, dataSrc, flags);
+  if(memcmp(&magic[0], Cal::ENCODED_FILE_MAGIC, 4) == 0) return loadEncodedCoreModel(model, dataSrc, flags);
+
+  if(memcmp(&magic[0], Cal::MODEL_FILE_MAGIC, 4) != 0)
   {
     CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
     model->destroy(); return false;
@@ -464,6 +2392,11 @@ bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc)
     CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
     model->destroy(); return false;
   }
+
+  // place all core bones next to each other
+  CalArena *pArena = &model->m_arena;
+  int remainingSize = dataSrc.getRemainingSize();
+  if(remainingSize > 0) pArena->reserve(std::min(boneCount, remainingSize / 64) * sizeof(CalCoreBone));
   
   // load all core bones
   int boneId;
@@ -471,7 +2404,7 @@ bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc)
   {
     // load the core bone
     CalCoreBone *pCoreBone;
-    pCoreBone = loadCoreBones(dataSrc);
+    pCoreBone = loadCoreBones(dataSrc, flags, pArena);
     if(pCoreBone == 0) { model->destroy(); return false; }
     
     // set the core skeleton of the core bone instance
@@ -481,6 +2414,10 @@ bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc)
     model->m_vectorCoreBone.push_back(pCoreBone);
   }
 
+  // the core submeshes take the rest of the file, so they are skipped by not
+  // reading any further
+  if(flags & LOADER_SKELETON_ONLY) return true;
+
   // get the number of submeshes
   int submeshCount;
   dataSrc.readInteger(submeshCount);
@@ -492,13 +2429,17 @@ bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc)
     model->destroy(); return false;
   }
 
+  // place all core submeshes next to each other
+  remainingSize = dataSrc.getRemainingSize();
+  if(remainingSize > 0) pArena->reserve(std::min(submeshCount, remainingSize / 24) * sizeof(CalCoreSubmesh));
+
   // load all core submeshes
   int submeshId;
   for(submeshId = 0; submeshId < submeshCount; submeshId++)
   {
     // load the core submesh
     CalCoreSubmesh *pCoreSubmesh;
-    pCoreSubmesh = loadCoreSubmesh(dataSrc);
+    pCoreSubmesh = loadCoreSubmesh(dataSrc, pArena);
     if(pCoreSubmesh == 0) { model->destroy(); return false; }
 
     // add the core submesh to the core mesh instance
@@ -510,43 +2451,58 @@ bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc)
 
 bool CalLoader::loadCoreModel(CalCoreModel *model, const std::string& strFilename1, const std::string& strFilename2)
 {
-  // open the first file
-  std::ifstream file1;
-  file1.open(strFilename1.c_str(), std::ios::in | std::ios::binary);
-  if(!file1)
+  // map the first file
+  CalMappedFileSource fileSrc1(strFilename1);
+  if(!fileSrc1.isMapped())
   {
     CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename1);
     model->destroy(); return false;
   }
 
-  // open the second file
-  std::ifstream file2;
-  file2.open(strFilename2.c_str(), std::ios::in | std::ios::binary);
-  if(!file2)
+  // map the second file, unless only the skeleton is loaded
+  int flags = getLoadingFlags();
+  CalMappedFileSource fileSrc2((flags & LOADER_SKELETON_ONLY) ? std::string() : strFilename2);
+  if(!fileSrc2.isMapped() && !(flags & LOADER_SKELETON_ONLY))
   {
     CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__, strFilename2);
     model->destroy(); return false;
   }
-  
-  CalStreamSource streamSrc1( file1 );
-  CalStreamSource streamSrc2( file2 );
 
-  bool result = loadCoreModel(model, streamSrc1, streamSrc2);
-  file1.close();
-  file2.close();
-  return result;
+  return loadCoreModelFrom(model, fileSrc1, fileSrc2, flags);
 }
 
 bool CalLoader::loadCoreModel(CalCoreModel *model,
 			      void* inputBuffer1, int len1, const std::string& strFilename1,
 			      void* inputBuffer2, int len2, const std::string& strFilename2)
 {
-  CalBufferSource bufferSrc1(inputBuffer1);
-  CalBufferSource bufferSrc2(inputBuffer2);
-  return loadCoreModel(model, bufferSrc1, bufferSrc2);
+  CalBufferSource bufferSrc1(inputBuffer1, len1);
+  CalBufferSource bufferSrc2(inputBuffer2, len2);
+  return loadCoreModelFrom(model, bufferSrc1, bufferSrc2, getLoadingFlags());
+}
+
+bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc1, CalDataSource& dataSrc2, int flags)
+{
+  return loadCoreModelFrom(model, dataSrc1, dataSrc2, flags);
 }
 
-bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc1, CalDataSource& dataSrc2)
+ /*****************************************************************************/
+/** Loads a core model from a skeleton and a mesh data source.
+  *
+  * This function loads a core model from two data sources of a given type, see
+  * loadCoreAnimationFrom().
+  *
+  * @param model The core model to load into.
+  * @param dataSrc1 The data source to load the core skeleton from.
+  * @param dataSrc2 The data source to load the core mesh from.
+  * @param flags The loading mode flags, see setLoadingMode().
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+template<class DataSource>
+bool CalLoader::loadCoreModelFrom(CalCoreModel *model, DataSource& dataSrc1, DataSource& dataSrc2, int flags)
 {
   // check if this is a valid file
   char magic[4];
@@ -571,6 +2527,11 @@ bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc1, CalD
     CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
     model->destroy(); return false;
   }
+
+  // place all core bones next to each other
+  CalArena *pArena = &model->m_arena;
+  int remainingSize = dataSrc1.getRemainingSize();
+  if(remainingSize > 0) pArena->reserve(std::min(boneCount, remainingSize / 64) * sizeof(CalCoreBone));
   
   // load all core bones
   int boneId;
@@ -578,7 +2539,7 @@ bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc1, CalD
   {
     // load the core bone
     CalCoreBone *pCoreBone;
-    pCoreBone = loadCoreBones(dataSrc1);
+    pCoreBone = loadCoreBones(dataSrc1, flags, pArena);
     if(pCoreBone == 0) { model->destroy(); return false; }
 
     // set the core skeleton of the core bone instance
@@ -591,6 +2552,8 @@ bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc1, CalD
   // calculate state of the core skeleton
   model->calculateState();
 
+  if(flags & LOADER_SKELETON_ONLY) return true;
+
   
   // check if this is a valid file
   if(!dataSrc2.readBytes(&magic[0], 4) || (memcmp(&magic[0], Cal::MESH_FILE_MAGIC, 4) != 0))
@@ -617,13 +2580,17 @@ bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc1, CalD
     model->destroy(); return false;
   }
 
+  // place all core submeshes next to each other
+  remainingSize = dataSrc2.getRemainingSize();
+  if(remainingSize > 0) pArena->reserve(std::min(submeshCount, remainingSize / 24) * sizeof(CalCoreSubmesh));
+
   // load all core submeshes
   int submeshId;
   for(submeshId = 0; submeshId < submeshCount; submeshId++)
   {
     // load the core submesh
     CalCoreSubmesh *pCoreSubmesh;
-    pCoreSubmesh = loadCoreSubmesh(dataSrc2);
+    pCoreSubmesh = loadCoreSubmesh(dataSrc2, pArena);
     if(pCoreSubmesh == 0) { model->destroy(); return false; }
 
     // add the core submesh to the core mesh instance
@@ -640,13 +2607,63 @@ bool CalLoader::loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc1, CalD
   *
   * @param file The file stream to load the core submesh instance from.
   * @param strFilename The name of the file stream.
+  * @param pArena The arena to place the core submesh in, or 0 for the heap.
+  *
+  * @return One of the following values:
+  *         \li a pointer to the core submesh
+  *         \li \b 0 if an error happend
+  *****************************************************************************/
+
+template<class DataSource>
+CalCoreSubmesh *CalLoader::loadCoreSubmesh(DataSource& dataSrc, CalArena *pArena)
+{
+  CalCoreSubmesh *pCoreSubmesh;
+  pCoreSubmesh = loadCoreSubmeshHeader(dataSrc, pArena);
+  if(pCoreSubmesh == 0) return 0;
+
+  // load all vertices and their influences, the springs and the faces
+  int vertexCount = (int)pCoreSubmesh->getVectorVertex().size();
+  int faceCount = (int)pCoreSubmesh->getVectorFace().size();
+
+  bool bSuccess = true;
+  int vertexId;
+  for(vertexId = 0; bSuccess && (vertexId < vertexCount); vertexId++)
+  {
+    bSuccess = loadCoreSubmeshVertex(dataSrc, pCoreSubmesh, vertexId);
+  }
+
+  if(!bSuccess || !loadCoreSubmeshSprings(dataSrc, pCoreSubmesh) || !loadCoreSubmeshFaces(dataSrc, pCoreSubmesh, 0, faceCount) || !finishCoreSubmesh(pCoreSubmesh))
+  {
+    pCoreSubmesh->destroy();
+    CalArena::release(pArena, pCoreSubmesh);
+    return 0;
+  }
+#ifdef DEBUG_LOADER
+  printf("loadCoreSubMesh: DONE!!!!!!\n\n\n\n\n");
+#endif
+    
+
+  return pCoreSubmesh;
+}
+
+ /*****************************************************************************/
+/** Loads the header of a core submesh instance.
+  *
+  * This function loads the counts and the tangent space flags of a core
+  * submesh and makes room for all of its data. The vertices, springs and faces
+  * follow with loadCoreSubmeshVertex(), loadCoreSubmeshSprings() and
+  * loadCoreSubmeshFaces(), and finishCoreSubmesh() completes the core submesh.
+  *
+  * @param dataSrc The data source to load the core submesh from.
+  * @param pArena The arena to place the core submesh in, or 0 for the heap.
   *
   * @return One of the following values:
   *         \li a pointer to the core submesh
   *         \li \b 0 if an error happend
   *****************************************************************************/
 
-CalCoreSubmesh *CalLoader::loadCoreSubmesh(CalDataSource& dataSrc)
+template<class DataSource>
+CalCoreSubmesh *CalLoader::loadCoreSubmeshHeader(DataSource& dataSrc, CalArena *pArena)
 {
   if(!dataSrc.ok())
   {
@@ -701,7 +2718,7 @@ CalCoreSubmesh *CalLoader::loadCoreSubmesh(CalDataSource& dataSrc)
 
   // allocate a new core submesh instance
   CalCoreSubmesh *pCoreSubmesh;
-  pCoreSubmesh = new CalCoreSubmesh();
+  pCoreSubmesh = CalArena::construct<CalCoreSubmesh>(pArena);
   if(pCoreSubmesh == 0)
   {
     CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__, "CalLoader::loadCoreSubmesh");
@@ -711,7 +2728,7 @@ CalCoreSubmesh *CalLoader::loadCoreSubmesh(CalDataSource& dataSrc)
   // create the core submesh instance
   if(!pCoreSubmesh->create())
   {
-    delete pCoreSubmesh;
+    CalArena::release(pArena, pCoreSubmesh);
     return 0;
   }
 
@@ -726,7 +2743,7 @@ CalCoreSubmesh *CalLoader::loadCoreSubmesh(CalDataSource& dataSrc)
   {
     CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
     pCoreSubmesh->destroy();
-    delete pCoreSubmesh;
+    CalArena::release(pArena, pCoreSubmesh);
     return 0;
   }
   
@@ -743,284 +2760,259 @@ CalCoreSubmesh *CalLoader::loadCoreSubmesh(CalDataSource& dataSrc)
 #endif
   }
 
+  return pCoreSubmesh;
+}
+
+ /*****************************************************************************/
+/** Loads a vertex of a core submesh instance.
+  *
+  * This function loads a vertex with its texture coordinates, influences and
+  * physical property. The vertices must be loaded in order.
+  *
+  * @param dataSrc The data source to load the vertex from.
+  * @param pCoreSubmesh The core submesh the vertex belongs to.
+  * @param vertexId The ID of the vertex.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+template<class DataSource>
+bool CalLoader::loadCoreSubmeshVertex(DataSource& dataSrc, CalCoreSubmesh *pCoreSubmesh, int vertexId)
+{
   // Get the influence vector.
   std::vector<CalCoreSubmesh::Influence>& vectorInfluence = pCoreSubmesh->getVectorInfluence();
   
-  // Get the vertex vector.
-  std::vector<CalCoreSubmesh::Vertex>& vectorVertex = pCoreSubmesh->getVectorVertex();
-  
   // Get the tangent space vectors
   std::vector<std::vector<CalCoreSubmesh::TangentSpace> >& vectorvectorTangentSpace =
     pCoreSubmesh->getVectorVectorTangentSpace();
+
+  int textureCoordinateCount = (int)vectorvectorTangentSpace.size();
+  bool bSprings = !pCoreSubmesh->getVectorSpring().empty();
+
+  // The vertex we're setting.
+  CalCoreSubmesh::Vertex &vertex = pCoreSubmesh->getVectorVertex()[vertexId];
   
-  // load all vertices and their influences
-  int vertexId;
-  for(vertexId = 0; vertexId < vertexCount; vertexId++)
-  {
-    // The vertex we're setting.
-    CalCoreSubmesh::Vertex &vertex = vectorVertex[vertexId];
-    
-    // load data of the vertex
-    dataSrc.readFloat(vertex.position.x);
-    dataSrc.readFloat(vertex.position.y);
-    dataSrc.readFloat(vertex.position.z);
+  // load data of the vertex
+  dataSrc.readFloats(&vertex.position.x, 3);
 #ifdef DEBUG_LOADER
   printf("loadCoreSubMesh: vertex.position: %f %f %f\n", vertex.position.x, vertex.position.y, vertex.position.z);
 #endif
 
-    char nxyz[3];
-    dataSrc.readBytes(nxyz, 3);
-    vertex.nx = nxyz[0];
-    vertex.ny = nxyz[1];
-    vertex.nz = nxyz[2];
+  char nxyz[3];
+  dataSrc.readBytes(nxyz, 3);
+  vertex.nx = nxyz[0];
+  vertex.ny = nxyz[1];
+  vertex.nz = nxyz[2];
 #ifdef DEBUG_LOADER
   printf("loadCoreSubMesh: vertex. nx ny nz: %d %d %d\n", vertex.nx, vertex.ny, vertex.nz);
 #endif
 
-    // Load the LOD control information.
-    int faceCollapseCount, collapseId;
-    dataSrc.readInteger(collapseId);
-    dataSrc.readInteger(faceCollapseCount);
+  // Load the LOD control information.
+  int lodControl[2];
+  dataSrc.readIntegers(lodControl, 2);
+  int collapseId = lodControl[0];
+  int faceCollapseCount = lodControl[1];
 #ifdef DEBUG_LOADER
   printf("loadCoreSubMesh: collapseId faceCollapseCount: %d %d\n", collapseId, faceCollapseCount);
 #endif
 
-    pCoreSubmesh->setLodControl(vertexId, faceCollapseCount, collapseId);
-    
-    // check if an error happend
-    if(!dataSrc.ok())
-    {
-      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
-      pCoreSubmesh->destroy();
-      delete pCoreSubmesh;
-      return 0;
-    }
-    
-    // load all texture coordinates of the vertex
-    int textureCoordinateId;
-    for(textureCoordinateId = 0; textureCoordinateId < textureCoordinateCount; textureCoordinateId++)
-    {
-      CalCoreSubmesh::TextureCoordinate textureCoordinate;
+  pCoreSubmesh->setLodControl(vertexId, faceCollapseCount, collapseId);
+  
+  // check if an error happend
+  if(!dataSrc.ok())
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return false;
+  }
+  
+  // load all texture coordinates of the vertex
+  int textureCoordinateId;
+  for(textureCoordinateId = 0; textureCoordinateId < textureCoordinateCount; textureCoordinateId++)
+  {
+    CalCoreSubmesh::TextureCoordinate textureCoordinate;
 
-      // load data of the influence
-      dataSrc.readFloat(textureCoordinate.u);
-      dataSrc.readFloat(textureCoordinate.v);
+    // load data of the texture coordinate
+    dataSrc.readFloats(&textureCoordinate.u, 2);
 #ifdef DEBUG_LOADER
-      printf("loadCoreSubMesh: textureCoordinate(%d): %f %f\n", textureCoordinateId,textureCoordinate.u, textureCoordinate.v);
+    printf("loadCoreSubMesh: textureCoordinate(%d): %f %f\n", textureCoordinateId,textureCoordinate.u, textureCoordinate.v);
 #endif
 
-      pCoreSubmesh->setTextureCoordinate(vertexId, textureCoordinateId, textureCoordinate);
-      
-      if (pCoreSubmesh->tangentsEnabled(textureCoordinateId))
-      {
-	char tanspace[4];
-	dataSrc.readBytes(tanspace, 4);
-	vectorvectorTangentSpace[textureCoordinateId][vertexId].tx = tanspace[0];
-	vectorvectorTangentSpace[textureCoordinateId][vertexId].ty = tanspace[1];
-	vectorvectorTangentSpace[textureCoordinateId][vertexId].tz = tanspace[2];
-	vectorvectorTangentSpace[textureCoordinateId][vertexId].crossFactor = tanspace[3];
+    pCoreSubmesh->setTextureCoordinate(vertexId, textureCoordinateId, textureCoordinate);
+    
+    if (pCoreSubmesh->tangentsEnabled(textureCoordinateId))
+    {
+      char tanspace[4];
+      dataSrc.readBytes(tanspace, 4);
+      vectorvectorTangentSpace[textureCoordinateId][vertexId].tx = tanspace[0];
+      vectorvectorTangentSpace[textureCoordinateId][vertexId].ty = tanspace[1];
+      vectorvectorTangentSpace[textureCoordinateId][vertexId].tz = tanspace[2];
+      vectorvectorTangentSpace[textureCoordinateId][vertexId].crossFactor = tanspace[3];
 #ifdef DEBUG_LOADER
-        printf("loadCoreSubMesh: vectorTangentSpace(%d, %d): %d %d %d %d\n", textureCoordinateId, vertexId, tanspace[0], tanspace[1], tanspace[2], tanspace[3]);
+      printf("loadCoreSubMesh: vectorTangentSpace(%d, %d): %d %d %d %d\n", textureCoordinateId, vertexId, tanspace[0], tanspace[1], tanspace[2], tanspace[3]);
 #endif
-      }
-      
-      // check if an error happend
-      if(!dataSrc.ok())
-      {
-        CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
-        pCoreSubmesh->destroy();
-        delete pCoreSubmesh;
-        return 0;
-      }
     }
-
-    // get the number of influences
-    int influenceCount;
-    dataSrc.readInteger(influenceCount);
-    vertex.influenceCount = influenceCount;
-#ifdef DEBUG_LOADER
-    printf("loadCoreSubMesh: influenceCount: %d\n", influenceCount);
-#endif
     
     // check if an error happend
     if(!dataSrc.ok())
     {
       CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
-      pCoreSubmesh->destroy();
-      delete pCoreSubmesh;
-      return 0;
-    }
-    
-    int firstInfluence = vectorInfluence.size();
-    vectorInfluence.resize(firstInfluence + vertex.influenceCount);
-    
-    // load all influences of the vertex
-    int influenceId;
-    for(influenceId = 0; influenceId < vertex.influenceCount; influenceId++)
-    {
-      // load data of the influence
-      dataSrc.readInteger(vectorInfluence[firstInfluence + influenceId].boneId);
-      dataSrc.readFloat(vectorInfluence[firstInfluence + influenceId].weight);
-
-      // check if an error happend
-      if(!dataSrc.ok())
-      {
-        CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
-        pCoreSubmesh->destroy();
-        delete pCoreSubmesh;
-        return 0;
-      }
-    }
-    
-    // load the physical property of the vertex if there are springs in the core submesh
-    if(springCount > 0)
-    {
-      CalCoreSubmesh::PhysicalProperty physicalProperty;
-
-      // load data of the physical property
-      dataSrc.readFloat(physicalProperty.weight);
-
-      // check if an error happend
-      if(!dataSrc.ok())
-      {
-        CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
-        pCoreSubmesh->destroy();
-        delete pCoreSubmesh;
-        return 0;
-      }
-
-      // set the physical property in the core submesh instance
-      pCoreSubmesh->setPhysicalProperty(vertexId, physicalProperty);
+      return false;
     }
   }
 
-  // Pack the influence vector.
-  vectorInfluence.reserve(vectorInfluence.size());
+  // get the number of influences
+  int influenceCount;
+  dataSrc.readInteger(influenceCount);
+  vertex.influenceCount = influenceCount;
+#ifdef DEBUG_LOADER
+  printf("loadCoreSubMesh: influenceCount: %d\n", influenceCount);
+#endif
   
-  // load all springs
-  int springId;
-  for(springId = 0; springId < springCount; springId++)
+  // check if an error happend
+  if(!dataSrc.ok())
   {
-    CalCoreSubmesh::Spring spring;
-
-    // load data of the spring
-    dataSrc.readInteger(spring.vertexId[0]);
-    dataSrc.readInteger(spring.vertexId[1]);
-    dataSrc.readFloat(spring.springCoefficient);
-    dataSrc.readFloat(spring.idleLength);
-
-    // check if an error happend
-    if(!dataSrc.ok())
-    {
-      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
-      pCoreSubmesh->destroy();
-      delete pCoreSubmesh;
-      return 0;
-    }
-
-    // set spring in the core submesh instance
-    pCoreSubmesh->setSpring(springId, spring);
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return false;
   }
-
-  // load all faces
-  int faceId;
-  for(faceId = 0; faceId < faceCount; faceId++)
+  
+  int firstInfluence = vectorInfluence.size();
+  vectorInfluence.resize(firstInfluence + vertex.influenceCount);
+  
+  // load all influences of the vertex, a bone id and a weight each, as one
+  // block of 32 bit words
+  if((vertex.influenceCount > 0) && !dataSrc.readIntegers((int *)&vectorInfluence[firstInfluence], 2 * vertex.influenceCount))
   {
-    CalCoreSubmesh::Face face;
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return false;
+  }
+  
+  // load the physical property of the vertex if there are springs in the core submesh
+  if(bSprings)
+  {
+    CalCoreSubmesh::PhysicalProperty physicalProperty;
 
-    // load data of the face
-    dataSrc.readInteger(face.vertexId[0]);
-    dataSrc.readInteger(face.vertexId[1]);
-    dataSrc.readInteger(face.vertexId[2]);
+    // load data of the physical property
+    dataSrc.readFloat(physicalProperty.weight);
 
     // check if an error happend
     if(!dataSrc.ok())
     {
       CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
-      pCoreSubmesh->destroy();
-      delete pCoreSubmesh;
-      return 0;
+      return false;
     }
 
-    // set face in the core submesh instance
-    pCoreSubmesh->setFace(faceId, face);
+    // set the physical property in the core submesh instance
+    pCoreSubmesh->setPhysicalProperty(vertexId, physicalProperty);
   }
-#ifdef DEBUG_LOADER
-  printf("loadCoreSubMesh: DONE!!!!!!\n\n\n\n\n");
-#endif
-    
 
-  return pCoreSubmesh;
+  return true;
 }
 
  /*****************************************************************************/
-/** Loads a core track instance.
+/** Loads the springs of a core submesh instance.
   *
-  * This function loads a core track instance from a data source.
+  * This function loads all springs of a core submesh, which are stored as the
+  * core submesh keeps them in memory. They follow the last vertex.
   *
-  * @param dataSrc The data source to load the core track instance from.
+  * @param dataSrc The data source to load the springs from.
+  * @param pCoreSubmesh The core submesh the springs belong to.
   *
   * @return One of the following values:
-  *         \li a pointer to the core track
-  *         \li \b 0 if an error happend
+  *         \li \b true if successful
+  *         \li \b false if an error happend
   *****************************************************************************/
 
-CalCoreTrack *CalLoader::loadCoreTrack(CalDataSource& dataSrc)
+template<class DataSource>
+bool CalLoader::loadCoreSubmeshSprings(DataSource& dataSrc, CalCoreSubmesh *pCoreSubmesh)
 {
-  if(!dataSrc.ok())
+  std::vector<CalCoreSubmesh::Spring>& vectorSpring = pCoreSubmesh->getVectorSpring();
+  if(!vectorSpring.empty() && !dataSrc.readIntegers((int *)&vectorSpring[0], 4 * (int)vectorSpring.size()))
   {
-    dataSrc.setError();
-    return 0;
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return false;
   }
 
-  // BUG BUG BUG - Code SHOULD use readString section below rather than the rest, but
-  // readString crashes and I dont have time to putz with it...
-  // get the name length of the bone
-  int len;
-  if(!dataSrc.readInteger(len) || (len < 1))
-  //std::string strName;
-  // if(!dataSrc.readString(strName))
+  return true;
+}
+
+ /*****************************************************************************/
+/** Loads faces of a core submesh instance.
+  *
+  * This function loads a range of faces of a core submesh in the same way as
+  * the springs. The faces follow the springs and must be loaded in order.
+  *
+  * @param dataSrc The data source to load the faces from.
+  * @param pCoreSubmesh The core submesh the faces belong to.
+  * @param firstFaceId The ID of the first face to load.
+  * @param faceCount The number of faces to load.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+template<class DataSource>
+bool CalLoader::loadCoreSubmeshFaces(DataSource& dataSrc, CalCoreSubmesh *pCoreSubmesh, int firstFaceId, int faceCount)
+{
+  if((faceCount > 0) && !dataSrc.readIntegers((int *)&pCoreSubmesh->getVectorFace()[firstFaceId], 3 * faceCount))
   {
     CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
-    return 0;
+    return false;
   }
 
-  // read the name of the bone
-  char *strBuffer;
-  strBuffer = new char[len];
-  dataSrc.readBytes(strBuffer, len);
-  std::string strName;
-  strName = strBuffer;
-  delete [] strBuffer;
+  return true;
+}
 
-  // END BUG
+ /*****************************************************************************/
+/** Completes a core submesh instance.
+  *
+  * This function is called once all data of a core submesh is loaded. It packs
+  * the influences and precomputes what the skinning kernels, the level of
+  * detail and the springs need.
+  *
+  * @param pCoreSubmesh The core submesh to complete.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
 
-  // allocate a new core track instance
-  CalCoreTrack *pCoreTrack;
-  pCoreTrack = new CalCoreTrack();
-  if(pCoreTrack == 0)
-  {
-    CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
-    return 0;
-  }
+bool CalLoader::finishCoreSubmesh(CalCoreSubmesh *pCoreSubmesh)
+{
+  // Pack the influence vector.
+  std::vector<CalCoreSubmesh::Influence>& vectorInfluence = pCoreSubmesh->getVectorInfluence();
+  vectorInfluence.reserve(vectorInfluence.size());
 
-  // create the core track instance
-  if(!pCoreTrack->create())
-  {
-    delete pCoreTrack;
-    return 0;
-  }
+  // gather the influence statistics for the skinning kernels
+  pCoreSubmesh->analyzeInfluences();
 
-  // link the core track to the appropriate core bone
-  pCoreTrack->setCoreBoneName(strName);
+  // precompute the faces of the lod steps and the independent spring batches
+  return pCoreSubmesh->buildLodSteps(CalCoreSubmesh::DEFAULT_LOD_STEP_COUNT) && pCoreSubmesh->buildSpringBatches();
+}
 
-  // read the number of keyframes
+ /*****************************************************************************/
+/** Loads a core track instance.
+  *
+  * This function loads a core track instance from a data source.
+  *
+  * @param dataSrc The data source to load the core track instance from.
+  * @param pArena The arena to place the core track and its core keyframes
+  *               in, or 0 for the heap.
+  *
+  * @return One of the following values:
+  *         \li a pointer to the core track
+  *         \li \b 0 if an error happend
+  *****************************************************************************/
+
+template<class DataSource>
+CalCoreTrack *CalLoader::loadCoreTrack(DataSource& dataSrc, CalArena *pArena)
+{
   int keyframeCount;
-  if(!dataSrc.readInteger(keyframeCount) || (keyframeCount <= 0))
-  {
-    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
-    return 0;
-  }
+  CalCoreTrack *pCoreTrack;
+  pCoreTrack = loadCoreTrackHeader(dataSrc, pArena, keyframeCount);
+  if(pCoreTrack == 0) return 0;
 
   // load all core keyframes
   int keyframeId;
@@ -1028,11 +3020,11 @@ CalCoreTrack *CalLoader::loadCoreTrack(CalDataSource& dataSrc)
   {
     // load the core keyframe
     CalCoreKeyframe *pCoreKeyframe;
-    pCoreKeyframe = loadCoreKeyframe(dataSrc);
+    pCoreKeyframe = loadCoreKeyframe(dataSrc, pArena);
     if(pCoreKeyframe == 0)
     {
       pCoreTrack->destroy();
-      delete pCoreTrack;
+      CalArena::release(pArena, pCoreTrack);
       return 0;
     }
 
@@ -1063,4 +3055,69 @@ CalCoreTrack *CalLoader::loadCoreTrack(CalDataSource& dataSrc)
   return pCoreTrack;
 }
 
+ /*****************************************************************************/
+/** Loads the header of a core track instance.
+  *
+  * This function loads the bone name and the number of keyframes of a core
+  * track. The keyframes follow, to be loaded with loadCoreKeyframe().
+  *
+  * @param dataSrc The data source to load the core track from.
+  * @param pArena The arena to place the core track in, or 0 for the heap;
+  *               its core keyframes must go to the same one.
+  * @param keyframeCount Receives the number of keyframes.
+  *
+  * @return One of the following values:
+  *         \li a pointer to the core track
+  *         \li \b 0 if an error happend
+  *****************************************************************************/
+
+template<class DataSource>
+CalCoreTrack *CalLoader::loadCoreTrackHeader(DataSource& dataSrc, CalArena *pArena, int& keyframeCount)
+{
+  if(!dataSrc.ok())
+  {
+    dataSrc.setError();
+    return 0;
+  }
+
+  // read the name of the bone
+  int nameId = readNameId(dataSrc);
+  if(nameId == -1)
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    return 0;
+  }
+
+  // allocate a new core track instance
+  CalCoreTrack *pCoreTrack;
+  pCoreTrack = CalArena::construct<CalCoreTrack>(pArena);
+  if(pCoreTrack == 0)
+  {
+    CalError::setLastError(CalError::MEMORY_ALLOCATION_FAILED, __FILE__, __LINE__);
+    return 0;
+  }
+
+  // create the core track instance
+  if(!pCoreTrack->create())
+  {
+    CalArena::release(pArena, pCoreTrack);
+    return 0;
+  }
+
+  // link the core track to the appropriate core bone
+  pCoreTrack->setCoreBoneNameId(nameId);
+  pCoreTrack->setKeyframeArena(pArena);
+
+  // read the number of keyframes
+  if(!dataSrc.readInteger(keyframeCount) || (keyframeCount <= 0))
+  {
+    CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+    pCoreTrack->destroy();
+    CalArena::release(pArena, pCoreTrack);
+    return 0;
+  }
+
+  return pCoreTrack;
+}
+
 //****************************************************************************//
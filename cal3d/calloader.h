@@ -17,22 +17,34 @@
 
 #include "calglobal.h"
 #include "caldatasource.h"
+#include "calerror.h"
 
 //****************************************************************************//
 // Forward declarations                                                       //
 //****************************************************************************//
 
+class CalArena;
 class CalCoreModel;
 class CalCoreBone;
 class CalCoreAnimation;
 class CalCoreTrack;
 class CalCoreKeyframe;
 class CalCoreSubmesh;
+class CalMappedFileSource;
+
+namespace CalBaked
+{
+  struct Section;
+  struct Submesh;
+}
 
 enum
 {
   LOADER_ROTATE_X_AXIS = 1,
-  LOADER_INVERT_V_COORD = 2
+  LOADER_INVERT_V_COORD = 2,
+  LOADER_LAZY_TRACKS = 4,
+  LOADER_SKELETON_ONLY = 8,
+  LOADER_STREAM_TRACKS = 16
 };
 
 //****************************************************************************//
@@ -45,6 +57,22 @@ enum
 
 class CAL3D_API CalLoader: public CalLoaderUserData
 {
+  friend class CalEncoder;
+
+// misc
+public:
+  /// The states of an incremental load, see step().
+  enum State
+  {
+    STATE_NONE = 0,
+    STATE_LOADING,
+    STATE_DONE,
+    STATE_FAILED
+  };
+
+protected:
+  struct IncrementalLoad;
+
 // constructors/destructor
 public:
   CalLoader();
@@ -70,18 +98,59 @@ public:
   bool loadCoreModel(CalCoreModel *model, void* inputBuffer1, int len1, const std::string& strFilename1,
 	                                  void* inputBuffer2, int len2, const std::string& strFilename2);
 
+  int loadCoreAnimations(const std::vector<CalCoreAnimation *>& vectorCoreAnimation, const std::vector<std::string>& vectorFilename, std::vector<CalError::Code>& vectorErrorCode, int threadCount = 0);
+  int loadCoreModels(const std::vector<CalCoreModel *>& vectorCoreModel, const std::vector<std::string>& vectorFilename, std::vector<CalError::Code>& vectorErrorCode, int threadCount = 0);
+
+  static bool loadDeferredTracks(CalCoreAnimation *anim, const std::string& strFilename);
+  static bool loadStreamedKeyframes(CalCoreAnimation *anim, CalMappedFileSource& fileSrc, float startTime, float endTime, CalArena *pArena, std::vector<std::map<float, CalCoreKeyframe *> >& vectorMapCoreKeyframe);
+
+  bool beginCoreAnimation(CalCoreAnimation *anim, const std::string& strFilename);
+  bool beginCoreModel(CalCoreModel *model, const std::string& strFilename);
+  bool beginCoreModel(CalCoreModel *model, const std::string& strFilename, const std::string& strFilenameM);
+  void cancel();
+  State getState() const;
+  State step(int byteBudget, int microsecondBudget = 0);
+
+  int getLoadingFlags() const;
+  void setLoadingFlags(int flags);
   static void setLoadingMode(int flags);
   
 protected:
-  static CalCoreBone *loadCoreBones(CalDataSource& dataSrc);
-  static CalCoreKeyframe *loadCoreKeyframe(CalDataSource& dataSrc);
-  static CalCoreSubmesh *loadCoreSubmesh(CalDataSource& dataSrc);
-  static CalCoreTrack *loadCoreTrack(CalDataSource& dataSrc);
+  static bool loadBakedCoreAnimation(CalCoreAnimation *anim, CalDataSource& dataSrc);
+  static bool loadBakedCoreModel(CalCoreModel *model, CalDataSource& dataSrc, int flags);
+  static CalCoreSubmesh *loadBakedCoreSubmesh(const char *pBody, const std::vector<const CalBaked::Section *>& vectorSection, const CalBaked::Submesh& submesh, CalArena *pArena);
+  static const char *readBakedBody(CalDataSource& dataSrc, int contentType, std::vector<char>& vectorBody, std::vector<CalBaked::Section>& vectorSection);
+  static bool loadEncodedCoreAnimation(CalCoreAnimation *anim, CalDataSource& dataSrc);
+  static bool loadEncodedCoreModel(CalCoreModel *model, CalDataSource& dataSrc, int flags);
+  static const char *readEncodedBody(CalDataSource& dataSrc, std::vector<char>& vectorBody, int& length);
+  static bool loadLazyCoreAnimation(CalCoreAnimation *anim, CalMappedFileSource& dataSrc, const std::string& strFilename);
   static bool loadCoreAnimation(CalCoreAnimation *anim, CalDataSource& dataSrc);
-  static bool loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc);
-  static bool loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc1, CalDataSource& dataSrc2);
+  static bool loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc, int flags);
+  static bool loadCoreModel(CalCoreModel *model, CalDataSource& dataSrc1, CalDataSource& dataSrc2, int flags);
+  static bool finishCoreSubmesh(CalCoreSubmesh *pCoreSubmesh);
+  bool loadNextPiece();
+
+  // the loader itself, instantiated in calloader.cpp for each data source type
+  template<class DataSource> static CalCoreBone *loadCoreBones(DataSource& dataSrc, int flags, CalArena *pArena);
+  template<class DataSource> static CalCoreKeyframe *loadCoreKeyframe(DataSource& dataSrc, CalArena *pArena);
+  template<class DataSource> static CalCoreSubmesh *loadCoreSubmesh(DataSource& dataSrc, CalArena *pArena);
+  template<class DataSource> static CalCoreSubmesh *loadCoreSubmeshHeader(DataSource& dataSrc, CalArena *pArena);
+  template<class DataSource> static bool loadCoreSubmeshVertex(DataSource& dataSrc, CalCoreSubmesh *pCoreSubmesh, int vertexId);
+  template<class DataSource> static bool loadCoreSubmeshSprings(DataSource& dataSrc, CalCoreSubmesh *pCoreSubmesh);
+  template<class DataSource> static bool loadCoreSubmeshFaces(DataSource& dataSrc, CalCoreSubmesh *pCoreSubmesh, int firstFaceId, int faceCount);
+  template<class DataSource> static CalCoreTrack *loadCoreTrack(DataSource& dataSrc, CalArena *pArena);
+  template<class DataSource> static CalCoreTrack *loadCoreTrackHeader(DataSource& dataSrc, CalArena *pArena, int& keyframeCount);
+  template<class DataSource> static bool loadCoreAnimationFrom(CalCoreAnimation *anim, DataSource& dataSrc);
+  template<class DataSource> static bool loadCoreModelFrom(CalCoreModel *model, DataSource& dataSrc, int flags);
+  template<class DataSource> static bool loadCoreModelFrom(CalCoreModel *model, DataSource& dataSrc1, DataSource& dataSrc2, int flags);
 
   static int loadingMode;
+  int m_loadingFlags;
+  IncrementalLoad *m_pIncrementalLoad;
+
+private:
+  CalLoader(const CalLoader&);
+  CalLoader& operator=(const CalLoader&);
 };
 
 #endif
@@ -0,0 +1,712 @@
+#include "stdafx.h"
+//****************************************************************************//
+// lodbuilder.cpp                                                             //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "callodbuilder.h"
+#include "calerror.h"
+#include "calvector.h"
+#include "calcoremodel.h"
+#include "calcoresub.h"
+
+#include <queue>
+#include <algorithm>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  /// A symmetric 4x4 error quadric, stored as its upper triangle.
+  struct Quadric
+  {
+    double m[10];
+  };
+
+  /// A candidate collapse of a vertex into one of its neighbours.
+  struct Collapse
+  {
+    double cost;
+    int vertexId;
+    int targetId;
+    int stamp;
+
+    bool operator<(const Collapse& other) const
+    {
+      // the priority queue pops the largest element, so order by descending cost
+      return cost > other.cost;
+    }
+  };
+
+  /// The working state of one submesh reduction.
+  struct Reduction
+  {
+    CalCoreSubmesh *pCoreSubmesh;
+    std::vector<CalCoreSubmesh::Face> vectorFace;
+    std::vector<bool> vectorFaceAlive;
+    std::vector<std::vector<int> > vectorvectorVertexFace;
+    std::vector<Quadric> vectorQuadric;
+    std::vector<bool> vectorLocked;
+    std::vector<bool> vectorCollapsed;
+    std::vector<int> vectorStamp;
+    std::vector<int> vectorFirstInfluence;
+    double influencePenalty;
+    double textureCoordinatePenalty;
+  };
+
+  void addPlane(Quadric& quadric, double a, double b, double c, double d)
+  {
+    quadric.m[0] += a * a; quadric.m[1] += a * b; quadric.m[2] += a * c; quadric.m[3] += a * d;
+    quadric.m[4] += b * b; quadric.m[5] += b * c; quadric.m[6] += b * d;
+    quadric.m[7] += c * c; quadric.m[8] += c * d;
+    quadric.m[9] += d * d;
+  }
+
+  double evaluateQuadric(const Quadric& quadric, const CalVector& p)
+  {
+    double x = p.x, y = p.y, z = p.z;
+    return quadric.m[0] * x * x + 2.0 * quadric.m[1] * x * y + 2.0 * quadric.m[2] * x * z + 2.0 * quadric.m[3] * x
+         + quadric.m[4] * y * y + 2.0 * quadric.m[5] * y * z + 2.0 * quadric.m[6] * y
+         + quadric.m[7] * z * z + 2.0 * quadric.m[8] * z
+         + quadric.m[9];
+  }
+
+  bool faceHasVertex(const CalCoreSubmesh::Face& face, int vertexId)
+  {
+    return (face.vertexId[0] == vertexId) || (face.vertexId[1] == vertexId) || (face.vertexId[2] == vertexId);
+  }
+
+  CalVector faceNormal(const CalVector& p0, const CalVector& p1, const CalVector& p2)
+  {
+    return (p1 - p0) % (p2 - p0);
+  }
+
+  void collectNeighbours(Reduction& reduction, int vertexId, std::vector<int>& vectorNeighbour)
+  {
+    vectorNeighbour.clear();
+
+    std::vector<int>& vectorVertexFace = reduction.vectorvectorVertexFace[vertexId];
+    for(size_t i = 0; i < vectorVertexFace.size(); i++)
+    {
+      int faceId = vectorVertexFace[i];
+      if(!reduction.vectorFaceAlive[faceId]) continue;
+
+      for(int j = 0; j < 3; j++)
+      {
+        int neighbourId = reduction.vectorFace[faceId].vertexId[j];
+        if(neighbourId != vertexId) vectorNeighbour.push_back(neighbourId);
+      }
+    }
+
+    std::sort(vectorNeighbour.begin(), vectorNeighbour.end());
+    vectorNeighbour.erase(std::unique(vectorNeighbour.begin(), vectorNeighbour.end()), vectorNeighbour.end());
+  }
+
+  double influenceDistance(Reduction& reduction, int vertexId, int targetId)
+  {
+    std::vector<CalCoreSubmesh::Vertex>& vectorVertex = reduction.pCoreSubmesh->getVectorVertex();
+    std::vector<CalCoreSubmesh::Influence>& vectorInfluence = reduction.pCoreSubmesh->getVectorInfluence();
+
+    const CalCoreSubmesh::Influence *pInfluence = &vectorInfluence[0] + reduction.vectorFirstInfluence[vertexId];
+    const CalCoreSubmesh::Influence *pTargetInfluence = &vectorInfluence[0] + reduction.vectorFirstInfluence[targetId];
+    int influenceCount = vectorVertex[vertexId].influenceCount;
+    int targetInfluenceCount = vectorVertex[targetId].influenceCount;
+
+    // L1 distance between the two weight vectors over all bones
+    double distance = 0.0;
+    int i, j;
+    for(i = 0; i < influenceCount; i++)
+    {
+      double weight = pInfluence[i].weight;
+      for(j = 0; j < targetInfluenceCount; j++)
+      {
+        if(pTargetInfluence[j].boneId == pInfluence[i].boneId)
+        {
+          weight -= pTargetInfluence[j].weight;
+          break;
+        }
+      }
+      distance += fabs(weight);
+    }
+    for(j = 0; j < targetInfluenceCount; j++)
+    {
+      for(i = 0; i < influenceCount; i++)
+      {
+        if(pInfluence[i].boneId == pTargetInfluence[j].boneId) break;
+      }
+      if(i == influenceCount) distance += fabs(pTargetInfluence[j].weight);
+    }
+
+    return distance;
+  }
+
+  double textureCoordinateDistance(Reduction& reduction, int vertexId, int targetId)
+  {
+    std::vector<std::vector<CalCoreSubmesh::TextureCoordinate> >& vectorvectorTextureCoordinate = reduction.pCoreSubmesh->getVectorVectorTextureCoordinate();
+
+    double distance = 0.0;
+    for(size_t mapId = 0; mapId < vectorvectorTextureCoordinate.size(); mapId++)
+    {
+      std::vector<CalCoreSubmesh::TextureCoordinate>& vectorTextureCoordinate = vectorvectorTextureCoordinate[mapId];
+      if(vectorTextureCoordinate.size() != reduction.vectorQuadric.size()) continue;
+
+      double du = vectorTextureCoordinate[vertexId].u - vectorTextureCoordinate[targetId].u;
+      double dv = vectorTextureCoordinate[vertexId].v - vectorTextureCoordinate[targetId].v;
+      distance += du * du + dv * dv;
+    }
+
+    return distance;
+  }
+
+  bool evaluateCollapse(Reduction& reduction, int vertexId, int targetId, const std::vector<int>& vectorNeighbour, std::vector<int>& vectorTargetNeighbour, double& cost)
+  {
+    std::vector<CalCoreSubmesh::Vertex>& vectorVertex = reduction.pCoreSubmesh->getVectorVertex();
+    const CalVector& targetPosition = vectorVertex[targetId].position;
+
+    // the collapse must keep the mesh manifold: the only common neighbours of
+    // the two vertices are the opposite corners of the faces on their edge
+    collectNeighbours(reduction, targetId, vectorTargetNeighbour);
+
+    int commonCount = 0;
+    size_t i = 0, j = 0;
+    while((i < vectorNeighbour.size()) && (j < vectorTargetNeighbour.size()))
+    {
+      if(vectorNeighbour[i] < vectorTargetNeighbour[j]) i++;
+      else if(vectorTargetNeighbour[j] < vectorNeighbour[i]) j++;
+      else { commonCount++; i++; j++; }
+    }
+
+    int sharedFaceCount = 0;
+    std::vector<int>& vectorVertexFace = reduction.vectorvectorVertexFace[vertexId];
+    for(i = 0; i < vectorVertexFace.size(); i++)
+    {
+      int faceId = vectorVertexFace[i];
+      if(!reduction.vectorFaceAlive[faceId]) continue;
+
+      const CalCoreSubmesh::Face& face = reduction.vectorFace[faceId];
+      if(faceHasVertex(face, targetId))
+      {
+        sharedFaceCount++;
+        continue;
+      }
+
+      // the remaining faces must not flip or degenerate when the vertex moves
+      CalVector p[3], q[3];
+      for(int k = 0; k < 3; k++)
+      {
+        p[k] = vectorVertex[face.vertexId[k]].position;
+        q[k] = (face.vertexId[k] == vertexId) ? targetPosition : p[k];
+      }
+
+      CalVector normal = faceNormal(p[0], p[1], p[2]);
+      CalVector newNormal = faceNormal(q[0], q[1], q[2]);
+      if(newNormal.length() <= 1e-6f * normal.length()) return false;
+      if(normal * newNormal <= 0.0f) return false;
+    }
+
+    if((sharedFaceCount == 0) || (commonCount != sharedFaceCount)) return false;
+
+    cost = evaluateQuadric(reduction.vectorQuadric[vertexId], targetPosition) + evaluateQuadric(reduction.vectorQuadric[targetId], targetPosition);
+    if(reduction.influencePenalty > 0.0) cost += reduction.influencePenalty * influenceDistance(reduction, vertexId, targetId);
+    if(reduction.textureCoordinatePenalty > 0.0) cost += reduction.textureCoordinatePenalty * textureCoordinateDistance(reduction, vertexId, targetId);
+
+    return true;
+  }
+
+  void pushBestCollapse(Reduction& reduction, int vertexId, std::priority_queue<Collapse>& queueCollapse)
+  {
+    // any queued collapse of this vertex is outdated from now on
+    reduction.vectorStamp[vertexId]++;
+    if(reduction.vectorLocked[vertexId] || reduction.vectorCollapsed[vertexId]) return;
+
+    std::vector<int> vectorNeighbour;
+    std::vector<int> vectorTargetNeighbour;
+    collectNeighbours(reduction, vertexId, vectorNeighbour);
+
+    Collapse best;
+    best.cost = 0.0;
+    best.vertexId = vertexId;
+    best.targetId = -1;
+    best.stamp = reduction.vectorStamp[vertexId];
+
+    for(size_t i = 0; i < vectorNeighbour.size(); i++)
+    {
+      double cost;
+      if(!evaluateCollapse(reduction, vertexId, vectorNeighbour[i], vectorNeighbour, vectorTargetNeighbour, cost)) continue;
+
+      if((best.targetId == -1) || (cost < best.cost))
+      {
+        best.cost = cost;
+        best.targetId = vectorNeighbour[i];
+      }
+    }
+
+    if(best.targetId != -1) queueCollapse.push(best);
+  }
+
+  struct PositionLess
+  {
+    const CalCoreSubmesh::Vertex *pVertex;
+
+    bool operator()(int a, int b) const
+    {
+      const CalVector& pa = pVertex[a].position;
+      const CalVector& pb = pVertex[b].position;
+      if(pa.x != pb.x) return pa.x < pb.x;
+      if(pa.y != pb.y) return pa.y < pb.y;
+      if(pa.z != pb.z) return pa.z < pb.z;
+      return a < b;
+    }
+  };
+}
+
+ /*****************************************************************************/
+/** Constructs the LOD builder instance.
+  *
+  * This function is the default constructor of the LOD builder instance.
+  *****************************************************************************/
+
+CalLodBuilder::CalLodBuilder()
+{
+  m_influenceWeight = 0.01f;
+  m_textureCoordinateWeight = 0.1f;
+  m_minFaceRatio = 0.0f;
+}
+
+ /*****************************************************************************/
+/** Destructs the LOD builder instance.
+  *
+  * This function is the destructor of the LOD builder instance.
+  *****************************************************************************/
+
+CalLodBuilder::~CalLodBuilder()
+{
+}
+
+ /*****************************************************************************/
+/** Builds the LOD of all core submeshes of a core model.
+  *
+  * This function runs buildCoreSubmesh() on every core submesh of a core
+  * model instance.
+  *
+  * @param pCoreModel A pointer to the core model instance.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLodBuilder::buildCoreModel(CalCoreModel *pCoreModel)
+{
+  if(pCoreModel == 0)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return false;
+  }
+
+  for(int submeshId = 0; submeshId < pCoreModel->getCoreSubmeshCount(); submeshId++)
+  {
+    if(!buildCoreSubmesh(pCoreModel->getCoreSubmesh(submeshId))) return false;
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Builds the LOD of a core submesh.
+  *
+  * This function reduces a core submesh by repeatedly collapsing the vertex
+  * with the cheapest quadric error into one of its neighbours. Vertices on
+  * borders and UV seams (shared positions), spring and physical vertices are
+  * never removed, and collapses between differently weighted or textured
+  * vertices are penalized. The vertices and faces are then reordered so that
+  * the first collapsed vertex is the last one, the LOD control data and LOD
+  * count are set and the LOD steps are rebuilt.
+  *
+  * @param pCoreSubmesh A pointer to the core submesh instance.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLodBuilder::buildCoreSubmesh(CalCoreSubmesh *pCoreSubmesh)
+{
+  if(pCoreSubmesh == 0)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return false;
+  }
+
+  std::vector<CalCoreSubmesh::Vertex>& vectorVertex = pCoreSubmesh->getVectorVertex();
+  int vertexCount = vectorVertex.size();
+  int faceCount = pCoreSubmesh->getVectorFace().size();
+
+  Reduction reduction;
+  reduction.pCoreSubmesh = pCoreSubmesh;
+  reduction.vectorFace = pCoreSubmesh->getVectorFace();
+  reduction.vectorFaceAlive.assign(faceCount, true);
+  reduction.vectorvectorVertexFace.resize(vertexCount);
+  reduction.vectorLocked.assign(vertexCount, false);
+  reduction.vectorCollapsed.assign(vertexCount, false);
+  reduction.vectorStamp.assign(vertexCount, 0);
+  reduction.vectorFirstInfluence.resize(vertexCount);
+
+  Quadric zeroQuadric;
+  std::fill(zeroQuadric.m, zeroQuadric.m + 10, 0.0);
+  reduction.vectorQuadric.assign(vertexCount, zeroQuadric);
+
+  int vertexId, faceId;
+
+  int influenceCount = 0;
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    reduction.vectorFirstInfluence[vertexId] = influenceCount;
+    influenceCount += vectorVertex[vertexId].influenceCount;
+  }
+  if(influenceCount > (int)pCoreSubmesh->getVectorInfluence().size())
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalLodBuilder::buildCoreSubmesh");
+    return false;
+  }
+
+  // build the face adjacency and quadrics, and count the uses of every edge
+  std::vector<std::pair<int, int> > vectorEdge;
+  vectorEdge.reserve(faceCount * 3);
+
+  CalVector minimum, maximum;
+  if(vertexCount > 0)
+  {
+    minimum = vectorVertex[0].position;
+    maximum = vectorVertex[0].position;
+  }
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    const CalVector& position = vectorVertex[vertexId].position;
+    minimum.x = std::min(minimum.x, position.x); maximum.x = std::max(maximum.x, position.x);
+    minimum.y = std::min(minimum.y, position.y); maximum.y = std::max(maximum.y, position.y);
+    minimum.z = std::min(minimum.z, position.z); maximum.z = std::max(maximum.z, position.z);
+  }
+
+  for(faceId = 0; faceId < faceCount; faceId++)
+  {
+    const CalCoreSubmesh::Face& face = reduction.vectorFace[faceId];
+
+    int k;
+    for(k = 0; k < 3; k++)
+    {
+      if((face.vertexId[k] < 0) || (face.vertexId[k] >= vertexCount))
+      {
+        CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalLodBuilder::buildCoreSubmesh");
+        return false;
+      }
+    }
+
+    // degenerate faces stay where they are and take no part in the reduction
+    if((face.vertexId[0] == face.vertexId[1]) || (face.vertexId[1] == face.vertexId[2]) || (face.vertexId[0] == face.vertexId[2]))
+    {
+      reduction.vectorFaceAlive[faceId] = false;
+      continue;
+    }
+
+    CalVector normal = faceNormal(vectorVertex[face.vertexId[0]].position, vectorVertex[face.vertexId[1]].position, vectorVertex[face.vertexId[2]].position);
+    float length = normal.length();
+    if(length > 0.0f)
+    {
+      normal /= length;
+      double d = -(normal * vectorVertex[face.vertexId[0]].position);
+      for(k = 0; k < 3; k++) addPlane(reduction.vectorQuadric[face.vertexId[k]], normal.x, normal.y, normal.z, d);
+    }
+
+    for(k = 0; k < 3; k++)
+    {
+      int a = face.vertexId[k];
+      int b = face.vertexId[(k + 1) % 3];
+      reduction.vectorvectorVertexFace[a].push_back(faceId);
+      vectorEdge.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+    }
+  }
+
+  // lock the border and non-manifold vertices
+  std::sort(vectorEdge.begin(), vectorEdge.end());
+  size_t edgeId = 0;
+  while(edgeId < vectorEdge.size())
+  {
+    size_t edgeEnd = edgeId + 1;
+    while((edgeEnd < vectorEdge.size()) && (vectorEdge[edgeEnd] == vectorEdge[edgeId])) edgeEnd++;
+    if(edgeEnd - edgeId != 2)
+    {
+      reduction.vectorLocked[vectorEdge[edgeId].first] = true;
+      reduction.vectorLocked[vectorEdge[edgeId].second] = true;
+    }
+    edgeId = edgeEnd;
+  }
+
+  // lock the vertices that share their position with another one (UV and normal seams)
+  if(vertexCount > 0)
+  {
+    std::vector<int> vectorSorted(vertexCount);
+    for(vertexId = 0; vertexId < vertexCount; vertexId++) vectorSorted[vertexId] = vertexId;
+
+    PositionLess positionLess;
+    positionLess.pVertex = &vectorVertex[0];
+    std::sort(vectorSorted.begin(), vectorSorted.end(), positionLess);
+
+    for(vertexId = 1; vertexId < vertexCount; vertexId++)
+    {
+      const CalVector& a = vectorVertex[vectorSorted[vertexId - 1]].position;
+      const CalVector& b = vectorVertex[vectorSorted[vertexId]].position;
+      if((a.x == b.x) && (a.y == b.y) && (a.z == b.z))
+      {
+        reduction.vectorLocked[vectorSorted[vertexId - 1]] = true;
+        reduction.vectorLocked[vectorSorted[vertexId]] = true;
+      }
+    }
+  }
+
+  // lock the vertices driven by the spring system
+  std::vector<CalCoreSubmesh::PhysicalProperty>& vectorPhysicalProperty = pCoreSubmesh->getVectorPhysicalProperty();
+  if((int)vectorPhysicalProperty.size() == vertexCount)
+  {
+    for(vertexId = 0; vertexId < vertexCount; vertexId++)
+    {
+      if(vectorPhysicalProperty[vertexId].weight > 0.0f) reduction.vectorLocked[vertexId] = true;
+    }
+  }
+
+  std::vector<CalCoreSubmesh::Spring>& vectorSpring = pCoreSubmesh->getVectorSpring();
+  for(size_t springId = 0; springId < vectorSpring.size(); springId++)
+  {
+    for(int k = 0; k < 2; k++)
+    {
+      int springVertexId = vectorSpring[springId].vertexId[k];
+      if((springVertexId >= 0) && (springVertexId < vertexCount)) reduction.vectorLocked[springVertexId] = true;
+    }
+  }
+
+  // scale the penalties with the model size, so they are comparable to the quadric error
+  double scale = (maximum - minimum).length();
+  reduction.influencePenalty = m_influenceWeight * scale * scale;
+  reduction.textureCoordinatePenalty = m_textureCoordinateWeight * scale * scale;
+
+  // collapse the cheapest vertices until no valid collapse is left
+  std::priority_queue<Collapse> queueCollapse;
+  for(vertexId = 0; vertexId < vertexCount; vertexId++) pushBestCollapse(reduction, vertexId, queueCollapse);
+
+  int minFaceCount = (int)(m_minFaceRatio * faceCount);
+  int aliveFaceCount = 0;
+  for(faceId = 0; faceId < faceCount; faceId++) if(reduction.vectorFaceAlive[faceId]) aliveFaceCount++;
+
+  std::vector<int> vectorCollapseOrder;
+  std::vector<int> vectorCollapseTarget(vertexCount, -1);
+  std::vector<int> vectorCollapseFaceCount(vertexCount, 0);
+  std::vector<int> vectorRemovedFace;
+  std::vector<int> vectorNeighbour;
+  std::vector<int> vectorTargetNeighbour;
+
+  while(!queueCollapse.empty() && (aliveFaceCount > minFaceCount))
+  {
+    Collapse collapse = queueCollapse.top();
+    queueCollapse.pop();
+
+    vertexId = collapse.vertexId;
+    if(reduction.vectorCollapsed[vertexId] || (collapse.stamp != reduction.vectorStamp[vertexId])) continue;
+
+    // the neighbourhood may have changed since the collapse was queued
+    collectNeighbours(reduction, vertexId, vectorNeighbour);
+    double cost;
+    if(!std::binary_search(vectorNeighbour.begin(), vectorNeighbour.end(), collapse.targetId)
+    || !evaluateCollapse(reduction, vertexId, collapse.targetId, vectorNeighbour, vectorTargetNeighbour, cost)
+    || (cost > collapse.cost))
+    {
+      pushBestCollapse(reduction, vertexId, queueCollapse);
+      continue;
+    }
+
+    int targetId = collapse.targetId;
+
+    // remove the faces on the collapsed edge and move the others to the target
+    int removedFaceCount = 0;
+    std::vector<int>& vectorVertexFace = reduction.vectorvectorVertexFace[vertexId];
+    for(size_t i = 0; i < vectorVertexFace.size(); i++)
+    {
+      faceId = vectorVertexFace[i];
+      if(!reduction.vectorFaceAlive[faceId]) continue;
+
+      CalCoreSubmesh::Face& face = reduction.vectorFace[faceId];
+      if(faceHasVertex(face, targetId))
+      {
+        reduction.vectorFaceAlive[faceId] = false;
+        vectorRemovedFace.push_back(faceId);
+        removedFaceCount++;
+      }
+      else
+      {
+        for(int k = 0; k < 3; k++) if(face.vertexId[k] == vertexId) face.vertexId[k] = targetId;
+        reduction.vectorvectorVertexFace[targetId].push_back(faceId);
+      }
+    }
+    aliveFaceCount -= removedFaceCount;
+
+    for(int k = 0; k < 10; k++) reduction.vectorQuadric[targetId].m[k] += reduction.vectorQuadric[vertexId].m[k];
+
+    reduction.vectorCollapsed[vertexId] = true;
+    vectorCollapseOrder.push_back(vertexId);
+    vectorCollapseTarget[vertexId] = targetId;
+    vectorCollapseFaceCount[vertexId] = removedFaceCount;
+
+    // re-evaluate the vertices around the target
+    pushBestCollapse(reduction, targetId, queueCollapse);
+    collectNeighbours(reduction, targetId, vectorNeighbour);
+    for(size_t i = 0; i < vectorNeighbour.size(); i++) pushBestCollapse(reduction, vectorNeighbour[i], queueCollapse);
+  }
+
+  // store the LOD control data while the vertex IDs are still the original ones
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    if(!pCoreSubmesh->setLodControl(vertexId, vectorCollapseFaceCount[vertexId], vectorCollapseTarget[vertexId]))
+    {
+      CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalLodBuilder::buildCoreSubmesh");
+      return false;
+    }
+  }
+
+  // the kept vertices come first, followed by the collapsed ones in reverse collapse order
+  std::vector<int> vectorVertexOrder;
+  vectorVertexOrder.reserve(vertexCount);
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    if(!reduction.vectorCollapsed[vertexId]) vectorVertexOrder.push_back(vertexId);
+  }
+  vectorVertexOrder.insert(vectorVertexOrder.end(), vectorCollapseOrder.rbegin(), vectorCollapseOrder.rend());
+
+  // the same goes for the faces, whose removed ones are grouped by collapse
+  std::vector<bool> vectorFaceRemoved(faceCount, false);
+  size_t removedId;
+  for(removedId = 0; removedId < vectorRemovedFace.size(); removedId++) vectorFaceRemoved[vectorRemovedFace[removedId]] = true;
+
+  std::vector<int> vectorFaceOrder;
+  vectorFaceOrder.reserve(faceCount);
+  for(faceId = 0; faceId < faceCount; faceId++)
+  {
+    if(!vectorFaceRemoved[faceId]) vectorFaceOrder.push_back(faceId);
+  }
+
+  size_t groupEnd = vectorRemovedFace.size();
+  for(int collapseId = vectorCollapseOrder.size() - 1; collapseId >= 0; collapseId--)
+  {
+    size_t groupStart = groupEnd - vectorCollapseFaceCount[vectorCollapseOrder[collapseId]];
+    vectorFaceOrder.insert(vectorFaceOrder.end(), vectorRemovedFace.begin() + groupStart, vectorRemovedFace.begin() + groupEnd);
+    groupEnd = groupStart;
+  }
+
+  if(!pCoreSubmesh->reorderVertices(vectorVertexOrder)) return false;
+  if(!pCoreSubmesh->reorderFaces(vectorFaceOrder)) return false;
+
+  pCoreSubmesh->setLodCount(vectorCollapseOrder.size());
+
+  return pCoreSubmesh->buildLodSteps(CalCoreSubmesh::DEFAULT_LOD_STEP_COUNT);
+}
+
+ /*****************************************************************************/
+/** Returns the influence weight.
+  *
+  * This function returns the penalty for collapsing vertices with different
+  * bone influences.
+  *
+  * @return The influence weight.
+  *****************************************************************************/
+
+float CalLodBuilder::getInfluenceWeight()
+{
+  return m_influenceWeight;
+}
+
+ /*****************************************************************************/
+/** Returns the minimum face ratio.
+  *
+  * This function returns the fraction of the faces at which the reduction
+  * stops.
+  *
+  * @return The minimum face ratio.
+  *****************************************************************************/
+
+float CalLodBuilder::getMinFaceRatio()
+{
+  return m_minFaceRatio;
+}
+
+ /*****************************************************************************/
+/** Returns the texture coordinate weight.
+  *
+  * This function returns the penalty for collapsing vertices with different
+  * texture coordinates.
+  *
+  * @return The texture coordinate weight.
+  *****************************************************************************/
+
+float CalLodBuilder::getTextureCoordinateWeight()
+{
+  return m_textureCoordinateWeight;
+}
+
+ /*****************************************************************************/
+/** Sets the influence weight.
+  *
+  * This function sets the penalty for collapsing vertices with different bone
+  * influences. It is multiplied by the L1 distance of the two weight vectors
+  * and the squared model size.
+  *
+  * @param influenceWeight The influence weight.
+  *****************************************************************************/
+
+void CalLodBuilder::setInfluenceWeight(float influenceWeight)
+{
+  m_influenceWeight = influenceWeight;
+}
+
+ /*****************************************************************************/
+/** Sets the minimum face ratio.
+  *
+  * This function sets the fraction of the faces at which the reduction
+  * stops. The default of 0 reduces the submesh as far as possible.
+  *
+  * @param minFaceRatio The minimum face ratio.
+  *****************************************************************************/
+
+void CalLodBuilder::setMinFaceRatio(float minFaceRatio)
+{
+  m_minFaceRatio = minFaceRatio;
+}
+
+ /*****************************************************************************/
+/** Sets the texture coordinate weight.
+  *
+  * This function sets the penalty for collapsing vertices with different
+  * texture coordinates. It is multiplied by the squared texture coordinate
+  * distance and the squared model size.
+  *
+  * @param textureCoordinateWeight The texture coordinate weight.
+  *****************************************************************************/
+
+void CalLodBuilder::setTextureCoordinateWeight(float textureCoordinateWeight)
+{
+  m_textureCoordinateWeight = textureCoordinateWeight;
+}
+
+//****************************************************************************//
@@ -0,0 +1,67 @@
+//****************************************************************************//
+// lodbuilder.h                                                               //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_LODBUILDER_H
+#define CAL_LODBUILDER_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+
+//****************************************************************************//
+// Forward declarations                                                       //
+//****************************************************************************//
+
+class CalCoreModel;
+class CalCoreSubmesh;
+
+//****************************************************************************//
+// Class declaration                                                          //
+//****************************************************************************//
+
+ /*****************************************************************************/
+/** The LOD builder class.
+  *
+  * This class generates the progressive mesh LOD of a core submesh. Vertices
+  * are removed by quadric error driven edge collapses, the submesh is
+  * reordered into collapse order and its LOD control data is filled, so the
+  * result can be saved with CalSaver and used by CalSubmesh::setLodLevel().
+  *****************************************************************************/
+
+class CAL3D_API CalLodBuilder
+{
+// member variables
+protected:
+  float m_influenceWeight;
+  float m_textureCoordinateWeight;
+  float m_minFaceRatio;
+
+// constructors/destructor
+public:
+  CalLodBuilder();
+  virtual ~CalLodBuilder();
+
+// member functions
+public:
+  bool buildCoreModel(CalCoreModel *pCoreModel);
+  bool buildCoreSubmesh(CalCoreSubmesh *pCoreSubmesh);
+  float getInfluenceWeight();
+  float getMinFaceRatio();
+  float getTextureCoordinateWeight();
+  void setInfluenceWeight(float influenceWeight);
+  void setMinFaceRatio(float minFaceRatio);
+  void setTextureCoordinateWeight(float textureCoordinateWeight);
+};
+
+#endif
+
+//****************************************************************************//
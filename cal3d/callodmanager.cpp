@@ -0,0 +1,686 @@
+#include "stdafx.h"
+//****************************************************************************//
+// lodmanager.cpp                                                             //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "callodmanager.h"
+#include "calerror.h"
+#include "calmodel.h"
+#include "calsub.h"
+#include "calcoresub.h"
+
+#include <algorithm>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  /// Orders instance IDs by ascending screen size.
+  struct ScreenSizeLess
+  {
+    const std::vector<float> *pVectorScreenSize;
+
+    bool operator()(int a, int b) const
+    {
+      return (*pVectorScreenSize)[a] < (*pVectorScreenSize)[b];
+    }
+  };
+}
+
+ /*****************************************************************************/
+/** Constructs the LOD manager instance.
+  *
+  * This function is the default constructor of the LOD manager instance.
+  *****************************************************************************/
+
+CalLodManager::CalLodManager()
+{
+  m_triangleBudget = 0;
+  m_vertexBudget = 0;
+  m_hysteresis = 0.05f;
+  m_minLodLevel = 0.0f;
+  m_maxSkinningInterval = 1;
+  m_frame = 0;
+
+  m_statistics.modelCount = 0;
+  m_statistics.triangleCount = 0;
+  m_statistics.triangleBudget = 0;
+  m_statistics.vertexCount = 0;
+  m_statistics.vertexBudget = 0;
+  m_statistics.reducedModelCount = 0;
+  m_statistics.skinningReducedModelCount = 0;
+  m_statistics.bOverBudget = false;
+}
+
+ /*****************************************************************************/
+/** Destructs the LOD manager instance.
+  *
+  * This function is the destructor of the LOD manager instance.
+  *****************************************************************************/
+
+CalLodManager::~CalLodManager()
+{
+}
+
+ /*****************************************************************************/
+/** Adds a model instance.
+  *
+  * This function puts a model instance under the control of the LOD manager.
+  * The model must be removed again before it is destroyed.
+  *
+  * @param pModel A pointer to the model instance.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLodManager::addModel(CalModel *pModel)
+{
+  if((pModel == 0) || (findInstance(pModel) != -1))
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return false;
+  }
+
+  Instance instance;
+  instance.pModel = pModel;
+  instance.screenSize = 1.0f;
+  instance.lodLevel = -1.0f;
+  instance.skinningInterval = 1;
+  instance.skinningPhase = m_vectorInstance.size();
+  instance.triangleCount = 0;
+  instance.vertexCount = 0;
+
+  m_vectorInstance.push_back(instance);
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Counts the triangles and vertices of a model at a LOD level.
+  *
+  * This function sums up the face and vertex counts of all submeshes of a
+  * model instance at the LOD step a LOD level selects.
+  *
+  * @param pModel A pointer to the model instance.
+  * @param lodLevel The LOD level.
+  * @param triangleCount The variable the triangle count is written to.
+  * @param vertexCount The variable the vertex count is written to.
+  *****************************************************************************/
+
+void CalLodManager::countModel(CalModel *pModel, float lodLevel, size_t& triangleCount, size_t& vertexCount)
+{
+  triangleCount = 0;
+  vertexCount = 0;
+
+  for(int submeshId = 0; submeshId < pModel->getSubmeshCount(); submeshId++)
+  {
+    CalCoreSubmesh *pCoreSubmesh = pModel->getSubmesh(submeshId)->getCoreSubmesh();
+
+    int lodStepId = pCoreSubmesh->findLodStep(lodLevel);
+    if(lodStepId == -1)
+    {
+      triangleCount += pCoreSubmesh->getFaceCount();
+      vertexCount += pCoreSubmesh->getVertexCount();
+    }
+    else
+    {
+      const CalCoreSubmesh::LodStep& lodStep = pCoreSubmesh->getVectorLodStep()[lodStepId];
+      triangleCount += lodStep.faceCount;
+      vertexCount += lodStep.vertexCount;
+    }
+  }
+}
+
+ /*****************************************************************************/
+/** Finds a model instance.
+  *
+  * This function returns the index of a managed model instance.
+  *
+  * @param pModel A pointer to the model instance.
+  *
+  * @return One of the following values:
+  *         \li the index of the model instance
+  *         \li \b -1 if the model instance is not managed
+  *****************************************************************************/
+
+int CalLodManager::findInstance(CalModel *pModel)
+{
+  for(int instanceId = 0; instanceId < (int)m_vectorInstance.size(); instanceId++)
+  {
+    if(m_vectorInstance[instanceId].pModel == pModel) return instanceId;
+  }
+
+  return -1;
+}
+
+ /*****************************************************************************/
+/** Returns the hysteresis.
+  *
+  * This function returns the LOD level change below which an instance keeps
+  * its current level.
+  *
+  * @return The hysteresis.
+  *****************************************************************************/
+
+float CalLodManager::getHysteresis()
+{
+  return m_hysteresis;
+}
+
+ /*****************************************************************************/
+/** Returns the assigned LOD level of a model instance.
+  *
+  * This function returns the LOD level the last update assigned to a model
+  * instance.
+  *
+  * @param pModel A pointer to the model instance.
+  *
+  * @return One of the following values:
+  *         \li the LOD level
+  *         \li \b -1.0 if the model instance is not managed
+  *****************************************************************************/
+
+float CalLodManager::getLodLevel(CalModel *pModel)
+{
+  int instanceId = findInstance(pModel);
+  if(instanceId == -1) return -1.0f;
+
+  return m_vectorInstance[instanceId].lodLevel;
+}
+
+ /*****************************************************************************/
+/** Returns the maximum skinning interval.
+  *
+  * This function returns the largest number of frames between two skinning
+  * updates of a model instance.
+  *
+  * @return The maximum skinning interval.
+  *****************************************************************************/
+
+int CalLodManager::getMaxSkinningInterval()
+{
+  return m_maxSkinningInterval;
+}
+
+ /*****************************************************************************/
+/** Returns the minimum LOD level.
+  *
+  * This function returns the lowest LOD level the manager assigns.
+  *
+  * @return The minimum LOD level.
+  *****************************************************************************/
+
+float CalLodManager::getMinLodLevel()
+{
+  return m_minLodLevel;
+}
+
+ /*****************************************************************************/
+/** Returns the skinning interval of a model instance.
+  *
+  * This function returns the number of frames between two skinning updates
+  * the last update assigned to a model instance.
+  *
+  * @param pModel A pointer to the model instance.
+  *
+  * @return One of the following values:
+  *         \li the skinning interval
+  *         \li \b -1 if the model instance is not managed
+  *****************************************************************************/
+
+int CalLodManager::getSkinningInterval(CalModel *pModel)
+{
+  int instanceId = findInstance(pModel);
+  if(instanceId == -1) return -1;
+
+  return m_vectorInstance[instanceId].skinningInterval;
+}
+
+ /*****************************************************************************/
+/** Returns the budget usage.
+  *
+  * This function returns the budget usage of the last update, for telemetry.
+  * The vertex count is the number of vertices skinned per frame, taking the
+  * skinning intervals into account.
+  *
+  * @return The statistics of the last update.
+  *****************************************************************************/
+
+const CalLodManager::Statistics& CalLodManager::getStatistics()
+{
+  return m_statistics;
+}
+
+ /*****************************************************************************/
+/** Returns the LOD level of an instance at a global scale.
+  *
+  * This function maps the screen size of an instance to a LOD level.
+  *
+  * @param instance The instance.
+  * @param scale The global detail scale.
+  *
+  * @return The LOD level.
+  *****************************************************************************/
+
+float CalLodManager::getTargetLodLevel(const Instance& instance, float scale)
+{
+  float lodLevel = scale * instance.screenSize;
+  if(lodLevel > 1.0f) lodLevel = 1.0f;
+  if(lodLevel < m_minLodLevel) lodLevel = m_minLodLevel;
+
+  return lodLevel;
+}
+
+ /*****************************************************************************/
+/** Returns the triangle budget.
+  *
+  * This function returns the number of triangles per frame the managed
+  * instances may draw. 0 means unlimited.
+  *
+  * @return The triangle budget.
+  *****************************************************************************/
+
+size_t CalLodManager::getTriangleBudget()
+{
+  return m_triangleBudget;
+}
+
+ /*****************************************************************************/
+/** Returns the vertex budget.
+  *
+  * This function returns the number of vertices per frame the managed
+  * instances may skin. 0 means unlimited.
+  *
+  * @return The vertex budget.
+  *****************************************************************************/
+
+size_t CalLodManager::getVertexBudget()
+{
+  return m_vertexBudget;
+}
+
+ /*****************************************************************************/
+/** Returns whether a model instance should be skinned this frame.
+  *
+  * This function tells the application whether to update the vertices of a
+  * model instance in the current frame. The instances that share a skinning
+  * interval are spread evenly over the frames.
+  *
+  * @param pModel A pointer to the model instance.
+  *
+  * @return One of the following values:
+  *         \li \b true if the model instance is due
+  *         \li \b false if it is not
+  *****************************************************************************/
+
+bool CalLodManager::isSkinningDue(CalModel *pModel)
+{
+  int instanceId = findInstance(pModel);
+  if(instanceId == -1) return true;
+
+  const Instance& instance = m_vectorInstance[instanceId];
+
+  return ((m_frame + instance.skinningPhase) % instance.skinningInterval) == 0;
+}
+
+ /*****************************************************************************/
+/** Checks counts against the budget.
+  *
+  * @param triangleCount The number of triangles.
+  * @param vertexCount The number of vertices.
+  *
+  * @return One of the following values:
+  *         \li \b true if both counts are within the budget
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalLodManager::isWithinBudget(size_t triangleCount, size_t vertexCount)
+{
+  if((m_triangleBudget != 0) && (triangleCount > m_triangleBudget)) return false;
+  if((m_vertexBudget != 0) && (vertexCount > m_vertexBudget)) return false;
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Removes a model instance.
+  *
+  * This function releases a model instance from the LOD manager. Its LOD
+  * level is left as it is.
+  *
+  * @param pModel A pointer to the model instance.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLodManager::removeModel(CalModel *pModel)
+{
+  int instanceId = findInstance(pModel);
+  if(instanceId == -1)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return false;
+  }
+
+  m_vectorInstance.erase(m_vectorInstance.begin() + instanceId);
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Sets the distance of a model instance.
+  *
+  * This function sets the importance of a model instance from its distance to
+  * the camera, as the inverse of the distance. Use either this function or
+  * setScreenSize() for all instances.
+  *
+  * @param pModel A pointer to the model instance.
+  * @param distance The distance to the camera.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLodManager::setDistance(CalModel *pModel, float distance)
+{
+  if(distance <= 0.0f) return setScreenSize(pModel, 1e30f);
+
+  return setScreenSize(pModel, 1.0f / distance);
+}
+
+ /*****************************************************************************/
+/** Sets the hysteresis.
+  *
+  * This function sets the LOD level change below which an instance keeps its
+  * current level, to avoid switching back and forth between two levels. It
+  * is overridden when the budget would be exceeded.
+  *
+  * @param hysteresis The hysteresis.
+  *****************************************************************************/
+
+void CalLodManager::setHysteresis(float hysteresis)
+{
+  m_hysteresis = hysteresis;
+}
+
+ /*****************************************************************************/
+/** Sets the maximum skinning interval.
+  *
+  * This function sets the largest number of frames between two skinning
+  * updates of a model instance. The default of 1 disables skinning rate
+  * reductions.
+  *
+  * @param maxSkinningInterval The maximum skinning interval.
+  *****************************************************************************/
+
+void CalLodManager::setMaxSkinningInterval(int maxSkinningInterval)
+{
+  if(maxSkinningInterval < 1) maxSkinningInterval = 1;
+
+  m_maxSkinningInterval = maxSkinningInterval;
+}
+
+ /*****************************************************************************/
+/** Sets the minimum LOD level.
+  *
+  * This function sets the lowest LOD level the manager assigns.
+  *
+  * @param minLodLevel The minimum LOD level.
+  *****************************************************************************/
+
+void CalLodManager::setMinLodLevel(float minLodLevel)
+{
+  if(minLodLevel < 0.0f) minLodLevel = 0.0f;
+  if(minLodLevel > 1.0f) minLodLevel = 1.0f;
+
+  m_minLodLevel = minLodLevel;
+}
+
+ /*****************************************************************************/
+/** Sets the screen size of a model instance.
+  *
+  * This function sets the importance of a model instance, usually its
+  * projected size on the screen. An instance with a screen size of 1 keeps
+  * full detail as long as the budget allows it; 0 means not visible.
+  *
+  * @param pModel A pointer to the model instance.
+  * @param screenSize The screen size.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalLodManager::setScreenSize(CalModel *pModel, float screenSize)
+{
+  int instanceId = findInstance(pModel);
+  if(instanceId == -1)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return false;
+  }
+
+  if(screenSize < 0.0f) screenSize = 0.0f;
+  m_vectorInstance[instanceId].screenSize = screenSize;
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Sets the triangle budget.
+  *
+  * This function sets the number of triangles per frame the managed instances
+  * may draw. 0 means unlimited.
+  *
+  * @param triangleBudget The triangle budget.
+  *****************************************************************************/
+
+void CalLodManager::setTriangleBudget(size_t triangleBudget)
+{
+  m_triangleBudget = triangleBudget;
+}
+
+ /*****************************************************************************/
+/** Sets the vertex budget.
+  *
+  * This function sets the number of vertices per frame the managed instances
+  * may skin. 0 means unlimited.
+  *
+  * @param vertexBudget The vertex budget.
+  *****************************************************************************/
+
+void CalLodManager::setVertexBudget(size_t vertexBudget)
+{
+  m_vertexBudget = vertexBudget;
+}
+
+ /*****************************************************************************/
+/** Sums up the counts of all instances at a global scale.
+  *
+  * This function leaves out the instances that are not visible.
+  *
+  * @param scale The global detail scale.
+  * @param triangleCount The variable the triangle count is written to.
+  * @param vertexCount The variable the vertex count is written to.
+  *****************************************************************************/
+
+void CalLodManager::sumTargetCounts(float scale, size_t& triangleCount, size_t& vertexCount)
+{
+  triangleCount = 0;
+  vertexCount = 0;
+
+  std::vector<Instance>::iterator iteratorInstance;
+  for(iteratorInstance = m_vectorInstance.begin(); iteratorInstance != m_vectorInstance.end(); ++iteratorInstance)
+  {
+    // invisible instances are neither drawn nor skinned
+    if(iteratorInstance->screenSize <= 0.0f) continue;
+
+    size_t instanceTriangleCount, instanceVertexCount;
+    countModel(iteratorInstance->pModel, getTargetLodLevel(*iteratorInstance, scale), instanceTriangleCount, instanceVertexCount);
+    triangleCount += instanceTriangleCount;
+    vertexCount += instanceVertexCount;
+  }
+}
+
+ /*****************************************************************************/
+/** Updates the LOD of all managed instances.
+  *
+  * This function is called once per frame after the screen sizes are set. The
+  * LOD level of every instance is its screen size times a global scale, which
+  * is searched to be as large as the budget allows. Levels move only when the
+  * change exceeds the hysteresis, unless the budget requires it. If the vertex
+  * budget is still exceeded at the lowest levels, the skinning interval of the
+  * smallest instances is raised up to the maximum skinning interval.
+  * Instances with a screen size of 0 get the minimum LOD level and are left
+  * out of the budget, so they do not take detail away from visible ones.
+  *****************************************************************************/
+
+void CalLodManager::update()
+{
+  m_frame++;
+
+  int instanceCount = m_vectorInstance.size();
+  int instanceId;
+
+  // find the largest global scale that fits into the budget
+  float minScreenSize = 0.0f;
+  for(instanceId = 0; instanceId < instanceCount; instanceId++)
+  {
+    float screenSize = m_vectorInstance[instanceId].screenSize;
+    if((screenSize > 0.0f) && ((minScreenSize == 0.0f) || (screenSize < minScreenSize))) minScreenSize = screenSize;
+  }
+
+  size_t triangleCount, vertexCount;
+  float scale = (minScreenSize > 0.0f) ? 1.0f / minScreenSize : 1.0f;
+  sumTargetCounts(scale, triangleCount, vertexCount);
+  if(!isWithinBudget(triangleCount, vertexCount))
+  {
+    float lowScale = 0.0f;
+    float highScale = scale;
+    for(int iteration = 0; iteration < 20; iteration++)
+    {
+      float middleScale = 0.5f * (lowScale + highScale);
+      sumTargetCounts(middleScale, triangleCount, vertexCount);
+      if(isWithinBudget(triangleCount, vertexCount)) lowScale = middleScale;
+      else highScale = middleScale;
+    }
+    scale = lowScale;
+  }
+
+  // apply the hysteresis, but give way to the budget
+  std::vector<float> vectorTargetLodLevel(instanceCount);
+  triangleCount = 0;
+  vertexCount = 0;
+  for(instanceId = 0; instanceId < instanceCount; instanceId++)
+  {
+    Instance& instance = m_vectorInstance[instanceId];
+    float targetLodLevel = getTargetLodLevel(instance, scale);
+    vectorTargetLodLevel[instanceId] = targetLodLevel;
+
+    if((instance.lodLevel < 0.0f)
+    || (targetLodLevel > instance.lodLevel + m_hysteresis)
+    || (targetLodLevel < instance.lodLevel - m_hysteresis)
+    || ((targetLodLevel == 1.0f) && (instance.lodLevel < 1.0f))
+    || ((targetLodLevel == m_minLodLevel) && (instance.lodLevel > m_minLodLevel)))
+    {
+      instance.lodLevel = targetLodLevel;
+    }
+
+    if(instance.screenSize > 0.0f)
+    {
+      countModel(instance.pModel, instance.lodLevel, instance.triangleCount, instance.vertexCount);
+    }
+    else
+    {
+      instance.triangleCount = 0;
+      instance.vertexCount = 0;
+    }
+    triangleCount += instance.triangleCount;
+    vertexCount += instance.vertexCount;
+  }
+
+  std::vector<float> vectorScreenSize(instanceCount);
+  std::vector<int> vectorOrder(instanceCount);
+  for(instanceId = 0; instanceId < instanceCount; instanceId++)
+  {
+    vectorScreenSize[instanceId] = m_vectorInstance[instanceId].screenSize;
+    vectorOrder[instanceId] = instanceId;
+  }
+  ScreenSizeLess screenSizeLess;
+  screenSizeLess.pVectorScreenSize = &vectorScreenSize;
+  std::sort(vectorOrder.begin(), vectorOrder.end(), screenSizeLess);
+
+  int orderId;
+  for(orderId = 0; (orderId < instanceCount) && !isWithinBudget(triangleCount, vertexCount); orderId++)
+  {
+    Instance& instance = m_vectorInstance[vectorOrder[orderId]];
+    if((instance.screenSize <= 0.0f) || (instance.lodLevel <= vectorTargetLodLevel[vectorOrder[orderId]])) continue;
+
+    triangleCount -= instance.triangleCount;
+    vertexCount -= instance.vertexCount;
+    instance.lodLevel = vectorTargetLodLevel[vectorOrder[orderId]];
+    countModel(instance.pModel, instance.lodLevel, instance.triangleCount, instance.vertexCount);
+    triangleCount += instance.triangleCount;
+    vertexCount += instance.vertexCount;
+  }
+
+  // skin the smallest instances less often if the vertex budget is still exceeded
+  size_t skinnedVertexCount = vertexCount;
+  for(instanceId = 0; instanceId < instanceCount; instanceId++) m_vectorInstance[instanceId].skinningInterval = 1;
+
+  for(int skinningInterval = 2; skinningInterval <= m_maxSkinningInterval; skinningInterval *= 2)
+  {
+    for(orderId = 0; (orderId < instanceCount) && (m_vertexBudget != 0) && (skinnedVertexCount > m_vertexBudget); orderId++)
+    {
+      Instance& instance = m_vectorInstance[vectorOrder[orderId]];
+      if(instance.screenSize <= 0.0f) continue;
+
+      skinnedVertexCount -= instance.vertexCount / instance.skinningInterval;
+      instance.skinningInterval = skinningInterval;
+      skinnedVertexCount += instance.vertexCount / instance.skinningInterval;
+    }
+  }
+
+  // assign the levels and record the budget usage
+  m_statistics.modelCount = instanceCount;
+  m_statistics.triangleCount = triangleCount;
+  m_statistics.triangleBudget = m_triangleBudget;
+  m_statistics.vertexCount = skinnedVertexCount;
+  m_statistics.vertexBudget = m_vertexBudget;
+  m_statistics.reducedModelCount = 0;
+  m_statistics.skinningReducedModelCount = 0;
+
+  for(instanceId = 0; instanceId < instanceCount; instanceId++)
+  {
+    Instance& instance = m_vectorInstance[instanceId];
+    instance.pModel->setLodLevel(instance.lodLevel);
+
+    if(instance.lodLevel < 1.0f) m_statistics.reducedModelCount++;
+    if(instance.skinningInterval > 1) m_statistics.skinningReducedModelCount++;
+  }
+
+  m_statistics.bOverBudget = !isWithinBudget(triangleCount, skinnedVertexCount);
+}
+
+//****************************************************************************//
@@ -0,0 +1,117 @@
+//****************************************************************************//
+// lodmanager.h                                                               //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_LODMANAGER_H
+#define CAL_LODMANAGER_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+
+//****************************************************************************//
+// Forward declarations                                                       //
+//****************************************************************************//
+
+class CalModel;
+
+//****************************************************************************//
+// Class declaration                                                          //
+//****************************************************************************//
+
+ /*****************************************************************************/
+/** The LOD manager class.
+  *
+  * This class assigns the LOD levels of a set of model instances once per
+  * frame, so that their triangle and skinned vertex counts stay within a
+  * global budget. Instances with a larger screen size keep more detail. When
+  * the vertex budget can't be met by LOD alone, the least important instances
+  * are skinned only every few frames.
+  *****************************************************************************/
+
+class CAL3D_API CalLodManager
+{
+// misc
+public:
+  /// The budget usage of the last update.
+  struct Statistics
+  {
+    size_t modelCount;
+    size_t triangleCount;
+    size_t triangleBudget;
+    size_t vertexCount;
+    size_t vertexBudget;
+    size_t reducedModelCount;
+    size_t skinningReducedModelCount;
+    bool bOverBudget;
+  };
+
+protected:
+  struct Instance
+  {
+    CalModel *pModel;
+    float screenSize;
+    float lodLevel;
+    int skinningInterval;
+    int skinningPhase;
+    size_t triangleCount;
+    size_t vertexCount;
+  };
+
+// member variables
+protected:
+  std::vector<Instance> m_vectorInstance;
+  size_t m_triangleBudget;
+  size_t m_vertexBudget;
+  float m_hysteresis;
+  float m_minLodLevel;
+  int m_maxSkinningInterval;
+  unsigned int m_frame;
+  Statistics m_statistics;
+
+// constructors/destructor
+public:
+  CalLodManager();
+  virtual ~CalLodManager();
+
+// member functions
+public:
+  bool addModel(CalModel *pModel);
+  float getHysteresis();
+  float getLodLevel(CalModel *pModel);
+  int getMaxSkinningInterval();
+  float getMinLodLevel();
+  int getSkinningInterval(CalModel *pModel);
+  const Statistics& getStatistics();
+  size_t getTriangleBudget();
+  size_t getVertexBudget();
+  bool isSkinningDue(CalModel *pModel);
+  bool removeModel(CalModel *pModel);
+  bool setDistance(CalModel *pModel, float distance);
+  void setHysteresis(float hysteresis);
+  void setMaxSkinningInterval(int maxSkinningInterval);
+  void setMinLodLevel(float minLodLevel);
+  bool setScreenSize(CalModel *pModel, float screenSize);
+  void setTriangleBudget(size_t triangleBudget);
+  void setVertexBudget(size_t vertexBudget);
+  void update();
+
+protected:
+  static void countModel(CalModel *pModel, float lodLevel, size_t& triangleCount, size_t& vertexCount);
+  int findInstance(CalModel *pModel);
+  float getTargetLodLevel(const Instance& instance, float scale);
+  bool isWithinBudget(size_t triangleCount, size_t vertexCount);
+  void sumTargetCounts(float scale, size_t& triangleCount, size_t& vertexCount);
+};
+
+#endif
+
+//****************************************************************************//
@@ -0,0 +1,434 @@
+#include "stdafx.h"
+//****************************************************************************//
+// meshoptimizer.cpp                                                          //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calmeshoptimizer.h"
+#include "calerror.h"
+#include "calcoremodel.h"
+
+ /*****************************************************************************/
+/** Constructs the mesh optimizer instance.
+  *
+  * This function is the default constructor of the mesh optimizer instance.
+  *****************************************************************************/
+
+CalMeshOptimizer::CalMeshOptimizer()
+{
+  m_cacheSize = 16;
+  m_faceCount = 0;
+  m_cacheMissCountBefore = 0;
+  m_cacheMissCountAfter = 0;
+}
+
+ /*****************************************************************************/
+/** Destructs the mesh optimizer instance.
+  *
+  * This function is the destructor of the mesh optimizer instance.
+  *****************************************************************************/
+
+CalMeshOptimizer::~CalMeshOptimizer()
+{
+}
+
+ /*****************************************************************************/
+/** Counts the vertex cache misses of a face list.
+  *
+  * This function simulates a FIFO post-transform vertex cache while drawing
+  * a list of faces.
+  *
+  * @param pFace A pointer to the faces.
+  * @param faceCount The number of faces.
+  * @param cacheSize The number of vertices in the cache.
+  *
+  * @return The number of cache misses.
+  *****************************************************************************/
+
+size_t CalMeshOptimizer::calculateCacheMissCount(const CalCoreSubmesh::Face *pFace, size_t faceCount, int cacheSize)
+{
+  if(cacheSize < 1) cacheSize = 1;
+
+  std::vector<int> vectorCache(cacheSize, -1);
+  int cachePosition = 0;
+  size_t cacheMissCount = 0;
+
+  for(size_t faceId = 0; faceId < faceCount; faceId++)
+  {
+    for(int faceVertexId = 0; faceVertexId < 3; faceVertexId++)
+    {
+      int vertexId = pFace[faceId].vertexId[faceVertexId];
+
+      int cacheId;
+      for(cacheId = 0; cacheId < cacheSize; cacheId++)
+      {
+        if(vectorCache[cacheId] == vertexId) break;
+      }
+
+      if(cacheId == cacheSize)
+      {
+        vectorCache[cachePosition] = vertexId;
+        cachePosition = (cachePosition + 1) % cacheSize;
+        cacheMissCount++;
+      }
+    }
+  }
+
+  return cacheMissCount;
+}
+
+ /*****************************************************************************/
+/** Returns the average cache miss ratio after the optimization.
+  *
+  * This function returns the average number of vertex cache misses per face
+  * (ACMR) of the full detail faces after the last optimization.
+  *
+  * @return The ACMR after the optimization.
+  *****************************************************************************/
+
+float CalMeshOptimizer::getAcmrAfter()
+{
+  if(m_faceCount == 0) return 0.0f;
+
+  return (float)m_cacheMissCountAfter / (float)m_faceCount;
+}
+
+ /*****************************************************************************/
+/** Returns the average cache miss ratio before the optimization.
+  *
+  * This function returns the average number of vertex cache misses per face
+  * (ACMR) of the full detail faces before the last optimization.
+  *
+  * @return The ACMR before the optimization.
+  *****************************************************************************/
+
+float CalMeshOptimizer::getAcmrBefore()
+{
+  if(m_faceCount == 0) return 0.0f;
+
+  return (float)m_cacheMissCountBefore / (float)m_faceCount;
+}
+
+ /*****************************************************************************/
+/** Returns the cache size.
+  *
+  * This function returns the number of vertices in the simulated vertex
+  * cache.
+  *
+  * @return The cache size.
+  *****************************************************************************/
+
+int CalMeshOptimizer::getCacheSize()
+{
+  return m_cacheSize;
+}
+
+ /*****************************************************************************/
+/** Optimizes all core submeshes of a core model.
+  *
+  * This function optimizes every core submesh of a core model instance. The
+  * reported ACMR covers all of them.
+  *
+  * @param pCoreModel A pointer to the core model instance.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalMeshOptimizer::optimizeCoreModel(CalCoreModel *pCoreModel)
+{
+  m_faceCount = 0;
+  m_cacheMissCountBefore = 0;
+  m_cacheMissCountAfter = 0;
+
+  if(pCoreModel == 0)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return false;
+  }
+
+  for(int submeshId = 0; submeshId < pCoreModel->getCoreSubmeshCount(); submeshId++)
+  {
+    if(!optimizeSubmesh(pCoreModel->getCoreSubmesh(submeshId))) return false;
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Optimizes a core submesh.
+  *
+  * This function reorders the faces and vertices of a core submesh for the
+  * vertex cache and for the skinning loop.
+  *
+  * @param pCoreSubmesh A pointer to the core submesh instance.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalMeshOptimizer::optimizeCoreSubmesh(CalCoreSubmesh *pCoreSubmesh)
+{
+  m_faceCount = 0;
+  m_cacheMissCountBefore = 0;
+  m_cacheMissCountAfter = 0;
+
+  return optimizeSubmesh(pCoreSubmesh);
+}
+
+ /*****************************************************************************/
+/** Sets the cache size.
+  *
+  * This function sets the number of vertices in the vertex cache that is
+  * optimized for and simulated.
+  *
+  * @param cacheSize The cache size.
+  *****************************************************************************/
+
+void CalMeshOptimizer::setCacheSize(int cacheSize)
+{
+  if(cacheSize < 3) cacheSize = 3;
+
+  m_cacheSize = cacheSize;
+}
+
+ /*****************************************************************************/
+/** Reorders a face list for the vertex cache.
+  *
+  * This function implements the Tipsify algorithm (Sander, Nehab and Barczak
+  * 2007): the faces are emitted in fans around the current vertex, and the
+  * next fanning vertex is the most recently used one that will still be in
+  * the cache after its remaining faces are drawn.
+  *
+  * @param pFace A pointer to the faces that should be reordered in place.
+  * @param faceCount The number of faces.
+  * @param vertexCount The number of vertices referenced by the faces.
+  *****************************************************************************/
+
+void CalMeshOptimizer::optimizeFaces(CalCoreSubmesh::Face *pFace, size_t faceCount, size_t vertexCount)
+{
+  if(faceCount < 2) return;
+
+  // build the vertex to face adjacency
+  std::vector<int> vectorLiveCount(vertexCount + 1, 0);
+  size_t faceId;
+  int faceVertexId;
+  for(faceId = 0; faceId < faceCount; faceId++)
+  {
+    for(faceVertexId = 0; faceVertexId < 3; faceVertexId++) vectorLiveCount[pFace[faceId].vertexId[faceVertexId]]++;
+  }
+
+  std::vector<int> vectorFirstAdjacency(vertexCount + 1, 0);
+  size_t vertexId;
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    vectorFirstAdjacency[vertexId + 1] = vectorFirstAdjacency[vertexId] + vectorLiveCount[vertexId];
+  }
+
+  std::vector<int> vectorAdjacency(faceCount * 3);
+  std::vector<int> vectorFill(vectorFirstAdjacency.begin(), vectorFirstAdjacency.end() - 1);
+  for(faceId = 0; faceId < faceCount; faceId++)
+  {
+    for(faceVertexId = 0; faceVertexId < 3; faceVertexId++) vectorAdjacency[vectorFill[pFace[faceId].vertexId[faceVertexId]]++] = faceId;
+  }
+
+  std::vector<int> vectorCacheTime(vertexCount, 0);
+  std::vector<bool> vectorEmitted(faceCount, false);
+  std::vector<int> vectorDeadEnd;
+  std::vector<int> vectorCandidate;
+  std::vector<CalCoreSubmesh::Face> vectorOutput;
+  vectorOutput.reserve(faceCount);
+
+  int fanVertexId = 0;
+  int time = m_cacheSize + 1;
+  size_t cursor = 1;
+
+  while(fanVertexId >= 0)
+  {
+    vectorCandidate.clear();
+
+    // emit all remaining faces around the fanning vertex
+    for(int adjacencyId = vectorFirstAdjacency[fanVertexId]; adjacencyId < vectorFirstAdjacency[fanVertexId + 1]; adjacencyId++)
+    {
+      int adjacentFaceId = vectorAdjacency[adjacencyId];
+      if(vectorEmitted[adjacentFaceId]) continue;
+
+      const CalCoreSubmesh::Face& face = pFace[adjacentFaceId];
+      for(faceVertexId = 0; faceVertexId < 3; faceVertexId++)
+      {
+        int faceVertex = face.vertexId[faceVertexId];
+        vectorDeadEnd.push_back(faceVertex);
+        vectorCandidate.push_back(faceVertex);
+        vectorLiveCount[faceVertex]--;
+        if(time - vectorCacheTime[faceVertex] > m_cacheSize) vectorCacheTime[faceVertex] = time++;
+      }
+
+      vectorEmitted[adjacentFaceId] = true;
+      vectorOutput.push_back(face);
+    }
+
+    // pick the candidate that stays in the cache the longest
+    int nextVertexId = -1;
+    int bestPriority = -1;
+    size_t candidateId;
+    for(candidateId = 0; candidateId < vectorCandidate.size(); candidateId++)
+    {
+      int candidate = vectorCandidate[candidateId];
+      if(vectorLiveCount[candidate] <= 0) continue;
+
+      int priority = 0;
+      if(time - vectorCacheTime[candidate] + 2 * vectorLiveCount[candidate] <= m_cacheSize) priority = time - vectorCacheTime[candidate];
+      if(priority > bestPriority)
+      {
+        bestPriority = priority;
+        nextVertexId = candidate;
+      }
+    }
+
+    // at a dead end, fall back to a recently used vertex or the next unfinished one
+    while((nextVertexId == -1) && !vectorDeadEnd.empty())
+    {
+      int deadEnd = vectorDeadEnd.back();
+      vectorDeadEnd.pop_back();
+      if(vectorLiveCount[deadEnd] > 0) nextVertexId = deadEnd;
+    }
+
+    while((nextVertexId == -1) && (cursor < vertexCount))
+    {
+      if(vectorLiveCount[cursor] > 0) nextVertexId = cursor;
+      cursor++;
+    }
+
+    fanVertexId = nextVertexId;
+  }
+
+  std::copy(vectorOutput.begin(), vectorOutput.end(), pFace);
+}
+
+ /*****************************************************************************/
+/** Optimizes a core submesh.
+  *
+  * This function does the work of optimizeCoreSubmesh() and adds the face
+  * and cache miss counts to the ones of the current run.
+  *
+  * The faces that are never removed by a LOD collapse come first and are
+  * reordered as one band; the faces removed by the collapses stay in their
+  * groups. The vertices that are never collapsed are then sorted by first
+  * use, and the face tables of the reduced LOD steps, which are separate
+  * index lists, are optimized band by band.
+  *
+  * @param pCoreSubmesh A pointer to the core submesh instance.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalMeshOptimizer::optimizeSubmesh(CalCoreSubmesh *pCoreSubmesh)
+{
+  if(pCoreSubmesh == 0)
+  {
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+    return false;
+  }
+
+  std::vector<CalCoreSubmesh::Face>& vectorFace = pCoreSubmesh->getVectorFace();
+  std::vector<CalCoreSubmesh::LodControl>& vectorLodControl = pCoreSubmesh->getVectorLodControl();
+  size_t vertexCount = pCoreSubmesh->getVertexCount();
+  size_t faceCount = vectorFace.size();
+
+  if(faceCount == 0) return true;
+
+  int faceId;
+  for(faceId = 0; faceId < (int)faceCount; faceId++)
+  {
+    for(int faceVertexId = 0; faceVertexId < 3; faceVertexId++)
+    {
+      if((vectorFace[faceId].vertexId[faceVertexId] < 0) || (vectorFace[faceId].vertexId[faceVertexId] >= (int)vertexCount))
+      {
+        CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, "CalMeshOptimizer::optimizeSubmesh");
+        return false;
+      }
+    }
+  }
+
+  // find the vertices and faces that no LOD collapse touches
+  size_t lodCount = pCoreSubmesh->getLodCount();
+  if(lodCount > vertexCount) lodCount = vertexCount;
+  size_t keptVertexCount = vertexCount - lodCount;
+
+  size_t keptFaceCount = faceCount;
+  size_t vertexId;
+  for(vertexId = keptVertexCount; vertexId < vectorLodControl.size(); vertexId++)
+  {
+    keptFaceCount -= vectorLodControl[vertexId].faceCollapseCount;
+  }
+  if(keptFaceCount > faceCount)
+  {
+    CalError::setLastError(CalError::INVALID_ATTRIBUTE_VALUE, __FILE__, __LINE__, "CalMeshOptimizer::optimizeSubmesh");
+    return false;
+  }
+
+  int lodStepCount = pCoreSubmesh->getVectorLodStep().size();
+  if(lodStepCount == 0) lodStepCount = CalCoreSubmesh::DEFAULT_LOD_STEP_COUNT;
+
+  m_faceCount += faceCount;
+  m_cacheMissCountBefore += calculateCacheMissCount(&vectorFace[0], faceCount, m_cacheSize);
+
+  // reorder the kept faces for the vertex cache
+  optimizeFaces(&vectorFace[0], keptFaceCount, vertexCount);
+
+  // sort the kept vertices by first use, the collapsed ones keep their place
+  std::vector<int> vectorVertexOrder;
+  vectorVertexOrder.reserve(vertexCount);
+  std::vector<bool> vectorUsed(vertexCount, false);
+  for(faceId = 0; faceId < (int)faceCount; faceId++)
+  {
+    for(int faceVertexId = 0; faceVertexId < 3; faceVertexId++)
+    {
+      int faceVertex = vectorFace[faceId].vertexId[faceVertexId];
+      if(((size_t)faceVertex < keptVertexCount) && !vectorUsed[faceVertex])
+      {
+        vectorUsed[faceVertex] = true;
+        vectorVertexOrder.push_back(faceVertex);
+      }
+    }
+  }
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    if((vertexId >= keptVertexCount) || !vectorUsed[vertexId]) vectorVertexOrder.push_back(vertexId);
+  }
+
+  if(!pCoreSubmesh->reorderVertices(vectorVertexOrder)) return false;
+
+  m_cacheMissCountAfter += calculateCacheMissCount(&vectorFace[0], faceCount, m_cacheSize);
+
+  // the reduced LOD steps have their own face tables
+  if(!pCoreSubmesh->buildLodSteps(lodStepCount)) return false;
+
+  std::vector<CalCoreSubmesh::LodStep>& vectorLodStep = pCoreSubmesh->getVectorLodStep();
+  for(int lodStepId = 1; lodStepId < (int)vectorLodStep.size(); lodStepId++)
+  {
+    CalCoreSubmesh::Face *pLodFace = pCoreSubmesh->getLodStepFaces(lodStepId);
+    if(pLodFace != 0) optimizeFaces(pLodFace, vectorLodStep[lodStepId].faceCount, vectorLodStep[lodStepId].vertexCount);
+  }
+
+  return true;
+}
+
+//****************************************************************************//
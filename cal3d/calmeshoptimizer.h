@@ -0,0 +1,74 @@
+//****************************************************************************//
+// meshoptimizer.h                                                            //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_MESHOPTIMIZER_H
+#define CAL_MESHOPTIMIZER_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+#include "calcoresub.h"
+
+//****************************************************************************//
+// Forward declarations                                                       //
+//****************************************************************************//
+
+class CalCoreModel;
+
+//****************************************************************************//
+// Class declaration                                                          //
+//****************************************************************************//
+
+ /*****************************************************************************/
+/** The mesh optimizer class.
+  *
+  * This class reorders the faces of a core submesh for the post-transform
+  * vertex cache (Tipsify) and its vertices by first use. The progressive LOD
+  * order is kept: only the faces and vertices that are never collapsed move,
+  * and the face tables of the reduced LOD steps are optimized on their own.
+  * CalSaver writes the new face and vertex order into model files, while the
+  * reduced LOD steps are rebuilt in collapse order when those are loaded;
+  * only baked files keep the optimized LOD step face tables.
+  *****************************************************************************/
+
+class CAL3D_API CalMeshOptimizer
+{
+// member variables
+protected:
+  int m_cacheSize;
+  size_t m_faceCount;
+  size_t m_cacheMissCountBefore;
+  size_t m_cacheMissCountAfter;
+
+// constructors/destructor
+public:
+  CalMeshOptimizer();
+  virtual ~CalMeshOptimizer();
+
+// member functions
+public:
+  static size_t calculateCacheMissCount(const CalCoreSubmesh::Face *pFace, size_t faceCount, int cacheSize);
+  float getAcmrAfter();
+  float getAcmrBefore();
+  int getCacheSize();
+  bool optimizeCoreModel(CalCoreModel *pCoreModel);
+  bool optimizeCoreSubmesh(CalCoreSubmesh *pCoreSubmesh);
+  void setCacheSize(int cacheSize);
+
+protected:
+  void optimizeFaces(CalCoreSubmesh::Face *pFace, size_t faceCount, size_t vertexCount);
+  bool optimizeSubmesh(CalCoreSubmesh *pCoreSubmesh);
+};
+
+#endif
+
+//****************************************************************************//
@@ -26,6 +26,30 @@
 #include "calcoretrack.h"
 #include "calcorebone.h"
 #include "calcoresub.h"
+#include "calnametable.h"
+
+// threading includes
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+ /*****************************************************************************/
+/** The skinning pipeline worker.
+  *
+  * The worker thread sleeps until beginUpdateVertices hands it a frame, skins
+  * the listed submeshes into their back buffers and signals completion. The
+  * mutex is only taken by the fences, never by readers of the buffered data.
+  *****************************************************************************/
+
+struct CalModel::SkinningWorker
+{
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<CalSubmesh *> vectorSubmesh;
+  bool bPending;
+  bool bQuit;
+};
 
  /*****************************************************************************/
 /** Constructs the model instance.
@@ -38,12 +62,16 @@ CalModel::CalModel(void)
   m_pCoreModel = 0;
   m_translation.clear();
   m_rotation.clear();
+  m_pSkinningWorker = 0;
+  m_bSkinningInFlight = false;
+  m_bSkeletonOnly = false;
 }
 
 CalModel::~CalModel(void)
 {
   assert(m_vectorBone.empty());
   assert(m_vectorSubmesh.empty());
+  assert(m_pSkinningWorker == 0);
 }
 
 CalModel *CalModel::Alloc(void) { return new CalModel; }
@@ -56,13 +84,18 @@ void CalModel::Free(CalModel *x) { delete x; }
   *
   * @param pCoreModel A pointer to the core model on which this model instance
   *                   should be based on.
+  * @param flags A boolean OR of any of the following flags
+  *         \li MODEL_SKELETON_ONLY will create the bones only, for servers
+  *             that pose the skeleton but never draw it. The model gets no
+  *             submeshes and keeps no transforms for skinning, even if the
+  *             core model has submeshes.
   *
   * @return One of the following values:
   *         \li \b true if successful
   *         \li \b false if an error happend
   *****************************************************************************/
 
-bool CalModel::create(CalCoreModel *pCoreModel)
+bool CalModel::create(CalCoreModel *pCoreModel, int flags)
 {
   if(pCoreModel == 0)
   {
@@ -71,9 +104,10 @@ bool CalModel::create(CalCoreModel *pCoreModel)
   }
 
   m_pCoreModel = pCoreModel;
+  m_bSkeletonOnly = (flags & MODEL_SKELETON_ONLY) != 0;
 
   // get the number of submeshes
-  int submeshCount = pCoreModel->getCoreSubmeshCount();
+  int submeshCount = m_bSkeletonOnly ? 0 : pCoreModel->getCoreSubmeshCount();
 
   // reserve space in the bone vector
   m_vectorSubmesh.reserve(submeshCount);
@@ -106,10 +140,26 @@ bool CalModel::create(CalCoreModel *pCoreModel)
   // reserve space in the bone vector
   m_vectorBone.reserve(boneCount);
   m_vectorBone.resize(boneCount);
-  m_vectorTransformMatrix.reserve(boneCount);
-  m_vectorTransformMatrix.resize(boneCount);
-  m_vectorTransformVector.reserve(boneCount);
-  m_vectorTransformVector.resize(boneCount);
+
+  // only the submeshes read the cached transforms
+  if(m_bSkeletonOnly)
+  {
+    m_vectorTransformMatrix.clear();
+    m_vectorTransformVector.clear();
+    m_vectorSkinningMatrix.clear();
+    m_vectorSkinningVector.clear();
+  }
+  else
+  {
+    m_vectorTransformMatrix.reserve(boneCount);
+    m_vectorTransformMatrix.resize(boneCount);
+    m_vectorTransformVector.reserve(boneCount);
+    m_vectorTransformVector.resize(boneCount);
+    m_vectorSkinningMatrix.reserve(boneCount);
+    m_vectorSkinningMatrix.resize(boneCount);
+    m_vectorSkinningVector.reserve(boneCount);
+    m_vectorSkinningVector.resize(boneCount);
+  }
   
   // clone every core bone
   int boneId;
@@ -139,6 +189,9 @@ bool CalModel::create(CalCoreModel *pCoreModel)
 
 void CalModel::destroy(void)
 {
+  // stop the skinning pipeline before the submeshes go away
+  enableSkinningPipeline(false);
+
   // destroy all submeshes
   std::vector<CalSubmesh *>::iterator iteratorSubmesh;
   for(iteratorSubmesh = m_vectorSubmesh.begin(); iteratorSubmesh != m_vectorSubmesh.end(); ++iteratorSubmesh)
@@ -155,6 +208,7 @@ void CalModel::destroy(void)
   m_vectorBone.clear();
 
   m_pCoreModel = 0;
+  m_bSkeletonOnly = false;
 }
 
  /*****************************************************************************/
@@ -237,9 +291,36 @@ CalBone *CalModel::getBone(int boneId)
 
 int CalModel::findBone(const std::string& name, int hint)
 {
+  // A name that was never interned can't belong to a bone.
+  int nameId = CalNameTable::find(name);
+  if (nameId == -1)
+    return -1;
+
+  return findBone(nameId, hint);
+}
+
+ /*****************************************************************************/
+/** Given a bone name ID, returns the bone's ID.
+  *
+  * This function accepts the ID of a bone name in the name table, and returns
+  * the bone's ID. Core tracks are bound to bones this way.
+  *
+  * @param nameId The ID of the name of the bone that should be returned.
+  * @param hint The ID of the bone to try first.
+  *
+  * @return One of the following values:
+  *         \li the ID of the bone
+  *         \li \b -1 if an error happend
+  *****************************************************************************/
+
+int CalModel::findBone(int nameId, int hint)
+{
+  if (nameId < 0)
+    return -1;
+
   // See if the hint helps.
   if ((hint >= 0) && (hint < (int)m_vectorBone.size()))
-    if (m_vectorBone[hint].getCoreBone()->getName().compare(name) == 0)
+    if (m_vectorBone[hint].getCoreBone()->getNameId() == nameId)
       return hint;
   
   // If not, do a brute scan.
@@ -247,7 +328,7 @@ int CalModel::findBone(const std::string& name, int hint)
   size_t boneCount = m_vectorBone.size();
   for (boneId = 0; boneId < (int)boneCount; boneId++)
   {
-    if (m_vectorBone[boneId].getCoreBone()->getName().compare(name) == 0)
+    if (m_vectorBone[boneId].getCoreBone()->getNameId() == nameId)
       return boneId;
   }
   
@@ -331,6 +412,10 @@ void CalModel::calculateState(void)
       m_vectorBone[boneId].calculateState();
   }
 
+  // a skeleton-only model has no submeshes to read the cache
+  if (m_bSkeletonOnly)
+    return;
+
   // cache the transform matrix and transform vector for faster access.
   for (boneId = 0; boneId < boneCount; boneId++) {
     m_vectorTransformMatrix[boneId] = m_vectorBone[boneId].m_transformMatrix;
@@ -392,6 +477,20 @@ void CalModel::lockState(void)
 
 void CalModel::blendState(CalCoreAnimation *pCoreAnimation, float weight, float time)
 {
+  // sample a streamed core animation from the chunk around the time, which
+  // stays in memory while we hold it; read the keyframes of a lazily loaded
+  // one on first use
+  const CalCoreAnimation::Chunk *pChunk = 0;
+  if(pCoreAnimation->isStreamed())
+  {
+    pChunk = pCoreAnimation->acquireChunk(time);
+    if(pChunk == 0) return;
+  }
+  else if(!pCoreAnimation->loadTracks())
+  {
+    return;
+  }
+
   // get the duration of the core animation
   float duration;
   duration = pCoreAnimation->getDuration();
@@ -400,12 +499,15 @@ void CalModel::blendState(CalCoreAnimation *pCoreAnimation, float weight, float
   std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
   
   // loop through all core tracks of the core animation
+  int trackId = 0;
   std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
-  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack, ++trackId)
   {
-    // get the appropriate bone
-    int boneId = findBone((*iteratorCoreTrack)->getCoreBoneName(), (*iteratorCoreTrack)->getCoreBoneHint());
-    (*iteratorCoreTrack)->setCoreBoneHint(boneId);
+    // get the appropriate bone; the hint is shared with the models playing
+    // the core animation on other threads, so it is only stored on a change
+    int boneHint = (*iteratorCoreTrack)->getCoreBoneHint();
+    int boneId = findBone((*iteratorCoreTrack)->getCoreBoneNameId(), boneHint);
+    if(boneId != boneHint) (*iteratorCoreTrack)->setCoreBoneHint(boneId);
     
     if (boneId >= 0)
     {
@@ -414,13 +516,16 @@ void CalModel::blendState(CalCoreAnimation *pCoreAnimation, float weight, float
       // get the current translation and rotation
       CalVector orientation;
       CalQuaternion rotation;
-      (*iteratorCoreTrack)->getState(time, duration, orientation, rotation);
+      if(pChunk != 0) CalCoreTrack::getState(pCoreAnimation->getChunkMapCoreKeyframe(pChunk, trackId), time, duration, orientation, rotation);
+      else (*iteratorCoreTrack)->getState(time, duration, orientation, rotation);
       CalVector translation = orientation * bone.getCoreBone()->getLength();
       
       // blend the bone state with the new state
       bone.blendState(weight, translation, rotation);
     }
   }
+
+  if(pChunk != 0) pCoreAnimation->releaseChunk(pChunk);
 }
 
  /*****************************************************************************/
@@ -445,8 +550,20 @@ bool CalModel::mimicSkeleton(CalModel *pModel)
   for(boneId = 0; boneId < (int)m_vectorBone.size(); boneId++)
   {
     m_vectorBone[boneId].mimicBone(&(pModel->m_vectorBone[boneId]));
-    m_vectorTransformMatrix[boneId] = pModel->m_vectorTransformMatrix[boneId];
-    m_vectorTransformVector[boneId] = pModel->m_vectorTransformVector[boneId];
+    if (m_bSkeletonOnly)
+      continue;
+
+    // a skeleton-only source has no cache, its bones hold the same transforms
+    if (pModel->m_bSkeletonOnly)
+    {
+      m_vectorTransformMatrix[boneId] = pModel->m_vectorBone[boneId].m_transformMatrix;
+      m_vectorTransformVector[boneId] = pModel->m_vectorBone[boneId].m_transformVector;
+    }
+    else
+    {
+      m_vectorTransformMatrix[boneId] = pModel->m_vectorTransformMatrix[boneId];
+      m_vectorTransformVector[boneId] = pModel->m_vectorTransformVector[boneId];
+    }
   }
   
   // copy the base translation and rotation.
@@ -472,6 +589,20 @@ CalCoreModel *CalModel::getCoreModel()
   return m_pCoreModel;
 }
 
+ /*****************************************************************************/
+/** Returns if the model instance has bones only.
+  *
+  * @return One of the following values:
+  *         \li \b true if the model instance was created with
+  *             MODEL_SKELETON_ONLY
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalModel::isSkeletonOnly()
+{
+  return m_bSkeletonOnly;
+}
+
  /*****************************************************************************/
 /** Sets the LOD level.
   *
@@ -511,13 +642,15 @@ void CalModel::updateSpringSystem(float delta)
  /*****************************************************************************/
 /** Updates the model instance.
   *
-  * This function updates the model instance for a given amount of time.
-  *
-  * @param deltaTime The elapsed time in seconds since the last update.
+  * This function updates the buffered vertex data of all submeshes on the
+  * calling thread. If a pipelined update is in flight, it is finished first.
   *****************************************************************************/
 
 void CalModel::updateVertices(void)
 {
+  // never skin a submesh the worker is still writing
+  if(m_bSkinningInFlight) endUpdateVertices();
+
   int submeshCount = m_vectorSubmesh.size();
   for (int submeshId = 0; submeshId < submeshCount; submeshId++) {
     CalSubmesh *submesh = m_vectorSubmesh[submeshId];
@@ -525,4 +658,170 @@ void CalModel::updateVertices(void)
   }
 }
 
+ /*****************************************************************************/
+/** Enables or disables the skinning pipeline.
+  *
+  * With the pipeline enabled, beginUpdateVertices hands the buffered submeshes
+  * to a worker thread that skins them into back buffers, while the buffered
+  * data of the previous frame stays readable. endUpdateVertices waits for the
+  * worker and publishes the new frame. With the pipeline disabled, both fences
+  * degrade to a synchronous updateVertices.
+  *
+  * @param enabled \b true to start the worker thread, \b false to stop it.
+  *****************************************************************************/
+
+void CalModel::enableSkinningPipeline(bool enabled)
+{
+  if(enabled)
+  {
+    // If the pipeline is already running, do nothing.
+    if(m_pSkinningWorker != 0) return;
+
+    m_pSkinningWorker = new SkinningWorker();
+    m_pSkinningWorker->bPending = false;
+    m_pSkinningWorker->bQuit = false;
+    m_pSkinningWorker->thread = std::thread(&CalModel::runSkinningWorker, this);
+  }
+  else
+  {
+    if(m_pSkinningWorker == 0) return;
+
+    // publish the frame in flight, then let the worker run out
+    if(m_bSkinningInFlight) endUpdateVertices();
+    {
+      std::lock_guard<std::mutex> lock(m_pSkinningWorker->mutex);
+      m_pSkinningWorker->bQuit = true;
+    }
+    m_pSkinningWorker->condition.notify_all();
+    m_pSkinningWorker->thread.join();
+
+    delete m_pSkinningWorker;
+    m_pSkinningWorker = 0;
+  }
+}
+
+ /*****************************************************************************/
+/** Returns if the skinning pipeline is enabled.
+  *
+  * @return One of the following values:
+  *         \li \b true if the skinning pipeline is enabled
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalModel::isSkinningPipelineEnabled(void)
+{
+  return m_pSkinningWorker != 0;
+}
+
+ /*****************************************************************************/
+/** Starts updating the buffered vertex data.
+  *
+  * This function snapshots the current bone transforms and hands all buffered
+  * submeshes to the skinning worker. Until the matching endUpdateVertices, the
+  * buffered data of the previous frame (getBufferedVertices and friends) stays
+  * stable and can be read without locking, and the skeleton may already be
+  * posed for the next frame. LOD changes, spring system updates and the
+  * destruction of the model must wait until after endUpdateVertices.
+  * If a previous update is still in flight, it is finished first.
+  *****************************************************************************/
+
+void CalModel::beginUpdateVertices(void)
+{
+  if(m_bSkinningInFlight) endUpdateVertices();
+
+  // without a worker, skin synchronously
+  if(m_pSkinningWorker == 0)
+  {
+    updateVertices();
+    return;
+  }
+
+  // snapshot the bone transforms; the skeleton is free to move on after this
+  m_vectorSkinningMatrix = m_vectorTransformMatrix;
+  m_vectorSkinningVector = m_vectorTransformVector;
+
+  // collect the buffered submeshes for the worker
+  m_pSkinningWorker->vectorSubmesh.clear();
+  int submeshCount = m_vectorSubmesh.size();
+  for (int submeshId = 0; submeshId < submeshCount; submeshId++) {
+    CalSubmesh *submesh = m_vectorSubmesh[submeshId];
+    if (submesh->hasInternalData())
+    {
+      submesh->prepareBackBuffers();
+      submesh->m_bSkinFromSnapshot = true;
+      m_pSkinningWorker->vectorSubmesh.push_back(submesh);
+    }
+  }
+
+  // kick the worker
+  {
+    std::lock_guard<std::mutex> lock(m_pSkinningWorker->mutex);
+    m_pSkinningWorker->bPending = true;
+  }
+  m_pSkinningWorker->condition.notify_all();
+
+  m_bSkinningInFlight = true;
+}
+
+ /*****************************************************************************/
+/** Finishes updating the buffered vertex data.
+  *
+  * This function waits for the skinning worker to finish the frame started by
+  * beginUpdateVertices and publishes it. Pointers returned by the buffered
+  * data accessors before this call refer to the previous frame and must not
+  * be used afterwards.
+  *****************************************************************************/
+
+void CalModel::endUpdateVertices(void)
+{
+  if(!m_bSkinningInFlight) return;
+
+  // wait for the worker
+  {
+    std::unique_lock<std::mutex> lock(m_pSkinningWorker->mutex);
+    while(m_pSkinningWorker->bPending) m_pSkinningWorker->condition.wait(lock);
+  }
+
+  // publish the new frame
+  std::vector<CalSubmesh *>::iterator iteratorSubmesh;
+  for(iteratorSubmesh = m_pSkinningWorker->vectorSubmesh.begin(); iteratorSubmesh != m_pSkinningWorker->vectorSubmesh.end(); ++iteratorSubmesh)
+  {
+    (*iteratorSubmesh)->m_bSkinFromSnapshot = false;
+    (*iteratorSubmesh)->swapBuffers();
+  }
+
+  m_bSkinningInFlight = false;
+}
+
+ /*****************************************************************************/
+/** Runs the skinning worker.
+  *
+  * This function is the body of the skinning worker thread.
+  *****************************************************************************/
+
+void CalModel::runSkinningWorker(void)
+{
+  SkinningWorker *pWorker = m_pSkinningWorker;
+
+  std::unique_lock<std::mutex> lock(pWorker->mutex);
+  for(;;)
+  {
+    while(!pWorker->bPending && !pWorker->bQuit) pWorker->condition.wait(lock);
+    if(pWorker->bQuit) break;
+
+    // skin outside the lock; the fences own the submesh list until bPending drops
+    lock.unlock();
+    std::vector<CalSubmesh *>::iterator iteratorSubmesh;
+    for(iteratorSubmesh = pWorker->vectorSubmesh.begin(); iteratorSubmesh != pWorker->vectorSubmesh.end(); ++iteratorSubmesh)
+    {
+      CalSubmesh *submesh = *iteratorSubmesh;
+      submesh->skinVertices(submesh->m_vectorVertexBack, submesh->m_vectorNormalBack, submesh->m_vectorvectorTangentSpaceBack, submesh->m_springTimeQueued);
+    }
+    lock.lock();
+
+    pWorker->bPending = false;
+    pWorker->condition.notify_all();
+  }
+}
+
 //****************************************************************************//
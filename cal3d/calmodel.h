@@ -29,6 +29,11 @@ class CalCoreAnimation;
 class CalBone;
 class CalSubmesh;
 
+enum
+{
+  MODEL_SKELETON_ONLY = 1
+};
+
 //****************************************************************************//
 // Class declaration                                                          //
 //****************************************************************************//
@@ -41,6 +46,10 @@ class CAL3D_API CalModel: public CalModelUserData
 {
   friend class CalSubmesh;
   friend CalModel *CalModelNew(void);
+
+// misc
+protected:
+  struct SkinningWorker;
   
 // member variables
 protected:
@@ -50,7 +59,14 @@ protected:
   std::vector<CalBone> m_vectorBone;
   std::vector<CalMatrix> m_vectorTransformMatrix;
   std::vector<CalVector> m_vectorTransformVector;
+  std::vector<CalMatrix> m_vectorSkinningMatrix;
+  std::vector<CalVector> m_vectorSkinningVector;
   std::vector<CalSubmesh *> m_vectorSubmesh;
+  SkinningWorker *m_pSkinningWorker;
+  bool m_bSkinningInFlight;
+  bool m_bSkeletonOnly;
+
+  void runSkinningWorker(void);
   
 // constructors/destructor
 public: 
@@ -61,9 +77,10 @@ public:
   
 // member functions
 public:
-  bool create(CalCoreModel *pCoreModel);
+  bool create(CalCoreModel *pCoreModel, int flags = 0);
   void destroy(void);
   CalCoreModel *getCoreModel(void);
+  bool isSkeletonOnly(void);
   void setLodLevel(float lodLevel);
 
   // State queries
@@ -72,6 +89,7 @@ public:
   int getBoneCount(void);
   CalBone *getBone(int boneId);
   int findBone(const std::string& name, int hint=(-1));
+  int findBone(int nameId, int hint=(-1));
   
   // functions to set the pose using animations.
   void setTranslation(const CalVector &translation);
@@ -91,6 +109,12 @@ public:
   
   // function to update the vertices.
   void updateVertices(void);
+
+  // functions to update the vertices on a worker thread.
+  void enableSkinningPipeline(bool enabled);
+  bool isSkinningPipelineEnabled(void);
+  void beginUpdateVertices(void);
+  void endUpdateVertices(void);
   
   // functions to loop over the submeshes.
   int getSubmeshCount(void);
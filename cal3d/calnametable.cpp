@@ -0,0 +1,201 @@
+#include "stdafx.h"
+//****************************************************************************//
+// nametable.cpp                                                              //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calnametable.h"
+
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+// threading includes
+#include <mutex>
+
+namespace
+{
+  /// A name in the table, pointing at the string that holds it.
+  struct NameKey
+  {
+    const char *pName;
+    size_t length;
+  };
+
+  /// Returns the hash of a name (FNV-1a).
+  struct NameKeyHash
+  {
+    size_t operator()(const NameKey& key) const
+    {
+      size_t hash = 2166136261u;
+      for(size_t i = 0; i < key.length; i++)
+      {
+        hash ^= (unsigned char)key.pName[i];
+        hash *= 16777619u;
+      }
+      return hash;
+    }
+  };
+
+  struct NameKeyEqual
+  {
+    bool operator()(const NameKey& a, const NameKey& b) const
+    {
+      return (a.length == b.length) && (memcmp(a.pName, b.pName, a.length) == 0);
+    }
+  };
+
+  /// The names, guarded by one mutex. A deque doesn't move its strings when
+  /// it grows, so the keys and the references handed out stay valid.
+  struct Table
+  {
+    std::mutex mutex;
+    std::deque<std::string> dequeName;
+    std::unordered_map<NameKey, int, NameKeyHash, NameKeyEqual> mapNameId;
+  };
+
+  /// The table is never destroyed, so core bones and core tracks can still
+  /// ask for their names while static objects are destroyed.
+  Table& getTable()
+  {
+    static Table *pTable = new Table();
+    return *pTable;
+  }
+}
+
+ /*****************************************************************************/
+/** Returns the ID of a name.
+  *
+  * This function looks a name up without adding it to the table.
+  *
+  * @param strName The name to look up.
+  *
+  * @return One of the following values:
+  *         \li the \b ID of the name
+  *         \li \b -1 if the name isn't in the table
+  *****************************************************************************/
+
+int CalNameTable::find(const std::string& strName)
+{
+  Table& table = getTable();
+
+  NameKey key;
+  key.pName = strName.data();
+  key.length = strName.size();
+
+  std::lock_guard<std::mutex> lock(table.mutex);
+
+  std::unordered_map<NameKey, int, NameKeyHash, NameKeyEqual>::iterator iteratorNameId;
+  iteratorNameId = table.mapNameId.find(key);
+  if(iteratorNameId == table.mapNameId.end()) return -1;
+
+  return iteratorNameId->second;
+}
+
+ /*****************************************************************************/
+/** Returns a name.
+  *
+  * This function returns the name with the given ID. The string stays valid
+  * until the program ends.
+  *
+  * @param nameId The ID of the name.
+  *
+  * @return The name, or an empty string if the ID is not valid.
+  *****************************************************************************/
+
+const std::string& CalNameTable::getName(int nameId)
+{
+  static const std::string strEmpty;
+
+  Table& table = getTable();
+
+  std::lock_guard<std::mutex> lock(table.mutex);
+
+  if((nameId < 0) || (nameId >= (int)table.dequeName.size())) return strEmpty;
+
+  return table.dequeName[nameId];
+}
+
+ /*****************************************************************************/
+/** Returns the number of names.
+  *
+  * This function returns the number of names in the table.
+  *
+  * @return The number of names.
+  *****************************************************************************/
+
+int CalNameTable::getNameCount()
+{
+  Table& table = getTable();
+
+  std::lock_guard<std::mutex> lock(table.mutex);
+
+  return (int)table.dequeName.size();
+}
+
+ /*****************************************************************************/
+/** Interns a name.
+  *
+  * This function returns the ID of a name, adding the name to the table if it
+  * isn't in it yet.
+  *
+  * @param strName The name to intern.
+  *
+  * @return The ID of the name.
+  *****************************************************************************/
+
+int CalNameTable::intern(const std::string& strName)
+{
+  return intern(strName.data(), (int)strName.size());
+}
+
+ /*****************************************************************************/
+/** Interns a name.
+  *
+  * This function returns the ID of a name, adding the name to the table if it
+  * isn't in it yet. The loader passes the name straight from the file, so no
+  * string is made for names that are already known.
+  *
+  * @param pName The characters of the name, which need not end with a zero.
+  * @param length The number of characters.
+  *
+  * @return The ID of the name.
+  *****************************************************************************/
+
+int CalNameTable::intern(const char *pName, int length)
+{
+  Table& table = getTable();
+
+  NameKey key;
+  key.pName = pName;
+  key.length = (length > 0) ? length : 0;
+
+  std::lock_guard<std::mutex> lock(table.mutex);
+
+  std::unordered_map<NameKey, int, NameKeyHash, NameKeyEqual>::iterator iteratorNameId;
+  iteratorNameId = table.mapNameId.find(key);
+  if(iteratorNameId != table.mapNameId.end()) return iteratorNameId->second;
+
+  // the key must point at the string kept in the table
+  int nameId = (int)table.dequeName.size();
+  table.dequeName.push_back(std::string(pName, key.length));
+  key.pName = table.dequeName.back().data();
+  table.mapNameId[key] = nameId;
+
+  return nameId;
+}
+
+//****************************************************************************//
@@ -0,0 +1,36 @@
+//****************************************************************************//
+// nametable.h                                                                //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_NAMETABLE_H
+#define CAL_NAMETABLE_H
+
+#include "calglobal.h"
+
+ /*****************************************************************************/
+/** The name table.
+  *
+  * The names of core bones and core tracks are kept once for the whole
+  * library. Core bones and core tracks store the ID of their name, so tracks
+  * are bound to bones by comparing integers. Names are never removed; all
+  * functions may be called from several threads.
+  *****************************************************************************/
+
+namespace CalNameTable
+{
+  CAL3D_API int find(const std::string& strName);
+  CAL3D_API const std::string& getName(int nameId);
+  CAL3D_API int getNameCount();
+  CAL3D_API int intern(const std::string& strName);
+  CAL3D_API int intern(const char *pName, int length);
+}
+
+#endif
+
+//****************************************************************************//
@@ -1,211 +1,363 @@
 ///////////////////////////////////////////////////////////////////////////////////////////
 //
-// This file is included as the body of the following functions:
+// This file holds the skinning kernel behind the following functions:
 //
-// CalPhysique::calculateVertices
-// CalPhysique::calculateNormals
-// CalPhysique::calculateTangentSpaces
-// CalPhysique::calculateVN
-// CalPhysique::calculateVNT
+// CalSubmesh::calculateVertices
+// CalSubmesh::calculateNormals
+// CalSubmesh::calculateTangentSpaces
+// CalSubmesh::calculateVN
+// CalSubmesh::calculateVNT
 //
 // Each of these functions does basically the same thing: calculate the
 // transformed vertices, normals, and tangents.  Some of the functions omit
-// certain components.
+// certain components.  The kernel is a template on the output channels and
+// on the maximum influence count of the submesh, so the compiler can drop the
+// unused channels and unroll the blend.  A MAXINF of 0 selects the generic
+// version that loops over any number of influences.  The instances are bound
+// per submesh in CalSubmesh::bindKernels.
+//
+// If the core submesh has an influence set table (see
+// CalCoreSubmesh::analyzeInfluences), the kernel blends one transform per
+// unique influence set up front and each vertex only needs a single matrix
+// multiply.  Otherwise the transforms are blended per vertex.  Seam vertices,
+// which the exporter split off an earlier vertex with the same position and
+// influences, copy their skinned position from that vertex.
+//
+// This file is only meant to be included by calsub.cpp.
 //
 ///////////////////////////////////////////////////////////////////////////////////////////
 
-// get bone vectors
-CalMatrix *arrayTransformMatrix = &(m_pModel->m_vectorTransformMatrix[0]);
-CalVector *arrayTransformVector = &(m_pModel->m_vectorTransformVector[0]);
-
-// get vertex vector of the core submesh
-CalCoreSubmesh::Vertex *arrayVertex = &(m_pCoreSubmesh->getVectorVertex()[0]);
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// Blends the bone transforms of two or more influences into one rotation and
+// one translation.
+//
+///////////////////////////////////////////////////////////////////////////////////////////
 
-#if CALCULATE_TANGENTS
-// get tangent space vector of the core submesh.
-if (!m_pCoreSubmesh->tangentsEnabled(textureCoordinateId))
+template<int MAXINF>
+static inline void calBlendInfluences(const CalCoreSubmesh::Influence *pInfluence, int influenceCount,
+                                      const CalMatrix *arrayTransformMatrix, const CalVector *arrayTransformVector,
+                                      CalMatrix& r, CalVector& t)
 {
-  CalError::setLastError(CalError::INVALID_TANGENT_SPACE, __FILE__, __LINE__, "");
-  return 0;
-}
-CalCoreSubmesh::TangentSpace *arrayTangentSpace = &(m_pCoreSubmesh->getVectorTangentSpace(textureCoordinateId)[0]);
-#endif
+  // Apply the first influence to the blended rotation and translation.
+  int boneId = pInfluence[0].boneId;
+  float weight = pInfluence[0].weight;
+  r = CalMatrix(weight, arrayTransformMatrix[boneId]);
+
+  const CalVector &boneTranslation = arrayTransformVector[boneId];
+  t.x = boneTranslation.x*weight;
+  t.y = boneTranslation.y*weight;
+  t.z = boneTranslation.z*weight;
 
-// get influence vector of the core submesh
-//CalCoreSubmesh::Influence *arrayInfluence = &(m_pCoreSubmesh->getVectorInfluence()[0]);
-CalCoreSubmesh::Influence *arrayInfluence = 0;
-if (m_pCoreSubmesh->getVectorInfluence().size()) arrayInfluence=&m_pCoreSubmesh->getVectorInfluence().front();
+  // Add in all other influences to the blended rotation and translation.
+  // With a known maximum the loop has a constant trip count and unrolls.
+  const int influenceLimit = (MAXINF > 0) ? MAXINF : influenceCount;
+  for(int influenceId = 1; influenceId < influenceLimit; influenceId++)
+  {
+    if((MAXINF > 0) && (influenceId >= influenceCount)) break;
 
-// get physical property vector of the core submesh
-CalCoreSubmesh::PhysicalProperty *arrayPhysicalProperty = 0;
-if (m_pCoreSubmesh->getVectorPhysicalProperty().size()) arrayPhysicalProperty=&m_pCoreSubmesh->getVectorPhysicalProperty().front();
+    int boneId = pInfluence[influenceId].boneId;
+    float weight = pInfluence[influenceId].weight;
+    r.blend(weight, arrayTransformMatrix[boneId]);
 
-// calculate all submesh vertices
-int nextInfluence = 0;
-for(size_t vertexId = 0; vertexId < m_vertexCount; vertexId++)
+    const CalVector &boneTranslation = arrayTransformVector[boneId];
+    t.x += boneTranslation.x*weight;
+    t.y += boneTranslation.y*weight;
+    t.z += boneTranslation.z*weight;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// Blends one transform for each of the first influence sets of a core submesh.
+// Sets without an influence get the identity, sets with one influence get the
+// bone transform as is, just like the per-vertex path.
+//
+///////////////////////////////////////////////////////////////////////////////////////////
+
+template<int MAXINF>
+static void calBlendInfluenceSets(CalCoreSubmesh *pCoreSubmesh,
+                                  const CalMatrix *arrayTransformMatrix, const CalVector *arrayTransformVector,
+                                  int influenceSetCount, CalMatrix *arraySetMatrix, CalVector *arraySetVector)
 {
-  // skip vertices that are controlled by the spring subsystem.
-  if(m_pCoreSubmesh->m_vectorSpring.size() > 0)
+  std::vector<CalCoreSubmesh::InfluenceSet>& vectorInfluenceSet = pCoreSubmesh->getVectorInfluenceSet();
+  const CalCoreSubmesh::Influence *arrayInfluence = 0;
+  if (pCoreSubmesh->getVectorInfluence().size()) arrayInfluence = &pCoreSubmesh->getVectorInfluence().front();
+
+  for(int influenceSetId = 0; influenceSetId < influenceSetCount; influenceSetId++)
   {
-    CalCoreSubmesh::PhysicalProperty& physicalProperty = arrayPhysicalProperty[vertexId];
-    if(physicalProperty.weight > 0.0f) continue;
+    const CalCoreSubmesh::InfluenceSet &influenceSet = vectorInfluenceSet[influenceSetId];
+
+    if(influenceSet.influenceCount == 0)
+    {
+      CalMatrix &r = arraySetMatrix[influenceSetId];
+      r = CalMatrix();
+      r.dxdx = r.dydy = r.dzdz = 1.0f;
+      arraySetVector[influenceSetId].clear();
+    }
+    else if((MAXINF == 1) || (influenceSet.influenceCount == 1))
+    {
+      int boneId = arrayInfluence[influenceSet.firstInfluence].boneId;
+      arraySetMatrix[influenceSetId] = arrayTransformMatrix[boneId];
+      arraySetVector[influenceSetId] = arrayTransformVector[boneId];
+    }
+    else
+    {
+      calBlendInfluences<MAXINF>(&arrayInfluence[influenceSet.firstInfluence], influenceSet.influenceCount,
+                                 arrayTransformMatrix, arrayTransformVector,
+                                 arraySetMatrix[influenceSetId], arraySetVector[influenceSetId]);
+    }
   }
-  
-  // get the vertex
-  CalCoreSubmesh::Vertex &vertex = arrayVertex[vertexId];
-  
-  // Fetch the not-yet-transformed position.
-  #if CALCULATE_VERTICES
-  float vx = vertex.position.x;
-  float vy = vertex.position.y;
-  float vz = vertex.position.z;
-  #endif
-
-  // Fetch the not-yet-transformed normal.
-  // You know, I think this scaling by (1 / 127.0) may not be needed, if renormalization is turned on.
-  #if CALCULATE_NORMALS
-  float nx = vertex.nx * (1.0f / 127.0f);
-  float ny = vertex.ny * (1.0f / 127.0f);
-  float nz = vertex.nz * (1.0f / 127.0f);
-  #endif
+}
 
-  // Fetch the not-yet-transformed tangent.
-  // You know, I think this scaling by (1 / 127.0) may not be needed, if renormalization is turned on.
-  #if CALCULATE_TANGENTS
-  CalCoreSubmesh::TangentSpace &tanspace = arrayTangentSpace[vertexId];
-  float tx = tanspace.tx * (1.0f / 127.0f);
-  float ty = tanspace.ty * (1.0f / 127.0f);
-  float tz = tanspace.tz * (1.0f / 127.0f);
-  float crossFactor = tanspace.crossFactor;
-  #endif
-  
-  if (vertex.influenceCount == 1)
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// Applies a (blended) bone transform to the requested channels of a vertex.
+// Normals and tangents of blended vertices are renormalized.  If a seam
+// position is given, it is copied instead of transforming the position.
+//
+///////////////////////////////////////////////////////////////////////////////////////////
+
+template<int CHANNELS>
+static inline void calTransformVertex(const CalMatrix &r, const CalVector &t, bool bNormalize,
+                                      const CalCoreSubmesh::Vertex &vertex, const CalCoreSubmesh::TangentSpace *pTangentSpace,
+                                      const float *pSeamPosition,
+                                      float *&pVertexBuffer, float *&pNormalBuffer, float *&pTangentBuffer)
+{
+  // Apply the transform to the position.
+  if((CHANNELS & CalSubmesh::SKIN_VERTICES) && (pSeamPosition != 0))
+  {
+    pVertexBuffer[0] = pSeamPosition[0];
+    pVertexBuffer[1] = pSeamPosition[1];
+    pVertexBuffer[2] = pSeamPosition[2];
+    pVertexBuffer += 3;
+  }
+  else if(CHANNELS & CalSubmesh::SKIN_VERTICES)
   {
-    // Get data straight out of the bone, no blending involved.
-    int boneId = arrayInfluence[nextInfluence].boneId;
-    const CalMatrix &r = arrayTransformMatrix[boneId];
-    nextInfluence += vertex.influenceCount;
-    
-    // Apply the bone transform to the position.
-    #if CALCULATE_VERTICES
-    const CalVector &t = arrayTransformVector[boneId];
+    float vx = vertex.position.x;
+    float vy = vertex.position.y;
+    float vz = vertex.position.z;
     pVertexBuffer[0] = t.x+r.dxdx*vx+r.dxdy*vy+r.dxdz*vz;
     pVertexBuffer[1] = t.y+r.dydx*vx+r.dydy*vy+r.dydz*vz;
     pVertexBuffer[2] = t.z+r.dzdx*vx+r.dzdy*vy+r.dzdz*vz;
     pVertexBuffer += 3;
-    #endif
-    
-    // Apply the bone transform to the normal.
-    #if CALCULATE_NORMALS
-    pNormalBuffer[0] = r.dxdx*nx+r.dxdy*ny+r.dxdz*nz;
-    pNormalBuffer[1] = r.dydx*nx+r.dydy*ny+r.dydz*nz;
-    pNormalBuffer[2] = r.dzdx*nx+r.dzdy*ny+r.dzdz*nz;
+  }
+
+  // Apply the transform to the normal.
+  // You know, I think this scaling by (1 / 127.0) may not be needed, if renormalization is turned on.
+  if(CHANNELS & CalSubmesh::SKIN_NORMALS)
+  {
+    float nx = vertex.nx * (1.0f / 127.0f);
+    float ny = vertex.ny * (1.0f / 127.0f);
+    float nz = vertex.nz * (1.0f / 127.0f);
+    float postnx = r.dxdx*nx+r.dxdy*ny+r.dxdz*nz;
+    float postny = r.dydx*nx+r.dydy*ny+r.dydz*nz;
+    float postnz = r.dzdx*nx+r.dzdy*ny+r.dzdz*nz;
+    if(bNormalize)
+    {
+      float nscale = 1.0f / sqrt(postnx * postnx + postny * postny + postnz * postnz);
+      postnx *= nscale;
+      postny *= nscale;
+      postnz *= nscale;
+    }
+    pNormalBuffer[0] = postnx;
+    pNormalBuffer[1] = postny;
+    pNormalBuffer[2] = postnz;
     pNormalBuffer += 3;
-    #endif
-
-    // Apply the bone transform to the tangent.
-    #if CALCULATE_TANGENTS
-    pTangentBuffer[0] = r.dxdx*tx+r.dxdy*ty+r.dxdz*tz;
-    pTangentBuffer[1] = r.dydx*tx+r.dydy*ty+r.dydz*tz;
-    pTangentBuffer[2] = r.dzdx*tx+r.dzdy*ty+r.dzdz*tz;
-    pTangentBuffer[3] = crossFactor;
+  }
+
+  // Apply the transform to the tangent.
+  if(CHANNELS & CalSubmesh::SKIN_TANGENTS)
+  {
+    float tx = pTangentSpace->tx * (1.0f / 127.0f);
+    float ty = pTangentSpace->ty * (1.0f / 127.0f);
+    float tz = pTangentSpace->tz * (1.0f / 127.0f);
+    float posttx = r.dxdx*tx+r.dxdy*ty+r.dxdz*tz;
+    float postty = r.dydx*tx+r.dydy*ty+r.dydz*tz;
+    float posttz = r.dzdx*tx+r.dzdy*ty+r.dzdz*tz;
+    if(bNormalize)
+    {
+      float tscale = 1.0f / sqrt(posttx * posttx + postty * postty + posttz * posttz);
+      posttx *= tscale;
+      postty *= tscale;
+      posttz *= tscale;
+    }
+    pTangentBuffer[0] = posttx;
+    pTangentBuffer[1] = postty;
+    pTangentBuffer[2] = posttz;
+    pTangentBuffer[3] = pTangentSpace->crossFactor;
     pTangentBuffer += 4;
-    #endif
   }
-  else
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// The skinning kernel.
+//
+///////////////////////////////////////////////////////////////////////////////////////////
+
+template<int CHANNELS, int MAXINF>
+size_t CalSubmesh::calculateKernel(float *pVertexBuffer, float *pNormalBuffer, int textureCoordinateId, float *pTangentBuffer)
+{
+  const bool bVertices = (CHANNELS & SKIN_VERTICES) != 0;
+  const bool bNormals = (CHANNELS & SKIN_NORMALS) != 0;
+  const bool bTangents = (CHANNELS & SKIN_TANGENTS) != 0;
+
+  // get bone vectors (a submesh that is being skinned by the pipeline worker
+  // reads the palette snapshot taken in CalModel::beginUpdateVertices)
+  CalMatrix *arrayTransformMatrix = m_bSkinFromSnapshot ? &(m_pModel->m_vectorSkinningMatrix[0]) : &(m_pModel->m_vectorTransformMatrix[0]);
+  CalVector *arrayTransformVector = m_bSkinFromSnapshot ? &(m_pModel->m_vectorSkinningVector[0]) : &(m_pModel->m_vectorTransformVector[0]);
+
+  // get vertex vector of the core submesh
+  CalCoreSubmesh::Vertex *arrayVertex = &(m_pCoreSubmesh->getVectorVertex()[0]);
+
+  // get tangent space vector of the core submesh.
+  CalCoreSubmesh::TangentSpace *arrayTangentSpace = 0;
+  if(bTangents)
+  {
+    if (!m_pCoreSubmesh->tangentsEnabled(textureCoordinateId))
+    {
+      CalError::setLastError(CalError::INVALID_TANGENT_SPACE, __FILE__, __LINE__, "");
+      return 0;
+    }
+    arrayTangentSpace = &(m_pCoreSubmesh->getVectorTangentSpace(textureCoordinateId)[0]);
+  }
+
+  // get influence vector of the core submesh
+  CalCoreSubmesh::Influence *arrayInfluence = 0;
+  if (m_pCoreSubmesh->getVectorInfluence().size()) arrayInfluence=&m_pCoreSubmesh->getVectorInfluence().front();
+
+  // get physical property vector of the core submesh
+  CalCoreSubmesh::PhysicalProperty *arrayPhysicalProperty = 0;
+  if (m_pCoreSubmesh->getVectorPhysicalProperty().size()) arrayPhysicalProperty=&m_pCoreSubmesh->getVectorPhysicalProperty().front();
+  bool bSprings = m_pCoreSubmesh->m_vectorSpring.size() > 0;
+
+  // use one transform per influence set, if the core submesh has a set table;
+  // skinVertices blends them once for all passes of an update
+  std::vector<CalCoreSubmesh::InfluenceSet>& vectorInfluenceSet = m_pCoreSubmesh->getVectorInfluenceSet();
+  std::vector<int>& vectorVertexInfluenceSet = m_pCoreSubmesh->getVectorVertexInfluenceSet();
+  bool bInfluenceSets = (m_influenceSetCount > 0) && (vectorVertexInfluenceSet.size() == m_pCoreSubmesh->getVectorVertex().size());
+  if(bInfluenceSets && !m_bInfluenceSetsBlended) blendInfluenceSets<MAXINF>();
+
+  // get the seam vertices; they refer to the influence set table
+  std::vector<int>& vectorSeamVertex = m_pCoreSubmesh->getVectorSeamVertex();
+  bool bSeams = bVertices && bInfluenceSets && (vectorSeamVertex.size() == vectorVertexInfluenceSet.size());
+  const float *pVertexBufferStart = pVertexBuffer;
+
+  // the transform of vertices without any influence
+  CalMatrix identity;
+  identity.dxdx = identity.dydy = identity.dzdz = 1.0f;
+  CalVector zero(0.0f, 0.0f, 0.0f);
+
+  // calculate all submesh vertices
+  int nextInfluence = 0;
+  for(size_t vertexId = 0; vertexId < m_vertexCount; vertexId++)
   {
-    if (vertex.influenceCount == 0) {
-      // Apply the bone transform to the position.
-      #if CALCULATE_VERTICES
-      pVertexBuffer[0] = vx;
-      pVertexBuffer[1] = vy;
-      pVertexBuffer[2] = vz;
-      pVertexBuffer += 3;
-      #endif
-    
-      // Apply the bone transform to the normal.
-      #if CALCULATE_NORMALS
-      pNormalBuffer[0] = nx;
-      pNormalBuffer[1] = ny;
-      pNormalBuffer[2] = nz;
-      pNormalBuffer += 3;
-      #endif
-
-      // Apply the bone transform to the tangent.
-      #if CALCULATE_TANGENTS
-      pTangentBuffer[0] = tx;
-      pTangentBuffer[1] = ty;
-      pTangentBuffer[2] = tz;
-      pTangentBuffer[3] = crossFactor;
-      pTangentBuffer += 4;
-      #endif
+    // get the vertex and its influences
+    CalCoreSubmesh::Vertex &vertex = arrayVertex[vertexId];
+    int influenceCount = vertex.influenceCount;
+    const CalCoreSubmesh::Influence *pInfluence = arrayInfluence + nextInfluence;
+    nextInfluence += influenceCount;
+
+    // skip vertices that are controlled by the spring subsystem.
+    if(bSprings && (arrayPhysicalProperty[vertexId].weight > 0.0f))
+    {
+      if(bVertices) pVertexBuffer += 3;
+      if(bNormals) pNormalBuffer += 3;
+      if(bTangents) pTangentBuffer += 4;
+      continue;
+    }
+
+    // find the transform of the vertex
+    CalMatrix blendedMatrix;
+    CalVector blendedVector;
+    const CalMatrix *pMatrix;
+    const CalVector *pVector;
+    bool bNormalize;
+
+    if(bInfluenceSets)
+    {
+      // The transform has already been blended for the influence set.
+      int influenceSetId = vectorVertexInfluenceSet[vertexId];
+      pMatrix = &m_vectorInfluenceSetMatrix[influenceSetId];
+      pVector = &m_vectorInfluenceSetVector[influenceSetId];
+      bNormalize = vectorInfluenceSet[influenceSetId].influenceCount > 1;
+    }
+    else if(influenceCount == 0)
+    {
+      // No bone at all, pass the vertex through.
+      pMatrix = &identity;
+      pVector = &zero;
+      bNormalize = false;
+    }
+    else if((MAXINF == 1) || (influenceCount == 1))
+    {
+      // Get data straight out of the bone, no blending involved.
+      int boneId = pInfluence[0].boneId;
+      pMatrix = &arrayTransformMatrix[boneId];
+      pVector = &arrayTransformVector[boneId];
+      bNormalize = false;
     }
     else
     {
-      // Apply the first influence to the blended rotation.
-      int boneId = arrayInfluence[nextInfluence].boneId;
-      float weight = arrayInfluence[nextInfluence].weight;
-      CalMatrix r(weight, arrayTransformMatrix[boneId]);
-      
-      // Apply the first influence to the blended translation.
-      #if CALCULATE_VERTICES
-      const CalVector &t = arrayTransformVector[boneId];
-      float x = t.x*weight;
-      float y = t.y*weight;
-      float z = t.z*weight;
-      #endif
-      
-      // Add in all other influences to the blended rotation and translation.
-      int influenceId;
-      for(influenceId = 1; influenceId < vertex.influenceCount; influenceId++)
-      {
-	int boneId = arrayInfluence[nextInfluence + influenceId].boneId;
-	float weight = arrayInfluence[nextInfluence + influenceId].weight;
-	r.blend(weight, arrayTransformMatrix[boneId]);
-        #if CALCULATE_VERTICES
-	const CalVector &t = arrayTransformVector[boneId];
-	x += t.x*weight;
-	y += t.y*weight;
-	z += t.z*weight;
-        #endif
-      }
-      nextInfluence += vertex.influenceCount;
-      
-      // Apply the blended rotation and blended translation to the position.
-      #if CALCULATE_VERTICES
-      pVertexBuffer[0] = x+r.dxdx*vx+r.dxdy*vy+r.dxdz*vz;
-      pVertexBuffer[1] = y+r.dydx*vx+r.dydy*vy+r.dydz*vz;
-      pVertexBuffer[2] = z+r.dzdx*vx+r.dzdy*vy+r.dzdz*vz;
-      pVertexBuffer += 3;
-      #endif
-    
-      // Apply the blended rotation to the normal.
-      #if CALCULATE_NORMALS
-      float postnx = r.dxdx*nx+r.dxdy*ny+r.dxdz*nz;
-      float postny = r.dydx*nx+r.dydy*ny+r.dydz*nz;
-      float postnz = r.dzdx*nx+r.dzdy*ny+r.dzdz*nz;
-      float nscale = 1.0f / sqrt(postnx * postnx + postny * postny + postnz * postnz);
-      pNormalBuffer[0] = postnx * nscale;
-      pNormalBuffer[1] = postny * nscale;
-      pNormalBuffer[2] = postnz * nscale;
-      pNormalBuffer += 3;
-      #endif
-      
-      // Apply the blended rotation to the tangent.
-      #if CALCULATE_TANGENTS
-      float posttx = r.dxdx*tx+r.dxdy*ty+r.dxdz*tz;
-      float postty = r.dydx*tx+r.dydy*ty+r.dydz*tz;
-      float posttz = r.dzdx*tx+r.dzdy*ty+r.dzdz*tz;
-      float tscale = 1.0f / sqrt(posttx * posttx + postty * postty + posttz * posttz);
-      pTangentBuffer[0] = posttx * tscale;
-      pTangentBuffer[1] = postty * tscale;
-      pTangentBuffer[2] = posttz * tscale;
-      pTangentBuffer[3] = crossFactor;
-      pTangentBuffer += 4;
-      #endif
+      // Blend all influences of the vertex.
+      calBlendInfluences<MAXINF>(pInfluence, influenceCount, arrayTransformMatrix, arrayTransformVector, blendedMatrix, blendedVector);
+      pMatrix = &blendedMatrix;
+      pVector = &blendedVector;
+      bNormalize = true;
     }
+
+    // seam vertices take the position of the earlier vertex they were split off
+    const float *pSeamPosition = 0;
+    if(bSeams && (vectorSeamVertex[vertexId] != (int)vertexId))
+    {
+      pSeamPosition = pVertexBufferStart + 3 * vectorSeamVertex[vertexId];
+    }
+
+    calTransformVertex<CHANNELS>(*pMatrix, *pVector, bNormalize, vertex, bTangents ? &arrayTangentSpace[vertexId] : 0,
+                                 pSeamPosition, pVertexBuffer, pNormalBuffer, pTangentBuffer);
   }
+
+  return m_vertexCount;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// Blends the transforms of the influence sets that the vertices of the
+// current lod level use into the per-submesh cache.
+//
+///////////////////////////////////////////////////////////////////////////////////////////
+
+template<int MAXINF>
+void CalSubmesh::blendInfluenceSets(void)
+{
+  if(m_influenceSetCount == 0) return;
+
+  const CalMatrix *arrayTransformMatrix;
+  const CalVector *arrayTransformVector;
+  getSkinningPalette(arrayTransformMatrix, arrayTransformVector);
+
+  size_t influenceSetCount = m_pCoreSubmesh->getVectorInfluenceSet().size();
+  m_vectorInfluenceSetMatrix.resize(influenceSetCount);
+  m_vectorInfluenceSetVector.resize(influenceSetCount);
+  calBlendInfluenceSets<MAXINF>(m_pCoreSubmesh, arrayTransformMatrix, arrayTransformVector, (int)std::min(m_influenceSetCount, influenceSetCount),
+                                &m_vectorInfluenceSetMatrix[0], &m_vectorInfluenceSetVector[0]);
 }
 
-return m_vertexCount;
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// Binds the kernel instances of one maximum influence count into a kernel
+// table that is indexed by the channel mask.
+//
+///////////////////////////////////////////////////////////////////////////////////////////
 
+template<int MAXINF>
+void CalSubmesh::bindKernelSet(void)
+{
+  m_arrayKernel[SKIN_VERTICES] = &CalSubmesh::calculateKernel<SKIN_VERTICES, MAXINF>;
+  m_arrayKernel[SKIN_NORMALS] = &CalSubmesh::calculateKernel<SKIN_NORMALS, MAXINF>;
+  m_arrayKernel[SKIN_TANGENTS] = &CalSubmesh::calculateKernel<SKIN_TANGENTS, MAXINF>;
+  m_arrayKernel[SKIN_VERTICES | SKIN_NORMALS] = &CalSubmesh::calculateKernel<SKIN_VERTICES | SKIN_NORMALS, MAXINF>;
+  m_arrayKernel[SKIN_VERTICES | SKIN_NORMALS | SKIN_TANGENTS] = &CalSubmesh::calculateKernel<SKIN_VERTICES | SKIN_NORMALS | SKIN_TANGENTS, MAXINF>;
+  m_blendInfluenceSets = &CalSubmesh::blendInfluenceSets<MAXINF>;
+}
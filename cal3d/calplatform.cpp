@@ -341,6 +341,136 @@ bool CalPlatform::readString(char* input, std::string& strValue)
   return true;
 }
 
+ /*****************************************************************************/
+/** Reads a number of floats.
+  *
+  * This function reads a given number of floats from an input stream in one
+  * block.
+  *
+  * @param input The stream to read the floats from.
+  * @param pValue A pointer to the array where the floats are stored into.
+  * @param count The number of floats that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalPlatform::readFloats(std::istream& input, float *pValue, int count)
+{
+  if((count < 0) || (count > 0x1fffffff)) return false;
+
+  input.read((char *)pValue, 4 * count);
+  if(!input) return false;
+
+  swapWords(pValue, count);
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Reads a number of integers.
+  *
+  * This function reads a given number of integers from an input stream in one
+  * block.
+  *
+  * @param input The stream to read the integers from.
+  * @param pValue A pointer to the array where the integers are stored into.
+  * @param count The number of integers that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalPlatform::readIntegers(std::istream& input, int *pValue, int count)
+{
+  if((count < 0) || (count > 0x1fffffff)) return false;
+
+  input.read((char *)pValue, 4 * count);
+  if(!input) return false;
+
+  swapWords(pValue, count);
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Reads a number of floats.
+  *
+  * This function reads a given number of floats from a memory buffer in one
+  * block.
+  *
+  * @param input The memory buffer to read the floats from.
+  * @param pValue A pointer to the array where the floats are stored into.
+  * @param count The number of floats that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalPlatform::readFloats(char* input, float *pValue, int count)
+{
+  if((input == NULL) || (count < 0)) return false;
+
+  memcpy( (void*)pValue, (void*)input, 4 * count );
+  swapWords(pValue, count);
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Reads a number of integers.
+  *
+  * This function reads a given number of integers from a memory buffer in one
+  * block.
+  *
+  * @param input The memory buffer to read the integers from.
+  * @param pValue A pointer to the array where the integers are stored into.
+  * @param count The number of integers that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalPlatform::readIntegers(char* input, int *pValue, int count)
+{
+  if((input == NULL) || (count < 0)) return false;
+
+  memcpy( (void*)pValue, (void*)input, 4 * count );
+  swapWords(pValue, count);
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Converts an array of 32 bit words from file byte order.
+  *
+  * This function swaps the bytes of every word on big endian machines and
+  * does nothing on little endian ones. The loop is written so compilers can
+  * vectorize it.
+  *
+  * @param pBuffer A pointer to the words.
+  * @param count The number of words.
+  *****************************************************************************/
+
+void CalPlatform::swapWords(void *pBuffer, int count)
+{
+#ifdef CAL3D_BIG_ENDIAN
+  unsigned int *pWord = (unsigned int *)pBuffer;
+  for(int wordId = 0; wordId < count; wordId++)
+  {
+    unsigned int x = pWord[wordId];
+    pWord[wordId] = (x >> 24) | ((x >> 8) & 0x0000ff00) | ((x << 8) & 0x00ff0000) | (x << 24);
+  }
+#else
+  (void)pBuffer;
+  (void)count;
+#endif
+}
+
 
  /*****************************************************************************/
 /** Writes a number of bytes.
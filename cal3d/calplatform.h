@@ -114,12 +114,17 @@ public:
   static bool readShort(std::istream& input, short& value);
   static bool readInteger(std::istream& input, int& value);
   static bool readString(std::istream& input, std::string& strValue);
+  static bool readFloats(std::istream& input, float *pValue, int count);
+  static bool readIntegers(std::istream& input, int *pValue, int count);
 
   static bool readBytes(char* input, void *pBuffer, int length);
   static bool readFloat(char* input, float& value);
   static bool readShort(char* input, short& value);
   static bool readInteger(char* input, int& value);
   static bool readString(char* input, std::string& strValue);
+  static bool readFloats(char* input, float *pValue, int count);
+  static bool readIntegers(char* input, int *pValue, int count);
+  static void swapWords(void *pBuffer, int count);
 
   static bool writeBytes(std::ostream& output, const void *pBuffer, int length);
   static bool writeFloat(std::ostream& output, float value);
@@ -29,6 +29,263 @@
 #include "calcoretrack.h"
 #include "calcorekey.h"
 #include "calcoresub.h"
+#include "calbaked.h"
+#include "streamsink.h"
+
+//****************************************************************************//
+// Baked file writer                                                          //
+//****************************************************************************//
+
+namespace
+{
+  /// Returns the address of the elements of a vector, or 0 if it is empty.
+  template<typename T>
+  const void *getArray(const std::vector<T>& vectorElement)
+  {
+    return vectorElement.empty() ? 0 : &vectorElement[0];
+  }
+
+  /// Brings in the keyframes of a lazily loaded core animation for saving,
+  /// and frees them again afterwards if they were not in memory before.
+  class TrackLoad
+  {
+  public:
+    TrackLoad(CalCoreAnimation *pCoreAnimation)
+      : m_pCoreAnimation(pCoreAnimation), m_bUnload(!pCoreAnimation->isTrackDataLoaded())
+    {
+    }
+
+    ~TrackLoad()
+    {
+      if(m_bUnload) m_pCoreAnimation->unloadTracks();
+    }
+
+    bool load()
+    {
+      return m_pCoreAnimation->loadTracks();
+    }
+
+  private:
+    CalCoreAnimation *m_pCoreAnimation;
+    bool m_bUnload;
+  };
+
+  /// Collects the sections of a baked file and writes them aligned.
+  class BakedWriter
+  {
+  public:
+    BakedWriter(int contentType)
+      : m_contentType(contentType)
+    {
+    }
+
+    /// Adds a section that refers to an array kept alive by the caller.
+    void addSection(int type, int owner, int index, const void *pData, size_t count)
+    {
+      if(count == 0) return;
+
+      Block block;
+      block.section.type = type;
+      block.section.owner = owner;
+      block.section.index = index;
+      block.section.offset = 0;
+      block.section.count = (unsigned int)count;
+      block.section.reserved = 0;
+      block.pData = pData;
+      m_vectorBlock.push_back(block);
+    }
+
+    /// Adds a section whose array the writer keeps, for converted data.
+    template<typename T>
+    T *addTable(int type, int owner, int index, size_t count)
+    {
+      if(count == 0) return 0;
+
+      m_listTable.push_back(std::vector<char>(count * sizeof(T), 0));
+      T *pTable = (T *)&m_listTable.back()[0];
+      addSection(type, owner, index, pTable, count);
+
+      return pTable;
+    }
+
+    /// Adds a string to the string section and returns its offset.
+    int addString(const std::string& strValue)
+    {
+      int offset = (int)m_vectorString.size();
+      m_vectorString.insert(m_vectorString.end(), strValue.c_str(), strValue.c_str() + strValue.size() + 1);
+
+      return offset;
+    }
+
+    bool write(CalDataSink& dataSink)
+    {
+      addSection(CalBaked::SECTION_STRING, -1, 0, m_vectorString.empty() ? 0 : &m_vectorString[0], m_vectorString.size());
+
+      // lay out the arrays behind the section table
+      unsigned int bodySize = align((unsigned int)(m_vectorBlock.size() * sizeof(CalBaked::Section)));
+      std::vector<CalBaked::Section> vectorSection;
+      size_t blockId;
+      for(blockId = 0; blockId < m_vectorBlock.size(); blockId++)
+      {
+        CalBaked::Section& section = m_vectorBlock[blockId].section;
+        section.offset = bodySize;
+        bodySize = align(bodySize + section.count * CalBaked::getElementSize(section.type));
+        vectorSection.push_back(section);
+      }
+
+      CalBaked::Header header;
+      memcpy(header.magic, Cal::BAKED_FILE_MAGIC, sizeof(header.magic));
+      header.version = Cal::BAKED_FILE_VERSION;
+      header.byteOrder = CalBaked::BYTE_ORDER_TAG;
+      header.contentType = m_contentType;
+      header.bodySize = bodySize;
+      header.sectionCount = (int)vectorSection.size();
+      header.reserved[0] = 0;
+      header.reserved[1] = 0;
+
+      if(!dataSink.ok())
+      {
+        CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
+        return false;
+      }
+
+      // write the header and the section table
+      bool bWritten = dataSink.writeBytes(&header, sizeof(header));
+      if(!vectorSection.empty()) bWritten = bWritten && dataSink.writeBytes(&vectorSection[0], (int)(vectorSection.size() * sizeof(CalBaked::Section)));
+
+      // write all arrays
+      unsigned int position = (unsigned int)(vectorSection.size() * sizeof(CalBaked::Section));
+      for(blockId = 0; bWritten && (blockId < m_vectorBlock.size()); blockId++)
+      {
+        const CalBaked::Section& section = m_vectorBlock[blockId].section;
+        bWritten = pad(dataSink, section.offset - position)
+          && dataSink.writeBytes(m_vectorBlock[blockId].pData, section.count * CalBaked::getElementSize(section.type));
+        position = section.offset + section.count * CalBaked::getElementSize(section.type);
+      }
+      bWritten = bWritten && pad(dataSink, bodySize - position);
+
+      if(!bWritten)
+      {
+        dataSink.setError();
+        return false;
+      }
+
+      return true;
+    }
+
+  private:
+    struct Block
+    {
+      CalBaked::Section section;
+      const void *pData;
+    };
+
+    static unsigned int align(unsigned int offset)
+    {
+      return (offset + CalBaked::ALIGNMENT - 1) & ~(unsigned int)(CalBaked::ALIGNMENT - 1);
+    }
+
+    static bool pad(CalDataSink& dataSink, unsigned int length)
+    {
+      static const char zero[CalBaked::ALIGNMENT] = { 0 };
+      return dataSink.writeBytes(zero, length);
+    }
+
+    int m_contentType;
+    std::vector<Block> m_vectorBlock;
+    std::list<std::vector<char> > m_listTable;
+    std::vector<char> m_vectorString;
+  };
+}
+
+//****************************************************************************//
+// Section buffers                                                            //
+//****************************************************************************//
+
+namespace
+{
+  /// Size from which buffered sections are handed to the data sink.
+  const size_t FLUSH_SIZE = 64 * 1024;
+
+  void appendBytes(std::vector<char>& vectorSection, const void *pData, size_t length)
+  {
+    const char *pBytes = (const char *)pData;
+    vectorSection.insert(vectorSection.end(), pBytes, pBytes + length);
+  }
+
+  /// Appends 32 bit words, little endian like all cal3d files.
+  void appendWords(std::vector<char>& vectorSection, const void *pData, size_t count)
+  {
+    size_t size = vectorSection.size();
+    appendBytes(vectorSection, pData, count * 4);
+    if(count > 0) CalPlatform::swapWords(&vectorSection[size], (int)count);
+  }
+
+  void appendInteger(std::vector<char>& vectorSection, int value)
+  {
+    appendWords(vectorSection, &value, 1);
+  }
+
+  void appendFloat(std::vector<char>& vectorSection, float value)
+  {
+    appendWords(vectorSection, &value, 1);
+  }
+
+  void appendString(std::vector<char>& vectorSection, const std::string& strValue)
+  {
+    appendInteger(vectorSection, (int)strValue.size() + 1);
+    appendBytes(vectorSection, strValue.c_str(), strValue.size() + 1);
+  }
+
+  /// Hands the buffered sections to the data sink once they reach FLUSH_SIZE,
+  /// or right away if bFinal is set.
+  bool flushSections(CalDataSink& dataSink, std::vector<char>& vectorSection, bool bFinal)
+  {
+    if(vectorSection.empty() || (!bFinal && (vectorSection.size() < FLUSH_SIZE))) return true;
+
+    if(!dataSink.writeBytes(&vectorSection[0], (int)vectorSection.size()))
+    {
+      dataSink.setError();
+      return false;
+    }
+
+    vectorSection.clear();
+
+    return true;
+  }
+
+  /// Creates a file and saves an object into it through a stream sink.
+  template<class Object>
+  bool saveFile(CalSaver& saver, bool (CalSaver::*pSave)(CalDataSink&, Object *), const std::string& strFilename, Object *pObject)
+  {
+    // open the file
+    std::ofstream file;
+    file.open(strFilename.c_str(), std::ios::out | std::ios::binary);
+    if(!file)
+    {
+      CalError::setLastError(CalError::FILE_CREATION_FAILED, __FILE__, __LINE__, strFilename);
+      return false;
+    }
+
+    CalStreamSink dataSink(file);
+    if(!(saver.*pSave)(dataSink, pObject))
+    {
+      // name the file if writing it failed
+      if(!dataSink.ok()) CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
+      return false;
+    }
+
+    // explicitly close the file
+    file.close();
+    if(!file)
+    {
+      CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
+      return false;
+    }
+
+    return true;
+  }
+}
 
  /*****************************************************************************/
 /** Constructs the saver instance.
@@ -51,9 +308,10 @@ CalSaver::~CalSaver()
 }
 
  /*****************************************************************************/
-/** Saves a core animation instance.
+/** Saves a core animation instance in the baked format.
   *
-  * This function saves a core animation instance to a file.
+  * This function saves a core animation instance to a baked file, which holds
+  * all keyframes in one array. See calbaked.h for the layout.
   *
   * @param strFilename The name of the file to save the core animation instance
   *                    to.
@@ -65,243 +323,478 @@ CalSaver::~CalSaver()
   *         \li \b false if an error happend
   *****************************************************************************/
 
-bool CalSaver::saveCoreAnimation(const std::string& strFilename, CalCoreAnimation *pCoreAnimation)
+bool CalSaver::saveBakedCoreAnimation(const std::string& strFilename, CalCoreAnimation *pCoreAnimation)
 {
-  // open the file
-  std::ofstream file;
-  file.open(strFilename.c_str(), std::ios::out | std::ios::binary);
-  if(!file)
-  {
-    CalError::setLastError(CalError::FILE_CREATION_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
-  }
+  return saveFile(*this, &CalSaver::saveBakedCoreAnimation, strFilename, pCoreAnimation);
+}
+
+ /*****************************************************************************/
+/** Saves a core animation instance in the baked format to a data sink.
+  *
+  * This function saves a core animation instance like the file version of
+  * saveBakedCoreAnimation() does, but hands the data to a data sink.
+  *
+  * @param dataSink The data sink to save the core animation instance to.
+  * @param pCoreAnimation A pointer to the core animation instance that should
+  *                       be saved.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
 
-  // write magic tag
-  file.write((char *)&Cal::ANIMATION_FILE_MAGIC, sizeof(Cal::ANIMATION_FILE_MAGIC));
-  if(!file)
+bool CalSaver::saveBakedCoreAnimation(CalDataSink& dataSink, CalCoreAnimation *pCoreAnimation)
+{
+  // bring in the keyframes of a lazily loaded core animation; a streamed one
+  // keeps streaming from its chunks meanwhile
+  TrackLoad trackLoad(pCoreAnimation);
+  if(!trackLoad.load()) return false;
+
+  BakedWriter writer(CalBaked::CONTENT_ANIMATION);
+
+  CalBaked::Animation *pAnimation = writer.addTable<CalBaked::Animation>(CalBaked::SECTION_ANIMATION, -1, 0, 1);
+  pAnimation->duration = pCoreAnimation->getDuration();
+
+  // get core track list
+  std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+  // count the keyframes of all tracks
+  size_t keyframeCount = 0;
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
   {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
+    keyframeCount += (*iteratorCoreTrack)->getMapCoreKeyframe().size();
   }
 
-  // write version info
-  file.write((char *)&Cal::CURRENT_FILE_VERSION, sizeof(Cal::CURRENT_FILE_VERSION));
-  if(!file)
+  CalBaked::Track *pTrack = writer.addTable<CalBaked::Track>(CalBaked::SECTION_TRACK, -1, 0, listCoreTrack.size());
+  CalBaked::Keyframe *pKeyframe = writer.addTable<CalBaked::Keyframe>(CalBaked::SECTION_KEYFRAME, -1, 0, keyframeCount);
+
+  // store the keyframes of each track one after the other
+  int keyframeId = 0;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack, ++pTrack)
   {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
+    std::map<float, CalCoreKeyframe *>& mapCoreKeyframe = (*iteratorCoreTrack)->getMapCoreKeyframe();
+
+    pTrack->nameOffset = writer.addString((*iteratorCoreTrack)->getCoreBoneName());
+    pTrack->firstKeyframe = keyframeId;
+    pTrack->keyframeCount = (int)mapCoreKeyframe.size();
+
+    std::map<float, CalCoreKeyframe *>::iterator iteratorCoreKeyframe;
+    for(iteratorCoreKeyframe = mapCoreKeyframe.begin(); iteratorCoreKeyframe != mapCoreKeyframe.end(); ++iteratorCoreKeyframe, ++keyframeId)
+    {
+      CalCoreKeyframe *pCoreKeyframe = iteratorCoreKeyframe->second;
+      const CalVector& translation = pCoreKeyframe->getOrientation();
+      const CalQuaternion& rotation = pCoreKeyframe->getRotation();
+
+      pKeyframe[keyframeId].time = pCoreKeyframe->getTime();
+      pKeyframe[keyframeId].translation[0] = translation.x;
+      pKeyframe[keyframeId].translation[1] = translation.y;
+      pKeyframe[keyframeId].translation[2] = translation.z;
+      pKeyframe[keyframeId].rotation[0] = rotation.x;
+      pKeyframe[keyframeId].rotation[1] = rotation.y;
+      pKeyframe[keyframeId].rotation[2] = rotation.z;
+      pKeyframe[keyframeId].rotation[3] = rotation.w;
+    }
   }
 
-  // write the duration of the core animation
-  float duration;
-  duration = pCoreAnimation->getDuration();
+  return writer.write(dataSink);
+}
+
+ /*****************************************************************************/
+/** Saves a core model instance in the baked format.
+  *
+  * This function saves a core model instance to a baked file, which holds the
+  * skeleton and every array of the core submeshes as they are kept in memory,
+  * including the precomputed LOD step, influence set and spring batch tables.
+  * See calbaked.h for the layout.
+  *
+  * @param strFilename The name of the file to save the core model instance to.
+  * @param pCoreModel A pointer to the core model instance that should be saved.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalSaver::saveBakedCoreModel(const std::string& strFilename, CalCoreModel *pCoreModel)
+{
+  return saveFile(*this, &CalSaver::saveBakedCoreModel, strFilename, pCoreModel);
+}
+
+ /*****************************************************************************/
+/** Saves a core model instance in the baked format to a data sink.
+  *
+  * This function saves a core model instance like the file version of
+  * saveBakedCoreModel() does, but hands the data to a data sink.
+  *
+  * @param dataSink The data sink to save the core model instance to.
+  * @param pCoreModel A pointer to the core model instance that should be saved.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalSaver::saveBakedCoreModel(CalDataSink& dataSink, CalCoreModel *pCoreModel)
+{
+  BakedWriter writer(CalBaked::CONTENT_MODEL);
 
-  file.write((char *)&duration, 4);
-  if(!file)
+  // count the children of all bones
+  int boneCount = pCoreModel->getCoreBoneCount();
+  size_t childCount = 0;
+  int boneId;
+  for(boneId = 0; boneId < boneCount; boneId++)
   {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
+    childCount += pCoreModel->getCoreBone(boneId)->getListChildId().size();
   }
 
-  // get core track list
-  std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
-
-  // write the number of tracks
-  int trackCount;
-  trackCount = listCoreTrack.size();
+  CalBaked::Bone *pBone = writer.addTable<CalBaked::Bone>(CalBaked::SECTION_BONE, -1, 0, boneCount);
+  int *pChildId = writer.addTable<int>(CalBaked::SECTION_BONE_CHILD, -1, 0, childCount);
 
-  file.write((char *)&trackCount, 4);
-  if(!file)
+  // store the skeleton
+  int childId = 0;
+  for(boneId = 0; boneId < boneCount; boneId++)
   {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return 0;
+    CalCoreBone *pCoreBone = pCoreModel->getCoreBone(boneId);
+    CalBaked::Bone& bone = pBone[boneId];
+
+    bone.nameOffset = writer.addString(pCoreBone->getName());
+    bone.parentId = pCoreBone->getParentId();
+    bone.length = pCoreBone->getLength();
+
+    const CalVector& translation = pCoreBone->getTranslation();
+    const CalQuaternion& rotation = pCoreBone->getRotation();
+    const CalVector& translationBoneSpace = pCoreBone->getTranslationBoneSpace();
+    const CalQuaternion& rotationBoneSpace = pCoreBone->getRotationBoneSpace();
+    bone.translation[0] = translation.x;
+    bone.translation[1] = translation.y;
+    bone.translation[2] = translation.z;
+    bone.rotation[0] = rotation.x;
+    bone.rotation[1] = rotation.y;
+    bone.rotation[2] = rotation.z;
+    bone.rotation[3] = rotation.w;
+    bone.translationBoneSpace[0] = translationBoneSpace.x;
+    bone.translationBoneSpace[1] = translationBoneSpace.y;
+    bone.translationBoneSpace[2] = translationBoneSpace.z;
+    bone.rotationBoneSpace[0] = rotationBoneSpace.x;
+    bone.rotationBoneSpace[1] = rotationBoneSpace.y;
+    bone.rotationBoneSpace[2] = rotationBoneSpace.z;
+    bone.rotationBoneSpace[3] = rotationBoneSpace.w;
+
+    std::list<int>& listChildId = pCoreBone->getListChildId();
+    bone.firstChild = childId;
+    bone.childCount = (int)listChildId.size();
+
+    std::list<int>::iterator iteratorChildId;
+    for(iteratorChildId = listChildId.begin(); iteratorChildId != listChildId.end(); ++iteratorChildId)
+    {
+      pChildId[childId++] = *iteratorChildId;
+    }
   }
 
-  // write all core bones
-  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
-  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+  int submeshCount = pCoreModel->getCoreSubmeshCount();
+  CalBaked::Submesh *pSubmesh = writer.addTable<CalBaked::Submesh>(CalBaked::SECTION_SUBMESH, -1, 0, submeshCount);
+
+  // store the arrays of all submeshes
+  int submeshId;
+  for(submeshId = 0; submeshId < submeshCount; submeshId++)
   {
-    // save core track
-    if(!saveCoreTrack(file, strFilename, *iteratorCoreTrack))
+    CalCoreSubmesh *pCoreSubmesh = pCoreModel->getCoreSubmesh(submeshId);
+    CalBaked::Submesh& submesh = pSubmesh[submeshId];
+
+    int vertexCount = (int)pCoreSubmesh->m_vectorVertex.size();
+    int textureCoordinateCount = (int)pCoreSubmesh->m_vectorvectorTextureCoordinate.size();
+
+    submesh.coreMaterialThreadId = pCoreSubmesh->m_coreMaterialThreadId;
+    submesh.vertexCount = vertexCount;
+    submesh.faceCount = (int)pCoreSubmesh->m_vectorFace.size();
+    submesh.lodCount = (int)pCoreSubmesh->m_lodCount;
+    submesh.springCount = (int)pCoreSubmesh->m_vectorSpring.size();
+    submesh.textureCoordinateCount = textureCoordinateCount;
+    submesh.maxInfluenceCount = pCoreSubmesh->m_maxInfluenceCount;
+    submesh.reserved = 0;
+
+    // the vertex and lod control layouts depend on the build, so convert them
+    CalBaked::Vertex *pVertex = writer.addTable<CalBaked::Vertex>(CalBaked::SECTION_VERTEX, submeshId, 0, vertexCount);
+    CalBaked::LodControl *pLodControl = writer.addTable<CalBaked::LodControl>(CalBaked::SECTION_LOD_CONTROL, submeshId, 0, vertexCount);
+
+    int vertexId;
+    for(vertexId = 0; vertexId < vertexCount; vertexId++)
     {
-      return false;
+      const CalCoreSubmesh::Vertex& vertex = pCoreSubmesh->m_vectorVertex[vertexId];
+      pVertex[vertexId].position[0] = vertex.position.x;
+      pVertex[vertexId].position[1] = vertex.position.y;
+      pVertex[vertexId].position[2] = vertex.position.z;
+      pVertex[vertexId].nx = vertex.nx;
+      pVertex[vertexId].ny = vertex.ny;
+      pVertex[vertexId].nz = vertex.nz;
+      pVertex[vertexId].influenceCount = vertex.influenceCount;
+
+      pLodControl[vertexId].faceCollapseCount = (int)pCoreSubmesh->m_vectorLodControl[vertexId].faceCollapseCount;
+      pLodControl[vertexId].collapseId = pCoreSubmesh->m_vectorLodControl[vertexId].collapseId;
     }
+
+    writer.addSection(CalBaked::SECTION_INFLUENCE, submeshId, 0, getArray(pCoreSubmesh->m_vectorInfluence), pCoreSubmesh->m_vectorInfluence.size());
+    if(submesh.springCount > 0)
+    {
+      writer.addSection(CalBaked::SECTION_PHYSICAL_PROPERTY, submeshId, 0, getArray(pCoreSubmesh->m_vectorPhysicalProperty), pCoreSubmesh->m_vectorPhysicalProperty.size());
+    }
+    writer.addSection(CalBaked::SECTION_SPRING, submeshId, 0, getArray(pCoreSubmesh->m_vectorSpring), pCoreSubmesh->m_vectorSpring.size());
+    writer.addSection(CalBaked::SECTION_FACE, submeshId, 0, getArray(pCoreSubmesh->m_vectorFace), pCoreSubmesh->m_vectorFace.size());
+
+    int textureCoordinateId;
+    for(textureCoordinateId = 0; textureCoordinateId < textureCoordinateCount; textureCoordinateId++)
+    {
+      writer.addSection(CalBaked::SECTION_TEXTURE_COORDINATE, submeshId, textureCoordinateId, getArray(pCoreSubmesh->m_vectorvectorTextureCoordinate[textureCoordinateId]), pCoreSubmesh->m_vectorvectorTextureCoordinate[textureCoordinateId].size());
+      if(pCoreSubmesh->m_vectorTangentsEnabled[textureCoordinateId])
+      {
+        writer.addSection(CalBaked::SECTION_TANGENT_SPACE, submeshId, textureCoordinateId, getArray(pCoreSubmesh->m_vectorvectorTangentSpace[textureCoordinateId]), pCoreSubmesh->m_vectorvectorTangentSpace[textureCoordinateId].size());
+      }
+    }
+
+    // the precomputed tables, so the loader doesn't need to build them again
+    std::vector<CalCoreSubmesh::LodStep>& vectorLodStep = pCoreSubmesh->m_vectorLodStep;
+    CalBaked::LodStep *pLodStep = writer.addTable<CalBaked::LodStep>(CalBaked::SECTION_LOD_STEP, submeshId, 0, vectorLodStep.size());
+    size_t lodStepId;
+    for(lodStepId = 0; lodStepId < vectorLodStep.size(); lodStepId++)
+    {
+      pLodStep[lodStepId].vertexCount = (int)vectorLodStep[lodStepId].vertexCount;
+      pLodStep[lodStepId].faceCount = (int)vectorLodStep[lodStepId].faceCount;
+      pLodStep[lodStepId].firstFace = (int)vectorLodStep[lodStepId].firstFace;
+    }
+    writer.addSection(CalBaked::SECTION_LOD_FACE, submeshId, 0, getArray(pCoreSubmesh->m_vectorLodFace), pCoreSubmesh->m_vectorLodFace.size());
+
+    writer.addSection(CalBaked::SECTION_INFLUENCE_SET, submeshId, 0, getArray(pCoreSubmesh->m_vectorInfluenceSet), pCoreSubmesh->m_vectorInfluenceSet.size());
+    writer.addSection(CalBaked::SECTION_VERTEX_INFLUENCE_SET, submeshId, 0, getArray(pCoreSubmesh->m_vectorVertexInfluenceSet), pCoreSubmesh->m_vectorVertexInfluenceSet.size());
+    writer.addSection(CalBaked::SECTION_SEAM_VERTEX, submeshId, 0, getArray(pCoreSubmesh->m_vectorSeamVertex), pCoreSubmesh->m_vectorSeamVertex.size());
+
+    writer.addSection(CalBaked::SECTION_SPRING_BATCH, submeshId, 0, getArray(pCoreSubmesh->m_vectorSpringBatch), pCoreSubmesh->m_vectorSpringBatch.size());
+    writer.addSection(CalBaked::SECTION_SPRING_FACTOR, submeshId, 0, getArray(pCoreSubmesh->m_vectorSpringFactor), pCoreSubmesh->m_vectorSpringFactor.size());
   }
 
-  // explicitly close the file
-  file.close();
+  return writer.write(dataSink);
+}
 
-  return true;
+ /*****************************************************************************/
+/** Saves a core animation instance.
+  *
+  * This function saves a core animation instance to a file.
+  *
+  * @param strFilename The name of the file to save the core animation instance
+  *                    to.
+  * @param pCoreAnimation A pointer to the core animation instance that should
+  *                       be saved.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalSaver::saveCoreAnimation(const std::string& strFilename, CalCoreAnimation *pCoreAnimation)
+{
+  return saveFile(*this, &CalSaver::saveCoreAnimation, strFilename, pCoreAnimation);
 }
 
  /*****************************************************************************/
-/** Saves a core bone instance.
+/** Saves a core animation instance to a data sink.
   *
-  * This function saves a core bone instance to a file stream.
+  * This function saves a core animation instance in the caf format to a data
+  * sink. The tracks are collected in a memory buffer that is handed to the
+  * data sink in large blocks.
   *
-  * @param file The file stream to save the core bone instance to.
-  * @param strFilename The name of the file stream.
-  * @param pCoreBone A pointer to the core bone instance that should be saved.
+  * @param dataSink The data sink to save the core animation instance to.
+  * @param pCoreAnimation A pointer to the core animation instance that should
+  *                       be saved.
   *
   * @return One of the following values:
   *         \li \b true if successful
   *         \li \b false if an error happend
   *****************************************************************************/
 
-bool CalSaver::saveCoreBones(std::ofstream& file, const std::string& strFilename, CalCoreBone *pCoreBone)
+bool CalSaver::saveCoreAnimation(CalDataSink& dataSink, CalCoreAnimation *pCoreAnimation)
 {
-  if(!file)
+  // bring in the keyframes of a lazily loaded core animation; a streamed one
+  // keeps streaming from its chunks meanwhile
+  TrackLoad trackLoad(pCoreAnimation);
+  if(!trackLoad.load()) return false;
+
+  if(!dataSink.ok())
   {
-    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, strFilename);
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
     return false;
   }
 
-  // write the name of the bone
-  int len;
-  len = pCoreBone->getName().size() + 1;
-  file.write((char *)&len, 4);
-  file.write(pCoreBone->getName().c_str(), len);
-  if(!file)
+  // get core track list
+  std::list<CalCoreTrack *>& listCoreTrack = pCoreAnimation->getListCoreTrack();
+
+  // write magic tag, version info, duration and the number of tracks
+  std::vector<char> vectorSection;
+  appendBytes(vectorSection, Cal::ANIMATION_FILE_MAGIC, sizeof(Cal::ANIMATION_FILE_MAGIC));
+  appendInteger(vectorSection, Cal::CURRENT_FILE_VERSION);
+  appendFloat(vectorSection, pCoreAnimation->getDuration());
+  appendInteger(vectorSection, (int)listCoreTrack.size());
+
+  // write all core tracks
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+  for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
   {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
+    saveCoreTrack(vectorSection, *iteratorCoreTrack);
+    if(!flushSections(dataSink, vectorSection, false)) return false;
   }
 
+  return flushSections(dataSink, vectorSection, true);
+}
+
+ /*****************************************************************************/
+/** Saves a core bone instance.
+  *
+  * This function appends a core bone instance to a section buffer.
+  *
+  * @param vectorSection The section buffer to append the core bone instance to.
+  * @param pCoreBone A pointer to the core bone instance that should be saved.
+  *****************************************************************************/
+
+void CalSaver::saveCoreBones(std::vector<char>& vectorSection, CalCoreBone *pCoreBone)
+{
+  // write the name of the bone
+  appendString(vectorSection, pCoreBone->getName());
+
   // write the length of the bone.
-  float length = pCoreBone->getLength();
-  file.write((char *)&length, 4);
+  appendFloat(vectorSection, pCoreBone->getLength());
 
   // write the translation of the bone
   const CalVector& translation = pCoreBone->getTranslation();
-  file.write((char *)&translation[0], 4);
-  file.write((char *)&translation[1], 4);
-  file.write((char *)&translation[2], 4);
+  appendFloat(vectorSection, translation[0]);
+  appendFloat(vectorSection, translation[1]);
+  appendFloat(vectorSection, translation[2]);
 
   // write the rotation of the bone
   const CalQuaternion& rotation = pCoreBone->getRotation();
-  file.write((char *)&rotation[0], 4);
-  file.write((char *)&rotation[1], 4);
-  file.write((char *)&rotation[2], 4);
-  file.write((char *)&rotation[3], 4);
+  appendFloat(vectorSection, rotation[0]);
+  appendFloat(vectorSection, rotation[1]);
+  appendFloat(vectorSection, rotation[2]);
+  appendFloat(vectorSection, rotation[3]);
 
   // write the translation of the bone
   const CalVector& translationBoneSpace = pCoreBone->getTranslationBoneSpace();
-  file.write((char *)&translationBoneSpace[0], 4);
-  file.write((char *)&translationBoneSpace[1], 4);
-  file.write((char *)&translationBoneSpace[2], 4);
+  appendFloat(vectorSection, translationBoneSpace[0]);
+  appendFloat(vectorSection, translationBoneSpace[1]);
+  appendFloat(vectorSection, translationBoneSpace[2]);
 
   // write the rotation of the bone
   const CalQuaternion& rotationBoneSpace = pCoreBone->getRotationBoneSpace();
-  file.write((char *)&rotationBoneSpace[0], 4);
-  file.write((char *)&rotationBoneSpace[1], 4);
-  file.write((char *)&rotationBoneSpace[2], 4);
-  file.write((char *)&rotationBoneSpace[3], 4);
+  appendFloat(vectorSection, rotationBoneSpace[0]);
+  appendFloat(vectorSection, rotationBoneSpace[1]);
+  appendFloat(vectorSection, rotationBoneSpace[2]);
+  appendFloat(vectorSection, rotationBoneSpace[3]);
 
   // write the parent bone id
-  int parentId;
-  parentId = pCoreBone->getParentId();
-  file.write((char *)&parentId, 4);
-
-  // check if an error happend
-  if(!file)
-  {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
-  }
+  appendInteger(vectorSection, pCoreBone->getParentId());
 
   // get children list
   std::list<int>& listChildId = pCoreBone->getListChildId();
 
   // write the number of children
-  int childCount;
-  childCount = listChildId.size();
-
-  file.write((char *)&childCount, 4);
-  if(!file)
-  {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
-  }
+  appendInteger(vectorSection, (int)listChildId.size());
 
   // write all children ids
   std::list<int>::iterator iteratorChildId;
   for(iteratorChildId = listChildId.begin(); iteratorChildId != listChildId.end(); ++iteratorChildId)
   {
-    // get child id
-    int childId;
-    childId = *iteratorChildId;
-
-    // write child id
-    file.write((char *)&childId, 4);
-    if(!file)
-    {
-      CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-      return false;
-    }
+    appendInteger(vectorSection, *iteratorChildId);
   }
-
-  return true;
 }
 
  /*****************************************************************************/
 /** Saves a core keyframe instance.
   *
-  * This function saves a core keyframe instance to a file stream.
+  * This function appends a core keyframe instance to a section buffer.
   *
-  * @param file The file stream to save the core keyframe instance to.
-  * @param strFilename The name of the file stream.
+  * @param vectorSection The section buffer to append the core keyframe instance
+  *                      to.
   * @param pCoreKeyframe A pointer to the core keyframe instance that should be
   *                      saved.
+  *****************************************************************************/
+
+void CalSaver::saveCoreKeyframe(std::vector<char>& vectorSection, CalCoreKeyframe *pCoreKeyframe)
+{
+  // time, orientation and rotation of the keyframe in one go
+  const CalVector& translation = pCoreKeyframe->getOrientation();
+  const CalQuaternion& rotation = pCoreKeyframe->getRotation();
+  float keyframe[8];
+  keyframe[0] = pCoreKeyframe->getTime();
+  keyframe[1] = translation[0];
+  keyframe[2] = translation[1];
+  keyframe[3] = translation[2];
+  keyframe[4] = rotation[0];
+  keyframe[5] = rotation[1];
+  keyframe[6] = rotation[2];
+  keyframe[7] = rotation[3];
+
+  appendWords(vectorSection, keyframe, 8);
+}
+
+ /*****************************************************************************/
+/** Saves the core mesh of a core model instance.
+  *
+  * This function saves the core submeshes of a core model instance to a mesh
+  * file (cmf).
+  *
+  * @param strFilename The name of the file to save the core mesh to.
+  * @param pCoreModel A pointer to the core model instance whose core mesh
+  *                   should be saved.
   *
   * @return One of the following values:
   *         \li \b true if successful
   *         \li \b false if an error happend
   *****************************************************************************/
 
-bool CalSaver::saveCoreKeyframe(std::ofstream& file, const std::string& strFilename, CalCoreKeyframe *pCoreKeyframe)
+bool CalSaver::saveCoreMesh(const std::string& strFilename, CalCoreModel *pCoreModel)
 {
-  if(!file)
-  {
-    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, strFilename);
-    return false;
-  }
-
-  // write the time of the keyframe
-  float time;
-  time = pCoreKeyframe->getTime();
-  file.write((char *)&time, 4);
-
-  // write the orientation of the keyframe
-  const CalVector& translation = pCoreKeyframe->getOrientation();
-  file.write((char *)&translation[0], 4);
-  file.write((char *)&translation[1], 4);
-  file.write((char *)&translation[2], 4);
+  return saveFile(*this, &CalSaver::saveCoreMesh, strFilename, pCoreModel);
+}
 
-  // write the rotation of the keyframe
-  const CalQuaternion& rotation = pCoreKeyframe->getRotation();
-  file.write((char *)&rotation[0], 4);
-  file.write((char *)&rotation[1], 4);
-  file.write((char *)&rotation[2], 4);
-  file.write((char *)&rotation[3], 4);
+ /*****************************************************************************/
+/** Saves the core mesh of a core model instance to a data sink.
+  *
+  * This function saves the core submeshes of a core model instance in the cmf
+  * format to a data sink. Together with saveCoreSkeleton() it writes the two
+  * file version of a core model.
+  *
+  * @param dataSink The data sink to save the core mesh to.
+  * @param pCoreModel A pointer to the core model instance whose core mesh
+  *                   should be saved.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
 
-  // check if an error happend
-  if(!file)
+bool CalSaver::saveCoreMesh(CalDataSink& dataSink, CalCoreModel *pCoreModel)
+{
+  if(!dataSink.ok())
   {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
     return false;
   }
 
-  return true;
-}
+  // write magic tag and version info
+  std::vector<char> vectorSection;
+  appendBytes(vectorSection, Cal::MESH_FILE_MAGIC, sizeof(Cal::MESH_FILE_MAGIC));
+  appendInteger(vectorSection, Cal::CURRENT_FILE_VERSION);
 
+  if(!saveCoreSubmeshes(dataSink, vectorSection, pCoreModel)) return false;
+
+  return flushSections(dataSink, vectorSection, true);
+}
 
  /*****************************************************************************/
 /** Saves a core model instance.
   *
   * This function saves a core model instance to a file.
   *
-  * @param strFilename The name of the file to save the core mesh instance to.
-  * @param pCoreMesh A pointer to the core mesh instance that should be saved.
+  * @param strFilename The name of the file to save the core model instance to.
+  * @param pCoreModel A pointer to the core model instance that should be saved.
   *
   * @return One of the following values:
   *         \li \b true if successful
@@ -310,269 +803,230 @@ bool CalSaver::saveCoreKeyframe(std::ofstream& file, const std::string& strFilen
 
 bool CalSaver::saveCoreModel(const std::string& strFilename, CalCoreModel *pCoreModel)
 {
-	//wchar_t msg[1024];
-	//swprintf(msg, L"TectureCoordinate Count: %d", textureCoordinateCount);
-	//MessageBox(NULL, strFilename, "Debug", MB_OK);
-	
-	// open the file
-  std::ofstream file;
-  file.open(strFilename.c_str(), std::ios::out | std::ios::binary);
-  if(!file)
-  {
-    CalError::setLastError(CalError::FILE_CREATION_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
-  }
+  return saveFile(*this, &CalSaver::saveCoreModel, strFilename, pCoreModel);
+}
 
-  // write magic tag
-  file.write((char *)&Cal::MODEL_FILE_MAGIC, sizeof(Cal::MODEL_FILE_MAGIC));
-  if(!file)
-  {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
-  }
+ /*****************************************************************************/
+/** Saves a core model instance to a data sink.
+  *
+  * This function saves a core model instance in the cdf format to a data sink.
+  * The skeleton and the submeshes are collected in a memory buffer that is
+  * handed to the data sink in large blocks.
+  *
+  * @param dataSink The data sink to save the core model instance to.
+  * @param pCoreModel A pointer to the core model instance that should be saved.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
 
-  // write version info
-  file.write((char *)&Cal::CURRENT_FILE_VERSION, sizeof(Cal::CURRENT_FILE_VERSION));
-  if(!file)
+bool CalSaver::saveCoreModel(CalDataSink& dataSink, CalCoreModel *pCoreModel)
+{
+  if(!dataSink.ok())
   {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
     return false;
   }
 
-  // write the number of bones
-  int boneCount;
-  boneCount = pCoreModel->getCoreBoneCount();
+  // write magic tag, version info and the number of bones
+  std::vector<char> vectorSection;
+  appendBytes(vectorSection, Cal::MODEL_FILE_MAGIC, sizeof(Cal::MODEL_FILE_MAGIC));
+  appendInteger(vectorSection, Cal::CURRENT_FILE_VERSION);
 
-  file.write((char *)&boneCount, 4);
-  if(!file)
-  {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
-  }
+  int boneCount = pCoreModel->getCoreBoneCount();
+  appendInteger(vectorSection, boneCount);
 
   // write all core bones
   int boneId;
   for(boneId = 0; boneId < boneCount; boneId++)
   {
-    // write the core bone
-    if(!saveCoreBones(file, strFilename, pCoreModel->getCoreBone(boneId)))
-    {
-      return false;
-    }
+    saveCoreBones(vectorSection, pCoreModel->getCoreBone(boneId));
   }
 
-  // write the number of submeshes
-  int submeshCount;
-  submeshCount = pCoreModel->getCoreSubmeshCount();
+  if(!saveCoreSubmeshes(dataSink, vectorSection, pCoreModel)) return false;
 
-  file.write((char *)&submeshCount, 4);
-  if(!file)
-  {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
-  }
-
-  // write all core submeshes
-  int submeshId;
-  for(submeshId = 0; submeshId < submeshCount; submeshId++)
-  {
-    // write the core submesh
-    if(!saveCoreSubmesh(file, strFilename, pCoreModel->getCoreSubmesh(submeshId)))
-    {
-      return false;
-    }
-  }
+  return flushSections(dataSink, vectorSection, true);
+}
 
-  // explicitly close the file
-  file.close();
+ /*****************************************************************************/
+/** Saves the core skeleton of a core model instance.
+  *
+  * This function saves the core bones of a core model instance to a skeleton
+  * file (csf).
+  *
+  * @param strFilename The name of the file to save the core skeleton to.
+  * @param pCoreModel A pointer to the core model instance whose core skeleton
+  *                   should be saved.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
 
-  return true;
+bool CalSaver::saveCoreSkeleton(const std::string& strFilename, CalCoreModel *pCoreModel)
+{
+  return saveFile(*this, &CalSaver::saveCoreSkeleton, strFilename, pCoreModel);
 }
 
-
  /*****************************************************************************/
-/** Saves a core submesh instance.
+/** Saves the core skeleton of a core model instance to a data sink.
   *
-  * This function saves a core submesh instance to a file stream.
+  * This function saves the core bones of a core model instance in the csf
+  * format to a data sink.
   *
-  * @param file The file stream to save the core submesh instance to.
-  * @param strFilename The name of the file stream.
-  * @param pCoreSubmesh A pointer to the core submesh instance that should be
-  *                     saved.
+  * @param dataSink The data sink to save the core skeleton to.
+  * @param pCoreModel A pointer to the core model instance whose core skeleton
+  *                   should be saved.
   *
   * @return One of the following values:
   *         \li \b true if successful
   *         \li \b false if an error happend
   *****************************************************************************/
 
-bool CalSaver::saveCoreSubmesh(std::ofstream& file, const std::string& strFilename, CalCoreSubmesh *pCoreSubmesh)
+bool CalSaver::saveCoreSkeleton(CalDataSink& dataSink, CalCoreModel *pCoreModel)
 {
-  if(!file)
+  if(!dataSink.ok())
   {
-    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, strFilename);
+    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__);
     return false;
   }
 
-  // write the core material thread id
-  int coreMaterialThreadId;
-  coreMaterialThreadId = pCoreSubmesh->getCoreMaterialThreadId();
-  file.write((char *)&coreMaterialThreadId, 4);
+  // write magic tag, version info and the number of bones
+  std::vector<char> vectorSection;
+  appendBytes(vectorSection, Cal::SKELETON_FILE_MAGIC, sizeof(Cal::SKELETON_FILE_MAGIC));
+  appendInteger(vectorSection, Cal::CURRENT_FILE_VERSION);
+
+  int boneCount = pCoreModel->getCoreBoneCount();
+  appendInteger(vectorSection, boneCount);
 
-  // check if an error happend
-  if(!file)
+  // write all core bones
+  int boneId;
+  for(boneId = 0; boneId < boneCount; boneId++)
   {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
+    saveCoreBones(vectorSection, pCoreModel->getCoreBone(boneId));
   }
 
+  return flushSections(dataSink, vectorSection, true);
+}
+
+ /*****************************************************************************/
+/** Saves a core submesh instance.
+  *
+  * This function appends a core submesh instance to a section buffer. The
+  * buffer grows once to the size of the submesh.
+  *
+  * @param vectorSection The section buffer to append the core submesh instance
+  *                      to.
+  * @param pCoreSubmesh A pointer to the core submesh instance that should be
+  *                     saved.
+  *****************************************************************************/
+
+void CalSaver::saveCoreSubmesh(std::vector<char>& vectorSection, CalCoreSubmesh *pCoreSubmesh)
+{
   // get the vertex, face, physical property, and spring vector
   std::vector<CalCoreSubmesh::Vertex>& vectorVertex = pCoreSubmesh->getVectorVertex();
   std::vector<CalCoreSubmesh::Face>& vectorFace = pCoreSubmesh->getVectorFace();
   std::vector<CalCoreSubmesh::PhysicalProperty>& vectorPhysicalProperty = pCoreSubmesh->getVectorPhysicalProperty();
   std::vector<CalCoreSubmesh::Spring>& vectorSpring = pCoreSubmesh->getVectorSpring();
   std::vector<CalCoreSubmesh::LodControl>& vectorLodControl = pCoreSubmesh->getVectorLodControl();
-  
-  // write the number of vertices, faces, level-of-details, springs, and maps
-  int vertexCount;
-  vertexCount = vectorVertex.size();
-  file.write((char *)&vertexCount, 4);
-
-  int faceCount;
-  faceCount = vectorFace.size();
-  file.write((char *)&faceCount, 4);
 
-  int lodCount;
-  lodCount = pCoreSubmesh->getLodCount();
-  file.write((char *)&lodCount, 4);
+  std::vector<std::vector<CalCoreSubmesh::TextureCoordinate> >
+    &vectorvectorTextureCoordinate = pCoreSubmesh->getVectorVectorTextureCoordinate();
+  std::vector<std::vector<CalCoreSubmesh::TangentSpace> >
+    &vectorvectorTangentSpace = pCoreSubmesh->getVectorVectorTangentSpace();
 
-  int springCount;
-  springCount = pCoreSubmesh->getSpringCount();
-  file.write((char *)&springCount, 4);
+  // Get the influence vector.
+  std::vector<CalCoreSubmesh::Influence>& vectorInfluence = pCoreSubmesh->getVectorInfluence();
 
-  int textureCoordinateCount;
-  textureCoordinateCount = pCoreSubmesh->getTextureCoordinateCount();
-  file.write((char *)&textureCoordinateCount, 4);
+  int vertexCount = (int)vectorVertex.size();
+  int faceCount = (int)vectorFace.size();
+  int springCount = pCoreSubmesh->getSpringCount();
+  int textureCoordinateCount = pCoreSubmesh->getTextureCoordinateCount();
 
-  // Write the tangent-space enabled flags.
+  // size the buffer for the whole submesh
+  size_t vertexSize = 12 + 3 + 8 + 4 + ((springCount > 0) ? 4 : 0);
   int textureCoordinateId;
-  for (textureCoordinateId = 0; textureCoordinateId < textureCoordinateCount; textureCoordinateId++)
+  for(textureCoordinateId = 0; textureCoordinateId < textureCoordinateCount; textureCoordinateId++)
   {
-    bool enabled = pCoreSubmesh->tangentsEnabled(textureCoordinateId);
-    file.write((char *)&enabled, 1);
+    vertexSize += pCoreSubmesh->tangentsEnabled(textureCoordinateId) ? 12 : 8;
   }
-  
-  // check if an error happend
-  if(!file)
+  vectorSection.reserve(vectorSection.size() + 24 + textureCoordinateCount + vertexCount * vertexSize
+    + vectorInfluence.size() * 8 + springCount * 16 + faceCount * 12);
+
+  // write the core material thread id
+  appendInteger(vectorSection, pCoreSubmesh->getCoreMaterialThreadId());
+
+  // write the number of vertices, faces, level-of-details, springs, and maps
+  appendInteger(vectorSection, vertexCount);
+  appendInteger(vectorSection, faceCount);
+  appendInteger(vectorSection, pCoreSubmesh->getLodCount());
+  appendInteger(vectorSection, springCount);
+  appendInteger(vectorSection, textureCoordinateCount);
+
+  // Write the tangent-space enabled flags.
+  for(textureCoordinateId = 0; textureCoordinateId < textureCoordinateCount; textureCoordinateId++)
   {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
+    char enabled = pCoreSubmesh->tangentsEnabled(textureCoordinateId) ? 1 : 0;
+    appendBytes(vectorSection, &enabled, 1);
   }
-  
-  std::vector<std::vector<CalCoreSubmesh::TextureCoordinate> >
-    &vectorvectorTextureCoordinate = pCoreSubmesh->getVectorVectorTextureCoordinate();
-  std::vector<std::vector<CalCoreSubmesh::TangentSpace> >
-    &vectorvectorTangentSpace = pCoreSubmesh->getVectorVectorTangentSpace();
-
-  // Get the influence vector.
-  std::vector<CalCoreSubmesh::Influence>& vectorInfluence = pCoreSubmesh->getVectorInfluence();
-  int nextInfluence = 0;
 
   // write all vertices
+  int nextInfluence = 0;
   int vertexId;
   for(vertexId = 0; vertexId < vertexCount; vertexId++)
   {
     CalCoreSubmesh::Vertex& vertex = vectorVertex[vertexId];
     CalCoreSubmesh::LodControl& lodcontrol = vectorLodControl[vertexId];
-    
+
     // write the vertex data
-    file.write((char *)&vertex.position.x, 4);
-    file.write((char *)&vertex.position.y, 4);
-    file.write((char *)&vertex.position.z, 4);
+    appendFloat(vectorSection, vertex.position.x);
+    appendFloat(vectorSection, vertex.position.y);
+    appendFloat(vectorSection, vertex.position.z);
     char nxyz[3];
     nxyz[0] = vertex.nx;
     nxyz[1] = vertex.ny;
     nxyz[2] = vertex.nz;
-    file.write((char *)nxyz, 3);
-    
+    appendBytes(vectorSection, nxyz, 3);
+
     // write the LOD control information.
-    int collapseId = lodcontrol.collapseId;
-    int faceCollapseCount = lodcontrol.faceCollapseCount;
-    file.write((char *)&collapseId, 4);
-    file.write((char *)&faceCollapseCount, 4);
-    
+    appendInteger(vectorSection, lodcontrol.collapseId);
+    appendInteger(vectorSection, (int)lodcontrol.faceCollapseCount);
+
     // write all texture coordinates of this vertex
     for(textureCoordinateId = 0; textureCoordinateId < textureCoordinateCount; textureCoordinateId++)
     {
       CalCoreSubmesh::TextureCoordinate& textureCoordinate = vectorvectorTextureCoordinate[textureCoordinateId][vertexId];
 
       // write the texture coordinate data
-      file.write((char *)&textureCoordinate.u, 4);
-      file.write((char *)&textureCoordinate.v, 4);
-      
-      if (pCoreSubmesh->tangentsEnabled(textureCoordinateId))
-      {
-	CalCoreSubmesh::TangentSpace& tangentSpace = vectorvectorTangentSpace[textureCoordinateId][vertexId];
-	char tanspace[4];
-	tanspace[0] = tangentSpace.tx;
-	tanspace[1] = tangentSpace.ty;
-	tanspace[2] = tangentSpace.tz;
-	tanspace[3] = tangentSpace.crossFactor;
-	file.write((char *)tanspace, 4);
-      }
-      
-      // check if an error happend
-      if(!file)
+      appendFloat(vectorSection, textureCoordinate.u);
+      appendFloat(vectorSection, textureCoordinate.v);
+
+      if(pCoreSubmesh->tangentsEnabled(textureCoordinateId))
       {
-        CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-        return false;
+        CalCoreSubmesh::TangentSpace& tangentSpace = vectorvectorTangentSpace[textureCoordinateId][vertexId];
+        char tanspace[4];
+        tanspace[0] = tangentSpace.tx;
+        tanspace[1] = tangentSpace.ty;
+        tanspace[2] = tangentSpace.tz;
+        tanspace[3] = tangentSpace.crossFactor;
+        appendBytes(vectorSection, tanspace, 4);
       }
     }
-    
-    // write the number of influences
-    int influenceCount = vertex.influenceCount;
-    file.write((char *)&influenceCount, 4);
-    
-    // check if an error happend
-    if(!file)
-    {
-      CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-      return false;
-    }
-    
-     // write all influences of this vertex
-    int influenceId;
-    for(influenceId = 0; influenceId < vertex.influenceCount; influenceId++)
-    {
-      CalCoreSubmesh::Influence& influence = vectorInfluence[nextInfluence + influenceId];
-
-      // write the influence data
-      file.write((char *)&influence.boneId, 4);
-      file.write((char *)&influence.weight, 4);
 
-      // check if an error happend
-      if(!file)
-      {
-        CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-        return false;
-      }
+    // write the number of influences and all influences of this vertex, the
+    // bone id and weight pairs are stored in a row like in the file
+    appendInteger(vectorSection, vertex.influenceCount);
+    if(vertex.influenceCount > 0)
+    {
+      appendWords(vectorSection, &vectorInfluence[nextInfluence], vertex.influenceCount * 2);
     }
     nextInfluence += vertex.influenceCount;
 
-    // save the physical property of the vertex if there are springs in the core submesh
+    // write the physical property of this vertex if there are springs in the core submesh
     if(springCount > 0)
     {
-      // write the physical property of this vertex if there are springs in the core submesh
-      CalCoreSubmesh::PhysicalProperty& physicalProperty = vectorPhysicalProperty[vertexId];
-
-      // write the physical property data
-      file.write((char *)&physicalProperty.weight, 4);
-
-      // check if an error happend
-      if(!file)
-      {
-        CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-        return false;
-      }
+      appendFloat(vectorSection, vectorPhysicalProperty[vertexId].weight);
     }
   }
 
@@ -583,100 +1037,80 @@ bool CalSaver::saveCoreSubmesh(std::ofstream& file, const std::string& strFilena
     CalCoreSubmesh::Spring& spring = vectorSpring[springId];
 
     // write the spring data
-    file.write((char *)&spring.vertexId[0], 4);
-    file.write((char *)&spring.vertexId[1], 4);
-    file.write((char *)&spring.springCoefficient, 4);
-    file.write((char *)&spring.idleLength, 4);
-
-    // check if an error happend
-    if(!file)
-    {
-      CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-      return false;
-    }
+    appendInteger(vectorSection, spring.vertexId[0]);
+    appendInteger(vectorSection, spring.vertexId[1]);
+    appendFloat(vectorSection, spring.springCoefficient);
+    appendFloat(vectorSection, spring.idleLength);
   }
 
-  // write all faces
-  int faceId;
-  for(faceId = 0; faceId < faceCount; faceId++)
+  // write all faces in one block
+  if(faceCount > 0)
   {
-    CalCoreSubmesh::Face& face = vectorFace[faceId];
-
-    // write the face data
-    file.write((char *)&face.vertexId[0], 4);
-    file.write((char *)&face.vertexId[1], 4);
-    file.write((char *)&face.vertexId[2], 4);
-
-    // check if an error happend
-    if(!file)
-    {
-      CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-      return false;
-    }
+    appendWords(vectorSection, &vectorFace[0], faceCount * 3);
   }
-
-  return true;
 }
 
  /*****************************************************************************/
-/** Saves a core track instance.
+/** Saves the core submeshes of a core model instance.
   *
-  * This function saves a core track instance to a file stream.
+  * This function appends the number of core submeshes and all core submeshes
+  * of a core model instance to a section buffer, handing the buffer to the
+  * data sink whenever it grows large.
   *
-  * @param file The file stream to save the core track instance to.
-  * @param strFilename The name of the file stream.
-  * @param pCoreTrack A pointer to the core track instance that should be saved.
+  * @param dataSink The data sink to save the core submeshes to.
+  * @param vectorSection The section buffer to append the core submeshes to.
+  * @param pCoreModel A pointer to the core model instance whose core submeshes
+  *                   should be saved.
   *
   * @return One of the following values:
   *         \li \b true if successful
   *         \li \b false if an error happend
   *****************************************************************************/
 
-bool CalSaver::saveCoreTrack(std::ofstream& file, const std::string& strFilename, CalCoreTrack *pCoreTrack)
+bool CalSaver::saveCoreSubmeshes(CalDataSink& dataSink, std::vector<char>& vectorSection, CalCoreModel *pCoreModel)
 {
-  if(!file)
+  // write the number of submeshes
+  int submeshCount = pCoreModel->getCoreSubmeshCount();
+  appendInteger(vectorSection, submeshCount);
+
+  // write all core submeshes
+  int submeshId;
+  for(submeshId = 0; submeshId < submeshCount; submeshId++)
   {
-    CalError::setLastError(CalError::INVALID_HANDLE, __FILE__, __LINE__, strFilename);
-    return false;
+    saveCoreSubmesh(vectorSection, pCoreModel->getCoreSubmesh(submeshId));
+    if(!flushSections(dataSink, vectorSection, false)) return false;
   }
-  
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Saves a core track instance.
+  *
+  * This function appends a core track instance to a section buffer.
+  *
+  * @param vectorSection The section buffer to append the core track instance
+  *                      to.
+  * @param pCoreTrack A pointer to the core track instance that should be saved.
+  *****************************************************************************/
+
+void CalSaver::saveCoreTrack(std::vector<char>& vectorSection, CalCoreTrack *pCoreTrack)
+{
   // write the name of the bone
-  int len;
-  len = pCoreTrack->getCoreBoneName().size() + 1;
-  file.write((char *)&len, 4);
-  file.write(pCoreTrack->getCoreBoneName().c_str(), len);
-  if(!file)
-  {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
-  }
-  
+  appendString(vectorSection, pCoreTrack->getCoreBoneName());
+
   // get core keyframe map
   std::map<float, CalCoreKeyframe *>& mapCoreKeyframe = pCoreTrack->getMapCoreKeyframe();
 
-  // read the number of keyframes
-  int keyframeCount;
-  keyframeCount = mapCoreKeyframe.size();
-
-  file.write((char *)&keyframeCount, 4);
-  if(!file)
-  {
-    CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__, strFilename);
-    return false;
-  }
+  // write the number of keyframes
+  appendInteger(vectorSection, (int)mapCoreKeyframe.size());
 
   // save all core keyframes
   std::map<float, CalCoreKeyframe *>::iterator iteratorCoreKeyframe;
   for(iteratorCoreKeyframe = mapCoreKeyframe.begin(); iteratorCoreKeyframe != mapCoreKeyframe.end(); ++iteratorCoreKeyframe)
   {
-    // save the core keyframe
-    if(!saveCoreKeyframe(file, strFilename, iteratorCoreKeyframe->second))
-    {
-      return false;
-    }
+    saveCoreKeyframe(vectorSection, iteratorCoreKeyframe->second);
   }
-
-  return true;
 }
 
 //****************************************************************************//
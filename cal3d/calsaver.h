@@ -27,13 +27,18 @@ class CalCoreAnimation;
 class CalCoreTrack;
 class CalCoreKeyframe;
 class CalCoreSubmesh;
+class CalDataSink;
 
 //****************************************************************************//
 // Class declaration                                                          //
 //****************************************************************************//
 
  /*****************************************************************************/
-/** The loader class.
+/** The saver class.
+  *
+  * The saver writes every file format either to a file or to a data sink, see
+  * caldatasink.h. Each section of a file is built in a memory buffer and
+  * handed to the data sink in large blocks.
   *****************************************************************************/
 
 class CAL3D_API CalSaver: public CalSaverUserData
@@ -45,14 +50,25 @@ public:
   
 // member functions
 public:
+  bool saveBakedCoreAnimation(const std::string& strFilename, CalCoreAnimation *pCoreAnimation);
+  bool saveBakedCoreAnimation(CalDataSink& dataSink, CalCoreAnimation *pCoreAnimation);
+  bool saveBakedCoreModel(const std::string& strFilename, CalCoreModel *pCoreModel);
+  bool saveBakedCoreModel(CalDataSink& dataSink, CalCoreModel *pCoreModel);
   bool saveCoreAnimation(const std::string& strFilename, CalCoreAnimation *pCoreAnimation);
+  bool saveCoreAnimation(CalDataSink& dataSink, CalCoreAnimation *pCoreAnimation);
+  bool saveCoreMesh(const std::string& strFilename, CalCoreModel *pCoreModel);
+  bool saveCoreMesh(CalDataSink& dataSink, CalCoreModel *pCoreModel);
   bool saveCoreModel(const std::string& strFilename, CalCoreModel *pCoreModel);
+  bool saveCoreModel(CalDataSink& dataSink, CalCoreModel *pCoreModel);
+  bool saveCoreSkeleton(const std::string& strFilename, CalCoreModel *pCoreModel);
+  bool saveCoreSkeleton(CalDataSink& dataSink, CalCoreModel *pCoreModel);
 
 protected:
-  bool saveCoreBones(std::ofstream& file, const std::string& strFilename, CalCoreBone *pCoreBone);
-  bool saveCoreKeyframe(std::ofstream& file, const std::string& strFilename, CalCoreKeyframe *pCoreKeyframe);
-  bool saveCoreSubmesh(std::ofstream& file, const std::string& strFilename, CalCoreSubmesh *pCoreSubmesh);
-  bool saveCoreTrack(std::ofstream& file, const std::string& strFilename, CalCoreTrack *pCoreTrack);
+  void saveCoreBones(std::vector<char>& vectorSection, CalCoreBone *pCoreBone);
+  void saveCoreKeyframe(std::vector<char>& vectorSection, CalCoreKeyframe *pCoreKeyframe);
+  void saveCoreSubmesh(std::vector<char>& vectorSection, CalCoreSubmesh *pCoreSubmesh);
+  bool saveCoreSubmeshes(CalDataSink& dataSink, std::vector<char>& vectorSection, CalCoreModel *pCoreModel);
+  void saveCoreTrack(std::vector<char>& vectorSection, CalCoreTrack *pCoreTrack);
 };
 
 #endif
@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// This file holds the spring relaxation kernel behind
+// CalSubmesh::calculateSpringVertices.
+//
+// Each relaxation step moves the two ends of a spring towards its idle length,
+// split by the precomputed factors of CalCoreSubmesh::buildSpringBatches.  The
+// springs of one batch share no vertex, so the kernel relaxes four of them at
+// a time with SSE and any slice of a batch can run on its own thread.  Where
+// SSE is not available the same formula runs one spring at a time.
+//
+// Both functions return the largest length error they corrected, the residual
+// that drives the adaptive iteration count.
+//
+// This file is only meant to be included by calsub.cpp.
+//
+///////////////////////////////////////////////////////////////////////////////////////////
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)) || defined(__SSE2__)
+#include <emmintrin.h>
+#define CAL_SPRING_SSE
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// Relaxes a single spring.
+//
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static inline float calRelaxSpring(CalVector *pVertex, const CalCoreSubmesh::Spring& spring, float factor0, float factor1)
+{
+  CalVector& vertex0 = pVertex[spring.vertexId[0]];
+  CalVector& vertex1 = pVertex[spring.vertexId[1]];
+
+  // compute the difference between the two spring vertices
+  CalVector distance = vertex1 - vertex0;
+  float length = distance.length();
+
+  if(length > 0.0f)
+  {
+    float factor = (length - spring.idleLength) / length;
+    vertex0 += distance * (factor * factor0);
+    vertex1 -= distance * (factor * factor1);
+
+    return (float)fabs(length - spring.idleLength);
+  }
+
+  return 0.0f;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////
+//
+// Relaxes a range of springs that share no vertex.
+//
+///////////////////////////////////////////////////////////////////////////////////////////
+
+static float calRelaxSpringRange(CalVector *pVertex, const CalCoreSubmesh::Spring *pSpring, const float *pSpringFactor, int springCount)
+{
+  int springId = 0;
+  float residual = 0.0f;
+
+#ifdef CAL_SPRING_SSE
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  __m128 maxError = zero;
+
+  for(; springId + 4 <= springCount; springId += 4)
+  {
+    const CalCoreSubmesh::Spring *s = pSpring + springId;
+    const float *f = pSpringFactor + 2 * springId;
+
+    CalVector& a0 = pVertex[s[0].vertexId[0]]; CalVector& b0 = pVertex[s[0].vertexId[1]];
+    CalVector& a1 = pVertex[s[1].vertexId[0]]; CalVector& b1 = pVertex[s[1].vertexId[1]];
+    CalVector& a2 = pVertex[s[2].vertexId[0]]; CalVector& b2 = pVertex[s[2].vertexId[1]];
+    CalVector& a3 = pVertex[s[3].vertexId[0]]; CalVector& b3 = pVertex[s[3].vertexId[1]];
+
+    // gather the four springs into SoA registers
+    __m128 ax = _mm_setr_ps(a0.x, a1.x, a2.x, a3.x);
+    __m128 ay = _mm_setr_ps(a0.y, a1.y, a2.y, a3.y);
+    __m128 az = _mm_setr_ps(a0.z, a1.z, a2.z, a3.z);
+    __m128 bx = _mm_setr_ps(b0.x, b1.x, b2.x, b3.x);
+    __m128 by = _mm_setr_ps(b0.y, b1.y, b2.y, b3.y);
+    __m128 bz = _mm_setr_ps(b0.z, b1.z, b2.z, b3.z);
+    __m128 idleLength = _mm_setr_ps(s[0].idleLength, s[1].idleLength, s[2].idleLength, s[3].idleLength);
+    __m128 factor0 = _mm_setr_ps(f[0], f[2], f[4], f[6]);
+    __m128 factor1 = _mm_setr_ps(f[1], f[3], f[5], f[7]);
+
+    __m128 dx = _mm_sub_ps(bx, ax);
+    __m128 dy = _mm_sub_ps(by, ay);
+    __m128 dz = _mm_sub_ps(bz, az);
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+
+    // springs of zero length stay as they are
+    __m128 mask = _mm_cmpgt_ps(length, zero);
+    __m128 error = _mm_sub_ps(length, idleLength);
+    __m128 factor = _mm_and_ps(mask, _mm_div_ps(error, length));
+    maxError = _mm_max_ps(maxError, _mm_and_ps(mask, _mm_and_ps(error, absMask)));
+    factor0 = _mm_mul_ps(factor, factor0);
+    factor1 = _mm_mul_ps(factor, factor1);
+
+    ax = _mm_add_ps(ax, _mm_mul_ps(dx, factor0));
+    ay = _mm_add_ps(ay, _mm_mul_ps(dy, factor0));
+    az = _mm_add_ps(az, _mm_mul_ps(dz, factor0));
+    bx = _mm_sub_ps(bx, _mm_mul_ps(dx, factor1));
+    by = _mm_sub_ps(by, _mm_mul_ps(dy, factor1));
+    bz = _mm_sub_ps(bz, _mm_mul_ps(dz, factor1));
+
+    // scatter the results back
+    float x[4], y[4], z[4];
+    _mm_storeu_ps(x, ax); _mm_storeu_ps(y, ay); _mm_storeu_ps(z, az);
+    a0.x = x[0]; a0.y = y[0]; a0.z = z[0];
+    a1.x = x[1]; a1.y = y[1]; a1.z = z[1];
+    a2.x = x[2]; a2.y = y[2]; a2.z = z[2];
+    a3.x = x[3]; a3.y = y[3]; a3.z = z[3];
+
+    _mm_storeu_ps(x, bx); _mm_storeu_ps(y, by); _mm_storeu_ps(z, bz);
+    b0.x = x[0]; b0.y = y[0]; b0.z = z[0];
+    b1.x = x[1]; b1.y = y[1]; b1.z = z[1];
+    b2.x = x[2]; b2.y = y[2]; b2.z = z[2];
+    b3.x = x[3]; b3.y = y[3]; b3.z = z[3];
+  }
+
+  float arrayError[4];
+  _mm_storeu_ps(arrayError, maxError);
+  residual = std::max(std::max(arrayError[0], arrayError[1]), std::max(arrayError[2], arrayError[3]));
+#endif
+
+  for(; springId < springCount; springId++)
+  {
+    float error = calRelaxSpring(pVertex, pSpring[springId], pSpringFactor[2 * springId], pSpringFactor[2 * springId + 1]);
+    if(error > residual) residual = error;
+  }
+
+  return residual;
+}
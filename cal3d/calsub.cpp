@@ -21,6 +21,233 @@
 #include "calerror.h"
 #include "calcoresub.h"
 #include "calmodel.h"
+#include "calphysop.h"
+#include "calspringop.h"
+
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  /// The smallest number of springs worth a thread of its own.
+  const int SPRINGS_PER_THREAD = 512;
+
+  /// Lets the spring threads wait for each other between two batches.
+  struct SpringBarrier
+  {
+    std::mutex mutex;
+    std::condition_variable condition;
+    int threadCount;
+    int waitCount;
+    int generation;
+
+    void wait()
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      int waitGeneration = generation;
+      if(++waitCount == threadCount)
+      {
+        waitCount = 0;
+        generation++;
+        condition.notify_all();
+      }
+      else
+      {
+        while(generation == waitGeneration) condition.wait(lock);
+      }
+    }
+  };
+
+  /// Relaxes this thread's slice of every spring batch until the residual
+  /// drops below the tolerance. pResidual holds two slots per thread.
+  int relaxSpringBatches(CalVector *pVertex, CalCoreSubmesh *pCoreSubmesh, int iterationCount, float tolerance, int threadId, int threadCount, SpringBarrier *pBarrier, float *pResidual)
+  {
+    const CalCoreSubmesh::Spring *pSpring = &pCoreSubmesh->getVectorSpring()[0];
+    const float *pSpringFactor = &pCoreSubmesh->getVectorSpringFactor()[0];
+    std::vector<CalCoreSubmesh::SpringBatch>& vectorSpringBatch = pCoreSubmesh->getVectorSpringBatch();
+
+    for(int iterationId = 0; iterationId < iterationCount; iterationId++)
+    {
+      float residual = 0.0f;
+      for(size_t batchId = 0; batchId < vectorSpringBatch.size(); batchId++)
+      {
+        const CalCoreSubmesh::SpringBatch& springBatch = vectorSpringBatch[batchId];
+        int firstSpring = springBatch.firstSpring + (int)(((long long)springBatch.springCount * threadId) / threadCount);
+        int lastSpring = springBatch.firstSpring + (int)(((long long)springBatch.springCount * (threadId + 1)) / threadCount);
+
+        float batchResidual = calRelaxSpringRange(pVertex, pSpring + firstSpring, pSpringFactor + 2 * firstSpring, lastSpring - firstSpring);
+        if(batchResidual > residual) residual = batchResidual;
+
+        // the next batch may touch the vertices of this one
+        if(pBarrier != 0) pBarrier->wait();
+      }
+
+      if(tolerance > 0.0f)
+      {
+        // all threads must agree on stopping, so they share their residuals
+        if(pBarrier != 0)
+        {
+          float *pSlot = pResidual + (iterationId & 1) * threadCount;
+          pSlot[threadId] = residual;
+          pBarrier->wait();
+          for(int slotId = 0; slotId < threadCount; slotId++) if(pSlot[slotId] > residual) residual = pSlot[slotId];
+        }
+
+        if(residual < tolerance) return iterationId + 1;
+      }
+    }
+
+    return iterationCount;
+  }
+
+  /// The spring relaxation handed to a pooled worker.
+  struct SpringJob
+  {
+    CalVector *pVertex;
+    CalCoreSubmesh *pCoreSubmesh;
+    int iterationCount;
+    float tolerance;
+    int threadId;
+    int threadCount;
+    SpringBarrier *pBarrier;
+    float *pResidual;
+  };
+
+  /// A spring thread that sleeps between updates.
+  struct SpringWorker
+  {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+    SpringJob job;
+    bool bPending;
+    bool bClaimed;
+    bool bStop;
+  };
+
+  /// The spring threads shared by all submesh instances. The threads are
+  /// started on first use and run until the pool is stopped, at the latest
+  /// when the process exits; an update claims the idle ones and relaxes on
+  /// the calling thread alone if there are none.
+  class SpringWorkerPool
+  {
+  public:
+    static SpringWorkerPool& getInstance()
+    {
+      static SpringWorkerPool pool;
+      return pool;
+    }
+
+    ~SpringWorkerPool()
+    {
+      stop();
+    }
+
+    /// Claims up to maxCount idle workers, starting new ones if allowed.
+    void claimWorkers(int maxCount, std::vector<SpringWorker *>& vectorWorker)
+    {
+      vectorWorker.clear();
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for(size_t workerId = 0; (workerId < m_vectorWorker.size()) && ((int)vectorWorker.size() < maxCount); workerId++)
+      {
+        if(m_vectorWorker[workerId]->bClaimed) continue;
+        m_vectorWorker[workerId]->bClaimed = true;
+        vectorWorker.push_back(m_vectorWorker[workerId]);
+      }
+
+      while(((int)vectorWorker.size() < maxCount) && ((int)m_vectorWorker.size() < m_maxWorkerCount))
+      {
+        SpringWorker *pWorker = new SpringWorker();
+        pWorker->bPending = false;
+        pWorker->bClaimed = true;
+        pWorker->bStop = false;
+        pWorker->thread = std::thread(runWorker, pWorker);
+        m_vectorWorker.push_back(pWorker);
+        vectorWorker.push_back(pWorker);
+      }
+    }
+
+    /// Returns claimed workers to the pool once they are done.
+    void releaseWorkers(std::vector<SpringWorker *>& vectorWorker)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for(size_t workerId = 0; workerId < vectorWorker.size(); workerId++) vectorWorker[workerId]->bClaimed = false;
+      vectorWorker.clear();
+    }
+
+    static void startJob(SpringWorker *pWorker, const SpringJob& job)
+    {
+      {
+        std::lock_guard<std::mutex> lock(pWorker->mutex);
+        pWorker->job = job;
+        pWorker->bPending = true;
+      }
+      pWorker->condition.notify_all();
+    }
+
+    static void waitJob(SpringWorker *pWorker)
+    {
+      std::unique_lock<std::mutex> lock(pWorker->mutex);
+      while(pWorker->bPending) pWorker->condition.wait(lock);
+    }
+
+    /// Stops all workers and waits for their threads to end. No worker may
+    /// be claimed.
+    void stop()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for(size_t workerId = 0; workerId < m_vectorWorker.size(); workerId++)
+      {
+        SpringWorker *pWorker = m_vectorWorker[workerId];
+        {
+          std::lock_guard<std::mutex> workerLock(pWorker->mutex);
+          pWorker->bStop = true;
+        }
+        pWorker->condition.notify_all();
+        pWorker->thread.join();
+        delete pWorker;
+      }
+      m_vectorWorker.clear();
+    }
+
+  protected:
+    SpringWorkerPool()
+    {
+      // the calling thread relaxes a slice of its own
+      int hardwareThreadCount = (int)std::thread::hardware_concurrency();
+      m_maxWorkerCount = (hardwareThreadCount > 1) ? hardwareThreadCount - 1 : 0;
+    }
+
+    static void runWorker(SpringWorker *pWorker)
+    {
+      std::unique_lock<std::mutex> lock(pWorker->mutex);
+      while(true)
+      {
+        while(!pWorker->bPending && !pWorker->bStop) pWorker->condition.wait(lock);
+        if(pWorker->bStop) return;
+
+        SpringJob job = pWorker->job;
+        lock.unlock();
+        relaxSpringBatches(job.pVertex, job.pCoreSubmesh, job.iterationCount, job.tolerance, job.threadId, job.threadCount, job.pBarrier, job.pResidual);
+        lock.lock();
+
+        pWorker->bPending = false;
+        pWorker->condition.notify_all();
+      }
+    }
+
+    std::mutex m_mutex;
+    std::vector<SpringWorker *> m_vectorWorker;
+    int m_maxWorkerCount;
+  };
+}
 
 
  /*****************************************************************************/
@@ -32,6 +259,25 @@
 CalSubmesh::CalSubmesh()
 {
   m_pCoreSubmesh = 0;
+  m_bInternalData = false;
+  m_bSkinFromSnapshot = false;
+  m_vertexCount = 0;
+  m_faceCount = 0;
+  m_influenceSetCount = 0;
+  m_bInfluenceSetsBlended = false;
+  m_lodStepId = -1;
+  m_springIterationCount = 2;
+  m_springIterationsUsed = 0;
+  m_springThreadCount = 1;
+  m_springTolerance = 0.0f;
+  m_springSleepThreshold = 0.0f;
+  m_springEnergy = 0.0f;
+  m_springCalmCount = 0;
+  m_bSpringAsleep = false;
+  m_springTime = 0.0f;
+  m_springTimeQueued = 0.0f;
+  for(int channelMask = 0; channelMask < SKIN_CHANNEL_MASKS; channelMask++) m_arrayKernel[channelMask] = 0;
+  m_blendInfluenceSets = 0;
 }
 
 CalSubmesh::~CalSubmesh()
@@ -151,10 +397,9 @@ bool CalSubmesh::create(CalCoreSubmesh *pCoreSubmesh, CalModel *pModel)
 
   m_pCoreSubmesh = pCoreSubmesh;
   m_pModel = pModel;
-  
-  // reserve memory for the face vector
-  m_vectorFace.reserve(m_pCoreSubmesh->getFaceCount());
-  m_vectorFace.resize(m_pCoreSubmesh->getFaceCount());
+
+  // pick the skinning kernels that fit the influence counts of the core submesh
+  bindKernels();
 
   // set the initial lod level
   setLodLevel(1.0f);
@@ -224,8 +469,9 @@ size_t CalSubmesh::getFaceCount()
 
 size_t CalSubmesh::getFaces(int *pFaceBuffer, int offset)
 {
-  // copy the face vector to the face buffer
-  int *src = (int*)&m_vectorFace[0];
+  // copy the faces of the lod step to the face buffer
+  int *src = (int*)m_pCoreSubmesh->getLodStepFaces(m_lodStepId);
+  if (src==0) return 0;
   if (offset==0) {
     memcpy(pFaceBuffer, src, m_faceCount * sizeof(Face));
   } else {
@@ -240,13 +486,46 @@ size_t CalSubmesh::getFaces(int *pFaceBuffer, int offset)
   * This function returns the face data (vertex indices) of the submesh
   * instance. The LOD setting of the submesh instance is taken into account.
   *
-  * @return A pointer to a buffer containing the faces.  The data is
-  *         guaranteed good until you modify the submesh.
+  * @return A pointer to a buffer containing the faces.  The buffer is shared
+  *         by all instances of the core submesh and stays good until you
+  *         modify the core submesh.
   *****************************************************************************/
 
 int *CalSubmesh::getBufferedFaces()
 {
-  return (int*)&(m_vectorFace[0]);
+  return (int*)m_pCoreSubmesh->getLodStepFaces(m_lodStepId);
+}
+
+ /*****************************************************************************/
+/** Binds the skinning kernels.
+  *
+  * This function selects the skinning kernel instances that match the
+  * maximum influence count of the core submesh. Submeshes with up to four
+  * influences per vertex get kernels with a fully unrolled blend, all others
+  * get the generic kernel.
+  *****************************************************************************/
+
+void CalSubmesh::bindKernels(void)
+{
+  switch(m_pCoreSubmesh->getMaxInfluenceCount())
+  {
+    case 0:
+    case 1:
+      bindKernelSet<1>();
+      break;
+    case 2:
+      bindKernelSet<2>();
+      break;
+    case 3:
+      bindKernelSet<3>();
+      break;
+    case 4:
+      bindKernelSet<4>();
+      break;
+    default:
+      bindKernelSet<0>();
+      break;
+  }
 }
 
  /*****************************************************************************/
@@ -274,13 +553,7 @@ int *CalSubmesh::getBufferedFaces()
 size_t CalSubmesh::calculateVNT(float *pVertexBuffer, float *pNormalBuffer,
 			      int textureCoordinateId, float *pTangentBuffer)
 {
-#undef CALCULATE_VERTICES
-#undef CALCULATE_NORMALS
-#undef CALCULATE_TANGENTS
-#define CALCULATE_VERTICES 1
-#define CALCULATE_NORMALS 1
-#define CALCULATE_TANGENTS 1
-#include "calphysop.h"
+  return (this->*m_arrayKernel[SKIN_VERTICES | SKIN_NORMALS | SKIN_TANGENTS])(pVertexBuffer, pNormalBuffer, textureCoordinateId, pTangentBuffer);
 }
 
  /*****************************************************************************/
@@ -301,13 +574,7 @@ size_t CalSubmesh::calculateVNT(float *pVertexBuffer, float *pNormalBuffer,
 
 size_t CalSubmesh::calculateVN(float *pVertexBuffer, float *pNormalBuffer)
 {
-#undef CALCULATE_VERTICES
-#undef CALCULATE_NORMALS
-#undef CALCULATE_TANGENTS
-#define CALCULATE_VERTICES 1
-#define CALCULATE_NORMALS 1
-#define CALCULATE_TANGENTS 0
-#include "calphysop.h"
+  return (this->*m_arrayKernel[SKIN_VERTICES | SKIN_NORMALS])(pVertexBuffer, pNormalBuffer, 0, 0);
 }
 
  /*****************************************************************************/
@@ -326,13 +593,7 @@ size_t CalSubmesh::calculateVN(float *pVertexBuffer, float *pNormalBuffer)
 
 size_t CalSubmesh::calculateVertices(float *pVertexBuffer)
 {
-#undef CALCULATE_VERTICES
-#undef CALCULATE_NORMALS
-#undef CALCULATE_TANGENTS
-#define CALCULATE_VERTICES 1
-#define CALCULATE_NORMALS 0
-#define CALCULATE_TANGENTS 0
-#include "calphysop.h"
+  return (this->*m_arrayKernel[SKIN_VERTICES])(pVertexBuffer, 0, 0, 0);
 }
 
  /*****************************************************************************/
@@ -351,13 +612,7 @@ size_t CalSubmesh::calculateVertices(float *pVertexBuffer)
 
 size_t CalSubmesh::calculateNormals(float *pNormalBuffer)
 {
-#undef CALCULATE_VERTICES
-#undef CALCULATE_NORMALS
-#undef CALCULATE_TANGENTS
-#define CALCULATE_VERTICES 0
-#define CALCULATE_NORMALS 1
-#define CALCULATE_TANGENTS 0
-#include "calphysop.h"
+  return (this->*m_arrayKernel[SKIN_NORMALS])(0, pNormalBuffer, 0, 0);
 }
 
  /*****************************************************************************/
@@ -378,13 +633,7 @@ size_t CalSubmesh::calculateNormals(float *pNormalBuffer)
 
 size_t CalSubmesh::calculateTangentSpaces(int textureCoordinateId, float *pTangentBuffer)
 {
-#undef CALCULATE_VERTICES
-#undef CALCULATE_NORMALS
-#undef CALCULATE_TANGENTS
-#define CALCULATE_VERTICES 0
-#define CALCULATE_NORMALS 0
-#define CALCULATE_TANGENTS 1
-#include "calphysop.h"
+  return (this->*m_arrayKernel[SKIN_TANGENTS])(0, 0, textureCoordinateId, pTangentBuffer);
 }
 
  /*****************************************************************************/
@@ -403,7 +652,7 @@ void CalSubmesh::calculateSpringForces(float deltaTime)
   
   // loop through all the vertices
   int vertexId;
-  for(vertexId = 0; vertexId < (int)m_vectorVertex.size(); vertexId++)
+  for(vertexId = 0; vertexId < (int)m_vectorPhysicalProperty.size(); vertexId++)
   {
     // get the physical property of the vertex
     PhysicalProperty& physicalProperty = m_vectorPhysicalProperty[vertexId];
@@ -425,20 +674,22 @@ void CalSubmesh::calculateSpringForces(float deltaTime)
   * This function calculates the vertices influenced by the spring system
   * instance.
   *
+  * @param vectorVertex The vertex buffer that holds the skinned vertices and
+  *                     receives the simulated ones.
   * @param deltaTime The elapsed time in seconds since the last calculation.
   *****************************************************************************/
 
-void CalSubmesh::calculateSpringVertices(float deltaTime)
+void CalSubmesh::calculateSpringVertices(std::vector<CalVector>& vectorVertex, float deltaTime)
 {
   // get the physical property vector of the core submesh
   std::vector<CalCoreSubmesh::PhysicalProperty>& vectorCorePhysicalProperty = m_pCoreSubmesh->getVectorPhysicalProperty();
 
   // loop through all the vertices
   int vertexId;
-  for(vertexId = 0; vertexId < (int)m_vectorVertex.size(); vertexId++)
+  for(vertexId = 0; vertexId < (int)vectorVertex.size(); vertexId++)
   {
     // get the vertex
-    CalVector& vertex = m_vectorVertex[vertexId];
+    CalVector& vertex = vectorVertex[vertexId];
 
     // get the physical property of the vertex
     CalSubmesh::PhysicalProperty& physicalProperty = m_vectorPhysicalProperty[vertexId];
@@ -458,7 +709,7 @@ void CalSubmesh::calculateSpringVertices(float deltaTime)
     }
     else
     {
-      physicalProperty.position = m_vectorVertex[vertexId];
+      physicalProperty.position = vectorVertex[vertexId];
     }
 
     // make the current position the old one
@@ -473,56 +724,89 @@ void CalSubmesh::calculateSpringVertices(float deltaTime)
 
   // get the spring vector of the core submesh
   std::vector<CalCoreSubmesh::Spring>& vectorSpring = m_pCoreSubmesh->getVectorSpring();
+  if(vectorSpring.empty() || vectorVertex.empty()) return;
 
-  // iterate a few times to relax the constraints
-#define ITERATION_COUNT 2
-  for(int iterationCount = 0; iterationCount < ITERATION_COUNT; iterationCount++)
+  if(m_pCoreSubmesh->getVectorSpringBatch().empty())
   {
-    // loop through all the springs
-    std::vector<CalCoreSubmesh::Spring>::iterator iteratorSpring;
-    for(iteratorSpring = vectorSpring.begin(); iteratorSpring != vectorSpring.end(); ++iteratorSpring)
+    // the core submesh changed since the batches were built, relax the springs one by one
+    m_springIterationsUsed = m_springIterationCount;
+    for(int iterationId = 0; iterationId < m_springIterationCount; iterationId++)
     {
-      // get the spring
-      CalCoreSubmesh::Spring& spring = *iteratorSpring;
-
-      // compute the difference between the two spring vertices
-      CalVector distance;
-      distance = m_vectorVertex[spring.vertexId[1]] - m_vectorVertex[spring.vertexId[0]];
-
-      // get the current length of the spring
-      float length;
-      length = distance.length();
-
-      if(length > 0.0f)
+      float residual = 0.0f;
+      std::vector<CalCoreSubmesh::Spring>::iterator iteratorSpring;
+      for(iteratorSpring = vectorSpring.begin(); iteratorSpring != vectorSpring.end(); ++iteratorSpring)
       {
-        float factor[2];
-        factor[0] = (length - spring.idleLength) / length;
-        factor[1] = factor[0];
-
-        if(vectorCorePhysicalProperty[spring.vertexId[0]].weight > 0.0f)
+        bool bFree0 = vectorCorePhysicalProperty[iteratorSpring->vertexId[0]].weight > 0.0f;
+        bool bFree1 = vectorCorePhysicalProperty[iteratorSpring->vertexId[1]].weight > 0.0f;
+        float factor0 = bFree0 ? 0.5f : 0.0f;
+        float factor1 = bFree0 ? 0.5f : 1.0f;
+        if(!bFree1)
         {
-          factor[0] /= 2.0f;
-          factor[1] /= 2.0f;
-        }
-        else
-        {
-          factor[0] = 0.0f;
+          factor0 *= 2.0f;
+          factor1 = 0.0f;
         }
 
-        if(vectorCorePhysicalProperty[spring.vertexId[1]].weight <= 0.0f)
-        {
-          factor[0] *= 2.0f;
-          factor[1] = 0.0f;
-        }
+        float error = calRelaxSpring(&vectorVertex[0], *iteratorSpring, factor0, factor1);
+        if(error > residual) residual = error;
+      }
 
-        m_vectorVertex[spring.vertexId[0]] += distance * factor[0];
-        m_vectorPhysicalProperty[spring.vertexId[0]].position = m_vectorVertex[spring.vertexId[0]];
+      if((m_springTolerance > 0.0f) && (residual < m_springTolerance))
+      {
+        m_springIterationsUsed = iterationId + 1;
+        break;
+      }
+    }
+  }
+  else
+  {
+    // relax the independent batches, on pooled threads if there are enough springs
+    int threadCount = std::min(m_springThreadCount, (int)vectorSpring.size() / SPRINGS_PER_THREAD);
+    std::vector<SpringWorker *> vectorWorker;
+    if(threadCount > 1) SpringWorkerPool::getInstance().claimWorkers(threadCount - 1, vectorWorker);
+    threadCount = (int)vectorWorker.size() + 1;
 
-        m_vectorVertex[spring.vertexId[1]] -= distance * factor[1];
-        m_vectorPhysicalProperty[spring.vertexId[1]].position = m_vectorVertex[spring.vertexId[1]];
+    if(threadCount == 1)
+    {
+      m_springIterationsUsed = relaxSpringBatches(&vectorVertex[0], m_pCoreSubmesh, m_springIterationCount, m_springTolerance, 0, 1, 0, 0);
+    }
+    else
+    {
+      SpringBarrier barrier;
+      barrier.threadCount = threadCount;
+      barrier.waitCount = 0;
+      barrier.generation = 0;
+
+      std::vector<float> vectorResidual(2 * threadCount);
+
+      SpringJob job;
+      job.pVertex = &vectorVertex[0];
+      job.pCoreSubmesh = m_pCoreSubmesh;
+      job.iterationCount = m_springIterationCount;
+      job.tolerance = m_springTolerance;
+      job.threadCount = threadCount;
+      job.pBarrier = &barrier;
+      job.pResidual = &vectorResidual[0];
+
+      size_t workerId;
+      for(workerId = 0; workerId < vectorWorker.size(); workerId++)
+      {
+        job.threadId = (int)workerId + 1;
+        SpringWorkerPool::startJob(vectorWorker[workerId], job);
       }
+      m_springIterationsUsed = relaxSpringBatches(&vectorVertex[0], m_pCoreSubmesh, m_springIterationCount, m_springTolerance, 0, threadCount, &barrier, &vectorResidual[0]);
+      for(workerId = 0; workerId < vectorWorker.size(); workerId++) SpringWorkerPool::waitJob(vectorWorker[workerId]);
+
+      SpringWorkerPool::getInstance().releaseWorkers(vectorWorker);
     }
   }
+
+  // the relaxed positions are the starting point of the next Verlet step
+  std::vector<CalCoreSubmesh::Spring>::iterator iteratorSpring;
+  for(iteratorSpring = vectorSpring.begin(); iteratorSpring != vectorSpring.end(); ++iteratorSpring)
+  {
+    m_vectorPhysicalProperty[iteratorSpring->vertexId[0]].position = vectorVertex[iteratorSpring->vertexId[0]];
+    m_vectorPhysicalProperty[iteratorSpring->vertexId[1]].position = vectorVertex[iteratorSpring->vertexId[1]];
+  }
 }
 
  /*****************************************************************************/
@@ -540,19 +824,36 @@ void CalSubmesh::updateSpringSystem(float t)
 /** Updates the buffered vertex data of a submesh.
   *
   * This function updates the buffered data of a specific submesh.
-  * First, it tries to find a highly-optimized function to calculate the
-  * data. If it can't find one, it will use the slower general-case functions.
   * If the submesh doesn't buffer vertices (that is, if internal data has not
   * been enabled), this is a no-op.
-  *
-  * @param submesh The submesh whose buffered vertex data needs to be updated.
   *****************************************************************************/
 
 void CalSubmesh::updateVertices(void)
 {
   // If this submesh does not store internal data, there's nothing to do.
   if (!m_bInternalData) return;
-  
+
+  skinVertices(m_vectorVertex, m_vectorNormal, m_vectorvectorTangentSpace, m_springTime);
+  m_springTime = 0.0;
+}
+
+ /*****************************************************************************/
+/** Skins the submesh into a set of vertex buffers.
+  *
+  * This function calculates the vertices, normals and tangent spaces of the
+  * submesh into the given buffers and runs the spring system on them. First,
+  * it tries to find a highly-optimized function to calculate the data. If it
+  * can't find one, it will use the slower general-case functions.
+  *
+  * @param vectorVertex The buffer that receives the vertices.
+  * @param vectorNormal The buffer that receives the normals.
+  * @param vectorvectorTangentSpace The buffers that receive the tangent
+  *                                 spaces, one per texture coordinate channel.
+  * @param springTime The amount of time to elapse for the spring system.
+  *****************************************************************************/
+
+void CalSubmesh::skinVertices(std::vector<CalVector>& vectorVertex, std::vector<CalVector>& vectorNormal, std::vector<std::vector<TangentSpace> >& vectorvectorTangentSpace, float springTime)
+{
   // Count the tangent spaces.
   int tangentSpaceCount = 0;
   int tangentSpaceIndex = 0;
@@ -565,32 +866,81 @@ void CalSubmesh::updateVertices(void)
     }
   }
   
+  // Blend the influence sets once for all the passes below.
+  (this->*m_blendInfluenceSets)();
+  m_bInfluenceSetsBlended = true;
+
   if (tangentSpaceCount == 1)
   {
     // If there's exactly one tangent space, use calculateVNT
-    std::vector<CalSubmesh::TangentSpace> &vectorTangentSpace = getVectorTangentSpace(tangentSpaceIndex);
-    calculateVNT((float*)&(m_vectorVertex[0]), (float *)&(m_vectorNormal[0]), 
+    std::vector<CalSubmesh::TangentSpace> &vectorTangentSpace = vectorvectorTangentSpace[tangentSpaceIndex];
+    calculateVNT((float*)&(vectorVertex[0]), (float *)&(vectorNormal[0]), 
 		 tangentSpaceIndex, (float *)&(vectorTangentSpace[0]));
   } else {
     // Use this code for every other case:
-    calculateVN((float *)&(m_vectorVertex[0]), (float *)&(m_vectorNormal[0]));
+    calculateVN((float *)&(vectorVertex[0]), (float *)&(vectorNormal[0]));
     for (int textureCoordinateId = 0; textureCoordinateId < (int)m_pCoreSubmesh->getTextureCoordinateCount(); textureCoordinateId++)
     {
       if (m_pCoreSubmesh->tangentsEnabled(textureCoordinateId))
 	    {
-	      calculateTangentSpaces(textureCoordinateId, (float *)&(m_vectorvectorTangentSpace[textureCoordinateId][0]));
+	      calculateTangentSpaces(textureCoordinateId, (float *)&(vectorvectorTangentSpace[textureCoordinateId][0]));
 	    }
     }
   }
+  m_bInfluenceSetsBlended = false;
   
   if (m_pCoreSubmesh->getSpringCount() > 0)
   {
-    calculateSpringForces(m_springTime);
-    calculateSpringVertices(m_springTime);
-    m_springTime = 0.0;
+    // a sleeping spring system wakes up as soon as the skeleton moves
+    if(m_bSpringAsleep && hasPaletteChanged()) wakeSpringSystem();
+
+    if(m_bSpringAsleep)
+    {
+      holdSpringVertices(vectorVertex);
+    }
+    else
+    {
+      calculateSpringForces(springTime);
+      calculateSpringVertices(vectorVertex, springTime);
+      updateSpringSleep(springTime);
+    }
   }
 }
 
+ /*****************************************************************************/
+/** Prepares the back buffers for the skinning pipeline.
+  *
+  * This function sizes the back buffers like the buffered data and queues the
+  * pending spring time for the pipeline worker. It must only be called while
+  * no skinning is in flight.
+  *****************************************************************************/
+
+void CalSubmesh::prepareBackBuffers(void)
+{
+  // a fresh copy gives the back buffers the layout of the buffered data
+  if (m_vectorVertexBack.size() != m_vectorVertex.size()) m_vectorVertexBack = m_vectorVertex;
+  if (m_vectorNormalBack.size() != m_vectorNormal.size()) m_vectorNormalBack = m_vectorNormal;
+  if (m_vectorvectorTangentSpaceBack.size() != m_vectorvectorTangentSpace.size()) m_vectorvectorTangentSpaceBack = m_vectorvectorTangentSpace;
+
+  // hand the spring time over to the worker
+  m_springTimeQueued = m_springTime;
+  m_springTime = 0.0f;
+}
+
+ /*****************************************************************************/
+/** Publishes the back buffers.
+  *
+  * This function swaps the back buffers written by the pipeline worker with
+  * the buffered data. It must only be called while no skinning is in flight.
+  *****************************************************************************/
+
+void CalSubmesh::swapBuffers(void)
+{
+  m_vectorVertex.swap(m_vectorVertexBack);
+  m_vectorNormal.swap(m_vectorNormalBack);
+  m_vectorvectorTangentSpace.swap(m_vectorvectorTangentSpaceBack);
+}
+
  /*****************************************************************************/
 /** Provides access to the vertex data.
   *
@@ -890,62 +1240,368 @@ bool CalSubmesh::hasInternalData()
  /*****************************************************************************/
 /** Sets the LOD level.
   *
-  * This function sets the LOD level of the submesh instance.
+  * This function sets the LOD level of the submesh instance. The level is
+  * rounded up to the next LOD step precomputed by the core submesh, so this
+  * only selects a shared face table and copies two counts. A core submesh
+  * without LOD steps shows all its faces.
   *
   * @param lodLevel The LOD level in the range [0.0, 1.0].
   *****************************************************************************/
 
 void CalSubmesh::setLodLevel(float lodLevel)
 {
-  // clamp the lod level to [0.0, 1.0]
-  if(lodLevel < 0.0f) lodLevel = 0.0f;
-  if(lodLevel > 1.0f) lodLevel = 1.0f;
+  // find the precomputed lod step; without steps, for example after the core
+  // submesh was edited, all faces are shown
+  m_lodStepId = m_pCoreSubmesh->findLodStep(lodLevel);
+  if(m_lodStepId < 0)
+  {
+    m_vertexCount = m_pCoreSubmesh->getVertexCount();
+    m_faceCount = m_pCoreSubmesh->getFaceCount();
+  }
+  else
+  {
+    // take over the vertex and face count of the step
+    const CalCoreSubmesh::LodStep &lodStep = m_pCoreSubmesh->getVectorLodStep()[m_lodStepId];
+    m_vertexCount = lodStep.vertexCount;
+    m_faceCount = lodStep.faceCount;
+  }
 
-  // get the lod count of the core submesh
-  size_t lodCount;
-  lodCount = m_pCoreSubmesh->getLodCount();
+  // only the influence sets of the remaining vertices need to be blended
+  m_influenceSetCount = 0;
+  std::vector<int>& vectorVertexInfluenceSet = m_pCoreSubmesh->getVectorVertexInfluenceSet();
+  if(vectorVertexInfluenceSet.size() == m_pCoreSubmesh->getVertexCount())
+  {
+    for(size_t vertexId = 0; vertexId < m_vertexCount; vertexId++)
+    {
+      if(vectorVertexInfluenceSet[vertexId] >= (int)m_influenceSetCount) m_influenceSetCount = vectorVertexInfluenceSet[vertexId] + 1;
+    }
+  }
+}
 
-  // calculate the target lod count
-  lodCount = (int)((1.0f - lodLevel) * lodCount);
+ /*****************************************************************************/
+/** Returns the spring iteration count.
+  *
+  * This function returns the number of relaxation passes the spring system
+  * of the submesh instance runs per update.
+  *
+  * @return The spring iteration count.
+  *****************************************************************************/
+
+int CalSubmesh::getSpringIterationCount()
+{
+  return m_springIterationCount;
+}
+
+ /*****************************************************************************/
+/** Sets the spring iteration count.
+  *
+  * This function sets the number of relaxation passes the spring system of
+  * the submesh instance runs per update. More passes keep long cloth and
+  * hair closer to its idle lengths. The default is 2.
+  *
+  * @param springIterationCount The spring iteration count.
+  *****************************************************************************/
 
-  // calculate the new number of vertices
-  m_vertexCount = m_pCoreSubmesh->getVertexCount() - lodCount;
+void CalSubmesh::setSpringIterationCount(int springIterationCount)
+{
+  if(springIterationCount < 1) springIterationCount = 1;
 
-  // get face vector of the core submesh
-  std::vector<CalCoreSubmesh::Face>& vectorFace = m_pCoreSubmesh->getVectorFace();
+  m_springIterationCount = springIterationCount;
+}
 
-  // get face vector of the core submesh
-  std::vector<CalCoreSubmesh::LodControl>& vectorLodControl = m_pCoreSubmesh->getVectorLodControl();
-  
-  // calculate the new number of faces
-  m_faceCount = vectorFace.size();
+ /*****************************************************************************/
+/** Returns the spring thread count.
+  *
+  * This function returns the largest number of threads the spring system of
+  * the submesh instance is relaxed on.
+  *
+  * @return The spring thread count.
+  *****************************************************************************/
+
+int CalSubmesh::getSpringThreadCount()
+{
+  return m_springThreadCount;
+}
+
+ /*****************************************************************************/
+/** Sets the spring thread count.
+  *
+  * This function sets the largest number of threads the spring system of the
+  * submesh instance is relaxed on. The threads come from a pool shared by all
+  * submesh instances that is started on first use and holds one thread less
+  * than the hardware runs; when no pooled thread is idle, the springs are
+  * relaxed on the calling thread alone. See stopSpringThreads(). The threads synchronize after every
+  * spring batch, so only large spring systems get more than one thread. The
+  * default of 1 relaxes on the calling thread.
+  *
+  * @param springThreadCount The spring thread count.
+  *****************************************************************************/
+
+void CalSubmesh::setSpringThreadCount(int springThreadCount)
+{
+  if(springThreadCount < 1) springThreadCount = 1;
+
+  m_springThreadCount = springThreadCount;
+}
+
+ /*****************************************************************************/
+/** Stops the spring threads.
+  *
+  * This function stops the threads of the pool shared by all submesh
+  * instances and waits for them to end. It runs by itself when the process
+  * exits; a client that unloads the library earlier should call it first. No
+  * spring system may be updated meanwhile. The next threaded update starts
+  * the pool again.
+  *****************************************************************************/
+
+void CalSubmesh::stopSpringThreads()
+{
+  SpringWorkerPool::getInstance().stop();
+}
+
+ /*****************************************************************************/
+/** Returns the spring tolerance.
+  *
+  * This function returns the residual below which the spring relaxation
+  * stops early.
+  *
+  * @return The spring tolerance.
+  *****************************************************************************/
+
+float CalSubmesh::getSpringTolerance()
+{
+  return m_springTolerance;
+}
+
+ /*****************************************************************************/
+/** Sets the spring tolerance.
+  *
+  * This function makes the spring iteration count adaptive. After every
+  * relaxation pass the largest spring length error is compared against the
+  * tolerance, and the relaxation stops once it is below. The spring iteration
+  * count becomes the maximum number of passes. The default of 0 always runs
+  * all passes.
+  *
+  * @param springTolerance The spring tolerance, in model units.
+  *****************************************************************************/
+
+void CalSubmesh::setSpringTolerance(float springTolerance)
+{
+  m_springTolerance = springTolerance;
+}
+
+ /*****************************************************************************/
+/** Returns the number of relaxation passes of the last update.
+  *
+  * This function returns how many relaxation passes the spring system ran in
+  * the last update, which is 0 while it sleeps.
+  *
+  * @return The number of relaxation passes.
+  *****************************************************************************/
+
+int CalSubmesh::getSpringIterationsUsed()
+{
+  return m_springIterationsUsed;
+}
+
+ /*****************************************************************************/
+/** Returns the spring sleep threshold.
+  *
+  * This function returns the kinetic energy per simulated vertex below which
+  * the spring system falls asleep.
+  *
+  * @return The spring sleep threshold.
+  *****************************************************************************/
+
+float CalSubmesh::getSpringSleepThreshold()
+{
+  return m_springSleepThreshold;
+}
 
-  for(int vertexId = vectorLodControl.size() - 1; vertexId >= (int)m_vertexCount; vertexId--)
+ /*****************************************************************************/
+/** Sets the spring sleep threshold.
+  *
+  * This function lets the spring system fall asleep once its kinetic energy
+  * per simulated vertex stayed below the threshold for a few updates. While
+  * it sleeps, the simulated vertices keep their last positions and no spring
+  * is integrated or relaxed. It wakes up when the bone transforms change or
+  * wakeSpringSystem() is called. The default of 0 never sleeps.
+  *
+  * @param springSleepThreshold The spring sleep threshold.
+  *****************************************************************************/
+
+void CalSubmesh::setSpringSleepThreshold(float springSleepThreshold)
+{
+  m_springSleepThreshold = springSleepThreshold;
+}
+
+ /*****************************************************************************/
+/** Returns the kinetic energy of the spring system.
+  *
+  * This function returns the kinetic energy per simulated vertex measured in
+  * the last update of the spring system. It is only measured while a sleep
+  * threshold is set, and is 0 otherwise.
+  *
+  * @return The kinetic energy.
+  *****************************************************************************/
+
+float CalSubmesh::getSpringEnergy()
+{
+  return m_springEnergy;
+}
+
+ /*****************************************************************************/
+/** Returns if the spring system sleeps.
+  *
+  * @return One of the following values:
+  *         \li \b true if the spring system sleeps
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalSubmesh::isSpringSystemAsleep()
+{
+  return m_bSpringAsleep;
+}
+
+ /*****************************************************************************/
+/** Wakes the spring system up.
+  *
+  * This function makes the spring system simulate again from the next update
+  * on, for example after an external impulse.
+  *****************************************************************************/
+
+void CalSubmesh::wakeSpringSystem()
+{
+  m_bSpringAsleep = false;
+  m_springCalmCount = 0;
+  m_vectorSleepMatrix.clear();
+  m_vectorSleepVector.clear();
+}
+
+ /*****************************************************************************/
+/** Returns the bone transforms the skinning reads.
+  *
+  * @param pMatrix The variable the address of the rotations is written to.
+  * @param pVector The variable the address of the translations is written to.
+  *
+  * @return The number of bone transforms.
+  *****************************************************************************/
+
+size_t CalSubmesh::getSkinningPalette(const CalMatrix *&pMatrix, const CalVector *&pVector)
+{
+  std::vector<CalMatrix>& vectorMatrix = m_bSkinFromSnapshot ? m_pModel->m_vectorSkinningMatrix : m_pModel->m_vectorTransformMatrix;
+  std::vector<CalVector>& vectorVector = m_bSkinFromSnapshot ? m_pModel->m_vectorSkinningVector : m_pModel->m_vectorTransformVector;
+
+  pMatrix = vectorMatrix.empty() ? 0 : &vectorMatrix[0];
+  pVector = vectorVector.empty() ? 0 : &vectorVector[0];
+
+  return vectorMatrix.size();
+}
+
+ /*****************************************************************************/
+/** Checks if the skeleton moved since the spring system fell asleep.
+  *
+  * @return One of the following values:
+  *         \li \b true if any bone transform changed
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalSubmesh::hasPaletteChanged()
+{
+  const CalMatrix *pMatrix;
+  const CalVector *pVector;
+  size_t boneCount = getSkinningPalette(pMatrix, pVector);
+
+  if(boneCount != m_vectorSleepMatrix.size()) return true;
+  if(boneCount == 0) return false;
+
+  return (memcmp(pMatrix, &m_vectorSleepMatrix[0], boneCount * sizeof(CalMatrix)) != 0)
+      || (memcmp(pVector, &m_vectorSleepVector[0], boneCount * sizeof(CalVector)) != 0);
+}
+
+ /*****************************************************************************/
+/** Keeps the simulated vertices of a sleeping spring system in place.
+  *
+  * @param vectorVertex The vertex buffer that holds the skinned vertices and
+  *                     receives the resting ones.
+  *****************************************************************************/
+
+void CalSubmesh::holdSpringVertices(std::vector<CalVector>& vectorVertex)
+{
+  std::vector<CalCoreSubmesh::PhysicalProperty>& vectorCorePhysicalProperty = m_pCoreSubmesh->getVectorPhysicalProperty();
+
+  for(int vertexId = 0; vertexId < (int)vectorVertex.size(); vertexId++)
   {
-    m_faceCount -= vectorLodControl[vertexId].faceCollapseCount;
+    if(vectorCorePhysicalProperty[vertexId].weight > 0.0f) vectorVertex[vertexId] = m_vectorPhysicalProperty[vertexId].position;
   }
-  
-  // fill the face vector with the collapsed vertex ids
-  int faceId;
-  for(faceId = 0; faceId < (int)m_faceCount; faceId++)
+
+  m_springEnergy = 0.0f;
+  m_springIterationsUsed = 0;
+}
+
+ /*****************************************************************************/
+/** Measures the kinetic energy and puts the spring system to sleep.
+  *
+  * This function computes the kinetic energy per simulated vertex from the
+  * last Verlet step. Once it stayed below the sleep threshold for a few
+  * updates, the velocities are cleared, the bone transforms are remembered
+  * and the spring system falls asleep. Without a sleep threshold nothing is
+  * measured, and an update without elapsed time keeps the last measurement.
+  *
+  * @param deltaTime The time step of the last update.
+  *****************************************************************************/
+
+void CalSubmesh::updateSpringSleep(float deltaTime)
+{
+  if(m_springSleepThreshold <= 0.0f)
   {
-    int vertexId;
-    for(vertexId = 0; vertexId < 3; vertexId++)
-    {
-      // get the vertex id
-      int collapsedVertexId;
-      collapsedVertexId = vectorFace[faceId].vertexId[vertexId];
+    m_springEnergy = 0.0f;
+    m_springCalmCount = 0;
+    return;
+  }
 
-      // collapse the vertex id until it fits into the current lod level
-      while(collapsedVertexId >= (int)m_vertexCount) collapsedVertexId = vectorLodControl[collapsedVertexId].collapseId;
+  // the velocities are only known per time step, so a zero step tells nothing
+  if(deltaTime <= 0.0f) return;
 
-      // store the collapse vertex id in the submesh face vector
-      m_vectorFace[faceId].vertexId[vertexId] = collapsedVertexId;
-    }
+  std::vector<CalCoreSubmesh::PhysicalProperty>& vectorCorePhysicalProperty = m_pCoreSubmesh->getVectorPhysicalProperty();
+
+  double energy = 0.0;
+  int simulatedCount = 0;
+  int vertexId;
+  for(vertexId = 0; vertexId < (int)m_vectorPhysicalProperty.size(); vertexId++)
+  {
+    float weight = vectorCorePhysicalProperty[vertexId].weight;
+    if(weight <= 0.0f) continue;
+
+    CalVector velocity = m_vectorPhysicalProperty[vertexId].position - m_vectorPhysicalProperty[vertexId].positionOld;
+    energy += 0.5 * weight * (velocity * velocity);
+    simulatedCount++;
   }
-}
 
-//****************************************************************************//
+  if(simulatedCount > 0) energy /= (double)simulatedCount * deltaTime * deltaTime;
+  m_springEnergy = (float)energy;
 
+  if(m_springEnergy >= m_springSleepThreshold)
+  {
+    m_springCalmCount = 0;
+    return;
+  }
+
+  if(++m_springCalmCount < SPRING_CALM_UPDATES) return;
 
+  // come to rest where we are
+  for(vertexId = 0; vertexId < (int)m_vectorPhysicalProperty.size(); vertexId++)
+  {
+    m_vectorPhysicalProperty[vertexId].positionOld = m_vectorPhysicalProperty[vertexId].position;
+  }
 
+  const CalMatrix *pMatrix;
+  const CalVector *pVector;
+  size_t boneCount = getSkinningPalette(pMatrix, pVector);
+  m_vectorSleepMatrix.assign(pMatrix, pMatrix + boneCount);
+  m_vectorSleepVector.assign(pVector, pVector + boneCount);
+
+  m_bSpringAsleep = true;
+}
+
+//****************************************************************************//
@@ -17,6 +17,7 @@
 
 #include "calglobal.h"
 #include "calvector.h"
+#include "calmatrix.h"
 
 //****************************************************************************//
 // Forward declarations                                                       //
@@ -60,6 +61,24 @@ public:
     int vertexId[3];
   };
 
+  /// The output channels of a skinning kernel.
+  enum
+  {
+    SKIN_VERTICES = 1,
+    SKIN_NORMALS = 2,
+    SKIN_TANGENTS = 4,
+    SKIN_CHANNEL_MASKS = 8
+  };
+
+  /// The number of calm updates before the spring system falls asleep.
+  enum { SPRING_CALM_UPDATES = 10 };
+
+protected:
+  /// A skinning kernel instance.
+  typedef size_t (CalSubmesh::*KernelFunc)(float *pVertexBuffer, float *pNormalBuffer, int textureCoordinateId, float *pTangentBuffer);
+  /// A function that blends the transforms of the influence sets.
+  typedef void (CalSubmesh::*BlendFunc)(void);
+
 // member variables
 protected:
   CalModel *m_pModel;
@@ -67,16 +86,48 @@ protected:
   std::vector<CalVector> m_vectorVertex;
   std::vector<CalVector> m_vectorNormal;
   std::vector<std::vector<TangentSpace> > m_vectorvectorTangentSpace;
-  std::vector<Face> m_vectorFace;
   std::vector<PhysicalProperty> m_vectorPhysicalProperty;
+  std::vector<CalVector> m_vectorVertexBack;
+  std::vector<CalVector> m_vectorNormalBack;
+  std::vector<std::vector<TangentSpace> > m_vectorvectorTangentSpaceBack;
+  std::vector<CalMatrix> m_vectorInfluenceSetMatrix;
+  std::vector<CalVector> m_vectorInfluenceSetVector;
+  size_t m_influenceSetCount;
+  bool m_bInfluenceSetsBlended;
   size_t m_vertexCount;
   size_t m_faceCount;
+  int m_lodStepId;
+  int m_springIterationCount;
+  int m_springIterationsUsed;
+  int m_springThreadCount;
+  float m_springTolerance;
+  float m_springSleepThreshold;
+  float m_springEnergy;
+  int m_springCalmCount;
+  bool m_bSpringAsleep;
+  std::vector<CalMatrix> m_vectorSleepMatrix;
+  std::vector<CalVector> m_vectorSleepVector;
   bool m_bInternalData;
+  bool m_bSkinFromSnapshot;
   float m_springTime;
+  float m_springTimeQueued;
+  KernelFunc m_arrayKernel[SKIN_CHANNEL_MASKS];
+  BlendFunc m_blendInfluenceSets;
   
+  template<int CHANNELS, int MAXINF> size_t calculateKernel(float *pVertexBuffer, float *pNormalBuffer, int textureCoordinateId, float *pTangentBuffer);
+  template<int MAXINF> void blendInfluenceSets(void);
+  template<int MAXINF> void bindKernelSet(void);
+  void bindKernels(void);
   void updateVertices(void);
+  void skinVertices(std::vector<CalVector>& vectorVertex, std::vector<CalVector>& vectorNormal, std::vector<std::vector<TangentSpace> >& vectorvectorTangentSpace, float springTime);
+  void prepareBackBuffers(void);
+  void swapBuffers(void);
   void calculateSpringForces(float deltaTime);
-  void calculateSpringVertices(float deltaTime);
+  void calculateSpringVertices(std::vector<CalVector>& vectorVertex, float deltaTime);
+  size_t getSkinningPalette(const CalMatrix *&pMatrix, const CalVector *&pVector);
+  bool hasPaletteChanged(void);
+  void holdSpringVertices(std::vector<CalVector>& vectorVertex);
+  void updateSpringSleep(float deltaTime);
 
 // Because of Win32 DLL Heap Weirdness, Constructors/Destructor must be private. Use Alloc and Free.
 
@@ -114,6 +165,19 @@ protected:
   size_t getFaces(int *pFaceBuffer, int offset);
   void enableInternalData(void);
   void setLodLevel(float lodLevel);
+  int getSpringIterationCount();
+  void setSpringIterationCount(int springIterationCount);
+  int getSpringThreadCount();
+  void setSpringThreadCount(int springThreadCount);
+  static void stopSpringThreads();
+  int getSpringIterationsUsed();
+  float getSpringTolerance();
+  void setSpringTolerance(float springTolerance);
+  float getSpringSleepThreshold();
+  void setSpringSleepThreshold(float springSleepThreshold);
+  float getSpringEnergy();
+  bool isSpringSystemAsleep();
+  void wakeSpringSystem();
 };
 
 #endif
@@ -0,0 +1,363 @@
+#include "stdafx.h"
+//****************************************************************************//
+// encodedsource.cpp                                                         //
+// Copyright (C) 2001-2003 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "encodedsource.h"
+#include "calerror.h"
+#include "calplatform.h"
+
+ /*****************************************************************************/
+/** Constructs an encoded source instance from the body of an encoded file.
+  *
+  * This function is the only constructor of the encoded source. It decodes
+  * all streams of the body. Use isDecoded() to check if the body was valid.
+  *
+  * @param pBody The address of the body.
+  * @param length The size of the body in bytes.
+  *****************************************************************************/
+
+CalEncodedSource::CalEncodedSource(const char* pBody, int length)
+  : mFailed(false), mDecoded(false)
+{
+   for (int type = 0; type < CalEncoded::STREAM_COUNT; type++) mOffset[type] = 0;
+
+   if ((pBody == NULL) || (length < 4)) return;
+
+   int streamCount;
+   CalPlatform::readInteger((char*)pBody, streamCount);
+   if (streamCount != CalEncoded::STREAM_COUNT) return;
+
+   // the stream table, four words per stream
+   const unsigned int tableSize = 4 + streamCount * 16;
+   if ((unsigned int)length < tableSize) return;
+
+   CalEncoded::Stream stream[CalEncoded::STREAM_COUNT];
+   CalPlatform::readIntegers((char*)pBody + 4, (int*)&stream[0], streamCount * 4);
+
+   unsigned int offset = tableSize;
+   for (int type = 0; type < streamCount; type++)
+   {
+      const CalEncoded::Stream& s = stream[type];
+      if ((s.size > 0x7fffffff) || (s.encodedSize > (unsigned int)length - offset)) return;
+      if ((s.stride < 0) || (s.stride > CalEncoded::MAX_STRIDE)) return;
+
+      const char* pEncoded = pBody + offset;
+      offset += s.encodedSize;
+
+      std::vector<char>& vectorStream = mvectorStream[type];
+      vectorStream.resize(s.size);
+      if (s.size == 0) continue;
+
+      // undo the compression first, then the delta coding and the byte planes
+      std::vector<char> vectorPlanes;
+      if (s.flags & CalEncoded::FLAG_COMPRESSED)
+      {
+         vectorPlanes.resize(s.size);
+         if (!CalEncoder::decompress(pEncoded, s.encodedSize, &vectorPlanes[0], s.size)) return;
+         pEncoded = &vectorPlanes[0];
+      }
+      else if (s.encodedSize != s.size)
+      {
+         return;
+      }
+
+      if (s.flags & CalEncoded::FLAG_SHUFFLED)
+      {
+         if (!CalEncoder::decodeWords(pEncoded, s.size, s.stride, &vectorStream[0])) return;
+      }
+      else
+      {
+         memcpy(&vectorStream[0], pEncoded, s.size);
+      }
+   }
+
+   mDecoded = true;
+}
+
+
+/**
+ * Destruct the CalEncodedSource.
+ */
+
+CalEncodedSource::~CalEncodedSource()
+{
+}
+
+
+ /*****************************************************************************/
+/** Checks whether the data source is in a good state.
+  *
+  * This function checks if the body was decoded and no read went past the end
+  * of a stream.
+  *
+  * @return One of the following values:
+  *         \li \b true if data source is in a good state
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalEncodedSource::ok() const
+{
+   return mDecoded && !mFailed;
+}
+
+ /*****************************************************************************/
+/** Sets the error code and message related to an encoded source.
+  *
+  *****************************************************************************/
+
+void CalEncodedSource::setError() const
+{
+   if (!mDecoded)
+      CalError::setLastError(CalError::INVALID_FILE_FORMAT, __FILE__, __LINE__);
+   else
+      CalError::setLastError(CalError::BAD_DATA_SOURCE, __FILE__, __LINE__);
+}
+
+ /*****************************************************************************/
+/** Advances the read position of a stream.
+  *
+  * This function checks that the given number of bytes are left in a stream
+  * and moves its read position behind them. If they are not, the data source
+  * stays in an error state.
+  *
+  * @param type The stream to read from.
+  * @param length The number of bytes to advance.
+  *
+  * @return One of the following values:
+  *         \li the address of the bytes in the stream
+  *         \li \b NULL if an error happend
+  *****************************************************************************/
+
+const char* CalEncodedSource::advance(int type, int length)
+{
+   if (!ok()) return NULL;
+
+   const std::vector<char>& vectorStream = mvectorStream[type];
+   if ((length < 0) || ((unsigned int)length > vectorStream.size() - mOffset[type]))
+   {
+      mFailed = true;
+      return NULL;
+   }
+
+   // an empty read from an empty stream has no address to hand out
+   if (length == 0) return "";
+
+   const char* pData = &vectorStream[mOffset[type]];
+   mOffset[type] += length;
+
+   return pData;
+}
+
+ /*****************************************************************************/
+/** Reads a number of bytes.
+  *
+  * This function reads a given number of bytes from this data source.
+  *
+  * @param pBuffer A pointer to the buffer where the bytes are stored into.
+  * @param length The number of bytes that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalEncodedSource::readBytes(void* pBuffer, int length)
+{
+   if (pBuffer == NULL) return false;
+
+   const char* pData = advance(CalEncoded::STREAM_BYTE, length);
+   if (pData == NULL) return false;
+
+   memcpy(pBuffer, pData, length);
+
+   return true;
+}
+
+ /*****************************************************************************/
+/** Reads a float.
+  *
+  * This function reads a float from this data source.
+  *
+  * @param value A reference to the float into which the data is read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalEncodedSource::readFloat(float& value)
+{
+   const char* pData = advance(CalEncoded::STREAM_FLOAT, 4);
+   if (pData == NULL) return false;
+
+   return CalPlatform::readFloat((char*)pData, value);
+}
+
+ /*****************************************************************************/
+/** Reads a short.
+  *
+  * This function reads a short from this data source. Shorts are kept in the
+  * byte stream.
+  *
+  * @param value A reference to the short into which the data is read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalEncodedSource::readShort(short& value)
+{
+   const char* pData = advance(CalEncoded::STREAM_BYTE, 2);
+   if (pData == NULL) return false;
+
+   return CalPlatform::readShort((char*)pData, value);
+}
+
+ /*****************************************************************************/
+/** Reads an integer.
+  *
+  * This function reads an integer from this data source.
+  *
+  * @param value A reference to the integer into which the data is read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalEncodedSource::readInteger(int& value)
+{
+   const char* pData = advance(CalEncoded::STREAM_INTEGER, 4);
+   if (pData == NULL) return false;
+
+   return CalPlatform::readInteger((char*)pData, value);
+}
+
+ /*****************************************************************************/
+/** Reads a string.
+  *
+  * This function reads a string from this data source. The string stream
+  * holds the strings as the original file did.
+  *
+  * @param strValue A reference to the string into which the data is read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalEncodedSource::readString(std::string& strValue)
+{
+   const char* pLength = advance(CalEncoded::STREAM_STRING, 4);
+   if (pLength == NULL) return false;
+
+   int length;
+   CalPlatform::readInteger((char*)pLength, length);
+
+   const char* pData = advance(CalEncoded::STREAM_STRING, length);
+   if (pData == NULL) return false;
+
+   // stop at the terminator like the other data sources do
+   strValue.assign(pData, strnlen(pData, length));
+
+   return true;
+}
+
+ /*****************************************************************************/
+/** Reads a number of floats.
+  *
+  * This function reads a given number of floats from this data source in one
+  * block.
+  *
+  * @param pValue A pointer to the array into which the data is read.
+  * @param count The number of floats that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalEncodedSource::readFloats(float* pValue, int count)
+{
+   if ((count < 0) || (count > 0x1fffffff)) return false;
+
+   const char* pData = advance(CalEncoded::STREAM_FLOAT, 4 * count);
+   if (pData == NULL) return false;
+
+   return CalPlatform::readFloats((char*)pData, pValue, count);
+}
+
+ /*****************************************************************************/
+/** Reads a number of integers.
+  *
+  * This function reads a given number of integers from this data source in one
+  * block.
+  *
+  * @param pValue A pointer to the array into which the data is read.
+  * @param count The number of integers that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalEncodedSource::readIntegers(int* pValue, int count)
+{
+   if ((count < 0) || (count > 0x1fffffff)) return false;
+
+   const char* pData = advance(CalEncoded::STREAM_INTEGER, 4 * count);
+   if (pData == NULL) return false;
+
+   return CalPlatform::readIntegers((char*)pData, pValue, count);
+}
+
+ /*****************************************************************************/
+/** Returns the number of bytes left to read.
+  *
+  * This function returns the number of bytes left in all streams, which is
+  * what is left of the original file.
+  *
+  * @return The number of bytes left to read.
+  *****************************************************************************/
+
+int CalEncodedSource::getRemainingSize() const
+{
+   if (!ok()) return -1;
+
+   size_t remainingSize = 0;
+   for (int type = 0; type < CalEncoded::STREAM_COUNT; type++)
+   {
+      remainingSize += mvectorStream[type].size() - mOffset[type];
+   }
+
+   return (remainingSize > 0x7fffffff) ? 0x7fffffff : (int)remainingSize;
+}
+
+ /*****************************************************************************/
+/** Checks if the body could be decoded.
+  *
+  * @return One of the following values:
+  *         \li \b true if all streams were decoded
+  *         \li \b false if the body is damaged
+  *****************************************************************************/
+
+bool CalEncodedSource::isDecoded() const
+{
+   return mDecoded;
+}
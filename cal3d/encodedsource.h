@@ -0,0 +1,69 @@
+//****************************************************************************//
+// encodedsource.h                                                           //
+// Copyright (C) 2001-2003 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_ENCODEDSOURCE_H
+#define CAL_ENCODEDSOURCE_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+#include "caldatasource.h"
+#include "calencoder.h"
+
+/**
+ * CalEncodedSource class.
+ *
+ * This is an object designed to represent a source of Cal3d data as coming from
+ * the body of an encoded file, see calencoder.h. The streams are decoded once
+ * when the source is constructed; every read then takes the next values of the
+ * stream of its type, so block reads copy straight into the arrays of the core
+ * objects.
+ *
+ * The class is final, so the loader, which is instantiated for it, calls its
+ * readers directly instead of through the vtable.
+ */
+
+
+class CAL3D_API CalEncodedSource final : public CalDataSource
+{
+public:
+   CalEncodedSource(const char* pBody, int length);
+   virtual ~CalEncodedSource();
+
+   virtual bool ok() const;
+   virtual void setError() const;
+   virtual bool readBytes(void* pBuffer, int length);
+   virtual bool readFloat(float& value);
+   virtual bool readShort(short& value);
+   virtual bool readInteger(int& value);
+   virtual bool readString(std::string& strValue);
+   virtual bool readFloats(float* pValue, int count);
+   virtual bool readIntegers(int* pValue, int count);
+   virtual int getRemainingSize() const;
+
+   bool isDecoded() const;
+
+protected:
+   const char* advance(int type, int length);
+
+   std::vector<char> mvectorStream[CalEncoded::STREAM_COUNT];
+   unsigned int mOffset[CalEncoded::STREAM_COUNT];
+   bool mFailed;
+   bool mDecoded;
+
+private:
+   CalEncodedSource(); //Can't use this
+   CalEncodedSource(const CalEncodedSource&);
+   CalEncodedSource& operator=(const CalEncodedSource&);
+};
+
+#endif
@@ -0,0 +1,419 @@
+#include "stdafx.h"
+//****************************************************************************//
+// mappedfilesource.cpp                                                      //
+// Copyright (C) 2001-2003 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "mappedfilesource.h"
+#include "calerror.h"
+#include "calplatform.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+ /*****************************************************************************/
+/** Constructs a mapped file source instance from a file.
+  *
+  * This function is the only constructor of the mapped file source. It maps
+  * the whole file read-only into memory. Use isMapped() to check if the file
+  * could be opened.
+  *
+  * @param strFilename The name of the file to map.
+  *****************************************************************************/
+
+CalMappedFileSource::CalMappedFileSource(const std::string& strFilename)
+  : mpData(NULL), mSize(0), mOffset(0), mFailed(false), mMapped(false)
+{
+#if defined(_WIN32)
+   HANDLE hFile = CreateFileA(strFilename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+   if (hFile == INVALID_HANDLE_VALUE) return;
+
+   LARGE_INTEGER size;
+   if (!GetFileSizeEx(hFile, &size) || (size.QuadPart > 0x7fffffff))
+   {
+      CloseHandle(hFile);
+      return;
+   }
+
+   mSize = (unsigned int)size.QuadPart;
+   if (mSize > 0)
+   {
+      // the view keeps the file alive, so both handles can go right away
+      HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+      if (hMapping != NULL)
+      {
+         mpData = (const char*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+         CloseHandle(hMapping);
+      }
+   }
+   CloseHandle(hFile);
+#else
+   int file = open(strFilename.c_str(), O_RDONLY);
+   if (file < 0) return;
+
+   struct stat status;
+   if ((fstat(file, &status) != 0) || (status.st_size > 0x7fffffff))
+   {
+      close(file);
+      return;
+   }
+
+   mSize = (unsigned int)status.st_size;
+   if (mSize > 0)
+   {
+      // the mapping keeps the file alive, so the descriptor can go right away
+      void* pData = mmap(NULL, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+      if (pData != MAP_FAILED) mpData = (const char*)pData;
+   }
+   close(file);
+#endif
+
+   // an empty file is mapped as well, every read from it fails
+   mMapped = (mpData != NULL) || (mSize == 0);
+   if (!mMapped) mSize = 0;
+}
+
+
+/**
+ * Destruct the CalMappedFileSource and unmap the file. Pointers returned by
+ * mapBytes() become invalid.
+ */
+
+CalMappedFileSource::~CalMappedFileSource()
+{
+   if (mpData == NULL) return;
+
+#if defined(_WIN32)
+   UnmapViewOfFile(mpData);
+#else
+   munmap((void*)mpData, mSize);
+#endif
+}
+
+
+ /*****************************************************************************/
+/** Checks whether the data source is in a good state.
+  *
+  * This function checks if the file is mapped and no read went past its end.
+  *
+  * @return One of the following values:
+  *         \li \b true if data source is in a good state
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalMappedFileSource::ok() const
+{
+   return mMapped && !mFailed;
+}
+
+ /*****************************************************************************/
+/** Sets the error code and message related to a mapped file source.
+  *
+  *****************************************************************************/
+
+void CalMappedFileSource::setError() const
+{
+   if (!mMapped)
+      CalError::setLastError(CalError::FILE_NOT_FOUND, __FILE__, __LINE__);
+   else
+      CalError::setLastError(CalError::BAD_DATA_SOURCE, __FILE__, __LINE__);
+}
+
+ /*****************************************************************************/
+/** Advances the read position.
+  *
+  * This function checks that the given number of bytes are left in the file
+  * and moves the read position behind them. If they are not, the data source
+  * stays in an error state.
+  *
+  * @param length The number of bytes to advance.
+  *
+  * @return One of the following values:
+  *         \li the address of the bytes in the mapping
+  *         \li \b NULL if an error happend
+  *****************************************************************************/
+
+const char* CalMappedFileSource::advance(int length)
+{
+   if (!ok()) return NULL;
+
+   if ((length < 0) || ((unsigned int)length > mSize - mOffset))
+   {
+      mFailed = true;
+      return NULL;
+   }
+
+   const char* pData = mpData + mOffset;
+   mOffset += length;
+
+   return pData;
+}
+
+ /*****************************************************************************/
+/** Reads a number of bytes.
+  *
+  * This function reads a given number of bytes from this data source.
+  *
+  * @param pBuffer A pointer to the buffer where the bytes are stored into.
+  * @param length The number of bytes that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalMappedFileSource::readBytes(void* pBuffer, int length)
+{
+   if (pBuffer == NULL) return false;
+
+   const char* pData = advance(length);
+   if (pData == NULL) return false;
+
+   memcpy(pBuffer, pData, length);
+
+   return true;
+}
+
+ /*****************************************************************************/
+/** Reads a float.
+  *
+  * This function reads a float from this data source.
+  *
+  * @param value A reference to the float into which the data is read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalMappedFileSource::readFloat(float& value)
+{
+   const char* pData = advance(4);
+   if (pData == NULL) return false;
+
+   return CalPlatform::readFloat((char*)pData, value);
+}
+
+ /*****************************************************************************/
+/** Reads a short.
+  *
+  * This function reads a short from this data source.
+  *
+  * @param value A reference to the short into which the data is read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalMappedFileSource::readShort(short& value)
+{
+   const char* pData = advance(2);
+   if (pData == NULL) return false;
+
+   return CalPlatform::readShort((char*)pData, value);
+}
+
+ /*****************************************************************************/
+/** Reads an integer.
+  *
+  * This function reads an integer from this data source.
+  *
+  * @param value A reference to the integer into which the data is read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalMappedFileSource::readInteger(int& value)
+{
+   const char* pData = advance(4);
+   if (pData == NULL) return false;
+
+   return CalPlatform::readInteger((char*)pData, value);
+}
+
+ /*****************************************************************************/
+/** Reads a string.
+  *
+  * This function reads a string from this data source. The string is stored
+  * as its length, including the terminator, followed by the characters.
+  *
+  * @param strValue A reference to the string into which the data is read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalMappedFileSource::readString(std::string& strValue)
+{
+   int length;
+   if (!readInteger(length)) return false;
+
+   const char* pData = advance(length);
+   if (pData == NULL) return false;
+
+   // stop at the terminator like the other data sources do
+   strValue.assign(pData, strnlen(pData, length));
+
+   return true;
+}
+
+ /*****************************************************************************/
+/** Reads a number of floats.
+  *
+  * This function reads a given number of floats from this data source in one
+  * block.
+  *
+  * @param pValue A pointer to the array into which the data is read.
+  * @param count The number of floats that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalMappedFileSource::readFloats(float* pValue, int count)
+{
+   if ((count < 0) || (count > 0x1fffffff)) return false;
+
+   const char* pData = advance(4 * count);
+   if (pData == NULL) return false;
+
+   return CalPlatform::readFloats((char*)pData, pValue, count);
+}
+
+ /*****************************************************************************/
+/** Reads a number of integers.
+  *
+  * This function reads a given number of integers from this data source in one
+  * block.
+  *
+  * @param pValue A pointer to the array into which the data is read.
+  * @param count The number of integers that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalMappedFileSource::readIntegers(int* pValue, int count)
+{
+   if ((count < 0) || (count > 0x1fffffff)) return false;
+
+   const char* pData = advance(4 * count);
+   if (pData == NULL) return false;
+
+   return CalPlatform::readIntegers((char*)pData, pValue, count);
+}
+
+ /*****************************************************************************/
+/** Maps a number of bytes.
+  *
+  * This function returns the address of the next bytes of the file without
+  * copying them and moves the read position behind them. The address stays
+  * valid as long as the data source exists. The bytes are in file byte order.
+  *
+  * @param length The number of bytes that should be mapped.
+  *
+  * @return One of the following values:
+  *         \li the address of the bytes
+  *         \li \b NULL if an error happend
+  *****************************************************************************/
+
+const char* CalMappedFileSource::mapBytes(int length)
+{
+   return advance(length);
+}
+
+ /*****************************************************************************/
+/** Checks if the file could be mapped.
+  *
+  * @return One of the following values:
+  *         \li \b true if the file is mapped
+  *         \li \b false if it could not be opened
+  *****************************************************************************/
+
+bool CalMappedFileSource::isMapped() const
+{
+   return mMapped;
+}
+
+ /*****************************************************************************/
+/** Moves the read position.
+  *
+  * This function moves the read position to a given offset from the start of
+  * the file.
+  *
+  * @param offset The new read position.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if the offset is past the end of the file
+  *****************************************************************************/
+
+bool CalMappedFileSource::seek(unsigned int offset)
+{
+   if (!ok() || (offset > mSize)) return false;
+
+   mOffset = offset;
+
+   return true;
+}
+
+ /*****************************************************************************/
+/** Returns the size of the file.
+  *
+  * @return The size of the file in bytes.
+  *****************************************************************************/
+
+unsigned int CalMappedFileSource::getSize() const
+{
+   return mSize;
+}
+
+ /*****************************************************************************/
+/** Returns the read position.
+  *
+  * @return The number of bytes read so far.
+  *****************************************************************************/
+
+unsigned int CalMappedFileSource::getOffset() const
+{
+   return mOffset;
+}
+
+ /*****************************************************************************/
+/** Returns the number of bytes left to read.
+  *
+  * @return The number of bytes behind the read position.
+  *****************************************************************************/
+
+int CalMappedFileSource::getRemainingSize() const
+{
+   if (!ok()) return -1;
+
+   unsigned int remainingSize = mSize - mOffset;
+   return (remainingSize > 0x7fffffff) ? 0x7fffffff : (int)remainingSize;
+}
@@ -0,0 +1,73 @@
+//****************************************************************************//
+// mappedfilesource.h                                                        //
+// Copyright (C) 2001-2003 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_MAPPEDFILESOURCE_H
+#define CAL_MAPPEDFILESOURCE_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+#include "caldatasource.h"
+
+/**
+ * CalMappedFileSource class.
+ *
+ * This is an object designed to represent a source of Cal3d data as coming from
+ * a file that is mapped into memory. Every read is checked against the size of
+ * the file; a read past the end fails and puts the source into an error state
+ * that all later reads keep. Blocks of the file can be taken in place with
+ * mapBytes() instead of being copied.
+ *
+ * The class is final, so the loader, which is instantiated for it, calls its
+ * readers directly instead of through the vtable.
+ */
+
+
+class CAL3D_API CalMappedFileSource final : public CalDataSource
+{
+public:
+   CalMappedFileSource(const std::string& strFilename);
+   virtual ~CalMappedFileSource();
+
+   virtual bool ok() const;
+   virtual void setError() const;
+   virtual bool readBytes(void* pBuffer, int length);
+   virtual bool readFloat(float& value);
+   virtual bool readShort(short& value);
+   virtual bool readInteger(int& value);
+   virtual bool readString(std::string& strValue);
+   virtual bool readFloats(float* pValue, int count);
+   virtual bool readIntegers(int* pValue, int count);
+   virtual const char* mapBytes(int length);
+   virtual int getRemainingSize() const;
+
+   bool isMapped() const;
+   bool seek(unsigned int offset);
+   unsigned int getSize() const;
+   unsigned int getOffset() const;
+
+protected:
+   const char* advance(int length);
+
+   const char* mpData;
+   unsigned int mSize;
+   unsigned int mOffset;
+   bool mFailed;
+   bool mMapped;
+
+private:
+   CalMappedFileSource(); //Can't use this
+   CalMappedFileSource(const CalMappedFileSource&);
+   CalMappedFileSource& operator=(const CalMappedFileSource&);
+};
+
+#endif
@@ -0,0 +1,95 @@
+#include "stdafx.h"
+//****************************************************************************//
+// streamsink.cpp                                                            //
+// Copyright (C) 2001-2003 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "streamsink.h"
+#include "calerror.h"
+#include "calplatform.h"
+
+ /*****************************************************************************/
+/** Constructs a stream sink instance from an existing ostream.
+  *
+  * This function is the only constructor of the stream sink.
+  *
+  * @param outputStream The output stream to use, which should be set up and
+  *                     ready to be written to before making the stream sink.
+  *****************************************************************************/
+
+CalStreamSink::CalStreamSink(std::ostream& outputStream)
+  : mOutputStream(&outputStream)
+{
+}
+
+
+/**
+ * Destruct the CalStreamSink. Note that output stream is not closed here;
+ * this should be handled externally.
+ */
+
+CalStreamSink::~CalStreamSink()
+{
+}
+
+ /*****************************************************************************/
+/** Checks whether the data sink is in a good state.
+  *
+  * This function checks if the ostream can be used.
+  *
+  * @return One of the following values:
+  *         \li \b true if data sink is in a good state
+  *         \li \b false if not
+  *****************************************************************************/
+
+bool CalStreamSink::ok() const
+{
+   if (!mOutputStream || !*mOutputStream)
+      return false;
+
+   return true;
+}
+
+ /*****************************************************************************/
+/** Sets the error code and message related to a streaming sink.
+  *
+  *****************************************************************************/
+
+void CalStreamSink::setError() const
+{
+   CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__);
+}
+
+ /*****************************************************************************/
+/** Writes a number of bytes.
+  *
+  * This function writes a given number of bytes to this data sink.
+  *
+  * @param pBuffer A pointer to the bytes that should be written.
+  * @param length The number of bytes that should be written.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalStreamSink::writeBytes(const void* pBuffer, int length)
+{
+   if (!ok() || (length < 0)) return false;
+   if (length == 0) return true;
+
+   return CalPlatform::writeBytes(*mOutputStream, pBuffer, length);
+}
@@ -0,0 +1,48 @@
+//****************************************************************************//
+// streamsink.h                                                              //
+// Copyright (C) 2001-2003 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This library is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU Lesser General Public License as published by   //
+// the Free Software Foundation; either version 2.1 of the License, or (at    //
+// your option) any later version.                                            //
+//****************************************************************************//
+
+#ifndef CAL_STREAMSINK_H
+#define CAL_STREAMSINK_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "calglobal.h"
+#include "caldatasink.h"
+#include <fstream>
+
+/**
+ * CalStreamSink class.
+ *
+ * This is an object designed to represent a sink for Cal3d data as going to
+ * a standard output stream.
+ */
+
+
+class CAL3D_API CalStreamSink : public CalDataSink
+{
+public:
+   CalStreamSink(std::ostream& outputStream);
+   virtual ~CalStreamSink();
+
+   virtual bool ok() const;
+   virtual void setError() const;
+   virtual bool writeBytes(const void* pBuffer, int length);
+
+protected:
+
+   std::ostream* mOutputStream;
+
+private:
+   CalStreamSink(); //Can't use this
+};
+
+#endif
@@ -175,3 +175,47 @@ bool CalStreamSource::readString(std::string& strValue)
 
    return CalPlatform::readString( *mInputStream, strValue );
 }
+
+ /*****************************************************************************/
+/** Reads a number of floats.
+  *
+  * This function reads a given number of floats from this data source in one
+  * block.
+  *
+  * @param pValue A pointer to the array into which the data is read.
+  * @param count The number of floats that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalStreamSource::readFloats(float* pValue, int count)
+{
+   //Check that the stream is usable
+   if (!ok()) return false;
+
+   return CalPlatform::readFloats( *mInputStream, pValue, count );
+}
+
+ /*****************************************************************************/
+/** Reads a number of integers.
+  *
+  * This function reads a given number of integers from this data source in one
+  * block.
+  *
+  * @param pValue A pointer to the array into which the data is read.
+  * @param count The number of integers that should be read.
+  *
+  * @return One of the following values:
+  *         \li \b true if successful
+  *         \li \b false if an error happend
+  *****************************************************************************/
+
+bool CalStreamSource::readIntegers(int* pValue, int count)
+{
+   //Check that the stream is usable
+   if (!ok()) return false;
+
+   return CalPlatform::readIntegers( *mInputStream, pValue, count );
+}
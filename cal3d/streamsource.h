@@ -44,6 +44,8 @@ public:
    virtual bool readShort(short& value);
    virtual bool readInteger(int& value);
    virtual bool readString(std::string& strValue);
+   virtual bool readFloats(float* pValue, int count);
+   virtual bool readIntegers(int* pValue, int count);
 
 protected:
 
@@ -686,6 +686,7 @@ bool BonesNonExclusive(INode **rootbones, int rootcount)
 wchar_t *CalExportModel(IObjParam *iObjParams,
 	wchar_t   *conf_filename,
 	bool    conf_progmesh,
+	bool    conf_optimize,
 	bool    conf_springsys,
 	int    *conf_bumpid,
 	int    *conf_bumpmap,
@@ -709,7 +710,7 @@ wchar_t *CalExportModel(IObjParam *iObjParams,
 		return ErrorMsg;
 	}
 
-	// Step 1. Generate the rootbone list and the mesh list.
+	// Step 2. Generate the rootbone list and the mesh list.
 
 	for (itemid = 0; itemid<conf_itemcount; itemid++) {
 		INode *node = iObjParams->GetINodeByName(conf_itemlist[itemid]);
@@ -728,11 +729,11 @@ wchar_t *CalExportModel(IObjParam *iObjParams,
 		return ErrorMsg;
 	}
 
-	// Step 2. Make sure none of the root bones inherit from each other.
+	// Step 3. Make sure none of the root bones inherit from each other.
 
 	if (BonesNonExclusive(rootbones, rootcount)) return ErrorMsg;
 
-	// Step 3. Build the Cal3D skeleton from the MAX bones.
+	// Step 4. Build the Cal3D skeleton from the MAX bones.
 
 	int t = iObjParams->GetTime();
 	CalCoreModel coreModel;
@@ -751,7 +752,31 @@ wchar_t *CalExportModel(IObjParam *iObjParams,
 		meshcount, meshes, 1);
 	if (!ok) { coreModel.destroy(); return ErrorMsg; }
 
-	// Step 4. Export the Cal3D model to the file.
+	// Step 6. Generate the progressive mesh LOD.
+
+	if (conf_progmesh) {
+		CalLodBuilder lodBuilder;
+		if (!lodBuilder.buildCoreModel(&coreModel)) {
+			swprintf(ErrorMsg, L"Cal3D could not build the progressive mesh for %s", conf_filename);
+			coreModel.destroy();
+			return ErrorMsg;
+		}
+	}
+
+	// Step 7. Reorder faces and vertices for the vertex cache.  The model
+	// file keeps this order; the faces of the reduced LOD steps are rebuilt
+	// in collapse order when the model is loaded.
+
+	if (conf_optimize) {
+		CalMeshOptimizer meshOptimizer;
+		if (!meshOptimizer.optimizeCoreModel(&coreModel)) {
+			swprintf(ErrorMsg, L"Cal3D could not optimize the mesh for %s", conf_filename);
+			coreModel.destroy();
+			return ErrorMsg;
+		}
+	}
+
+	// Step 8. Export the Cal3D model to the file.
 
 	CalSaver saver;
 	//std::stringstream ss;
@@ -763,7 +788,7 @@ wchar_t *CalExportModel(IObjParam *iObjParams,
 		return ErrorMsg;
 	}
 
-	// Step 6. Clean up everything.
+	// Step 9. Clean up everything.
 
 	coreModel.destroy();
 	return 0;
@@ -11,6 +11,7 @@
 wchar_t *CalExportModel(IObjParam *iobjparams,
 	wchar_t   *conf_filename,
 	bool    conf_progmesh,
+	bool    conf_optimize,
 	bool    conf_springsys,
 	int    *conf_bumpid,
 	int    *conf_bumpmap,
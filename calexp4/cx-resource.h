@@ -19,6 +19,7 @@
 #define IDC_SPRINGSYS                   1014
 #define IDC_USEMATNAME                  1015
 #define IDC_IGNOREMAT                   1015
+#define IDC_OPTIMIZE                    1016
 #define IDC_TI_POSX                     3019
 #define IDC_TI_POSXSPIN                 3020
 #define IDC_TI_POSY                     3021
@@ -0,0 +1,241 @@
+//****************************************************************************//
+// ct-archive.cpp                                                             //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  const int BLOB_COUNT = 40;
+
+  std::vector<char> readFile(const std::string& strFilename)
+  {
+    std::ifstream file(strFilename.c_str(), std::ios::in | std::ios::binary);
+    return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  }
+
+  void writeFile(const std::string& strFilename, const std::vector<char>& vectorData)
+  {
+    std::ofstream file(strFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!vectorData.empty()) file.write(&vectorData[0], vectorData.size());
+  }
+
+  std::vector<char> makeBlob(int blobId)
+  {
+    std::vector<char> vectorBlob(1 + (blobId * 37) % 101);
+    for(size_t byteId = 0; byteId < vectorBlob.size(); byteId++) vectorBlob[byteId] = (char)(blobId * 13 + byteId);
+    return vectorBlob;
+  }
+
+  std::string getBlobName(int blobId)
+  {
+    char strName[32];
+    std::sprintf(strName, "blobs/blob%d.bin", blobId);
+    return strName;
+  }
+
+  /// Returns true if an archive with the given bytes opens.
+  bool opens(const std::vector<char>& vectorData)
+  {
+    std::string strFilename = ctTempFilename("corrupt.car");
+    writeFile(strFilename, vectorData);
+
+    CalArchive archive;
+    bool bOpened = archive.create(strFilename);
+    if(!bOpened) CT_CHECK((CalError::getLastErrorCode() == CalError::INVALID_FILE_FORMAT) || (CalError::getLastErrorCode() == CalError::INCOMPATIBLE_FILE_VERSION));
+    archive.destroy();
+
+    std::remove(strFilename.c_str());
+    return bOpened;
+  }
+
+  unsigned int *getHeaderField(std::vector<char>& vectorData, size_t offset)
+  {
+    return (unsigned int *)(&vectorData[0] + offset);
+  }
+
+  CalArchiveFile::Entry *getEntry(std::vector<char>& vectorData, int entryId)
+  {
+    const CalArchiveFile::Header *pHeader = (const CalArchiveFile::Header *)&vectorData[0];
+    size_t offset = sizeof(CalArchiveFile::Header) + (pHeader->bucketCount + 1) * sizeof(unsigned int);
+    return (CalArchiveFile::Entry *)(&vectorData[0] + offset) + entryId;
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// The entries of an archive must come back by name, and the core models and
+// core animations in it must load like from their own files.
+CT_TEST(archiveRoundTrip)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 8);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(2.0f, 8);
+
+  std::string strModelFilename = ctTempFilename("archived.cdf");
+  std::string strAnimationFilename = ctTempFilename("archived.caf");
+  std::string strFilename = ctTempFilename("assets.car");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strModelFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreAnimation(strAnimationFilename, pCoreAnimation));
+
+  CalArchiveBuilder archiveBuilder;
+  CT_CHECK(archiveBuilder.addFile("model.cdf", strModelFilename));
+  CT_CHECK(archiveBuilder.addFile("walk.caf", strAnimationFilename));
+  int blobId;
+  for(blobId = 0; blobId < BLOB_COUNT; blobId++)
+  {
+    std::vector<char> vectorBlob = makeBlob(blobId);
+    CT_CHECK(archiveBuilder.addEntry(getBlobName(blobId), &vectorBlob[0], (int)vectorBlob.size()));
+  }
+  CT_CHECK(!archiveBuilder.addEntry("walk.caf", "x", 1));
+  CT_CHECK(archiveBuilder.getEntryCount() == BLOB_COUNT + 2);
+  CT_CHECK(archiveBuilder.save(strFilename));
+
+  CalArchive archive;
+  CT_CHECK(archive.create(strFilename));
+  CT_CHECK(archive.getEntryCount() == BLOB_COUNT + 2);
+  CT_CHECK(archive.findEntry("missing.bin") == -1);
+  CT_CHECK(archive.findEntry("blobs/blob") == -1);
+
+  for(blobId = 0; blobId < BLOB_COUNT; blobId++)
+  {
+    std::vector<char> vectorBlob = makeBlob(blobId);
+    int entryId = archive.findEntry(getBlobName(blobId));
+    CT_CHECK(entryId != -1);
+    if(entryId == -1) continue;
+
+    CT_CHECK(archive.getEntryName(entryId) == getBlobName(blobId));
+    CT_CHECK(archive.getEntrySize(entryId) == (int)vectorBlob.size());
+    CT_CHECK(std::memcmp(archive.getEntryData(entryId), &vectorBlob[0], vectorBlob.size()) == 0);
+  }
+
+  std::vector<char> vectorModel = readFile(strModelFilename);
+  int modelEntryId = archive.findEntry("model.cdf");
+  CT_CHECK(archive.getEntrySize(modelEntryId) == (int)vectorModel.size());
+
+  CalCoreModel coreModel;
+  coreModel.create("archived");
+  CT_CHECK(archive.loadCoreModel(&coreModel, "model.cdf"));
+  CT_CHECK(ctSameCoreModel(pCoreModel, &coreModel));
+
+  CalCoreAnimation coreAnimation;
+  CT_CHECK(archive.loadCoreAnimation(&coreAnimation, "walk.caf"));
+  CT_CHECK(ctSameCoreAnimation(pCoreAnimation, &coreAnimation));
+
+  CT_CHECK(!archive.loadCoreModel(&coreModel, "missing.cdf"));
+  CT_CHECK(CalError::getLastErrorCode() == CalError::FILE_NOT_FOUND);
+
+  coreAnimation.destroy();
+  coreModel.destroy();
+  archive.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strFilename.c_str());
+  std::remove(strAnimationFilename.c_str());
+  std::remove(strModelFilename.c_str());
+}
+
+// An archive whose table of contents is cut off or points outside the file
+// must not open.
+CT_TEST(corruptArchivesDoNotOpen)
+{
+  std::string strFilename = ctTempFilename("valid.car");
+  CalArchiveBuilder archiveBuilder;
+  for(int blobId = 0; blobId < BLOB_COUNT; blobId++)
+  {
+    std::vector<char> vectorBlob = makeBlob(blobId);
+    archiveBuilder.addEntry(getBlobName(blobId), &vectorBlob[0], (int)vectorBlob.size());
+  }
+  CT_CHECK(archiveBuilder.save(strFilename));
+
+  const std::vector<char> vectorValid = readFile(strFilename);
+  std::remove(strFilename.c_str());
+  CT_CHECK(opens(vectorValid));
+
+  const CalArchiveFile::Header& header = *(const CalArchiveFile::Header *)&vectorValid[0];
+  size_t entryTableOffset = sizeof(CalArchiveFile::Header) + (header.bucketCount + 1) * sizeof(unsigned int);
+  size_t nameOffset = entryTableOffset + header.entryCount * sizeof(CalArchiveFile::Entry);
+
+  // cut off in the header, the bucket table, the entry table, the names and the payloads
+  size_t arrayCut[] = { sizeof(CalArchiveFile::Header) - 1, entryTableOffset - 4, nameOffset - 8, nameOffset + header.nameSize - 1, vectorValid.size() - 1 };
+  for(size_t cutId = 0; cutId < sizeof(arrayCut) / sizeof(arrayCut[0]); cutId++)
+  {
+    std::vector<char> vectorData(vectorValid.begin(), vectorValid.begin() + arrayCut[cutId]);
+    CT_CHECK(!opens(vectorData));
+  }
+
+  std::vector<char> vectorData = vectorValid;
+  vectorData[0] ^= 0x20;
+  CT_CHECK(!opens(vectorData));
+
+  vectorData = vectorValid;
+  (*getHeaderField(vectorData, offsetof(CalArchiveFile::Header, version)))++;
+  CT_CHECK(!opens(vectorData));
+
+  // tables larger than the file
+  vectorData = vectorValid;
+  *getHeaderField(vectorData, offsetof(CalArchiveFile::Header, bucketCount)) = 0x40000000;
+  CT_CHECK(!opens(vectorData));
+
+  vectorData = vectorValid;
+  *getHeaderField(vectorData, offsetof(CalArchiveFile::Header, entryCount)) = 0x10000000;
+  CT_CHECK(!opens(vectorData));
+
+  vectorData = vectorValid;
+  *getHeaderField(vectorData, offsetof(CalArchiveFile::Header, bucketCount)) = 0;
+  CT_CHECK(!opens(vectorData));
+
+  // buckets that do not partition the entries
+  vectorData = vectorValid;
+  *getHeaderField(vectorData, sizeof(CalArchiveFile::Header)) = 1;
+  CT_CHECK(!opens(vectorData));
+
+  vectorData = vectorValid;
+  *getHeaderField(vectorData, entryTableOffset - sizeof(unsigned int)) = header.entryCount + 1;
+  CT_CHECK(!opens(vectorData));
+
+  // entries in the wrong bucket or with names and payloads outside the file
+  vectorData = vectorValid;
+  getEntry(vectorData, 0)->hash++;
+  CT_CHECK(!opens(vectorData));
+
+  vectorData = vectorValid;
+  getEntry(vectorData, 0)->nameOffset = header.nameSize;
+  CT_CHECK(!opens(vectorData));
+
+  vectorData = vectorValid;
+  getEntry(vectorData, 1)->offset = (unsigned int)vectorValid.size();
+  CT_CHECK(!opens(vectorData));
+
+  vectorData = vectorValid;
+  getEntry(vectorData, 2)->size = 0xfffffff0u;
+  CT_CHECK(!opens(vectorData));
+
+  vectorData = vectorValid;
+  getEntry(vectorData, 3)->offset = 0xfffffff0u;
+  CT_CHECK(!opens(vectorData));
+}
+
+//****************************************************************************//
@@ -0,0 +1,193 @@
+//****************************************************************************//
+// ct-arena.cpp                                                               //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <cstdio>
+#include <cstring>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  const int ALLOCATION_COUNT = 3000;
+
+  /// An object that counts its constructions and destructions.
+  struct Counted
+  {
+    static int constructionCount;
+    static int destructionCount;
+
+    double value[3];
+
+    Counted() { constructionCount++; }
+    ~Counted() { destructionCount++; }
+  };
+
+  int Counted::constructionCount = 0;
+  int Counted::destructionCount = 0;
+
+  struct Allocation
+  {
+    unsigned char *pData;
+    size_t size;
+  };
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// An arena must hand out aligned memory that does not overlap, own exactly
+// what it handed out, and run the destructors of released objects once.
+CT_TEST(arenaAllocatesAndReleases)
+{
+  CalArena arena;
+  CT_CHECK(arena.getCapacity() == 0);
+
+  std::vector<Allocation> vectorAllocation;
+  size_t size = 0;
+  int allocationId;
+  for(allocationId = 0; allocationId < ALLOCATION_COUNT; allocationId++)
+  {
+    Allocation allocation;
+    allocation.size = 1 + (allocationId * 37) % 300;
+    if(allocationId % 500 == 499) allocation.size = 3 * CalArena::MIN_BLOCK_SIZE;
+    size_t alignment = (size_t)1 << (allocationId % 7);
+
+    allocation.pData = (unsigned char *)arena.allocate(allocation.size, alignment);
+    CT_CHECK(allocation.pData != 0);
+    CT_CHECK(((size_t)allocation.pData & (alignment - 1)) == 0);
+    CT_CHECK(arena.owns(allocation.pData) && arena.owns(allocation.pData + allocation.size - 1));
+    std::memset(allocation.pData, allocationId & 0xff, allocation.size);
+
+    vectorAllocation.push_back(allocation);
+    size += allocation.size;
+  }
+  CT_CHECK(arena.getSize() == size);
+  CT_CHECK(arena.getCapacity() >= size);
+
+  // nothing was overwritten by a later allocation
+  for(allocationId = 0; allocationId < ALLOCATION_COUNT; allocationId++)
+  {
+    const Allocation& allocation = vectorAllocation[allocationId];
+    for(size_t byteId = 0; byteId < allocation.size; byteId++)
+    {
+      if(allocation.pData[byteId] != (allocationId & 0xff))
+      {
+        CT_CHECK(allocation.pData[byteId] == (allocationId & 0xff));
+        break;
+      }
+    }
+  }
+
+  // a reservation keeps the next allocations in one block
+  CT_CHECK(arena.reserve(100 * sizeof(Counted)));
+  std::vector<Counted *> vectorCounted;
+  for(allocationId = 0; allocationId < 100; allocationId++) vectorCounted.push_back(CalArena::construct<Counted>(&arena));
+  for(allocationId = 1; allocationId < 100; allocationId++) CT_CHECK(vectorCounted[allocationId] == vectorCounted[allocationId - 1] + 1);
+  CT_CHECK(Counted::constructionCount == 100);
+
+  // heap objects can be mixed with arena objects
+  Counted *pCounted = CalArena::construct<Counted>(0);
+  CT_CHECK(!arena.owns(pCounted));
+  int value;
+  CT_CHECK(!arena.owns(&value));
+  vectorCounted.push_back(pCounted);
+
+  for(size_t countedId = 0; countedId < vectorCounted.size(); countedId++) CalArena::release(&arena, vectorCounted[countedId]);
+  CT_CHECK(Counted::destructionCount == 101);
+
+  // swapping moves the memory, clearing frees it
+  CalArena arenaSwapped;
+  size_t capacity = arena.getCapacity();
+  arenaSwapped.swap(arena);
+  CT_CHECK(arena.getCapacity() == 0);
+  CT_CHECK(arenaSwapped.getCapacity() == capacity);
+  CT_CHECK(arenaSwapped.owns(vectorAllocation[0].pData) && !arena.owns(vectorAllocation[0].pData));
+
+  arenaSwapped.clear();
+  CT_CHECK(arenaSwapped.getCapacity() == 0);
+  CT_CHECK(arenaSwapped.getSize() == 0);
+  CT_CHECK(!arenaSwapped.owns(vectorAllocation[0].pData));
+}
+
+// Loaded core models and core animations must place their parts in their
+// arenas, and take heap parts added after loading as well.
+CT_TEST(loadedAssetsUseArenas)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(2000, 8);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(4.0f, 8);
+
+  std::string strModelFilename = ctTempFilename("arena.cdf");
+  std::string strAnimationFilename = ctTempFilename("arena.caf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strModelFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreAnimation(strAnimationFilename, pCoreAnimation));
+
+  CalLoader loader;
+  for(int loadId = 0; loadId < 3; loadId++)
+  {
+    CalCoreAnimation coreAnimation;
+    CT_CHECK(loader.loadCoreAnimation(&coreAnimation, strAnimationFilename));
+    CT_CHECK(ctSameCoreAnimation(pCoreAnimation, &coreAnimation));
+
+    std::list<CalCoreTrack *>& listCoreTrack = coreAnimation.getListCoreTrack();
+    CalArena *pArena = listCoreTrack.front()->getKeyframeArena();
+    CT_CHECK((pArena != 0) && (pArena->getSize() > 0));
+    if(pArena == 0) break;
+
+    std::list<CalCoreTrack *>::iterator iteratorCoreTrack;
+    for(iteratorCoreTrack = listCoreTrack.begin(); iteratorCoreTrack != listCoreTrack.end(); ++iteratorCoreTrack)
+    {
+      CT_CHECK(pArena->owns(*iteratorCoreTrack));
+      CT_CHECK(pArena->owns((*iteratorCoreTrack)->getMapCoreKeyframe().begin()->second));
+    }
+
+    // parts from the heap are freed with the rest
+    CalCoreTrack *pCoreTrack = new CalCoreTrack();
+    pCoreTrack->create();
+    pCoreTrack->setCoreBoneName("bone7");
+    CalCoreKeyframe *pCoreKeyframe = new CalCoreKeyframe();
+    pCoreKeyframe->create();
+    pCoreKeyframe->setTime(0.0f);
+    pCoreTrack->addCoreKeyframe(pCoreKeyframe);
+    coreAnimation.addCoreTrack(pCoreTrack);
+
+    pCoreKeyframe = new CalCoreKeyframe();
+    pCoreKeyframe->create();
+    pCoreKeyframe->setTime(coreAnimation.getDuration() + 1.0f);
+    listCoreTrack.front()->addCoreKeyframe(pCoreKeyframe);
+
+    coreAnimation.destroy();
+    CT_CHECK(pArena->getCapacity() == 0);
+
+    CalCoreModel coreModel;
+    coreModel.create("arena");
+    CT_CHECK(loader.loadCoreModel(&coreModel, strModelFilename));
+    CT_CHECK(ctSameCoreModel(pCoreModel, &coreModel));
+    CT_CHECK(coreModel.getMemorySize() > 0);
+    CT_CHECK(coreModel.addCoreSubmesh() == coreModel.getCoreSubmeshCount() - 1);
+    coreModel.destroy();
+  }
+
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strAnimationFilename.c_str());
+  std::remove(strModelFilename.c_str());
+}
+
+//****************************************************************************//
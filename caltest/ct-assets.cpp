@@ -0,0 +1,445 @@
+//****************************************************************************//
+// ct-assets.cpp                                                              //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  const int BONE_COUNT = 8;
+
+  /// A small random number generator, so the assets are the same everywhere.
+  struct Random
+  {
+    unsigned int state;
+
+    Random(unsigned int seed) : state(seed) {}
+
+    float next()
+    {
+      state = state * 1664525u + 1013904223u;
+      return (float)(state >> 8) / (float)(1 << 24);
+    }
+  };
+
+  template<typename T>
+  bool sameVector(const std::vector<T>& vectorA, const std::vector<T>& vectorB)
+  {
+    if(vectorA.size() != vectorB.size()) return false;
+    return vectorA.empty() || (std::memcmp(&vectorA[0], &vectorB[0], vectorA.size() * sizeof(T)) == 0);
+  }
+
+  bool springLess(const CalCoreSubmesh::Spring& springA, const CalCoreSubmesh::Spring& springB)
+  {
+    if(springA.vertexId[0] != springB.vertexId[0]) return springA.vertexId[0] < springB.vertexId[0];
+    return springA.vertexId[1] < springB.vertexId[1];
+  }
+
+  /// Adds a submesh whose vertices have zero to five influences. Every third
+  /// vertex repeats the position and influences of an earlier one, like the
+  /// duplicates the exporter writes along texture seams, and the vertices
+  /// collapse back to front for the lod levels.
+  void addSkinnedSubmesh(CalCoreModel *pCoreModel, int vertexCount)
+  {
+    CalCoreSubmesh *pCoreSubmesh = pCoreModel->getCoreSubmesh(pCoreModel->addCoreSubmesh());
+    pCoreSubmesh->resize(vertexCount, 1, vertexCount / 3, 0);
+
+    Random random(7);
+    std::vector<CalVector> vectorPosition(vertexCount);
+    std::vector<CalCoreSubmesh::Influence>& vectorInfluence = pCoreSubmesh->getVectorInfluence();
+    for(int vertexId = 0; vertexId < vertexCount; vertexId++)
+    {
+      int sourceId = ((vertexId % 3 == 2) && (vertexId > 10)) ? vertexId - 10 : vertexId;
+      if(sourceId == vertexId) vectorPosition[vertexId] = CalVector(random.next(), random.next(), random.next());
+      else vectorPosition[vertexId] = vectorPosition[sourceId];
+
+      pCoreSubmesh->setVertex(vertexId, vectorPosition[vertexId], CalVector(0.0f, 0.6f, (vertexId % 2) ? 0.8f : -0.8f));
+
+      int influenceCount = (sourceId % 7 == 0) ? 0 : 1 + (sourceId * sourceId) % 4;
+      if(sourceId % 13 == 0) influenceCount = 5;
+      pCoreSubmesh->setInfluenceCount(vertexId, influenceCount);
+
+      float totalWeight = 0.0f;
+      for(int influenceId = 0; influenceId < influenceCount; influenceId++) totalWeight += 1.0f + (sourceId * 7 + influenceId * 3) % 5;
+      for(int influenceId = 0; influenceId < influenceCount; influenceId++)
+      {
+        CalCoreSubmesh::Influence influence;
+        influence.boneId = (sourceId + influenceId * 3) % BONE_COUNT;
+        influence.weight = (1.0f + (sourceId * 7 + influenceId * 3) % 5) / totalWeight;
+        vectorInfluence.push_back(influence);
+      }
+
+      CalCoreSubmesh::TextureCoordinate textureCoordinate;
+      textureCoordinate.u = random.next();
+      textureCoordinate.v = random.next();
+      pCoreSubmesh->setTextureCoordinate(vertexId, 0, textureCoordinate);
+
+      // collapsing the last vertex of a face removes the face
+      pCoreSubmesh->setLodControl(vertexId, (vertexId % 3 == 2) ? 1 : 0, (vertexId >= 3) ? vertexId - 3 : -1);
+    }
+    pCoreSubmesh->setLodCount(vertexCount - 3);
+
+    for(int faceId = 0; faceId < vertexCount / 3; faceId++)
+    {
+      CalCoreSubmesh::Face face = { { faceId * 3, faceId * 3 + 1, faceId * 3 + 2 } };
+      pCoreSubmesh->setFace(faceId, face);
+    }
+
+    pCoreSubmesh->enableTangents(0, true);
+  }
+
+  /// Adds a square of cloth hanging from its first row, which follows a bone.
+  void addClothSubmesh(CalCoreModel *pCoreModel, int clothSize)
+  {
+    int vertexCount = clothSize * clothSize;
+    int springCount = 2 * clothSize * (clothSize - 1) + 2 * (clothSize - 1) * (clothSize - 1);
+
+    CalCoreSubmesh *pCoreSubmesh = pCoreModel->getCoreSubmesh(pCoreModel->addCoreSubmesh());
+    pCoreSubmesh->resize(vertexCount, 0, 2 * (clothSize - 1) * (clothSize - 1), springCount);
+
+    std::vector<CalCoreSubmesh::Influence>& vectorInfluence = pCoreSubmesh->getVectorInfluence();
+    for(int vertexId = 0; vertexId < vertexCount; vertexId++)
+    {
+      int x = vertexId % clothSize;
+      int y = vertexId / clothSize;
+      pCoreSubmesh->setVertex(vertexId, CalVector(x * 0.1f, 0.0f, -y * 0.1f), CalVector(0.0f, 1.0f, 0.0f));
+      pCoreSubmesh->setInfluenceCount(vertexId, 1);
+
+      CalCoreSubmesh::Influence influence;
+      influence.boneId = 1;
+      influence.weight = 1.0f;
+      vectorInfluence.push_back(influence);
+
+      CalCoreSubmesh::PhysicalProperty physicalProperty;
+      physicalProperty.weight = (y == 0) ? 0.0f : 1.0f;
+      pCoreSubmesh->setPhysicalProperty(vertexId, physicalProperty);
+      pCoreSubmesh->setLodControl(vertexId, 0, -1);
+    }
+
+    int springId = 0;
+    int faceId = 0;
+    for(int y = 0; y < clothSize; y++)
+    {
+      for(int x = 0; x < clothSize; x++)
+      {
+        int vertexId = y * clothSize + x;
+        CalCoreSubmesh::Spring spring;
+        spring.springCoefficient = 1.0f;
+
+        spring.idleLength = 0.1f;
+        if(x + 1 < clothSize) { spring.vertexId[0] = vertexId; spring.vertexId[1] = vertexId + 1; pCoreSubmesh->setSpring(springId++, spring); }
+        if(y + 1 < clothSize) { spring.vertexId[0] = vertexId; spring.vertexId[1] = vertexId + clothSize; pCoreSubmesh->setSpring(springId++, spring); }
+
+        if((x + 1 < clothSize) && (y + 1 < clothSize))
+        {
+          spring.idleLength = 0.1414f;
+          spring.vertexId[0] = vertexId; spring.vertexId[1] = vertexId + clothSize + 1; pCoreSubmesh->setSpring(springId++, spring);
+          spring.vertexId[0] = vertexId + 1; spring.vertexId[1] = vertexId + clothSize; pCoreSubmesh->setSpring(springId++, spring);
+
+          CalCoreSubmesh::Face face0 = { { vertexId, vertexId + 1, vertexId + clothSize } };
+          CalCoreSubmesh::Face face1 = { { vertexId + 1, vertexId + clothSize + 1, vertexId + clothSize } };
+          pCoreSubmesh->setFace(faceId++, face0);
+          pCoreSubmesh->setFace(faceId++, face1);
+        }
+      }
+    }
+  }
+}
+
+//****************************************************************************//
+// Test assets                                                                //
+//****************************************************************************//
+
+ /*****************************************************************************/
+/** Builds a core model.
+  *
+  * This function builds a core model with a tree of eight bones, a skinned
+  * submesh and a piece of cloth, and prepares its submeshes like the loader.
+  *
+  * @param vertexCount The number of vertices of the skinned submesh, or 0 for
+  *                    none.
+  * @param clothSize The number of vertices along each side of the cloth, or 0
+  *                  for none.
+  *
+  * @return The core model, to be freed with ctFreeCoreModel().
+  *****************************************************************************/
+
+CalCoreModel *ctMakeCoreModel(int vertexCount, int clothSize)
+{
+  CalCoreModel *pCoreModel = new CalCoreModel();
+  pCoreModel->create("caltest");
+
+  for(int boneId = 0; boneId < BONE_COUNT; boneId++)
+  {
+    char strName[16];
+    std::sprintf(strName, "bone%d", boneId);
+    pCoreModel->addCoreBone(strName);
+
+    CalCoreBone *pCoreBone = pCoreModel->getCoreBone(boneId);
+    int parentId = (boneId == 0) ? -1 : (boneId - 1) / 2;
+    pCoreBone->setParentId(parentId);
+    if(parentId != -1) pCoreModel->getCoreBone(parentId)->addChildId(boneId);
+
+    pCoreBone->setLength(0.1f);
+    pCoreBone->setTranslation(CalVector(0.1f * boneId, 0.2f, 0.3f));
+    pCoreBone->setRotation(CalQuaternion(0.1f * boneId, 0.2f, 0.05f, 0.97f));
+    pCoreBone->setTranslationBoneSpace(CalVector(-0.1f, 0.0f, 0.05f * boneId));
+    pCoreBone->setRotationBoneSpace(CalQuaternion(0.0f, 0.0f, 0.0f, 1.0f));
+  }
+  pCoreModel->calculateState();
+
+  if(vertexCount > 0) addSkinnedSubmesh(pCoreModel, vertexCount);
+  if(clothSize > 0) addClothSubmesh(pCoreModel, clothSize);
+
+  for(int submeshId = 0; submeshId < pCoreModel->getCoreSubmeshCount(); submeshId++)
+  {
+    CalCoreSubmesh *pCoreSubmesh = pCoreModel->getCoreSubmesh(submeshId);
+    pCoreSubmesh->analyzeInfluences();
+    pCoreSubmesh->buildLodSteps(CalCoreSubmesh::DEFAULT_LOD_STEP_COUNT);
+    pCoreSubmesh->buildSpringBatches();
+  }
+
+  return pCoreModel;
+}
+
+ /*****************************************************************************/
+/** Builds a core animation.
+  *
+  * This function builds a core animation for the bones of ctMakeCoreModel().
+  * The tracks mix steady keyframes at 30 frames per second, tracks that start
+  * late, sparse tracks and tracks with random gaps.
+  *
+  * @param duration The duration in seconds.
+  * @param trackCount The number of tracks, at most one per bone is bound.
+  *
+  * @return The core animation, to be freed with ctFreeCoreAnimation().
+  *****************************************************************************/
+
+CalCoreAnimation *ctMakeCoreAnimation(float duration, int trackCount)
+{
+  CalCoreAnimation *pCoreAnimation = new CalCoreAnimation();
+  pCoreAnimation->create("caltest");
+  pCoreAnimation->setDuration(duration);
+
+  Random random(11);
+  for(int trackId = 0; trackId < trackCount; trackId++)
+  {
+    CalCoreTrack *pCoreTrack = new CalCoreTrack();
+    pCoreTrack->create();
+
+    char strName[16];
+    std::sprintf(strName, "bone%d", trackId);
+    pCoreTrack->setCoreBoneName(strName);
+
+    int mode = trackId % 4;
+    float time = (mode == 1) ? 0.37f : 0.0f;
+    while(time <= duration)
+    {
+      CalCoreKeyframe *pCoreKeyframe = new CalCoreKeyframe();
+      pCoreKeyframe->create();
+      pCoreKeyframe->setTime(time);
+      pCoreKeyframe->setOrientation(CalVector(0.1f * trackId + 0.05f * random.next(), 0.2f, 0.3f));
+
+      CalQuaternion rotation(0.3f * random.next(), 0.3f * random.next(), 0.3f * random.next(), 1.0f);
+      float length = std::sqrt(rotation.x * rotation.x + rotation.y * rotation.y + rotation.z * rotation.z + rotation.w * rotation.w);
+      pCoreKeyframe->setRotation(CalQuaternion(rotation.x / length, rotation.y / length, rotation.z / length, rotation.w / length));
+      pCoreTrack->addCoreKeyframe(pCoreKeyframe);
+
+      if(mode == 2) time += 5.3f;
+      else if(mode == 3) time += 0.1f * random.next() + 0.001f;
+      else time += 1.0f / 30.0f;
+    }
+
+    pCoreAnimation->addCoreTrack(pCoreTrack);
+  }
+
+  return pCoreAnimation;
+}
+
+void ctFreeCoreModel(CalCoreModel *pCoreModel)
+{
+  pCoreModel->destroy();
+  delete pCoreModel;
+}
+
+void ctFreeCoreAnimation(CalCoreAnimation *pCoreAnimation)
+{
+  pCoreAnimation->destroy();
+  delete pCoreAnimation;
+}
+
+ /*****************************************************************************/
+/** Compares two core models.
+  *
+  * @return \b true if the bones and submeshes are bit for bit the same.
+  *****************************************************************************/
+
+bool ctSameCoreModel(CalCoreModel *pCoreModelA, CalCoreModel *pCoreModelB)
+{
+  if(pCoreModelA->getCoreBoneCount() != pCoreModelB->getCoreBoneCount()) return false;
+  for(int boneId = 0; boneId < pCoreModelA->getCoreBoneCount(); boneId++)
+  {
+    CalCoreBone *pCoreBoneA = pCoreModelA->getCoreBone(boneId);
+    CalCoreBone *pCoreBoneB = pCoreModelB->getCoreBone(boneId);
+    if(pCoreBoneA->getNameId() != pCoreBoneB->getNameId()) return false;
+    if(pCoreBoneA->getParentId() != pCoreBoneB->getParentId()) return false;
+    if(pCoreBoneA->getListChildId() != pCoreBoneB->getListChildId()) return false;
+    if(std::memcmp(&pCoreBoneA->getTranslation(), &pCoreBoneB->getTranslation(), sizeof(CalVector)) != 0) return false;
+    if(std::memcmp(&pCoreBoneA->getRotation(), &pCoreBoneB->getRotation(), sizeof(CalQuaternion)) != 0) return false;
+  }
+
+  if(pCoreModelA->getCoreSubmeshCount() != pCoreModelB->getCoreSubmeshCount()) return false;
+  for(int submeshId = 0; submeshId < pCoreModelA->getCoreSubmeshCount(); submeshId++)
+  {
+    CalCoreSubmesh *pCoreSubmeshA = pCoreModelA->getCoreSubmesh(submeshId);
+    CalCoreSubmesh *pCoreSubmeshB = pCoreModelB->getCoreSubmesh(submeshId);
+    if(pCoreSubmeshA->getVertexCount() != pCoreSubmeshB->getVertexCount()) return false;
+    for(size_t vertexId = 0; vertexId < pCoreSubmeshA->getVertexCount(); vertexId++)
+    {
+      const CalCoreSubmesh::Vertex& vertexA = pCoreSubmeshA->getVectorVertex()[vertexId];
+      const CalCoreSubmesh::Vertex& vertexB = pCoreSubmeshB->getVectorVertex()[vertexId];
+      if(std::memcmp(&vertexA.position, &vertexB.position, sizeof(CalVector)) != 0) return false;
+      if((vertexA.nx != vertexB.nx) || (vertexA.ny != vertexB.ny) || (vertexA.nz != vertexB.nz)) return false;
+      if(vertexA.influenceCount != vertexB.influenceCount) return false;
+    }
+
+    if(!sameVector(pCoreSubmeshA->getVectorFace(), pCoreSubmeshB->getVectorFace())) return false;
+    if(!sameVector(pCoreSubmeshA->getVectorInfluence(), pCoreSubmeshB->getVectorInfluence())) return false;
+    if(!sameVector(pCoreSubmeshA->getVectorPhysicalProperty(), pCoreSubmeshB->getVectorPhysicalProperty())) return false;
+
+    // the loader sorts the springs into batches again, so compare them as sets
+    std::vector<CalCoreSubmesh::Spring> vectorSpringA = pCoreSubmeshA->getVectorSpring();
+    std::vector<CalCoreSubmesh::Spring> vectorSpringB = pCoreSubmeshB->getVectorSpring();
+    std::sort(vectorSpringA.begin(), vectorSpringA.end(), springLess);
+    std::sort(vectorSpringB.begin(), vectorSpringB.end(), springLess);
+    if(!sameVector(vectorSpringA, vectorSpringB)) return false;
+
+    std::vector<CalCoreSubmesh::LodControl>& vectorLodControlA = pCoreSubmeshA->getVectorLodControl();
+    std::vector<CalCoreSubmesh::LodControl>& vectorLodControlB = pCoreSubmeshB->getVectorLodControl();
+    if(vectorLodControlA.size() != vectorLodControlB.size()) return false;
+    for(size_t vertexId = 0; vertexId < vectorLodControlA.size(); vertexId++)
+    {
+      if(vectorLodControlA[vertexId].faceCollapseCount != vectorLodControlB[vertexId].faceCollapseCount) return false;
+      if(vectorLodControlA[vertexId].collapseId != vectorLodControlB[vertexId].collapseId) return false;
+    }
+
+    size_t textureCoordinateCount = pCoreSubmeshA->getVectorVectorTextureCoordinate().size();
+    if(textureCoordinateCount != pCoreSubmeshB->getVectorVectorTextureCoordinate().size()) return false;
+    for(size_t textureCoordinateId = 0; textureCoordinateId < textureCoordinateCount; textureCoordinateId++)
+    {
+      if(!sameVector(pCoreSubmeshA->getVectorVectorTextureCoordinate()[textureCoordinateId], pCoreSubmeshB->getVectorVectorTextureCoordinate()[textureCoordinateId])) return false;
+    }
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Compares two core animations.
+  *
+  * @return \b true if the tracks and keyframes are bit for bit the same.
+  *****************************************************************************/
+
+bool ctSameCoreAnimation(CalCoreAnimation *pCoreAnimationA, CalCoreAnimation *pCoreAnimationB)
+{
+  if(pCoreAnimationA->getDuration() != pCoreAnimationB->getDuration()) return false;
+
+  std::list<CalCoreTrack *>& listCoreTrackA = pCoreAnimationA->getListCoreTrack();
+  std::list<CalCoreTrack *>& listCoreTrackB = pCoreAnimationB->getListCoreTrack();
+  if(listCoreTrackA.size() != listCoreTrackB.size()) return false;
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrackB = listCoreTrackB.begin();
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrackA;
+  for(iteratorCoreTrackA = listCoreTrackA.begin(); iteratorCoreTrackA != listCoreTrackA.end(); ++iteratorCoreTrackA, ++iteratorCoreTrackB)
+  {
+    if((*iteratorCoreTrackA)->getCoreBoneNameId() != (*iteratorCoreTrackB)->getCoreBoneNameId()) return false;
+
+    std::map<float, CalCoreKeyframe *>& mapCoreKeyframeA = (*iteratorCoreTrackA)->getMapCoreKeyframe();
+    std::map<float, CalCoreKeyframe *>& mapCoreKeyframeB = (*iteratorCoreTrackB)->getMapCoreKeyframe();
+    if(mapCoreKeyframeA.size() != mapCoreKeyframeB.size()) return false;
+
+    std::map<float, CalCoreKeyframe *>::iterator iteratorCoreKeyframeB = mapCoreKeyframeB.begin();
+    std::map<float, CalCoreKeyframe *>::iterator iteratorCoreKeyframeA;
+    for(iteratorCoreKeyframeA = mapCoreKeyframeA.begin(); iteratorCoreKeyframeA != mapCoreKeyframeA.end(); ++iteratorCoreKeyframeA, ++iteratorCoreKeyframeB)
+    {
+      if(iteratorCoreKeyframeA->first != iteratorCoreKeyframeB->first) return false;
+      if(std::memcmp(&iteratorCoreKeyframeA->second->getOrientation(), &iteratorCoreKeyframeB->second->getOrientation(), sizeof(CalVector)) != 0) return false;
+      if(std::memcmp(&iteratorCoreKeyframeA->second->getRotation(), &iteratorCoreKeyframeB->second->getRotation(), sizeof(CalQuaternion)) != 0) return false;
+    }
+  }
+
+  return true;
+}
+
+ /*****************************************************************************/
+/** Returns the largest difference between two sets of vectors.
+  *****************************************************************************/
+
+float ctMaxDifference(const std::vector<CalVector>& vectorA, const std::vector<CalVector>& vectorB)
+{
+  if(vectorA.size() != vectorB.size()) return 1e30f;
+
+  float maxDifference = 0.0f;
+  for(size_t id = 0; id < vectorA.size(); id++)
+  {
+    maxDifference = std::max(maxDifference, std::fabs(vectorA[id].x - vectorB[id].x));
+    maxDifference = std::max(maxDifference, std::fabs(vectorA[id].y - vectorB[id].y));
+    maxDifference = std::max(maxDifference, std::fabs(vectorA[id].z - vectorB[id].z));
+  }
+
+  return maxDifference;
+}
+
+ /*****************************************************************************/
+/** Poses a model.
+  *
+  * This function turns every bone of a model by an angle that depends on the
+  * frame and the bone, so each frame has a different pose.
+  *****************************************************************************/
+
+void ctPose(CalModel *pModel, int frame)
+{
+  pModel->clearState();
+  for(int boneId = 0; boneId < pModel->getBoneCount(); boneId++)
+  {
+    CalBone *pBone = pModel->getBone(boneId);
+    CalCoreBone *pCoreBone = pBone->getCoreBone();
+
+    float angle = 0.02f * frame * (1 + boneId % 3);
+    CalQuaternion rotation = pCoreBone->getRotation();
+    rotation *= CalQuaternion(std::sin(angle), 0.0f, 0.0f, std::cos(angle));
+    pBone->blendState(1.0f, pCoreBone->getTranslation(), rotation);
+  }
+  pModel->lockState();
+  pModel->calculateState();
+}
+
+ /*****************************************************************************/
+/** Returns the name of a file for the tests to write.
+  *****************************************************************************/
+
+std::string ctTempFilename(const std::string& strName)
+{
+  return "caltest-" + strName;
+}
+
+//****************************************************************************//
@@ -0,0 +1,193 @@
+//****************************************************************************//
+// ct-cache.cpp                                                               //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  const int REQUEST_THREAD_COUNT = 8;
+
+  bool copyFile(const std::string& strFilename, const std::string& strCopyFilename)
+  {
+    std::ifstream file(strFilename.c_str(), std::ios::in | std::ios::binary);
+    std::ofstream copy(strCopyFilename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    copy << file.rdbuf();
+    return file.good() && copy.good();
+  }
+
+  /// The asset one thread got from the cache.
+  struct RequestThread
+  {
+    CalAssetCache *pCache;
+    const std::string *pStrFilename;
+    CalCoreModel *pCoreModel;
+  };
+
+  void runRequestThread(RequestThread *pThread)
+  {
+    CalAssetCache::CoreModelHandle coreModelHandle = pThread->pCache->getCoreModel(*pThread->pStrFilename);
+    pThread->pCoreModel = coreModelHandle.get();
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// The asset cache must load a file once, share it under every path with the
+// same content and free it only when purged without handles left.
+CT_TEST(assetCacheSharesAssets)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(2000, 8);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(2.0f, 8);
+
+  std::string strModelFilename = ctTempFilename("cached.cdf");
+  std::string strCopyFilename = ctTempFilename("cached-copy.cdf");
+  std::string strAnimationFilename = ctTempFilename("cached.caf");
+  std::string strMissingFilename = ctTempFilename("missing.cdf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strModelFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreAnimation(strAnimationFilename, pCoreAnimation));
+  CT_CHECK(copyFile(strModelFilename, strCopyFilename));
+
+  CalCoreModel coreModel;
+  coreModel.create("loaded");
+  CalCoreAnimation coreAnimation;
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, strModelFilename));
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimation, strAnimationFilename));
+
+  CalAssetCache cache;
+  CT_CHECK(cache.create(0));
+
+  CalAssetCache::CoreModelHandle coreModelHandle = cache.getCoreModel(strModelFilename);
+  CT_CHECK(coreModelHandle.isValid());
+  CT_CHECK(ctSameCoreModel(&coreModel, coreModelHandle.get()));
+  CT_CHECK(cache.getCoreModel(strModelFilename).get() == coreModelHandle.get());
+  CT_CHECK(cache.getCoreModel(strCopyFilename).get() == coreModelHandle.get());
+  CT_CHECK(cache.getCoreModel(strCopyFilename).get() == coreModelHandle.get());
+
+  CalAssetCache::CoreAnimationHandle coreAnimationHandle = cache.getCoreAnimation(strAnimationFilename);
+  CT_CHECK(coreAnimationHandle.isValid());
+  CT_CHECK(ctSameCoreAnimation(&coreAnimation, coreAnimationHandle.get()));
+  CT_CHECK(coreAnimationHandle->getDuration() == coreAnimation.getDuration());
+
+  // failed loads are not cached
+  CT_CHECK(!cache.getCoreModel(strMissingFilename).isValid());
+  CT_CHECK(CalError::getLastErrorCode() == CalError::FILE_NOT_FOUND);
+  CT_CHECK(!cache.getCoreModel(strMissingFilename).isValid());
+
+  CalAssetCache::Statistics statistics = cache.getStatistics();
+  CT_CHECK(statistics.requestCount == 7);
+  CT_CHECK(statistics.loadCount == 2);
+  CT_CHECK(statistics.pathHitCount == 2);
+  CT_CHECK(statistics.contentHitCount == 1);
+  CT_CHECK(statistics.coalescedCount == 0);
+  CT_CHECK(statistics.failedCount == 2);
+  CT_CHECK(statistics.assetCount == 2);
+  CT_CHECK(statistics.referencedAssetCount == 2);
+  CT_CHECK(statistics.memorySize > 0);
+  CT_CHECK(cache.getHitRate() == 3.0f / 7.0f);
+
+  // copies hold references of their own
+  CalAssetCache::CoreModelHandle coreModelHandleCopy = coreModelHandle;
+  coreModelHandle.reset();
+  CT_CHECK(!coreModelHandle.isValid());
+  CalAssetCache::CoreModelHandle& coreModelHandleSame = coreModelHandleCopy;
+  coreModelHandleCopy = coreModelHandleSame;
+  CT_CHECK(coreModelHandleCopy.isValid());
+  coreAnimationHandle.reset();
+  CT_CHECK(cache.purge() == 1);
+  CT_CHECK(cache.getStatistics().assetCount == 1);
+
+  coreModelHandleCopy.reset();
+  CT_CHECK(cache.getStatistics().referencedAssetCount == 0);
+  CT_CHECK(cache.getStatistics().assetCount == 1);
+  CT_CHECK(cache.purge() == 1);
+  CT_CHECK(cache.getStatistics().assetCount == 0);
+  CT_CHECK(cache.getStatistics().memorySize == 0);
+
+  // purged assets are loaded again
+  cache.resetStatistics();
+  coreModelHandle = cache.getCoreModel(strCopyFilename);
+  CT_CHECK(ctSameCoreModel(&coreModel, coreModelHandle.get()));
+  CT_CHECK(cache.getStatistics().loadCount == 1);
+  coreModelHandle.reset();
+
+  cache.destroy();
+  coreAnimation.destroy();
+  coreModel.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strAnimationFilename.c_str());
+  std::remove(strCopyFilename.c_str());
+  std::remove(strModelFilename.c_str());
+}
+
+// Requests on several threads for the same file under two paths must share
+// one load.
+CT_TEST(concurrentRequestsShareOneLoad)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(20000, 16);
+
+  std::string strModelFilename = ctTempFilename("shared.cdf");
+  std::string strCopyFilename = ctTempFilename("shared-copy.cdf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strModelFilename, pCoreModel));
+  CT_CHECK(copyFile(strModelFilename, strCopyFilename));
+
+  CalAssetCache cache;
+  CT_CHECK(cache.create(0));
+
+  RequestThread arrayThread[REQUEST_THREAD_COUNT];
+  std::vector<std::thread> vectorThread;
+  int threadId;
+  for(threadId = 0; threadId < REQUEST_THREAD_COUNT; threadId++)
+  {
+    RequestThread& thread = arrayThread[threadId];
+    thread.pCache = &cache;
+    thread.pStrFilename = (threadId & 1) ? &strCopyFilename : &strModelFilename;
+    thread.pCoreModel = 0;
+    vectorThread.push_back(std::thread(runRequestThread, &thread));
+  }
+  for(threadId = 0; threadId < REQUEST_THREAD_COUNT; threadId++)
+  {
+    vectorThread[threadId].join();
+    CT_CHECK(arrayThread[threadId].pCoreModel != 0);
+    CT_CHECK(arrayThread[threadId].pCoreModel == arrayThread[0].pCoreModel);
+  }
+
+  CalAssetCache::Statistics statistics = cache.getStatistics();
+  CT_CHECK(statistics.requestCount == REQUEST_THREAD_COUNT);
+  CT_CHECK(statistics.loadCount == 1);
+  CT_CHECK(statistics.pathHitCount + statistics.contentHitCount + statistics.coalescedCount == REQUEST_THREAD_COUNT - 1);
+  CT_CHECK(statistics.referencedAssetCount == 0);
+  ctReport("%d path hits, %d content hits, %d coalesced", statistics.pathHitCount, statistics.contentHitCount, statistics.coalescedCount);
+
+  cache.destroy();
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strCopyFilename.c_str());
+  std::remove(strModelFilename.c_str());
+}
+
+//****************************************************************************//
@@ -0,0 +1,203 @@
+//****************************************************************************//
+// ct-formats.cpp                                                             //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  std::vector<char> readFile(const std::string& strFilename)
+  {
+    std::ifstream file(strFilename.c_str(), std::ios::in | std::ios::binary);
+    return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// A model file keeps the face and vertex order of the mesh optimizer.
+CT_TEST(optimizedModelSurvivesModelFile)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 8);
+
+  CalMeshOptimizer meshOptimizer;
+  CT_CHECK(meshOptimizer.optimizeCoreModel(pCoreModel));
+
+  std::string strFilename = ctTempFilename("optimized.cdf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strFilename, pCoreModel));
+
+  CalCoreModel coreModel;
+  coreModel.create("loaded");
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, strFilename));
+  CT_CHECK(ctSameCoreModel(pCoreModel, &coreModel));
+
+  coreModel.destroy();
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strFilename.c_str());
+}
+
+// A baked model file must load back into the same core model.
+CT_TEST(bakedModelRoundTrip)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 8);
+
+  std::string strFilename = ctTempFilename("baked.cbf");
+  CalSaver saver;
+  CT_CHECK(saver.saveBakedCoreModel(strFilename, pCoreModel));
+
+  CalCoreModel coreModel;
+  coreModel.create("loaded");
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, strFilename));
+  CT_CHECK(ctSameCoreModel(pCoreModel, &coreModel));
+
+  coreModel.destroy();
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strFilename.c_str());
+}
+
+// A baked animation file must load back into the same core animation.
+CT_TEST(bakedAnimationRoundTrip)
+{
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(4.0f, 8);
+
+  std::string strFilename = ctTempFilename("baked.cba");
+  CalSaver saver;
+  CT_CHECK(saver.saveBakedCoreAnimation(strFilename, pCoreAnimation));
+
+  CalCoreAnimation coreAnimation;
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimation, strFilename));
+  CT_CHECK(ctSameCoreAnimation(pCoreAnimation, &coreAnimation));
+
+  coreAnimation.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  std::remove(strFilename.c_str());
+}
+
+// An encoded model must load into the same core model as the file it was
+// encoded from.
+CT_TEST(encodedModelRoundTrip)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 8);
+
+  std::string strFilename = ctTempFilename("encoded.cdf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strFilename, pCoreModel));
+  std::vector<char> vectorFile = readFile(strFilename);
+  CT_CHECK(!vectorFile.empty());
+
+  std::vector<char> vectorEncoded;
+  CT_CHECK(CalEncoder::encodeBuffer(&vectorFile[0], (int)vectorFile.size(), vectorEncoded));
+  CT_CHECK(std::memcmp(&vectorEncoded[0], Cal::ENCODED_FILE_MAGIC, 4) == 0);
+
+  CalCoreModel coreModel;
+  CalCoreModel coreModelEncoded;
+  coreModel.create("loaded");
+  coreModelEncoded.create("encoded");
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, strFilename));
+  CT_CHECK(loader.loadCoreModel(&coreModelEncoded, &vectorEncoded[0], (int)vectorEncoded.size(), "encoded"));
+  CT_CHECK(ctSameCoreModel(&coreModel, &coreModelEncoded));
+
+  coreModelEncoded.destroy();
+  coreModel.destroy();
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strFilename.c_str());
+}
+
+// An encoded animation must load into the same core animation as the file it
+// was encoded from, and only by the library version that encoded it.
+CT_TEST(encodedAnimationRoundTrip)
+{
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(4.0f, 8);
+
+  std::string strFilename = ctTempFilename("encoded.caf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreAnimation(strFilename, pCoreAnimation));
+  std::vector<char> vectorFile = readFile(strFilename);
+  CT_CHECK(!vectorFile.empty());
+
+  std::vector<char> vectorEncoded;
+  CT_CHECK(CalEncoder::encodeBuffer(&vectorFile[0], (int)vectorFile.size(), vectorEncoded));
+
+  CalCoreAnimation coreAnimation;
+  CalCoreAnimation coreAnimationEncoded;
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimation, strFilename));
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimationEncoded, &vectorEncoded[0], (int)vectorEncoded.size(), "encoded"));
+  CT_CHECK(ctSameCoreAnimation(&coreAnimation, &coreAnimationEncoded));
+  coreAnimationEncoded.destroy();
+
+  // the reader version follows the version of the encoded file
+  vectorEncoded[8]++;
+  CT_CHECK(!loader.loadCoreAnimation(&coreAnimationEncoded, &vectorEncoded[0], (int)vectorEncoded.size(), "encoded"));
+  CT_CHECK(CalError::getLastErrorCode() == CalError::INCOMPATIBLE_FILE_VERSION);
+
+  coreAnimation.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  std::remove(strFilename.c_str());
+}
+
+// The encoder must write the whole file whatever the global loading mode, and
+// refuse files it can't read to their end.
+CT_TEST(encodingIgnoresLoadingMode)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(1000, 8);
+
+  std::string strFilename = ctTempFilename("mode.cdf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strFilename, pCoreModel));
+  std::vector<char> vectorFile = readFile(strFilename);
+  CT_CHECK(!vectorFile.empty());
+
+  CalLoader::setLoadingMode(LOADER_SKELETON_ONLY | LOADER_LAZY_TRACKS | LOADER_STREAM_TRACKS);
+  std::vector<char> vectorEncoded;
+  bool bEncoded = CalEncoder::encodeBuffer(&vectorFile[0], (int)vectorFile.size(), vectorEncoded);
+  CalLoader::setLoadingMode(0);
+  CT_CHECK(bEncoded);
+
+  CalCoreModel coreModel;
+  CalCoreModel coreModelEncoded;
+  coreModel.create("loaded");
+  coreModelEncoded.create("encoded");
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, strFilename));
+  CT_CHECK(loader.loadCoreModel(&coreModelEncoded, &vectorEncoded[0], (int)vectorEncoded.size(), "encoded"));
+  CT_CHECK(coreModelEncoded.getCoreSubmeshCount() == pCoreModel->getCoreSubmeshCount());
+  CT_CHECK(ctSameCoreModel(&coreModel, &coreModelEncoded));
+
+  // trailing bytes would be dropped from the encoded file
+  vectorFile.resize(vectorFile.size() + 16, 0);
+  CT_CHECK(!CalEncoder::encodeBuffer(&vectorFile[0], (int)vectorFile.size(), vectorEncoded));
+
+  coreModelEncoded.destroy();
+  coreModel.destroy();
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strFilename.c_str());
+}
+
+//****************************************************************************//
@@ -0,0 +1,455 @@
+//****************************************************************************//
+// ct-loading.cpp                                                             //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  const int LOADING_THREAD_COUNT = 8;
+  const int LOADS_PER_THREAD = 6;
+
+  /// The results of the loads of one thread.
+  struct LoadingThread
+  {
+    int threadId;
+    const std::string *pStrModelFilename;
+    const std::string *pStrAnimationFilename;
+    CalCoreModel *pCoreModel;
+    CalCoreAnimation *pCoreAnimation;
+    int failureCount;
+  };
+
+  /// Loads the files again and again, the odd threads the skeleton only.
+  void runLoadingThread(LoadingThread *pThread)
+  {
+    for(int loadId = 0; loadId < LOADS_PER_THREAD; loadId++)
+    {
+      CalLoader loader;
+      loader.setLoadingFlags((pThread->threadId & 1) ? LOADER_SKELETON_ONLY : 0);
+
+      CalCoreModel coreModel;
+      coreModel.create("loaded");
+      bool bLoaded = loader.loadCoreModel(&coreModel, *pThread->pStrModelFilename);
+      if(!bLoaded) pThread->failureCount++;
+      else if((pThread->threadId & 1) ? (coreModel.getCoreSubmeshCount() != 0) : !ctSameCoreModel(pThread->pCoreModel, &coreModel)) pThread->failureCount++;
+      coreModel.destroy();
+
+      CalCoreAnimation coreAnimation;
+      if(!loader.loadCoreAnimation(&coreAnimation, *pThread->pStrAnimationFilename)) pThread->failureCount++;
+      else if(!ctSameCoreAnimation(pThread->pCoreAnimation, &coreAnimation)) pThread->failureCount++;
+      coreAnimation.destroy();
+    }
+  }
+
+  /// What the completion callbacks of an asynchronous loader saw.
+  struct Completion
+  {
+    std::thread::id threadId;
+    std::vector<int> vectorRequestId;
+    std::vector<CalAsyncLoader::State> vectorState;
+    int otherThreadCount;
+  };
+
+  void complete(int requestId, CalAsyncLoader::State state, void *pUserData)
+  {
+    Completion *pCompletion = (Completion *)pUserData;
+    if(std::this_thread::get_id() != pCompletion->threadId) pCompletion->otherThreadCount++;
+    pCompletion->vectorRequestId.push_back(requestId);
+    pCompletion->vectorState.push_back(state);
+  }
+
+  void initCompletion(Completion& completion)
+  {
+    completion.threadId = std::this_thread::get_id();
+    completion.otherThreadCount = 0;
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// An asynchronous loader must load what a loader does, report failures with
+// the loader's error and run the callbacks on the thread that calls update().
+CT_TEST(asyncLoadsMatchLoad)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(2000, 8);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(4.0f, 8);
+
+  std::string strModelFilename = ctTempFilename("async.cdf");
+  std::string strAnimationFilename = ctTempFilename("async.caf");
+  std::string strMissingFilename = ctTempFilename("missing.cdf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strModelFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreAnimation(strAnimationFilename, pCoreAnimation));
+
+  CalCoreModel coreModel;
+  coreModel.create("loaded");
+  CalCoreAnimation coreAnimation;
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, strModelFilename));
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimation, strAnimationFilename));
+
+  Completion completion;
+  initCompletion(completion);
+
+  CalAsyncLoader asyncLoader;
+  CT_CHECK(asyncLoader.create(3));
+
+  const int LOAD_COUNT = 6;
+  CalCoreModel arrayCoreModel[LOAD_COUNT];
+  CalCoreAnimation arrayCoreAnimation[LOAD_COUNT];
+  int arrayModelRequestId[LOAD_COUNT];
+  int arrayAnimationRequestId[LOAD_COUNT];
+  int loadId;
+  for(loadId = 0; loadId < LOAD_COUNT; loadId++)
+  {
+    arrayCoreModel[loadId].create("async");
+    arrayModelRequestId[loadId] = asyncLoader.loadCoreModel(&arrayCoreModel[loadId], strModelFilename, 0, complete, &completion);
+    arrayAnimationRequestId[loadId] = asyncLoader.loadCoreAnimation(&arrayCoreAnimation[loadId], strAnimationFilename, loadId, complete, &completion);
+    CT_CHECK((arrayModelRequestId[loadId] != -1) && (arrayAnimationRequestId[loadId] != -1));
+  }
+
+  CalCoreModel coreModelMissing;
+  coreModelMissing.create("missing");
+  int missingRequestId = asyncLoader.loadCoreModel(&coreModelMissing, strMissingFilename, 0, complete, &completion);
+
+  for(loadId = 0; loadId < LOAD_COUNT; loadId++)
+  {
+    CT_CHECK(asyncLoader.wait(arrayModelRequestId[loadId]) == CalAsyncLoader::STATE_DONE);
+    CT_CHECK(asyncLoader.wait(arrayAnimationRequestId[loadId]) == CalAsyncLoader::STATE_DONE);
+    CT_CHECK(asyncLoader.getErrorCode(arrayModelRequestId[loadId]) == CalError::OK);
+    CT_CHECK(ctSameCoreModel(&coreModel, &arrayCoreModel[loadId]));
+    CT_CHECK(ctSameCoreAnimation(&coreAnimation, &arrayCoreAnimation[loadId]));
+  }
+  CT_CHECK(asyncLoader.wait(missingRequestId) == CalAsyncLoader::STATE_FAILED);
+  CT_CHECK(asyncLoader.getErrorCode(missingRequestId) == CalError::FILE_NOT_FOUND);
+  CT_CHECK(asyncLoader.getErrorText(missingRequestId) == strMissingFilename);
+  CT_CHECK(asyncLoader.getPendingCount() == 0);
+
+  // the callbacks only run in update(), once per request
+  CT_CHECK(completion.vectorRequestId.empty());
+  CT_CHECK(asyncLoader.update() == 2 * LOAD_COUNT + 1);
+  CT_CHECK((int)completion.vectorRequestId.size() == 2 * LOAD_COUNT + 1);
+  CT_CHECK(completion.otherThreadCount == 0);
+  CT_CHECK(asyncLoader.update() == 0);
+  CT_CHECK(asyncLoader.getState(missingRequestId) == CalAsyncLoader::STATE_NONE);
+  CT_CHECK(asyncLoader.wait(arrayModelRequestId[0]) == CalAsyncLoader::STATE_NONE);
+
+  asyncLoader.destroy();
+  CT_CHECK(asyncLoader.loadCoreModel(&coreModelMissing, strModelFilename) == -1);
+
+  for(loadId = 0; loadId < LOAD_COUNT; loadId++)
+  {
+    arrayCoreAnimation[loadId].destroy();
+    arrayCoreModel[loadId].destroy();
+  }
+  coreModelMissing.destroy();
+  coreAnimation.destroy();
+  coreModel.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strAnimationFilename.c_str());
+  std::remove(strModelFilename.c_str());
+}
+
+// A single loader thread must take the pending requests by priority, oldest
+// first, and cancelled requests must still be reported.
+CT_TEST(asyncLoaderKeepsPriorities)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(20000, 16);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(1.0f, 8);
+
+  std::string strModelFilename = ctTempFilename("priority.cdf");
+  std::string strAnimationFilename = ctTempFilename("priority.caf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strModelFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreAnimation(strAnimationFilename, pCoreAnimation));
+
+  Completion completion;
+  initCompletion(completion);
+
+  CalAsyncLoader asyncLoader;
+  CT_CHECK(asyncLoader.create(1));
+
+  // the big model keeps the loader thread busy while the others queue up
+  CalCoreModel coreModel;
+  coreModel.create("first");
+  int firstRequestId = asyncLoader.loadCoreModel(&coreModel, strModelFilename, 10, complete, &completion);
+
+  const int PRIORITY_COUNT = 5;
+  int arrayPriority[PRIORITY_COUNT] = { 0, 5, 1, 5, -1 };
+  CalCoreAnimation arrayCoreAnimation[PRIORITY_COUNT];
+  int arrayRequestId[PRIORITY_COUNT];
+  int priorityId;
+  for(priorityId = 0; priorityId < PRIORITY_COUNT; priorityId++)
+  {
+    arrayRequestId[priorityId] = asyncLoader.loadCoreAnimation(&arrayCoreAnimation[priorityId], strAnimationFilename, arrayPriority[priorityId], complete, &completion);
+  }
+
+  // the last one is dropped and the first one moved ahead of the 5s
+  CT_CHECK(asyncLoader.cancel(arrayRequestId[4]));
+  CT_CHECK(asyncLoader.getState(arrayRequestId[4]) == CalAsyncLoader::STATE_CANCELLED);
+  CT_CHECK(asyncLoader.setPriority(arrayRequestId[0], 7));
+
+  for(priorityId = 0; priorityId < PRIORITY_COUNT; priorityId++) asyncLoader.wait(arrayRequestId[priorityId]);
+  CT_CHECK(asyncLoader.wait(firstRequestId) == CalAsyncLoader::STATE_DONE);
+  CT_CHECK(!asyncLoader.cancel(firstRequestId));
+  CT_CHECK(!asyncLoader.setPriority(firstRequestId, 0));
+
+  CT_CHECK(asyncLoader.update() == PRIORITY_COUNT + 1);
+  int arrayOrder[PRIORITY_COUNT + 1] = { arrayRequestId[4], firstRequestId, arrayRequestId[0], arrayRequestId[1], arrayRequestId[3], arrayRequestId[2] };
+  CT_CHECK(completion.vectorRequestId == std::vector<int>(arrayOrder, arrayOrder + PRIORITY_COUNT + 1));
+  CT_CHECK(completion.vectorState[0] == CalAsyncLoader::STATE_CANCELLED);
+  CT_CHECK(arrayCoreAnimation[1].getListCoreTrack().size() == 8);
+
+  // destroying the loader reports the requests it drops
+  completion.vectorRequestId.clear();
+  completion.vectorState.clear();
+  int requestId = asyncLoader.loadCoreModel(&coreModel, strModelFilename, 0, complete, &completion);
+  asyncLoader.loadCoreAnimation(&arrayCoreAnimation[4], strAnimationFilename, 0, complete, &completion);
+  asyncLoader.destroy();
+  CT_CHECK(completion.vectorRequestId.size() == 2);
+  CT_CHECK(std::find(completion.vectorRequestId.begin(), completion.vectorRequestId.end(), requestId) != completion.vectorRequestId.end());
+  CT_CHECK(completion.otherThreadCount == 0);
+
+  for(priorityId = 0; priorityId < PRIORITY_COUNT; priorityId++) arrayCoreAnimation[priorityId].destroy();
+  coreModel.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strAnimationFilename.c_str());
+  std::remove(strModelFilename.c_str());
+}
+
+// Loaders on several threads must not see each other's loading flags, nor the
+// global loading mode, and must load what a single thread loads.
+CT_TEST(concurrentLoadsMatchSerial)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(2000, 8);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(4.0f, 8);
+
+  std::string strModelFilename = ctTempFilename("concurrent.cdf");
+  std::string strAnimationFilename = ctTempFilename("concurrent.caf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strModelFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreAnimation(strAnimationFilename, pCoreAnimation));
+
+  // the serial reference, which also takes the saver's rounding
+  CalCoreModel coreModel;
+  coreModel.create("serial");
+  CalCoreAnimation coreAnimation;
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, strModelFilename));
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimation, strAnimationFilename));
+
+  // the global mode only applies to loaders without flags of their own
+  CalLoader::setLoadingMode(LOADER_ROTATE_X_AXIS | LOADER_INVERT_V_COORD);
+
+  LoadingThread arrayThread[LOADING_THREAD_COUNT];
+  std::vector<std::thread> vectorThread;
+  int threadId;
+  for(threadId = 0; threadId < LOADING_THREAD_COUNT; threadId++)
+  {
+    LoadingThread& thread = arrayThread[threadId];
+    thread.threadId = threadId;
+    thread.pStrModelFilename = &strModelFilename;
+    thread.pStrAnimationFilename = &strAnimationFilename;
+    thread.pCoreModel = &coreModel;
+    thread.pCoreAnimation = &coreAnimation;
+    thread.failureCount = 0;
+    vectorThread.push_back(std::thread(runLoadingThread, &thread));
+  }
+  for(threadId = 0; threadId < LOADING_THREAD_COUNT; threadId++)
+  {
+    vectorThread[threadId].join();
+    CT_CHECK(arrayThread[threadId].failureCount == 0);
+  }
+
+  CalLoader::setLoadingMode(0);
+
+  coreAnimation.destroy();
+  coreModel.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strAnimationFilename.c_str());
+  std::remove(strModelFilename.c_str());
+}
+
+// A batch load must load every file like a single loader, and report the
+// files that fail by their error code.
+CT_TEST(batchLoadsMatchSerial)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(2000, 8);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(4.0f, 8);
+
+  std::string strModelFilename = ctTempFilename("batch.cdf");
+  std::string strAnimationFilename = ctTempFilename("batch.caf");
+  std::string strMissingFilename = ctTempFilename("missing.caf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strModelFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreAnimation(strAnimationFilename, pCoreAnimation));
+
+  CalCoreModel coreModel;
+  coreModel.create("serial");
+  CalCoreAnimation coreAnimation;
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, strModelFilename));
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimation, strAnimationFilename));
+
+  const int FILE_COUNT = 24;
+  CalCoreModel arrayCoreModel[FILE_COUNT];
+  CalCoreAnimation arrayCoreAnimation[FILE_COUNT];
+  std::vector<CalCoreModel *> vectorCoreModel;
+  std::vector<CalCoreAnimation *> vectorCoreAnimation;
+  std::vector<std::string> vectorModelFilename;
+  std::vector<std::string> vectorAnimationFilename;
+  int fileId;
+  for(fileId = 0; fileId < FILE_COUNT; fileId++)
+  {
+    arrayCoreModel[fileId].create("batch");
+    vectorCoreModel.push_back(&arrayCoreModel[fileId]);
+    vectorCoreAnimation.push_back(&arrayCoreAnimation[fileId]);
+    vectorModelFilename.push_back(strModelFilename);
+    vectorAnimationFilename.push_back((fileId == 5) ? strMissingFilename : strAnimationFilename);
+  }
+
+  std::vector<CalError::Code> vectorErrorCode;
+  CT_CHECK(loader.loadCoreModels(vectorCoreModel, vectorModelFilename, vectorErrorCode, 4) == FILE_COUNT);
+  CT_CHECK(vectorErrorCode.size() == FILE_COUNT);
+  for(fileId = 0; fileId < FILE_COUNT; fileId++)
+  {
+    CT_CHECK(vectorErrorCode[fileId] == CalError::OK);
+    CT_CHECK(ctSameCoreModel(&coreModel, &arrayCoreModel[fileId]));
+  }
+
+  CT_CHECK(loader.loadCoreAnimations(vectorCoreAnimation, vectorAnimationFilename, vectorErrorCode, 4) == FILE_COUNT - 1);
+  CT_CHECK(vectorErrorCode.size() == FILE_COUNT);
+  for(fileId = 0; fileId < FILE_COUNT; fileId++)
+  {
+    if(fileId == 5)
+    {
+      CT_CHECK(vectorErrorCode[fileId] == CalError::FILE_NOT_FOUND);
+      continue;
+    }
+    CT_CHECK(vectorErrorCode[fileId] == CalError::OK);
+    CT_CHECK(ctSameCoreAnimation(&coreAnimation, &arrayCoreAnimation[fileId]));
+  }
+  CT_CHECK(CalError::getLastErrorCode() == CalError::FILE_NOT_FOUND);
+
+  for(fileId = 0; fileId < FILE_COUNT; fileId++)
+  {
+    arrayCoreAnimation[fileId].destroy();
+    arrayCoreModel[fileId].destroy();
+  }
+  coreAnimation.destroy();
+  coreModel.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strAnimationFilename.c_str());
+  std::remove(strModelFilename.c_str());
+}
+
+// An incremental load in small steps must load what a one-shot load does,
+// with the loader's own flags rather than the global loading mode, and name
+// the file a piece failed in.
+CT_TEST(incrementalLoadMatchesLoad)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(2000, 8);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(4.0f, 8);
+
+  std::string strModelFilename = ctTempFilename("incremental.cdf");
+  std::string strSkeletonFilename = ctTempFilename("incremental.csf");
+  std::string strAnimationFilename = ctTempFilename("incremental.caf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strModelFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreSkeleton(strSkeletonFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreAnimation(strAnimationFilename, pCoreAnimation));
+
+  CalCoreModel coreModel;
+  coreModel.create("loaded");
+  CalCoreAnimation coreAnimation;
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, strModelFilename));
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimation, strAnimationFilename));
+
+  CalCoreModel coreModelIncremental;
+  coreModelIncremental.create("incremental");
+  CT_CHECK(loader.beginCoreModel(&coreModelIncremental, strModelFilename));
+  int stepCount = 0;
+  while(loader.step(256) == CalLoader::STATE_LOADING) stepCount++;
+  CT_CHECK(loader.getState() == CalLoader::STATE_DONE);
+  CT_CHECK(stepCount > 1);
+  CT_CHECK(ctSameCoreModel(&coreModel, &coreModelIncremental));
+
+  CalCoreAnimation coreAnimationIncremental;
+  CT_CHECK(loader.beginCoreAnimation(&coreAnimationIncremental, strAnimationFilename));
+  while(loader.step(256) == CalLoader::STATE_LOADING);
+  CT_CHECK(loader.getState() == CalLoader::STATE_DONE);
+  CT_CHECK(ctSameCoreAnimation(&coreAnimation, &coreAnimationIncremental));
+
+  // the flags are those the load was begun with, and the loader's own
+  // rather than the global mode
+  CalCoreAnimation coreAnimationStreamed;
+  CalLoader loaderStreamed;
+  loaderStreamed.setLoadingFlags(LOADER_LAZY_TRACKS | LOADER_STREAM_TRACKS);
+  CT_CHECK(loaderStreamed.beginCoreAnimation(&coreAnimationStreamed, strAnimationFilename));
+  loaderStreamed.setLoadingFlags(LOADER_LAZY_TRACKS);
+  while(loaderStreamed.step(256) == CalLoader::STATE_LOADING);
+  CT_CHECK(loaderStreamed.getState() == CalLoader::STATE_DONE);
+  CT_CHECK(coreAnimationStreamed.isStreamed());
+  CT_CHECK(!coreAnimationStreamed.isTrackDataLoaded());
+
+  CalCoreAnimation coreAnimationLoaded;
+  CalLoader::setLoadingMode(LOADER_LAZY_TRACKS | LOADER_STREAM_TRACKS);
+  CalLoader loaderLoaded;
+  loaderLoaded.setLoadingFlags(LOADER_INVERT_V_COORD);
+  CT_CHECK(loaderLoaded.beginCoreAnimation(&coreAnimationLoaded, strAnimationFilename));
+  while(loaderLoaded.step(256) == CalLoader::STATE_LOADING);
+  CalLoader::setLoadingMode(0);
+  CT_CHECK(loaderLoaded.getState() == CalLoader::STATE_DONE);
+  CT_CHECK(!coreAnimationLoaded.isLazy());
+  CT_CHECK(ctSameCoreAnimation(&coreAnimation, &coreAnimationLoaded));
+
+  // the model file is no mesh file
+  CalCoreModel coreModelFailed;
+  coreModelFailed.create("failed");
+  CT_CHECK(loader.beginCoreModel(&coreModelFailed, strSkeletonFilename, strModelFilename));
+  while(loader.step(0) == CalLoader::STATE_LOADING);
+  CT_CHECK(loader.getState() == CalLoader::STATE_FAILED);
+  CT_CHECK(CalError::getLastErrorCode() == CalError::INVALID_FILE_FORMAT);
+  CT_CHECK(CalError::getLastErrorText() == strModelFilename);
+  loader.cancel();
+
+  coreAnimationLoaded.destroy();
+  coreAnimationStreamed.destroy();
+  coreAnimationIncremental.destroy();
+  coreModelIncremental.destroy();
+  coreAnimation.destroy();
+  coreModel.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strAnimationFilename.c_str());
+  std::remove(strSkeletonFilename.c_str());
+  std::remove(strModelFilename.c_str());
+}
+
+//****************************************************************************//
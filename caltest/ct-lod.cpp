@@ -0,0 +1,251 @@
+//****************************************************************************//
+// ct-lod.cpp                                                                 //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  const int GRID_SIZE = 16;
+  const int SEAM_X = GRID_SIZE / 2;
+
+  /// Adds a bumpy square of GRID_SIZE x GRID_SIZE vertices. The column at
+  /// SEAM_X is doubled with other texture coordinates for the faces on its
+  /// right, like a texture seam, so its positions are shared.
+  CalCoreSubmesh *addGridSubmesh(CalCoreModel *pCoreModel)
+  {
+    int vertexCount = GRID_SIZE * GRID_SIZE + GRID_SIZE;
+    CalCoreSubmesh *pCoreSubmesh = pCoreModel->getCoreSubmesh(pCoreModel->addCoreSubmesh());
+    pCoreSubmesh->resize(vertexCount, 1, 2 * (GRID_SIZE - 1) * (GRID_SIZE - 1), 0);
+
+    std::vector<CalCoreSubmesh::Influence>& vectorInfluence = pCoreSubmesh->getVectorInfluence();
+    for(int vertexId = 0; vertexId < vertexCount; vertexId++)
+    {
+      bool bSeam = (vertexId >= GRID_SIZE * GRID_SIZE);
+      int x = bSeam ? SEAM_X : vertexId % GRID_SIZE;
+      int z = bSeam ? vertexId - GRID_SIZE * GRID_SIZE : vertexId / GRID_SIZE;
+
+      float height = 0.3f * std::sin(x * 0.7f) * std::cos(z * 0.5f);
+      pCoreSubmesh->setVertex(vertexId, CalVector((float)x, height, (float)z), CalVector(0.0f, 1.0f, 0.0f));
+      pCoreSubmesh->setInfluenceCount(vertexId, 1);
+
+      CalCoreSubmesh::Influence influence;
+      influence.boneId = (x < SEAM_X) ? 1 : 2;
+      influence.weight = 1.0f;
+      vectorInfluence.push_back(influence);
+
+      CalCoreSubmesh::TextureCoordinate textureCoordinate;
+      textureCoordinate.u = bSeam ? 0.0f : (float)x / (GRID_SIZE - 1);
+      textureCoordinate.v = (float)z / (GRID_SIZE - 1);
+      pCoreSubmesh->setTextureCoordinate(vertexId, 0, textureCoordinate);
+      pCoreSubmesh->setLodControl(vertexId, 0, -1);
+    }
+
+    int faceId = 0;
+    for(int z = 0; z < GRID_SIZE - 1; z++)
+    {
+      for(int x = 0; x < GRID_SIZE - 1; x++)
+      {
+        int vertexId[4] = { z * GRID_SIZE + x, z * GRID_SIZE + x + 1, (z + 1) * GRID_SIZE + x, (z + 1) * GRID_SIZE + x + 1 };
+        if(x == SEAM_X)
+        {
+          vertexId[0] = GRID_SIZE * GRID_SIZE + z;
+          vertexId[2] = GRID_SIZE * GRID_SIZE + z + 1;
+        }
+
+        CalCoreSubmesh::Face face0 = { { vertexId[0], vertexId[2], vertexId[1] } };
+        CalCoreSubmesh::Face face1 = { { vertexId[1], vertexId[2], vertexId[3] } };
+        pCoreSubmesh->setFace(faceId++, face0);
+        pCoreSubmesh->setFace(faceId++, face1);
+      }
+    }
+
+    return pCoreSubmesh;
+  }
+
+  /// Returns true if a vertex lies on the border of the grid or on its seam.
+  bool isBorderOrSeam(const CalVector& position)
+  {
+    return (position.x == 0.0f) || (position.x == GRID_SIZE - 1) || (position.z == 0.0f) || (position.z == GRID_SIZE - 1) || (position.x == SEAM_X);
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// The LOD builder must remove faces with every level, keep the border and
+// seam vertices and write a collapse table that the model file keeps.
+CT_TEST(lodBuilderKeepsBordersAndRoundTrips)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(0, 0);
+  CalCoreSubmesh *pCoreSubmesh = addGridSubmesh(pCoreModel);
+  size_t vertexCount = pCoreSubmesh->getVertexCount();
+  size_t faceCount = pCoreSubmesh->getFaceCount();
+
+  CalLodBuilder lodBuilder;
+  CT_CHECK(lodBuilder.buildCoreModel(pCoreModel));
+  CT_CHECK(pCoreSubmesh->getVertexCount() == vertexCount);
+  CT_CHECK(pCoreSubmesh->getFaceCount() == faceCount);
+  CT_CHECK(pCoreSubmesh->getLodCount() > 0);
+
+  // the border and seam vertices are all kept, ahead of the collapsed ones
+  size_t keptVertexCount = vertexCount - pCoreSubmesh->getLodCount();
+  int borderCount = 0;
+  size_t vertexId;
+  for(vertexId = 0; vertexId < vertexCount; vertexId++)
+  {
+    if(!isBorderOrSeam(pCoreSubmesh->getVectorVertex()[vertexId].position)) continue;
+    borderCount++;
+    CT_CHECK(vertexId < keptVertexCount);
+    CT_CHECK(pCoreSubmesh->getVectorLodControl()[vertexId].collapseId == -1);
+  }
+  CT_CHECK(borderCount == 6 * GRID_SIZE - 6);
+
+  // fewer levels never show more faces, and only faces of the kept vertices
+  CalModel model;
+  CT_CHECK(model.create(pCoreModel));
+  CalSubmesh *pSubmesh = model.getSubmesh(0);
+  std::vector<int> vectorFace(faceCount * 3);
+  size_t previousFaceCount = faceCount;
+  for(int level = 10; level >= 0; level--)
+  {
+    model.setLodLevel(level * 0.1f);
+    size_t lodFaceCount = pSubmesh->getFaces(&vectorFace[0], 0);
+    CT_CHECK(lodFaceCount == pSubmesh->getFaceCount());
+    CT_CHECK(lodFaceCount <= previousFaceCount);
+    previousFaceCount = lodFaceCount;
+
+    for(size_t faceId = 0; faceId < lodFaceCount; faceId++)
+    {
+      int *pVertexId = &vectorFace[faceId * 3];
+      CT_CHECK((pVertexId[0] != pVertexId[1]) && (pVertexId[1] != pVertexId[2]) && (pVertexId[0] != pVertexId[2]));
+      for(int cornerId = 0; cornerId < 3; cornerId++) CT_CHECK((size_t)pVertexId[cornerId] < pSubmesh->getVertexCount());
+    }
+  }
+  CT_CHECK(previousFaceCount < faceCount / 2);
+  ctReport("%d of %d faces at the lowest level", (int)previousFaceCount, (int)faceCount);
+  model.destroy();
+
+  // the collapse table and the steps come back from the model file
+  std::string strFilename = ctTempFilename("lod.cdf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strFilename, pCoreModel));
+
+  CalCoreModel coreModel;
+  coreModel.create("loaded");
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, strFilename));
+  CT_CHECK(ctSameCoreModel(pCoreModel, &coreModel));
+
+  CalCoreSubmesh *pCoreSubmeshLoaded = coreModel.getCoreSubmesh(0);
+  CT_CHECK(pCoreSubmeshLoaded->getLodCount() == pCoreSubmesh->getLodCount());
+  std::vector<CalCoreSubmesh::LodStep>& vectorLodStep = pCoreSubmesh->getVectorLodStep();
+  std::vector<CalCoreSubmesh::LodStep>& vectorLodStepLoaded = pCoreSubmeshLoaded->getVectorLodStep();
+  CT_CHECK(vectorLodStepLoaded.size() == vectorLodStep.size());
+  for(size_t lodStepId = 0; (lodStepId < vectorLodStep.size()) && (lodStepId < vectorLodStepLoaded.size()); lodStepId++)
+  {
+    CT_CHECK(vectorLodStepLoaded[lodStepId].vertexCount == vectorLodStep[lodStepId].vertexCount);
+    CT_CHECK(vectorLodStepLoaded[lodStepId].faceCount == vectorLodStep[lodStepId].faceCount);
+    if(vectorLodStepLoaded[lodStepId].faceCount != vectorLodStep[lodStepId].faceCount) continue;
+
+    CalCoreSubmesh::Face *pFace = pCoreSubmesh->getLodStepFaces(lodStepId);
+    CalCoreSubmesh::Face *pFaceLoaded = pCoreSubmeshLoaded->getLodStepFaces(lodStepId);
+    CT_CHECK((pFace == 0) == (pFaceLoaded == 0));
+    if(pFace && pFaceLoaded) CT_CHECK(std::memcmp(pFace, pFaceLoaded, vectorLodStep[lodStepId].faceCount * sizeof(CalCoreSubmesh::Face)) == 0);
+  }
+
+  coreModel.destroy();
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strFilename.c_str());
+}
+
+// Creating instances must only read the LOD steps of the core submesh, which
+// may be shared with instances on other threads; without steps an instance
+// shows all faces.
+CT_TEST(instancesOnlyReadLodSteps)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 0);
+  CalCoreSubmesh *pCoreSubmesh = pCoreModel->getCoreSubmesh(0);
+  size_t faceCount = pCoreSubmesh->getFaceCount();
+
+  // editing the lod control drops the steps
+  pCoreSubmesh->setLodCount(pCoreSubmesh->getLodCount());
+  CT_CHECK(pCoreSubmesh->getVectorLodStep().empty());
+
+  CalModel model;
+  CT_CHECK(model.create(pCoreModel));
+  CT_CHECK(pCoreSubmesh->getVectorLodStep().empty());
+  model.setLodLevel(0.5f);
+  CT_CHECK(model.getSubmesh(0)->getFaceCount() == faceCount);
+
+  std::vector<int> vectorFace(faceCount * 3);
+  CT_CHECK(model.getSubmesh(0)->getFaces(&vectorFace[0], 0) == faceCount);
+  CT_CHECK(model.getSubmesh(0)->getBufferedFaces() != 0);
+  model.destroy();
+
+  // once rebuilt, the steps are used again
+  CT_CHECK(pCoreSubmesh->buildLodSteps(CalCoreSubmesh::DEFAULT_LOD_STEP_COUNT));
+  CalModel modelRebuilt;
+  CT_CHECK(modelRebuilt.create(pCoreModel));
+  modelRebuilt.setLodLevel(0.5f);
+  CT_CHECK(modelRebuilt.getSubmesh(0)->getFaceCount() < faceCount);
+  modelRebuilt.destroy();
+
+  ctFreeCoreModel(pCoreModel);
+}
+
+// Instances that are not visible must not take detail away from the visible
+// ones.
+CT_TEST(invisibleInstancesLeaveBudgetAlone)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 0);
+  size_t faceCount = pCoreModel->getCoreSubmesh(0)->getFaceCount();
+
+  const int modelCount = 4;
+  CalModel arrayModel[modelCount];
+  CalLodManager lodManager;
+  lodManager.setTriangleBudget(faceCount);
+  lodManager.setVertexBudget(pCoreModel->getCoreSubmesh(0)->getVertexCount());
+
+  int modelId;
+  for(modelId = 0; modelId < modelCount; modelId++)
+  {
+    CT_CHECK(arrayModel[modelId].create(pCoreModel));
+    CT_CHECK(lodManager.addModel(&arrayModel[modelId]));
+    CT_CHECK(lodManager.setScreenSize(&arrayModel[modelId], (modelId == 0) ? 1.0f : 0.0f));
+  }
+
+  lodManager.update();
+  CT_CHECK(lodManager.getLodLevel(&arrayModel[0]) == 1.0f);
+  CT_CHECK(lodManager.getSkinningInterval(&arrayModel[0]) == 1);
+  CT_CHECK(lodManager.getStatistics().triangleCount == faceCount);
+  CT_CHECK(!lodManager.getStatistics().bOverBudget);
+
+  for(modelId = 0; modelId < modelCount; modelId++)
+  {
+    CT_CHECK(lodManager.removeModel(&arrayModel[modelId]));
+    arrayModel[modelId].destroy();
+  }
+  ctFreeCoreModel(pCoreModel);
+}
+
+//****************************************************************************//
@@ -0,0 +1,109 @@
+//****************************************************************************//
+// ct-main.cpp                                                                //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+//****************************************************************************//
+// Test runner                                                                //
+//****************************************************************************//
+
+namespace
+{
+  struct TestEntry
+  {
+    const char *strName;
+    CtTestFunction function;
+  };
+
+  /// The registered tests, filled by the static CtTest objects of each file.
+  std::vector<TestEntry>& getTests()
+  {
+    static std::vector<TestEntry> vectorTest;
+    return vectorTest;
+  }
+
+  int failureCount = 0;
+}
+
+CtTest::CtTest(const char *strName, CtTestFunction function)
+{
+  TestEntry entry;
+  entry.strName = strName;
+  entry.function = function;
+  getTests().push_back(entry);
+}
+
+void ctCheck(bool bCondition, const char *strCondition, const char *strFile, int line)
+{
+  if(bCondition) return;
+
+  std::printf("  check failed: %s in %s(%d)\n", strCondition, strFile, line);
+  failureCount++;
+}
+
+void ctReport(const char *strFormat, ...)
+{
+  std::va_list arguments;
+  va_start(arguments, strFormat);
+  std::printf("  ");
+  std::vprintf(strFormat, arguments);
+  std::printf("\n");
+  va_end(arguments);
+}
+
+double ctTime(void)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//****************************************************************************//
+// Main entry point of the test program                                       //
+//****************************************************************************//
+
+int main(int argc, char *argv[])
+{
+  // an argument runs only the tests whose name contains it
+  const char *strFilter = (argc > 1) ? argv[1] : "";
+
+  int testCount = 0;
+  int failedCount = 0;
+  std::vector<TestEntry>::iterator iteratorTest;
+  for(iteratorTest = getTests().begin(); iteratorTest != getTests().end(); ++iteratorTest)
+  {
+    if(std::strstr(iteratorTest->strName, strFilter) == 0) continue;
+
+    std::printf("%s\n", iteratorTest->strName);
+    std::fflush(stdout);
+
+    int previousFailureCount = failureCount;
+    double startTime = ctTime();
+    iteratorTest->function();
+    double time = ctTime() - startTime;
+
+    testCount++;
+    if(failureCount != previousFailureCount) failedCount++;
+    std::printf("  %s (%.1f ms)\n", (failureCount != previousFailureCount) ? "FAILED" : "ok", time * 1000.0);
+  }
+
+  std::printf("%d of %d tests passed\n", testCount - failedCount, testCount);
+
+  return (failedCount == 0) ? 0 : 1;
+}
+
+//****************************************************************************//
@@ -0,0 +1,157 @@
+//****************************************************************************//
+// ct-names.cpp                                                               //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <cstdio>
+#include <thread>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  const int NAMING_THREAD_COUNT = 8;
+  const int SHARED_NAME_COUNT = 500;
+
+  std::string getSharedName(int nameId)
+  {
+    char strName[48];
+    std::sprintf(strName, "caltest shared name %d", nameId);
+    return strName;
+  }
+
+  /// The IDs one thread got for the shared names, and the names it made up.
+  struct NamingThread
+  {
+    int threadId;
+    std::vector<int> vectorNameId;
+    std::vector<const std::string *> vectorName;
+  };
+
+  void runNamingThread(NamingThread *pThread)
+  {
+    pThread->vectorNameId.resize(SHARED_NAME_COUNT);
+    pThread->vectorName.resize(SHARED_NAME_COUNT);
+
+    // each thread walks the shared names in another order, with a stride
+    // coprime to their count, and adds one of its own in between
+    static const int arrayStride[NAMING_THREAD_COUNT] = { 1, 3, 7, 9, 11, 13, 17, 19 };
+    for(int stepId = 0; stepId < SHARED_NAME_COUNT; stepId++)
+    {
+      int nameId = (stepId * arrayStride[pThread->threadId] + 17 * pThread->threadId) % SHARED_NAME_COUNT;
+      pThread->vectorNameId[nameId] = CalNameTable::intern(getSharedName(nameId));
+      pThread->vectorName[nameId] = &CalNameTable::getName(pThread->vectorNameId[nameId]);
+
+      char strName[48];
+      std::sprintf(strName, "caltest thread %d name %d", pThread->threadId, stepId);
+      CalNameTable::intern(strName);
+    }
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// A name must be added to the name table once and always map to the same ID,
+// however it is passed in.
+CT_TEST(nameTableInternsOnce)
+{
+  const std::string strName = "caltest interned name";
+  CT_CHECK(CalNameTable::find(strName) == -1);
+
+  int nameCount = CalNameTable::getNameCount();
+  int nameId = CalNameTable::intern(strName);
+  CT_CHECK(CalNameTable::getNameCount() == nameCount + 1);
+  CT_CHECK(CalNameTable::find(strName) == nameId);
+  CT_CHECK(CalNameTable::getName(nameId) == strName);
+
+  // the same characters without a trailing zero
+  std::string strLonger = strName + " and more";
+  CT_CHECK(CalNameTable::intern(strLonger.c_str(), (int)strName.size()) == nameId);
+  CT_CHECK(CalNameTable::intern(strName) == nameId);
+  CT_CHECK(CalNameTable::getNameCount() == nameCount + 1);
+
+  // names differ in every character, including zeros
+  const char arrayName[] = { 'c', 'a', 'l', 0, 'x' };
+  int zeroNameId = CalNameTable::intern(arrayName, 5);
+  CT_CHECK(zeroNameId != CalNameTable::intern(arrayName, 3));
+  CT_CHECK(CalNameTable::getName(zeroNameId) == std::string(arrayName, 5));
+  CT_CHECK(CalNameTable::intern(arrayName, 0) == CalNameTable::intern(""));
+  CT_CHECK(CalNameTable::intern(arrayName, -1) == CalNameTable::intern(""));
+
+  CT_CHECK(CalNameTable::getName(-1).empty());
+  CT_CHECK(CalNameTable::getName(CalNameTable::getNameCount()).empty());
+}
+
+// Threads interning the same names must get the same IDs, and the names must
+// stay where they are while the table grows.
+CT_TEST(concurrentInternsAgree)
+{
+  int nameCount = CalNameTable::getNameCount();
+
+  NamingThread arrayThread[NAMING_THREAD_COUNT];
+  std::vector<std::thread> vectorThread;
+  int threadId;
+  for(threadId = 0; threadId < NAMING_THREAD_COUNT; threadId++)
+  {
+    arrayThread[threadId].threadId = threadId;
+    vectorThread.push_back(std::thread(runNamingThread, &arrayThread[threadId]));
+  }
+  for(threadId = 0; threadId < NAMING_THREAD_COUNT; threadId++) vectorThread[threadId].join();
+
+  CT_CHECK(CalNameTable::getNameCount() == nameCount + SHARED_NAME_COUNT * (NAMING_THREAD_COUNT + 1));
+
+  for(int nameId = 0; nameId < SHARED_NAME_COUNT; nameId++)
+  {
+    int sharedNameId = arrayThread[0].vectorNameId[nameId];
+    CT_CHECK(CalNameTable::find(getSharedName(nameId)) == sharedNameId);
+    for(threadId = 0; threadId < NAMING_THREAD_COUNT; threadId++)
+    {
+      CT_CHECK(arrayThread[threadId].vectorNameId[nameId] == sharedNameId);
+      CT_CHECK(arrayThread[threadId].vectorName[nameId] == &CalNameTable::getName(sharedNameId));
+    }
+    CT_CHECK(*arrayThread[0].vectorName[nameId] == getSharedName(nameId));
+  }
+}
+
+// Core bones and core tracks must refer to their names by the same IDs, so
+// a track binds to the bone of its name.
+CT_TEST(bonesAndTracksShareNameIds)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(0, 0);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(1.0f, 8);
+
+  std::list<CalCoreTrack *>::iterator iteratorCoreTrack = pCoreAnimation->getListCoreTrack().begin();
+  for(int boneId = 0; boneId < 8; boneId++, ++iteratorCoreTrack)
+  {
+    char strName[16];
+    std::sprintf(strName, "bone%d", boneId);
+
+    CalCoreBone *pCoreBone = pCoreModel->getCoreBone(boneId);
+    CT_CHECK(pCoreBone->getNameId() == CalNameTable::find(strName));
+    CT_CHECK(pCoreBone->getName() == strName);
+    CT_CHECK(pCoreModel->getCoreBoneId(strName) == boneId);
+    CT_CHECK((*iteratorCoreTrack)->getCoreBoneNameId() == pCoreBone->getNameId());
+    CT_CHECK((*iteratorCoreTrack)->getCoreBoneName() == strName);
+  }
+  CT_CHECK(pCoreModel->getCoreBoneId("caltest missing bone") == -1);
+
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+}
+
+//****************************************************************************//
@@ -0,0 +1,163 @@
+//****************************************************************************//
+// ct-optimizer.cpp                                                           //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <algorithm>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  const int GRID_SIZE = 24;
+
+  /// A face given by the positions of its corners, turned so that the
+  /// smallest one comes first and the winding is kept.
+  struct PositionFace
+  {
+    float position[9];
+
+    bool operator<(const PositionFace& face) const
+    {
+      return std::lexicographical_compare(position, position + 9, face.position, face.position + 9);
+    }
+
+    bool operator==(const PositionFace& face) const
+    {
+      return std::equal(position, position + 9, face.position);
+    }
+  };
+
+  bool positionLess(const CalVector& a, const CalVector& b)
+  {
+    if(a.x != b.x) return a.x < b.x;
+    if(a.y != b.y) return a.y < b.y;
+    return a.z < b.z;
+  }
+
+  std::vector<PositionFace> getPositionFaces(CalCoreSubmesh *pCoreSubmesh)
+  {
+    std::vector<CalCoreSubmesh::Vertex>& vectorVertex = pCoreSubmesh->getVectorVertex();
+    std::vector<CalCoreSubmesh::Face>& vectorFace = pCoreSubmesh->getVectorFace();
+
+    std::vector<PositionFace> vectorPositionFace(vectorFace.size());
+    for(size_t faceId = 0; faceId < vectorFace.size(); faceId++)
+    {
+      CalVector position[3];
+      int firstId = 0;
+      for(int cornerId = 0; cornerId < 3; cornerId++)
+      {
+        position[cornerId] = vectorVertex[vectorFace[faceId].vertexId[cornerId]].position;
+        if(positionLess(position[cornerId], position[firstId])) firstId = cornerId;
+      }
+
+      for(int cornerId = 0; cornerId < 3; cornerId++)
+      {
+        const CalVector& cornerPosition = position[(firstId + cornerId) % 3];
+        vectorPositionFace[faceId].position[cornerId * 3] = cornerPosition.x;
+        vectorPositionFace[faceId].position[cornerId * 3 + 1] = cornerPosition.y;
+        vectorPositionFace[faceId].position[cornerId * 3 + 2] = cornerPosition.z;
+      }
+    }
+
+    std::sort(vectorPositionFace.begin(), vectorPositionFace.end());
+    return vectorPositionFace;
+  }
+
+  /// Adds a square of GRID_SIZE x GRID_SIZE vertices whose faces come in a
+  /// scrambled order, like from an exporter that does not care for the cache.
+  CalCoreSubmesh *addScrambledGridSubmesh(CalCoreModel *pCoreModel)
+  {
+    int vertexCount = GRID_SIZE * GRID_SIZE;
+    int faceCount = 2 * (GRID_SIZE - 1) * (GRID_SIZE - 1);
+    CalCoreSubmesh *pCoreSubmesh = pCoreModel->getCoreSubmesh(pCoreModel->addCoreSubmesh());
+    pCoreSubmesh->resize(vertexCount, 1, faceCount, 0);
+
+    std::vector<CalCoreSubmesh::Influence>& vectorInfluence = pCoreSubmesh->getVectorInfluence();
+    for(int vertexId = 0; vertexId < vertexCount; vertexId++)
+    {
+      int x = vertexId % GRID_SIZE;
+      int z = vertexId / GRID_SIZE;
+      pCoreSubmesh->setVertex(vertexId, CalVector((float)x, 0.0f, (float)z), CalVector(0.0f, 1.0f, 0.0f));
+      pCoreSubmesh->setInfluenceCount(vertexId, 1);
+
+      CalCoreSubmesh::Influence influence;
+      influence.boneId = x % 4;
+      influence.weight = 1.0f;
+      vectorInfluence.push_back(influence);
+
+      CalCoreSubmesh::TextureCoordinate textureCoordinate;
+      textureCoordinate.u = (float)x / (GRID_SIZE - 1);
+      textureCoordinate.v = (float)z / (GRID_SIZE - 1);
+      pCoreSubmesh->setTextureCoordinate(vertexId, 0, textureCoordinate);
+      pCoreSubmesh->setLodControl(vertexId, 0, -1);
+    }
+
+    std::vector<CalCoreSubmesh::Face> vectorFace;
+    for(int z = 0; z < GRID_SIZE - 1; z++)
+    {
+      for(int x = 0; x < GRID_SIZE - 1; x++)
+      {
+        int vertexId = z * GRID_SIZE + x;
+        CalCoreSubmesh::Face face0 = { { vertexId, vertexId + GRID_SIZE, vertexId + 1 } };
+        CalCoreSubmesh::Face face1 = { { vertexId + 1, vertexId + GRID_SIZE, vertexId + GRID_SIZE + 1 } };
+        vectorFace.push_back(face0);
+        vectorFace.push_back(face1);
+      }
+    }
+
+    // a fixed stride through the faces, which is coprime to their count
+    for(int faceId = 0; faceId < faceCount; faceId++)
+    {
+      pCoreSubmesh->setFace(faceId, vectorFace[(faceId * 337) % faceCount]);
+    }
+
+    return pCoreSubmesh;
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// The mesh optimizer must keep the faces of a mesh and lower the number of
+// vertex cache misses per face.
+CT_TEST(optimizerKeepsFacesAndLowersAcmr)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(0, 0);
+  CalCoreSubmesh *pCoreSubmesh = addScrambledGridSubmesh(pCoreModel);
+  CT_CHECK(pCoreSubmesh->buildLodSteps(CalCoreSubmesh::DEFAULT_LOD_STEP_COUNT));
+
+  std::vector<PositionFace> vectorPositionFace = getPositionFaces(pCoreSubmesh);
+  size_t faceCount = pCoreSubmesh->getFaceCount();
+
+  CalMeshOptimizer meshOptimizer;
+  float acmrBefore = (float)CalMeshOptimizer::calculateCacheMissCount(&pCoreSubmesh->getVectorFace()[0], faceCount, meshOptimizer.getCacheSize()) / faceCount;
+  CT_CHECK(meshOptimizer.optimizeCoreSubmesh(pCoreSubmesh));
+
+  CT_CHECK(pCoreSubmesh->getFaceCount() == faceCount);
+  CT_CHECK(getPositionFaces(pCoreSubmesh) == vectorPositionFace);
+
+  float acmrAfter = (float)CalMeshOptimizer::calculateCacheMissCount(&pCoreSubmesh->getVectorFace()[0], faceCount, meshOptimizer.getCacheSize()) / faceCount;
+  ctReport("ACMR %.3f before, %.3f after", acmrBefore, acmrAfter);
+  CT_CHECK(meshOptimizer.getAcmrBefore() == acmrBefore);
+  CT_CHECK(meshOptimizer.getAcmrAfter() == acmrAfter);
+  CT_CHECK(acmrAfter < 0.8f * acmrBefore);
+
+  ctFreeCoreModel(pCoreModel);
+}
+
+//****************************************************************************//
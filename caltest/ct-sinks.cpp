@@ -0,0 +1,183 @@
+//****************************************************************************//
+// ct-sinks.cpp                                                               //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+#include "buffersink.h"
+#include "streamsink.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  /// A data sink that takes a given number of bytes and fails after that.
+  class FailingSink : public CalDataSink
+  {
+  public:
+    FailingSink(size_t maxSize) : m_maxSize(maxSize), m_size(0), m_bFailed(false) {}
+
+    virtual bool ok() const { return !m_bFailed; }
+    virtual void setError() const { CalError::setLastError(CalError::FILE_WRITING_FAILED, __FILE__, __LINE__); }
+
+    virtual bool writeBytes(const void *pBuffer, int length)
+    {
+      if(m_bFailed || (m_size + length > m_maxSize))
+      {
+        m_bFailed = true;
+        return false;
+      }
+      m_size += length;
+      return true;
+    }
+
+  private:
+    size_t m_maxSize;
+    size_t m_size;
+    bool m_bFailed;
+  };
+
+  std::vector<char> readFile(const std::string& strFilename)
+  {
+    std::ifstream file(strFilename.c_str(), std::ios::in | std::ios::binary);
+    return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  }
+
+  /// Saves an object into a file, a buffer sink behind some bytes and a
+  /// stream sink, and returns true if all three hold the same bytes.
+  template<class Object>
+  bool sameInAllSinks(bool (CalSaver::*pSaveFile)(const std::string&, Object *), bool (CalSaver::*pSaveSink)(CalDataSink&, Object *), Object *pObject, const std::string& strFilename)
+  {
+    CalSaver saver;
+    if(!(saver.*pSaveFile)(strFilename, pObject)) return false;
+    std::vector<char> vectorFile = readFile(strFilename);
+    std::remove(strFilename.c_str());
+
+    // the buffer sink appends to what is already in the buffer
+    std::vector<char> vectorBuffer(3, 'x');
+    CalBufferSink bufferSink(vectorBuffer);
+    if(!(saver.*pSaveSink)(bufferSink, pObject)) return false;
+    if(std::string(vectorBuffer.begin(), vectorBuffer.begin() + 3) != "xxx") return false;
+    vectorBuffer.erase(vectorBuffer.begin(), vectorBuffer.begin() + 3);
+
+    std::ostringstream stream(std::ios::out | std::ios::binary);
+    CalStreamSink streamSink(stream);
+    if(!(saver.*pSaveSink)(streamSink, pObject)) return false;
+    std::string strStream = stream.str();
+
+    return !vectorFile.empty() && (vectorBuffer == vectorFile) && (std::vector<char>(strStream.begin(), strStream.end()) == vectorFile);
+  }
+
+  /// Returns true if saving into sinks that fail anywhere before the end of
+  /// the file fails with the error of the sink.
+  template<class Object>
+  bool failsWithSink(bool (CalSaver::*pSaveSink)(CalDataSink&, Object *), Object *pObject)
+  {
+    CalSaver saver;
+    std::vector<char> vectorBuffer;
+    CalBufferSink bufferSink(vectorBuffer);
+    if(!(saver.*pSaveSink)(bufferSink, pObject) || (vectorBuffer.size() < 32)) return false;
+
+    size_t arrayMaxSize[] = { 0, 16, vectorBuffer.size() / 2, vectorBuffer.size() - 1 };
+    for(size_t maxSizeId = 0; maxSizeId < sizeof(arrayMaxSize) / sizeof(arrayMaxSize[0]); maxSizeId++)
+    {
+      FailingSink failingSink(arrayMaxSize[maxSizeId]);
+      CalError::setLastError(CalError::OK, __FILE__, __LINE__);
+      if((saver.*pSaveSink)(failingSink, pObject)) return false;
+      if(CalError::getLastErrorCode() != CalError::FILE_WRITING_FAILED) return false;
+    }
+
+    return true;
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// Every file the saver writes must come out the same through a file, a buffer
+// sink and a stream sink, and the skeleton and mesh files must load back into
+// the core model.
+CT_TEST(sinksMatchFiles)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(20000, 16);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(4.0f, 8);
+
+  CT_CHECK(sameInAllSinks(&CalSaver::saveCoreModel, &CalSaver::saveCoreModel, pCoreModel, ctTempFilename("sink.cdf")));
+  CT_CHECK(sameInAllSinks(&CalSaver::saveCoreSkeleton, &CalSaver::saveCoreSkeleton, pCoreModel, ctTempFilename("sink.csf")));
+  CT_CHECK(sameInAllSinks(&CalSaver::saveCoreMesh, &CalSaver::saveCoreMesh, pCoreModel, ctTempFilename("sink.cmf")));
+  CT_CHECK(sameInAllSinks(&CalSaver::saveBakedCoreModel, &CalSaver::saveBakedCoreModel, pCoreModel, ctTempFilename("sink.cbf")));
+  CT_CHECK(sameInAllSinks(&CalSaver::saveCoreAnimation, &CalSaver::saveCoreAnimation, pCoreAnimation, ctTempFilename("sink.caf")));
+  CT_CHECK(sameInAllSinks(&CalSaver::saveBakedCoreAnimation, &CalSaver::saveBakedCoreAnimation, pCoreAnimation, ctTempFilename("sink.cba")));
+
+  std::vector<char> vectorModel;
+  std::vector<char> vectorSkeleton;
+  std::vector<char> vectorMesh;
+  CalBufferSink modelSink(vectorModel);
+  CalBufferSink skeletonSink(vectorSkeleton);
+  CalBufferSink meshSink(vectorMesh);
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(modelSink, pCoreModel));
+  CT_CHECK(saver.saveCoreSkeleton(skeletonSink, pCoreModel));
+  CT_CHECK(saver.saveCoreMesh(meshSink, pCoreModel));
+
+  CalCoreModel coreModel;
+  coreModel.create("model");
+  CalCoreModel coreModelPair;
+  coreModelPair.create("pair");
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModel, &vectorModel[0], (int)vectorModel.size(), "sink.cdf"));
+  CT_CHECK(loader.loadCoreModel(&coreModelPair, &vectorSkeleton[0], (int)vectorSkeleton.size(), "sink.csf", &vectorMesh[0], (int)vectorMesh.size(), "sink.cmf"));
+  CT_CHECK(ctSameCoreModel(&coreModel, &coreModelPair));
+
+  coreModelPair.destroy();
+  coreModel.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+}
+
+// Saving must stop at the first failed write, with the error of the sink, and
+// never write into a sink that is not ok.
+CT_TEST(failingSinksFailSaves)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(20000, 16);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(4.0f, 8);
+
+  CT_CHECK(failsWithSink(&CalSaver::saveCoreModel, pCoreModel));
+  CT_CHECK(failsWithSink(&CalSaver::saveCoreSkeleton, pCoreModel));
+  CT_CHECK(failsWithSink(&CalSaver::saveCoreMesh, pCoreModel));
+  CT_CHECK(failsWithSink(&CalSaver::saveBakedCoreModel, pCoreModel));
+  CT_CHECK(failsWithSink(&CalSaver::saveCoreAnimation, pCoreAnimation));
+  CT_CHECK(failsWithSink(&CalSaver::saveBakedCoreAnimation, pCoreAnimation));
+
+  std::ostringstream stream(std::ios::out | std::ios::binary);
+  stream.setstate(std::ios::badbit);
+  CalStreamSink streamSink(stream);
+  CalSaver saver;
+  CT_CHECK(!saver.saveCoreModel(streamSink, pCoreModel));
+  CT_CHECK(stream.str().empty());
+
+  CT_CHECK(!saver.saveCoreModel(ctTempFilename("missing/directory.cdf"), pCoreModel));
+  CT_CHECK(CalError::getLastErrorCode() == CalError::FILE_CREATION_FAILED);
+
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+}
+
+//****************************************************************************//
@@ -0,0 +1,195 @@
+//****************************************************************************//
+// ct-skeleton.cpp                                                            //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  std::vector<char> readFile(const std::string& strFilename)
+  {
+    std::ifstream file(strFilename.c_str(), std::ios::in | std::ios::binary);
+    return std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  }
+
+  /// Returns true if two core models have the same core bones.
+  bool sameCoreSkeleton(CalCoreModel *pCoreModelA, CalCoreModel *pCoreModelB)
+  {
+    if(pCoreModelA->getCoreBoneCount() != pCoreModelB->getCoreBoneCount()) return false;
+
+    for(int boneId = 0; boneId < pCoreModelA->getCoreBoneCount(); boneId++)
+    {
+      CalCoreBone *pCoreBoneA = pCoreModelA->getCoreBone(boneId);
+      CalCoreBone *pCoreBoneB = pCoreModelB->getCoreBone(boneId);
+      if(pCoreBoneA->getNameId() != pCoreBoneB->getNameId()) return false;
+      if(pCoreBoneA->getParentId() != pCoreBoneB->getParentId()) return false;
+      if(pCoreBoneA->getListChildId() != pCoreBoneB->getListChildId()) return false;
+      if(std::memcmp(&pCoreBoneA->getTranslation(), &pCoreBoneB->getTranslation(), sizeof(CalVector)) != 0) return false;
+      if(std::memcmp(&pCoreBoneA->getRotation(), &pCoreBoneB->getRotation(), sizeof(CalQuaternion)) != 0) return false;
+    }
+
+    return true;
+  }
+
+  /// Returns true if two models hold the same absolute bone transforms.
+  bool sameSkeleton(CalModel *pModelA, CalModel *pModelB)
+  {
+    if(pModelA->getBoneCount() != pModelB->getBoneCount()) return false;
+
+    for(int boneId = 0; boneId < pModelA->getBoneCount(); boneId++)
+    {
+      CalBone *pBoneA = pModelA->getBone(boneId);
+      CalBone *pBoneB = pModelB->getBone(boneId);
+      if(std::memcmp(&pBoneA->getTranslationAbsolute(), &pBoneB->getTranslationAbsolute(), sizeof(CalVector)) != 0) return false;
+      if(std::memcmp(&pBoneA->getRotationAbsolute(), &pBoneB->getRotationAbsolute(), sizeof(CalQuaternion)) != 0) return false;
+    }
+
+    return true;
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// A skeleton-only instance of a core model with meshes must pose its bones
+// like a full instance, and a full instance that mimics it must skin the same
+// vertices as one posed on its own.
+CT_TEST(skeletonOnlyModelPosesLikeFullModel)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 8);
+
+  CalModel model;
+  CalModel modelSkeleton;
+  CalModel modelMimic;
+  CT_CHECK(model.create(pCoreModel));
+  CT_CHECK(modelSkeleton.create(pCoreModel, MODEL_SKELETON_ONLY));
+  CT_CHECK(modelMimic.create(pCoreModel));
+  CT_CHECK(!model.isSkeletonOnly());
+  CT_CHECK(modelSkeleton.isSkeletonOnly());
+  CT_CHECK(modelSkeleton.getSubmeshCount() == 0);
+  CT_CHECK(modelSkeleton.getBoneCount() == pCoreModel->getCoreBoneCount());
+  model.getSubmesh(0)->enableInternalData();
+  modelMimic.getSubmesh(0)->enableInternalData();
+
+  // the mesh functions have nothing to do
+  modelSkeleton.setLodLevel(0.5f);
+  modelSkeleton.updateSpringSystem(0.02f);
+  modelSkeleton.updateVertices();
+
+  float difference = 0.0f;
+  for(int frame = 0; frame < 20; frame++)
+  {
+    ctPose(&model, frame);
+    ctPose(&modelSkeleton, frame);
+    CT_CHECK(sameSkeleton(&model, &modelSkeleton));
+
+    CT_CHECK(modelMimic.mimicSkeleton(&modelSkeleton));
+    CT_CHECK(sameSkeleton(&model, &modelMimic));
+
+    model.updateVertices();
+    modelMimic.updateVertices();
+    difference = std::max(difference, ctMaxDifference(model.getSubmesh(0)->getVectorVertex(), modelMimic.getSubmesh(0)->getVectorVertex()));
+  }
+  CT_CHECK(difference == 0.0f);
+
+  // and the other way around
+  CT_CHECK(modelSkeleton.mimicSkeleton(&model));
+  CT_CHECK(sameSkeleton(&model, &modelSkeleton));
+
+  modelMimic.destroy();
+  modelSkeleton.destroy();
+  model.destroy();
+  ctFreeCoreModel(pCoreModel);
+}
+
+// Skeleton-only loads of every model format must load the bones of a full
+// load and no submeshes.
+CT_TEST(skeletonOnlyLoadsSkipMeshes)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 8);
+
+  std::string strModelFilename = ctTempFilename("skeleton.cdf");
+  std::string strSkeletonFilename = ctTempFilename("skeleton.csf");
+  std::string strMeshFilename = ctTempFilename("skeleton.cmf");
+  std::string strBakedFilename = ctTempFilename("skeleton.cbf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreModel(strModelFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreSkeleton(strSkeletonFilename, pCoreModel));
+  CT_CHECK(saver.saveCoreMesh(strMeshFilename, pCoreModel));
+  CT_CHECK(saver.saveBakedCoreModel(strBakedFilename, pCoreModel));
+
+  std::vector<char> vectorModel = readFile(strModelFilename);
+  std::vector<char> vectorEncoded;
+  CT_CHECK(!vectorModel.empty() && CalEncoder::encodeBuffer(&vectorModel[0], (int)vectorModel.size(), vectorEncoded));
+
+  CalCoreModel coreModelFull;
+  coreModelFull.create("full");
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreModel(&coreModelFull, strModelFilename));
+  CT_CHECK(coreModelFull.getCoreSubmeshCount() == pCoreModel->getCoreSubmeshCount());
+
+  CalLoader loaderSkeleton;
+  loaderSkeleton.setLoadingFlags(LOADER_SKELETON_ONLY);
+  for(int formatId = 0; formatId < 4; formatId++)
+  {
+    CalCoreModel coreModel;
+    coreModel.create("skeleton only");
+
+    bool bLoaded;
+    if(formatId == 0) bLoaded = loaderSkeleton.loadCoreModel(&coreModel, strModelFilename);
+    else if(formatId == 1) bLoaded = loaderSkeleton.loadCoreModel(&coreModel, strSkeletonFilename, strMeshFilename);
+    else if(formatId == 2) bLoaded = loaderSkeleton.loadCoreModel(&coreModel, strBakedFilename);
+    else bLoaded = loaderSkeleton.loadCoreModel(&coreModel, &vectorEncoded[0], (int)vectorEncoded.size(), "encoded");
+
+    CT_CHECK(bLoaded);
+    CT_CHECK(sameCoreSkeleton(&coreModelFull, &coreModel));
+    CT_CHECK(coreModel.getCoreSubmeshCount() == 0);
+
+    // a full instance of a skeleton-only core model is fine too
+    CalModel model;
+    CT_CHECK(model.create(&coreModel));
+    CT_CHECK(model.getSubmeshCount() == 0);
+    ctPose(&model, 3);
+    model.updateVertices();
+    model.destroy();
+
+    coreModel.destroy();
+  }
+
+  // the mesh file of a pair is not even opened
+  CalCoreModel coreModel;
+  coreModel.create("no mesh");
+  CT_CHECK(loaderSkeleton.loadCoreModel(&coreModel, strSkeletonFilename, ctTempFilename("missing.cmf")));
+  CT_CHECK(sameCoreSkeleton(&coreModelFull, &coreModel));
+  CT_CHECK(coreModel.getCoreSubmeshCount() == 0);
+
+  coreModel.destroy();
+  coreModelFull.destroy();
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strBakedFilename.c_str());
+  std::remove(strMeshFilename.c_str());
+  std::remove(strSkeletonFilename.c_str());
+  std::remove(strModelFilename.c_str());
+}
+
+//****************************************************************************//
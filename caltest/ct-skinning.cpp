@@ -0,0 +1,153 @@
+//****************************************************************************//
+// ct-skinning.cpp                                                            //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <algorithm>
+#include <cmath>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  float maxDifference(const float *pBufferA, const float *pBufferB, size_t count)
+  {
+    float maxDifference = 0.0f;
+    for(size_t id = 0; id < count; id++) maxDifference = std::max(maxDifference, std::fabs(pBufferA[id] - pBufferB[id]));
+    return maxDifference;
+  }
+
+  /// Returns the largest difference between the buffered data of two submeshes.
+  float maxBufferedDifference(CalSubmesh *pSubmeshA, CalSubmesh *pSubmeshB)
+  {
+    size_t vertexCount = pSubmeshA->getVertexCount();
+    if(vertexCount != pSubmeshB->getVertexCount()) return 1e30f;
+
+    float difference = maxDifference(pSubmeshA->getBufferedVertices(), pSubmeshB->getBufferedVertices(), vertexCount * 3);
+    difference = std::max(difference, maxDifference(pSubmeshA->getBufferedNormals(), pSubmeshB->getBufferedNormals(), vertexCount * 3));
+    if(pSubmeshA->getCoreSubmesh()->tangentsEnabled(0))
+    {
+      difference = std::max(difference, maxDifference(pSubmeshA->getBufferedTangentSpaces(0), pSubmeshB->getBufferedTangentSpaces(0), vertexCount * 4));
+    }
+
+    return difference;
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// The skinning pipeline must produce the same vertices as the synchronous
+// update.
+CT_TEST(pipelinedSkinningMatchesSynchronous)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 0);
+
+  CalModel modelSynchronous;
+  CalModel modelPipelined;
+  CT_CHECK(modelSynchronous.create(pCoreModel));
+  CT_CHECK(modelPipelined.create(pCoreModel));
+  modelSynchronous.getSubmesh(0)->enableInternalData();
+  modelPipelined.getSubmesh(0)->enableInternalData();
+  modelPipelined.enableSkinningPipeline(true);
+  CT_CHECK(modelPipelined.isSkinningPipelineEnabled());
+
+  float difference = 0.0f;
+  for(int frame = 0; frame < 50; frame++)
+  {
+    ctPose(&modelSynchronous, frame);
+    modelSynchronous.updateVertices();
+
+    ctPose(&modelPipelined, frame);
+    modelPipelined.beginUpdateVertices();
+    modelPipelined.endUpdateVertices();
+
+    difference = std::max(difference, maxBufferedDifference(modelSynchronous.getSubmesh(0), modelPipelined.getSubmesh(0)));
+  }
+  CT_CHECK(difference == 0.0f);
+
+  modelPipelined.destroy();
+  modelSynchronous.destroy();
+  ctFreeCoreModel(pCoreModel);
+}
+
+// The buffered vertices must match a direct call to the skinning kernels.
+CT_TEST(bufferedSkinningMatchesDirect)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 0);
+
+  CalModel model;
+  CT_CHECK(model.create(pCoreModel));
+  CalSubmesh *pSubmesh = model.getSubmesh(0);
+  pSubmesh->enableInternalData();
+  ctPose(&model, 17);
+  model.updateVertices();
+
+  size_t vertexCount = pSubmesh->getVertexCount();
+  std::vector<float> vectorVertex(vertexCount * 3);
+  std::vector<float> vectorNormal(vertexCount * 3);
+  CT_CHECK(pSubmesh->calculateVN(&vectorVertex[0], &vectorNormal[0]) == vertexCount);
+  CT_CHECK(maxDifference(pSubmesh->getBufferedVertices(), &vectorVertex[0], vertexCount * 3) == 0.0f);
+  CT_CHECK(maxDifference(pSubmesh->getBufferedNormals(), &vectorNormal[0], vertexCount * 3) == 0.0f);
+
+  model.destroy();
+  ctFreeCoreModel(pCoreModel);
+}
+
+// Blending once per influence set, only for the sets of the current lod
+// level, must give the same result as blending every vertex on its own.
+CT_TEST(influenceSetSkinningMatchesPerVertex)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(3000, 0);
+  CalCoreModel *pCoreModelPerVertex = ctMakeCoreModel(3000, 0);
+  CT_CHECK(pCoreModel->getCoreSubmesh(0)->getInfluenceSetCount() > 0);
+
+  // without the set table, the kernels blend every vertex on its own
+  pCoreModelPerVertex->getCoreSubmesh(0)->getVectorVertexInfluenceSet().clear();
+
+  CalModel model;
+  CalModel modelPerVertex;
+  CT_CHECK(model.create(pCoreModel));
+  CT_CHECK(modelPerVertex.create(pCoreModelPerVertex));
+  model.getSubmesh(0)->enableInternalData();
+  modelPerVertex.getSubmesh(0)->enableInternalData();
+
+  float difference = 0.0f;
+  const float arrayLodLevel[] = { 1.0f, 0.5f, 0.1f, 0.75f };
+  for(int frame = 0; frame < 20; frame++)
+  {
+    float lodLevel = arrayLodLevel[frame % 4];
+    model.setLodLevel(lodLevel);
+    modelPerVertex.setLodLevel(lodLevel);
+    CT_CHECK(model.getSubmesh(0)->getVertexCount() == modelPerVertex.getSubmesh(0)->getVertexCount());
+
+    ctPose(&model, frame);
+    ctPose(&modelPerVertex, frame);
+    model.updateVertices();
+    modelPerVertex.updateVertices();
+
+    difference = std::max(difference, maxBufferedDifference(model.getSubmesh(0), modelPerVertex.getSubmesh(0)));
+  }
+  CT_CHECK(difference < 1e-5f);
+
+  modelPerVertex.destroy();
+  model.destroy();
+  ctFreeCoreModel(pCoreModelPerVertex);
+  ctFreeCoreModel(pCoreModel);
+}
+
+//****************************************************************************//
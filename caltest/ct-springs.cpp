@@ -0,0 +1,159 @@
+//****************************************************************************//
+// ct-springs.cpp                                                             //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  /// Runs the cloth of a model for a number of frames and returns the time.
+  double runCloth(CalModel *pModel, int frameCount, std::vector<CalVector>& vectorVertex)
+  {
+    double startTime = ctTime();
+    for(int frame = 0; frame < frameCount; frame++)
+    {
+      ctPose(pModel, frame);
+      pModel->updateSpringSystem(1.0f / 30.0f);
+      pModel->updateVertices();
+    }
+    double time = ctTime() - startTime;
+
+    CalSubmesh *pSubmesh = pModel->getSubmesh(0);
+    const float *pVertex = pSubmesh->getBufferedVertices();
+    vectorVertex.resize(pSubmesh->getVertexCount());
+    for(size_t vertexId = 0; vertexId < vectorVertex.size(); vertexId++)
+    {
+      vectorVertex[vertexId].set(pVertex[3 * vertexId], pVertex[3 * vertexId + 1], pVertex[3 * vertexId + 2]);
+    }
+
+    return time;
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// Relaxing the springs on the pooled threads must give the same cloth as
+// relaxing them on the calling thread. The springs of a batch share no
+// vertices, so the result does not depend on how the batches are split.
+CT_TEST(threadedSpringsMatchSerial)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(0, 48);
+  CT_CHECK((int)pCoreModel->getCoreSubmesh(0)->getSpringCount() > 4 * 512);
+
+  CalModel modelSerial;
+  CalModel modelThreaded;
+  CT_CHECK(modelSerial.create(pCoreModel));
+  CT_CHECK(modelThreaded.create(pCoreModel));
+
+  CalModel *arrayModel[] = { &modelSerial, &modelThreaded };
+  for(int modelId = 0; modelId < 2; modelId++)
+  {
+    CalSubmesh *pSubmesh = arrayModel[modelId]->getSubmesh(0);
+    pSubmesh->enableInternalData();
+    pSubmesh->setSpringIterationCount(8);
+    pSubmesh->setSpringTolerance(1e-5f);
+  }
+  modelThreaded.getSubmesh(0)->setSpringThreadCount(4);
+
+  // run both three times: the second run reuses the pooled threads, the
+  // third starts them again after they were stopped
+  std::vector<CalVector> vectorVertexSerial, vectorVertexThreaded;
+  for(int runId = 0; runId < 3; runId++)
+  {
+    if(runId == 2) CalSubmesh::stopSpringThreads();
+
+    double serialTime = runCloth(&modelSerial, 30, vectorVertexSerial);
+    double threadedTime = runCloth(&modelThreaded, 30, vectorVertexThreaded);
+    ctReport("run %d: serial %.1f ms, threaded %.1f ms", runId + 1, serialTime * 1000.0, threadedTime * 1000.0);
+
+    CT_CHECK(ctMaxDifference(vectorVertexSerial, vectorVertexThreaded) == 0.0f);
+    CT_CHECK(modelSerial.getSubmesh(0)->getSpringIterationsUsed() == modelThreaded.getSubmesh(0)->getSpringIterationsUsed());
+  }
+
+  modelThreaded.destroy();
+  modelSerial.destroy();
+  ctFreeCoreModel(pCoreModel);
+}
+
+// Creating instances must only read the spring batches of the core submesh;
+// without batches the springs are relaxed one by one.
+CT_TEST(instancesOnlyReadSpringBatches)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(0, 8);
+  CalCoreSubmesh *pCoreSubmesh = pCoreModel->getCoreSubmesh(0);
+
+  // editing a spring drops the batches
+  CT_CHECK(pCoreSubmesh->setSpring(0, pCoreSubmesh->getVectorSpring()[0]));
+  CT_CHECK(pCoreSubmesh->getVectorSpringBatch().empty());
+
+  CalModel model;
+  CT_CHECK(model.create(pCoreModel));
+  CT_CHECK(pCoreSubmesh->getVectorSpringBatch().empty());
+  model.getSubmesh(0)->enableInternalData();
+
+  std::vector<CalVector> vectorVertex;
+  runCloth(&model, 10, vectorVertex);
+  CT_CHECK(pCoreSubmesh->getVectorSpringBatch().empty());
+  CT_CHECK(model.getSubmesh(0)->getSpringIterationsUsed() == model.getSubmesh(0)->getSpringIterationCount());
+  CT_CHECK(!vectorVertex.empty());
+
+  model.destroy();
+  ctFreeCoreModel(pCoreModel);
+}
+
+// The spring system only falls asleep on updates that let time elapse, and
+// measures nothing without a sleep threshold.
+CT_TEST(springSleepNeedsElapsedTime)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(0, 8);
+
+  CalModel model;
+  CT_CHECK(model.create(pCoreModel));
+  CalSubmesh *pSubmesh = model.getSubmesh(0);
+  pSubmesh->enableInternalData();
+
+  int updateId;
+  ctPose(&model, 0);
+  for(updateId = 0; updateId < 10; updateId++)
+  {
+    model.updateSpringSystem(1.0f / 30.0f);
+    model.updateVertices();
+  }
+  CT_CHECK(pSubmesh->getSpringEnergy() == 0.0f);
+
+  pSubmesh->setSpringSleepThreshold(1e30f);
+  for(updateId = 0; updateId < 100; updateId++)
+  {
+    model.updateSpringSystem(0.0f);
+    model.updateVertices();
+  }
+  CT_CHECK(!pSubmesh->isSpringSystemAsleep());
+
+  for(updateId = 0; (updateId < 100) && !pSubmesh->isSpringSystemAsleep(); updateId++)
+  {
+    model.updateSpringSystem(1.0f / 30.0f);
+    model.updateVertices();
+  }
+  CT_CHECK(pSubmesh->isSpringSystemAsleep());
+
+  model.destroy();
+  ctFreeCoreModel(pCoreModel);
+}
+
+//****************************************************************************//
@@ -0,0 +1,206 @@
+//****************************************************************************//
+// ct-streaming.cpp                                                           //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "ct-test.h"
+
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+//****************************************************************************//
+// Local helpers                                                              //
+//****************************************************************************//
+
+namespace
+{
+  const int PLAYER_COUNT = 6;
+  const int FRAMES_PER_PLAYER = 120;
+
+  /// A model playing a streamed core animation at its own time.
+  struct Player
+  {
+    int playerId;
+    CalCoreModel *pCoreModel;
+    CalCoreAnimation *pCoreAnimation;
+    CalCoreAnimation *pCoreAnimationStreamed;
+    int failureCount;
+  };
+
+  void blend(CalModel *pModel, CalCoreAnimation *pCoreAnimation, float time)
+  {
+    pModel->clearState();
+    pModel->blendState(pCoreAnimation, 1.0f, time);
+    pModel->lockState();
+    pModel->calculateState();
+  }
+
+  /// Returns true if two models hold the same bone states.
+  bool samePose(CalModel *pModelA, CalModel *pModelB)
+  {
+    for(int boneId = 0; boneId < pModelA->getBoneCount(); boneId++)
+    {
+      CalBone *pBoneA = pModelA->getBone(boneId);
+      CalBone *pBoneB = pModelB->getBone(boneId);
+      const CalVector& translationA = pBoneA->getTranslation();
+      const CalVector& translationB = pBoneB->getTranslation();
+      if(translationA.x != translationB.x || translationA.y != translationB.y || translationA.z != translationB.z) return false;
+
+      const CalQuaternion& rotationA = pBoneA->getRotation();
+      const CalQuaternion& rotationB = pBoneB->getRotation();
+      if(rotationA.x != rotationB.x || rotationA.y != rotationB.y || rotationA.z != rotationB.z || rotationA.w != rotationB.w) return false;
+    }
+
+    return true;
+  }
+
+  /// Plays the streamed core animation from its own start time and speed,
+  /// jumping now and then, next to the fully loaded one.
+  void runPlayer(Player *pPlayer)
+  {
+    CalModel model;
+    CalModel modelStreamed;
+    if(!model.create(pPlayer->pCoreModel) || !modelStreamed.create(pPlayer->pCoreModel))
+    {
+      pPlayer->failureCount++;
+      return;
+    }
+
+    float duration = pPlayer->pCoreAnimation->getDuration();
+    float time = 0.7f * pPlayer->playerId;
+    for(int frame = 0; frame < FRAMES_PER_PLAYER; frame++)
+    {
+      time = std::fmod(time + 0.02f * (1 + pPlayer->playerId % 3), duration);
+      if(frame % 40 == 39) time = std::fmod(time + 1.9f, duration);
+
+      blend(&model, pPlayer->pCoreAnimation, time);
+      blend(&modelStreamed, pPlayer->pCoreAnimationStreamed, time);
+      if(!samePose(&model, &modelStreamed)) pPlayer->failureCount++;
+    }
+
+    modelStreamed.destroy();
+    model.destroy();
+  }
+
+  bool loadStreamed(CalCoreAnimation *pCoreAnimation, const std::string& strFilename)
+  {
+    CalLoader loader;
+    loader.setLoadingFlags(LOADER_LAZY_TRACKS | LOADER_STREAM_TRACKS);
+    if(!loader.loadCoreAnimation(pCoreAnimation, strFilename)) return false;
+    return pCoreAnimation->setChunkDuration(0.25f);
+  }
+}
+
+//****************************************************************************//
+// Tests                                                                      //
+//****************************************************************************//
+
+// Players of one streamed core animation at different times, on several
+// threads, must see the keyframes of the fully loaded core animation.
+CT_TEST(streamedPlayersMatchLoaded)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(0, 0);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(6.0f, 8);
+
+  std::string strFilename = ctTempFilename("streamed.caf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreAnimation(strFilename, pCoreAnimation));
+
+  CalCoreAnimation coreAnimation;
+  CalCoreAnimation coreAnimationStreamed;
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimation, strFilename));
+  CT_CHECK(loadStreamed(&coreAnimationStreamed, strFilename));
+  CT_CHECK(coreAnimationStreamed.isStreamed());
+
+  Player arrayPlayer[PLAYER_COUNT];
+  std::vector<std::thread> vectorThread;
+  int playerId;
+  for(playerId = 0; playerId < PLAYER_COUNT; playerId++)
+  {
+    Player& player = arrayPlayer[playerId];
+    player.playerId = playerId;
+    player.pCoreModel = pCoreModel;
+    player.pCoreAnimation = &coreAnimation;
+    player.pCoreAnimationStreamed = &coreAnimationStreamed;
+    player.failureCount = 0;
+    vectorThread.push_back(std::thread(runPlayer, &player));
+  }
+  for(playerId = 0; playerId < PLAYER_COUNT; playerId++)
+  {
+    vectorThread[playerId].join();
+    CT_CHECK(arrayPlayer[playerId].failureCount == 0);
+  }
+
+  // the players never bring in the whole core animation
+  CT_CHECK(!coreAnimationStreamed.isTrackDataLoaded());
+
+  coreAnimationStreamed.destroy();
+  coreAnimation.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strFilename.c_str());
+}
+
+// Saving a streamed core animation must write all keyframes and leave it
+// streaming, with its keyframes out of memory.
+CT_TEST(savingStreamedAnimationKeepsStreaming)
+{
+  CalCoreModel *pCoreModel = ctMakeCoreModel(0, 0);
+  CalCoreAnimation *pCoreAnimation = ctMakeCoreAnimation(4.0f, 8);
+
+  std::string strFilename = ctTempFilename("streamed.caf");
+  std::string strSavedFilename = ctTempFilename("resaved.caf");
+  CalSaver saver;
+  CT_CHECK(saver.saveCoreAnimation(strFilename, pCoreAnimation));
+
+  CalCoreAnimation coreAnimation;
+  CalCoreAnimation coreAnimationStreamed;
+  CalLoader loader;
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimation, strFilename));
+  CT_CHECK(loadStreamed(&coreAnimationStreamed, strFilename));
+
+  CT_CHECK(saver.saveCoreAnimation(strSavedFilename, &coreAnimationStreamed));
+  CT_CHECK(coreAnimationStreamed.isStreamed());
+  CT_CHECK(!coreAnimationStreamed.isTrackDataLoaded());
+
+  CalCoreAnimation coreAnimationSaved;
+  CT_CHECK(loader.loadCoreAnimation(&coreAnimationSaved, strSavedFilename));
+  CT_CHECK(ctSameCoreAnimation(&coreAnimation, &coreAnimationSaved));
+
+  // and it still plays from its chunks
+  CalModel model;
+  CalModel modelStreamed;
+  CT_CHECK(model.create(pCoreModel));
+  CT_CHECK(modelStreamed.create(pCoreModel));
+  for(int frame = 0; frame < 30; frame++)
+  {
+    float time = 0.13f * frame;
+    blend(&model, &coreAnimation, time);
+    blend(&modelStreamed, &coreAnimationStreamed, time);
+    CT_CHECK(samePose(&model, &modelStreamed));
+  }
+  CT_CHECK(!coreAnimationStreamed.isTrackDataLoaded());
+
+  modelStreamed.destroy();
+  model.destroy();
+  coreAnimationSaved.destroy();
+  coreAnimationStreamed.destroy();
+  coreAnimation.destroy();
+  ctFreeCoreAnimation(pCoreAnimation);
+  ctFreeCoreModel(pCoreModel);
+  std::remove(strSavedFilename.c_str());
+  std::remove(strFilename.c_str());
+}
+
+//****************************************************************************//
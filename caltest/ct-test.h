@@ -0,0 +1,60 @@
+//****************************************************************************//
+// ct-test.h                                                                  //
+// Copyright (C) 2001, 2002 Bruno 'Beosil' Heidelberger                       //
+//****************************************************************************//
+// This program is free software; you can redistribute it and/or modify it    //
+// under the terms of the GNU General Public License as published by the Free //
+// Software Foundation; either version 2 of the License, or (at your option)  //
+// any later version.                                                         //
+//****************************************************************************//
+
+#ifndef CT_TEST_H
+#define CT_TEST_H
+
+//****************************************************************************//
+// Includes                                                                   //
+//****************************************************************************//
+
+#include "cal3d.h"
+
+#include <string>
+#include <vector>
+
+//****************************************************************************//
+// Test registration                                                          //
+//****************************************************************************//
+
+typedef void (*CtTestFunction)(void);
+
+/// Registers a test with the runner in ct-main.cpp.
+struct CtTest
+{
+  CtTest(const char *strName, CtTestFunction function);
+};
+
+void ctCheck(bool bCondition, const char *strCondition, const char *strFile, int line);
+void ctReport(const char *strFormat, ...);
+double ctTime(void);
+
+#define CT_TEST(name) static void name(void); static CtTest name##Registration(#name, name); static void name(void)
+#define CT_CHECK(condition) ctCheck((condition), #condition, __FILE__, __LINE__)
+
+//****************************************************************************//
+// Test assets                                                                //
+//****************************************************************************//
+
+CalCoreModel *ctMakeCoreModel(int vertexCount, int clothSize);
+CalCoreAnimation *ctMakeCoreAnimation(float duration, int trackCount);
+void ctFreeCoreModel(CalCoreModel *pCoreModel);
+void ctFreeCoreAnimation(CalCoreAnimation *pCoreAnimation);
+
+bool ctSameCoreModel(CalCoreModel *pCoreModelA, CalCoreModel *pCoreModelB);
+bool ctSameCoreAnimation(CalCoreAnimation *pCoreAnimationA, CalCoreAnimation *pCoreAnimationB);
+float ctMaxDifference(const std::vector<CalVector>& vectorA, const std::vector<CalVector>& vectorB);
+void ctPose(CalModel *pModel, int frame);
+
+std::string ctTempFilename(const std::string& strName);
+
+#endif
+
+//****************************************************************************//